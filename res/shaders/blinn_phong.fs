@@ -13,7 +13,14 @@ in vec2 TexCoords;
 
 uniform sampler2D floorTexture;
 uniform vec3 lightPos;
-uniform vec3 viewPos;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
 uniform bool blinn;
 
 uniform Light light;
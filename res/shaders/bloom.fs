@@ -1,15 +1,30 @@
 #version 330 core
-layout (location = 0) out vec4 FragColor;
-layout (location = 1) out vec4 BrightColor;
+out vec4 FragColor;
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-uniform vec3 lightPositions[4];
-uniform vec3 lightColors[4];
+struct Light {
+    vec3 Position;
+    float Linear;
+    vec3 Color;
+    float Quadratic;
+};
+
+layout (std140) uniform Lights
+{
+    Light lights[32];
+    int lightCount;
+};
 uniform sampler2D diffuseTexture;
-uniform vec3 viewPos;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
 
 void main()
 {           
@@ -22,24 +37,19 @@ void main()
     vec3 lighting = vec3(0.0);
     vec3 viewDir = normalize(viewPos - FragPos);
 
-    for (int i = 0; i < 4; i++) {
+    for (int i = 0; i < lightCount; i++) {
         // diffuse
-        vec3 lightDir = normalize(lightPositions[i] - FragPos);
+        vec3 lightDir = normalize(lights[i].Position - FragPos);
         float diff = max(dot(lightDir, normal), 0.0);
-        vec3 result = lightColors[i] * diff * color;      
+        vec3 result = lights[i].Color * diff * color;      
 
         // attenuation (use quadratic as we have gamma correction)
-        float distance = length(FragPos - lightPositions[i]);
+        float distance = length(FragPos - lights[i].Position);
         result *= 1.0 / (distance * distance);
         lighting += result;
     }
     vec3 result = ambient + lighting;
 
-    // check whether result is higher than some threshold, if so, output as bloom threshold color
-    float brightness = dot(result, vec3(0.2126, 0.7152, 0.0722));
-    if(brightness > 5.0)
-        BrightColor = vec4(result, 1.0);
-    else
-        BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
+    // the bright parts are extracted by the first bloom downsample, not here
     FragColor = vec4(result, 1.0);
 }
\ No newline at end of file
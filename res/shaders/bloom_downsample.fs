@@ -0,0 +1,73 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D sourceTexture;
+uniform bool prefilter; // first level: bright-pass and Karis average, reading the full-resolution HDR scene
+uniform float threshold;
+uniform float knee;     // width of the soft transition below the threshold
+
+float Luminance(vec3 color)
+{
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Keeps the part of the color above the threshold, with a quadratic curve in [threshold - knee, threshold + knee]
+vec3 BrightPass(vec3 color)
+{
+    float brightness = Luminance(color);
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 0.00001);
+    float contribution = max(soft, brightness - threshold) / max(brightness, 0.00001);
+    return color * contribution;
+}
+
+// Weighting each 2x2 box by 1 / (1 + luma) keeps single very bright pixels from flickering as the camera moves
+vec3 KarisAverage(vec3 a, vec3 b, vec3 c, vec3 d)
+{
+    vec4 sum = vec4(0.0);
+    sum += vec4(a, 1.0) / (1.0 + Luminance(a));
+    sum += vec4(b, 1.0) / (1.0 + Luminance(b));
+    sum += vec4(c, 1.0) / (1.0 + Luminance(c));
+    sum += vec4(d, 1.0) / (1.0 + Luminance(d));
+    return sum.rgb / sum.a;
+}
+
+// 13 bilinear taps covering a 6x6 source texel footprint as five overlapping 2x2 boxes (one centered, four in the
+// corners), a box filter with a wider support that does not shimmer when halving the resolution
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(sourceTexture, 0));
+
+    vec3 a = texture(sourceTexture, TexCoords + texel * vec2(-2.0,  2.0)).rgb;
+    vec3 b = texture(sourceTexture, TexCoords + texel * vec2( 0.0,  2.0)).rgb;
+    vec3 c = texture(sourceTexture, TexCoords + texel * vec2( 2.0,  2.0)).rgb;
+    vec3 d = texture(sourceTexture, TexCoords + texel * vec2(-2.0,  0.0)).rgb;
+    vec3 e = texture(sourceTexture, TexCoords).rgb;
+    vec3 f = texture(sourceTexture, TexCoords + texel * vec2( 2.0,  0.0)).rgb;
+    vec3 g = texture(sourceTexture, TexCoords + texel * vec2(-2.0, -2.0)).rgb;
+    vec3 h = texture(sourceTexture, TexCoords + texel * vec2( 0.0, -2.0)).rgb;
+    vec3 i = texture(sourceTexture, TexCoords + texel * vec2( 2.0, -2.0)).rgb;
+    vec3 j = texture(sourceTexture, TexCoords + texel * vec2(-1.0,  1.0)).rgb;
+    vec3 k = texture(sourceTexture, TexCoords + texel * vec2( 1.0,  1.0)).rgb;
+    vec3 l = texture(sourceTexture, TexCoords + texel * vec2(-1.0, -1.0)).rgb;
+    vec3 m = texture(sourceTexture, TexCoords + texel * vec2( 1.0, -1.0)).rgb;
+
+    vec3 result;
+    if (prefilter) {
+        result = KarisAverage(j, k, l, m) * 0.5;
+        result += KarisAverage(a, b, d, e) * 0.125;
+        result += KarisAverage(b, c, e, f) * 0.125;
+        result += KarisAverage(d, e, g, h) * 0.125;
+        result += KarisAverage(e, f, h, i) * 0.125;
+        result = BrightPass(result);
+    }
+    else {
+        result = e * 0.125;
+        result += (a + c + g + i) * 0.03125;
+        result += (b + d + f + h) * 0.0625;
+        result += (j + k + l + m) * 0.125;
+    }
+    FragColor = vec4(max(result, 0.0001), 1.0);
+}
@@ -5,9 +5,14 @@ in vec2 TexCoords;
 
 uniform sampler2D scene;
 uniform sampler2D bloomBlur;
+uniform float bloomStrength;
 
-uniform bool bloom;
-uniform float exposure;
+layout (std140) uniform PostParams
+{
+    float exposure;
+    int bloom;
+    int hdr;
+};
 
 void main()
 {
@@ -15,8 +20,8 @@ void main()
 	vec3 hdrColor = texture(scene, TexCoords).rgb;
 	vec3 bloomColor = texture(bloomBlur, TexCoords).rgb;
 
-	if (bloom) 
-	    hdrColor += 1.0f * bloomColor; // additive blending
+	if (bloom != 0) 
+	    hdrColor += bloomStrength * bloomColor; // additive blending
     
     // tone mapping
     vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
@@ -0,0 +1,24 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D sourceTexture; // the next smaller level, already combined with everything below it
+uniform float filterRadius;      // in source texels
+
+// 3x3 tent filter from 9 bilinear taps, blended additively onto the level this pass renders into
+void main()
+{
+    vec2 offset = filterRadius / vec2(textureSize(sourceTexture, 0));
+
+    vec3 result = texture(sourceTexture, TexCoords).rgb * 4.0;
+    result += (texture(sourceTexture, TexCoords + vec2(-offset.x, 0.0)).rgb +
+               texture(sourceTexture, TexCoords + vec2( offset.x, 0.0)).rgb +
+               texture(sourceTexture, TexCoords + vec2(0.0, -offset.y)).rgb +
+               texture(sourceTexture, TexCoords + vec2(0.0,  offset.y)).rgb) * 2.0;
+    result += texture(sourceTexture, TexCoords + vec2(-offset.x, -offset.y)).rgb +
+              texture(sourceTexture, TexCoords + vec2( offset.x, -offset.y)).rgb +
+              texture(sourceTexture, TexCoords + vec2(-offset.x,  offset.y)).rgb +
+              texture(sourceTexture, TexCoords + vec2( offset.x,  offset.y)).rgb;
+    FragColor = vec4(result / 16.0, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D gAlbedoSpec;
+
+// Ambient term of the light-volume mode, the volumes add each light on top of it
+void main()
+{
+	FragColor = vec4(vec3(0.3f) * texture(gAlbedoSpec, TexCoords).rgb, 1.0f);
+}
@@ -0,0 +1,6 @@
+#version 330 core
+
+// Stencil-only pass of the light volumes: depth and stencil do all the work, no color is written
+void main()
+{
+}
@@ -0,0 +1,81 @@
+#version 330 core
+out vec4 FragColor;
+
+flat in int lightTexel;
+
+#ifdef PACKED_GBUFFER
+uniform sampler2D gDepth;  // world positions are rebuilt from it
+uniform sampler2D gNormal; // octahedral-encoded
+#else
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+#endif
+uniform sampler2D gAlbedoSpec;
+uniform samplerBuffer lightData;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
+
+#ifdef PACKED_GBUFFER
+vec3 WorldPosition(ivec2 pixel)
+{
+	vec2 uv = (vec2(pixel) + 0.5f) / vec2(textureSize(gDepth, 0));
+	vec4 position = inverseProjection * vec4(vec3(uv, texelFetch(gDepth, pixel, 0).r) * 2.0f - 1.0f, 1.0f);
+	return (inverseView * vec4(position.xyz / position.w, 1.0f)).xyz;
+}
+
+vec3 DecodeNormal(vec2 e)
+{
+	e = e * 2.0f - 1.0f;
+	vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0f);
+	n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+	return normalize(n);
+}
+#endif
+
+void main()
+{
+	// The volumes are drawn at the G-buffer's resolution, the fragment addresses its texel directly
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+#ifdef PACKED_GBUFFER
+	vec3 FragPos = WorldPosition(pixel);
+#else
+	vec3 FragPos = texelFetch(gPosition, pixel, 0).rgb;
+#endif
+	vec4 positionRadius = texelFetch(lightData, lightTexel);
+
+	// The stencil only keeps pixels inside some light's volume, not necessarily this one's
+	float distance = length(positionRadius.xyz - FragPos);
+	if (distance > positionRadius.w)
+		discard;
+
+#ifdef PACKED_GBUFFER
+	vec3 Normal = DecodeNormal(texelFetch(gNormal, pixel, 0).rg);
+#else
+	vec3 Normal = texelFetch(gNormal, pixel, 0).rgb;
+#endif
+	vec4 AlbedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+	vec4 colorLinear = texelFetch(lightData, lightTexel + 1);
+	float quadratic = texelFetch(lightData, lightTexel + 2).r;
+	vec3 lightDir = (positionRadius.xyz - FragPos) / distance;
+	vec3 viewDir = normalize(viewPos - FragPos);
+
+	// Diffuse
+	vec3 diffuse = colorLinear.rgb * AlbedoSpec.rgb * max(dot(Normal, lightDir), 0.0f) * 1.5f;
+	// Specular
+	vec3 halfwayDir = normalize(lightDir + viewDir);
+	float spec = pow(max(dot(halfwayDir, Normal), 0.0f), 32.0f);
+	vec3 specular = colorLinear.rgb * spec * AlbedoSpec.a;
+	// Attenuation
+	float attenuation = 1.0f / (1.0f + colorLinear.a * distance + quadratic * distance * distance);
+
+	// Added to the ambient term by the blending
+	FragColor = vec4((diffuse + specular) * attenuation, 1.0f);
+}
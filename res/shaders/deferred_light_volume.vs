@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
+
+// One instance per light, 3 texels each: (position, radius), (color, linear), (quadratic)
+uniform samplerBuffer lightData;
+uniform float proxyScale; // scales the sphere mesh so it encloses a sphere of radius 1
+
+flat out int lightTexel;
+
+void main()
+{
+	lightTexel = gl_InstanceID * 3;
+	vec4 positionRadius = texelFetch(lightData, lightTexel);
+	gl_Position = projection * view * vec4(positionRadius.xyz + aPos * (positionRadius.w * proxyScale), 1.0);
+}
@@ -1,50 +1,97 @@
 #version 330 core
-#define NR_LIGHTS 32
 out vec4 FragColor;
 
 in vec2 TexCoords;
 
+#ifdef PACKED_GBUFFER
+uniform sampler2D gDepth;  // world positions are rebuilt from it
+uniform sampler2D gNormal; // octahedral-encoded
+#else
 uniform sampler2D gPosition;
 uniform sampler2D gNormal;
+#endif
 uniform sampler2D gAlbedoSpec;
 
-// Could be expanded further: 
-// Adding a float radius, so we don't need to do the calculcations  
-// where the distance is less than the radius of light.
-struct Light {
-	vec3 Position;
-	vec3 Color;
+// Clustered lights (see LightClusters): the lights of the pixel's cluster are listed in lightIndices
+uniform samplerBuffer lightData;     // 3 texels per light: (position, radius), (color, linear), (quadratic)
+uniform usamplerBuffer lightGrid;    // per cluster: (first index, light count)
+uniform usamplerBuffer lightIndices; // light indices, grouped by cluster
+uniform vec3 clusterGrid;            // tiles in x and y, depth slices
+uniform float clusterNear;
+uniform float clusterSliceScale;     // slices / log(far / near)
 
-	float Linear;
-	float Quadratic;
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
 };
 
-uniform Light lights[NR_LIGHTS];
-uniform vec3 viewPos;
+#ifdef PACKED_GBUFFER
+vec3 WorldPosition(vec2 uv)
+{
+	vec4 position = inverseProjection * vec4(vec3(uv, texture(gDepth, uv).r) * 2.0f - 1.0f, 1.0f);
+	return (inverseView * vec4(position.xyz / position.w, 1.0f)).xyz;
+}
+
+vec3 DecodeNormal(vec2 e)
+{
+	e = e * 2.0f - 1.0f;
+	vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0f);
+	n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+	return normalize(n);
+}
+#endif
+
+int ClusterIndex(vec3 worldPos)
+{
+	ivec3 grid = ivec3(clusterGrid);
+	float depth = max(-(view * vec4(worldPos, 1.0f)).z, clusterNear);
+	int slice = clamp(int(log(depth / clusterNear) * clusterSliceScale), 0, grid.z - 1);
+	ivec2 tile = clamp(ivec2(TexCoords * clusterGrid.xy), ivec2(0), grid.xy - 1);
+	return (slice * grid.y + tile.y) * grid.x + tile.x;
+}
 
 void main()
 {
 	// Retrieve g-Buffer data
+#ifdef PACKED_GBUFFER
+	vec3 FragPos = WorldPosition(TexCoords);
+	vec3 Normal = DecodeNormal(texture(gNormal, TexCoords).rg);
+#else
 	vec3 FragPos = texture(gPosition, TexCoords).rgb;
 	vec3 Normal = texture(gNormal, TexCoords).rgb;
+#endif
 	vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
 	float Specular = texture(gAlbedoSpec, TexCoords).a;
 
 	// Calculate lighting
 	vec3 lighting = vec3(0.3f) * Diffuse;
 	vec3 viewDir = normalize(viewPos - FragPos);
-	for(int i = 0; i < NR_LIGHTS; i++) {
-		vec3 lightDir = normalize(lights[i].Position - FragPos);
+	uvec2 cluster = texelFetch(lightGrid, ClusterIndex(FragPos)).rg;
+	for(uint i = 0u; i < cluster.y; i++) {
+		int light = int(texelFetch(lightIndices, int(cluster.x + i)).r) * 3;
+		vec4 positionRadius = texelFetch(lightData, light);
+		vec4 colorLinear = texelFetch(lightData, light + 1);
+		float quadratic = texelFetch(lightData, light + 2).r;
+
+		// Beyond the radius the light is below 5/256 of its brightness, the clusters were cut there too
+		float distance = length(positionRadius.xyz - FragPos);
+		if (distance > positionRadius.w)
+			continue;
+		vec3 lightDir = (positionRadius.xyz - FragPos) / distance;
 
 		// Diffuse
-		vec3 diffuse = lights[i].Color * Diffuse * max(dot(Normal, lightDir), 0.0f) * 1.5f;
+		vec3 diffuse = colorLinear.rgb * Diffuse * max(dot(Normal, lightDir), 0.0f) * 1.5f;
         // Specular
 		vec3 halfwayDir = normalize(lightDir + viewDir);
 		float spec = pow(max(dot(halfwayDir, Normal), 0.0f), 32.0f);
-		vec3 specular = lights[i].Color * spec * Specular;
+		vec3 specular = colorLinear.rgb * spec * Specular;
 		// Attenuation
-		float distance = length(lights[i].Position - FragPos);
-		float attenuation = 1.0f / (1.0f + lights[i].Linear * distance + lights[i].Quadratic * distance * distance);
+		float attenuation = 1.0f / (1.0f + colorLinear.a * distance + quadratic * distance * distance);
 		diffuse *= attenuation;
 		specular *= attenuation;
 		lighting += diffuse + specular;
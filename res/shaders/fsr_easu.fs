@@ -0,0 +1,149 @@
+#version 330 core
+out vec4 FragColor;
+
+// Edge Adaptive Spatial Upsampling, a GLSL 330 port of AMD FidelityFX Super Resolution 1.0 (EASU).
+// 12 taps around the output position are weighted with an approximated Lanczos-2 kernel that is
+// rotated along the local edge direction and stretched with the edge strength, then clamped to the
+// min/max of the 4 nearest texels to avoid ringing. Expects a perceptual (tonemapped, gamma) input.
+//
+//    b c
+//  e f g h
+//  i j k l
+//    n o
+
+uniform sampler2D inputTexture;
+uniform vec2 outputSize;
+
+vec3 Tap(ivec2 p, ivec2 size)
+{
+    return texelFetch(inputTexture, clamp(p, ivec2(0), size - 1), 0).rgb;
+}
+
+// Luma times 2
+float Luma(vec3 c)
+{
+    return c.b * 0.5 + (c.r * 0.5 + c.g);
+}
+
+// Accumulates direction and edge length of one bilinear quadrant, w is its bilinear weight.
+//    a
+//  b c d
+//    e
+void EasuSet(inout vec2 dir, inout float len, float w, float lA, float lB, float lC, float lD, float lE)
+{
+    // Direction is the '+' diff, the length converts gradient reversal to 0
+    float dc = lD - lC;
+    float cb = lC - lB;
+    float lenX = max(abs(dc), abs(cb));
+    lenX = 1.0 / max(lenX, 1.0 / 32768.0);
+    float dirX = lD - lB;
+    dir.x += dirX * w;
+    lenX = clamp(abs(dirX) * lenX, 0.0, 1.0);
+    len += lenX * lenX * w;
+
+    float ec = lE - lC;
+    float ca = lC - lA;
+    float lenY = max(abs(ec), abs(ca));
+    lenY = 1.0 / max(lenY, 1.0 / 32768.0);
+    float dirY = lE - lA;
+    dir.y += dirY * w;
+    lenY = clamp(abs(dirY) * lenY, 0.0, 1.0);
+    len += lenY * lenY * w;
+}
+
+void EasuTap(inout vec3 aC, inout float aW, vec2 off, vec2 dir, vec2 len, float lob, float clp, vec3 c)
+{
+    // Rotate offset by direction, then apply the anisotropy
+    vec2 v = vec2(off.x * dir.x + off.y * dir.y, off.x * -dir.y + off.y * dir.x);
+    v *= len;
+
+    // Distance^2, limited to the window as at the corners 2 taps can easily be outside
+    float d2 = min(dot(v, v), clp);
+
+    // Lanczos-2 approximation without sin(), rcp() or sqrt():
+    //  (25/16 * (2/5 * x^2 - 1)^2 - (25/16 - 1)) * (lob * x^2 - 1)^2
+    float wB = 2.0 / 5.0 * d2 - 1.0;
+    float wA = lob * d2 - 1.0;
+    wB *= wB;
+    wA *= wA;
+    wB = 25.0 / 16.0 * wB - (25.0 / 16.0 - 1.0);
+    float w = wB * wA;
+    aC += c * w;
+    aW += w;
+}
+
+void main()
+{
+    ivec2 size = textureSize(inputTexture, 0);
+
+    // Output pixel center in input texel space, split into the top-left texel 'f' and the fraction
+    vec2 pp = gl_FragCoord.xy * vec2(size) / outputSize - 0.5;
+    vec2 fp = floor(pp);
+    pp -= fp;
+    ivec2 f = ivec2(fp);
+
+    vec3 bC = Tap(f + ivec2( 0, -1), size);
+    vec3 cC = Tap(f + ivec2( 1, -1), size);
+    vec3 eC = Tap(f + ivec2(-1,  0), size);
+    vec3 fC = Tap(f + ivec2( 0,  0), size);
+    vec3 gC = Tap(f + ivec2( 1,  0), size);
+    vec3 hC = Tap(f + ivec2( 2,  0), size);
+    vec3 iC = Tap(f + ivec2(-1,  1), size);
+    vec3 jC = Tap(f + ivec2( 0,  1), size);
+    vec3 kC = Tap(f + ivec2( 1,  1), size);
+    vec3 lC = Tap(f + ivec2( 2,  1), size);
+    vec3 nC = Tap(f + ivec2( 0,  2), size);
+    vec3 oC = Tap(f + ivec2( 1,  2), size);
+
+    float bL = Luma(bC), cL = Luma(cC), eL = Luma(eC), fL = Luma(fC);
+    float gL = Luma(gC), hL = Luma(hC), iL = Luma(iC), jL = Luma(jC);
+    float kL = Luma(kC), lL = Luma(lC), nL = Luma(nC), oL = Luma(oC);
+
+    // Direction and length from the 4 bilinear quadrants around the output position
+    vec2 dir = vec2(0.0);
+    float len = 0.0;
+    EasuSet(dir, len, (1.0 - pp.x) * (1.0 - pp.y), bL, eL, fL, gL, jL);
+    EasuSet(dir, len, pp.x * (1.0 - pp.y), cL, fL, gL, hL, kL);
+    EasuSet(dir, len, (1.0 - pp.x) * pp.y, fL, iL, jL, kL, nL);
+    EasuSet(dir, len, pp.x * pp.y, gL, jL, kL, lL, oL);
+
+    // Normalize the direction, falling back to horizontal on flat areas
+    float dirR = dot(dir, dir);
+    bool zro = dirR < 1.0 / 32768.0;
+    dirR = zro ? 1.0 : inversesqrt(dirR);
+    dir.x = zro ? 1.0 : dir.x;
+    dir *= dirR;
+
+    // Transform length from {0 to 2} to {0 to 1} and shape with a square
+    len = len * 0.5;
+    len *= len;
+
+    // Stretch the kernel {1.0 vert|horz, to sqrt(2.0) on diagonal}
+    float stretch = dot(dir, dir) / max(abs(dir.x), abs(dir.y));
+    // Anisotropic length after rotation: x from 1.0 to 'stretch' on edges, y from 1.0 to 0.5 on edges
+    vec2 len2 = vec2(1.0 + (stretch - 1.0) * len, 1.0 - 0.5 * len);
+    // The window shifts from +/-sqrt(2.0) to slightly beyond 2.0 with the amount of edge
+    float lob = 0.5 + ((1.0 / 4.0 - 0.04) - 0.5) * len;
+    float clp = 1.0 / lob;
+
+    vec3 min4 = min(min(fC, gC), min(jC, kC));
+    vec3 max4 = max(max(fC, gC), max(jC, kC));
+
+    vec3 aC = vec3(0.0);
+    float aW = 0.0;
+    EasuTap(aC, aW, vec2( 0.0, -1.0) - pp, dir, len2, lob, clp, bC);
+    EasuTap(aC, aW, vec2( 1.0, -1.0) - pp, dir, len2, lob, clp, cC);
+    EasuTap(aC, aW, vec2(-1.0,  1.0) - pp, dir, len2, lob, clp, iC);
+    EasuTap(aC, aW, vec2( 0.0,  1.0) - pp, dir, len2, lob, clp, jC);
+    EasuTap(aC, aW, vec2( 0.0,  0.0) - pp, dir, len2, lob, clp, fC);
+    EasuTap(aC, aW, vec2(-1.0,  0.0) - pp, dir, len2, lob, clp, eC);
+    EasuTap(aC, aW, vec2( 1.0,  1.0) - pp, dir, len2, lob, clp, kC);
+    EasuTap(aC, aW, vec2( 2.0,  1.0) - pp, dir, len2, lob, clp, lC);
+    EasuTap(aC, aW, vec2( 2.0,  0.0) - pp, dir, len2, lob, clp, hC);
+    EasuTap(aC, aW, vec2( 1.0,  0.0) - pp, dir, len2, lob, clp, gC);
+    EasuTap(aC, aW, vec2( 1.0,  2.0) - pp, dir, len2, lob, clp, oC);
+    EasuTap(aC, aW, vec2( 0.0,  2.0) - pp, dir, len2, lob, clp, nC);
+
+    // Normalize and dering
+    FragColor = vec4(min(max4, max(min4, aC / aW)), 1.0);
+}
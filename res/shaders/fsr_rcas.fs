@@ -0,0 +1,62 @@
+#version 330 core
+out vec4 FragColor;
+
+// Robust Contrast Adaptive Sharpening, a GLSL 330 port of AMD FidelityFX Super Resolution 1.0 (RCAS).
+// Runs at output resolution after EASU. The sharpening lobe is limited per pixel so the result never
+// leaves the min/max of the '+' neighborhood, and it is reduced on noise.
+//
+//    b
+//  d e f
+//    h
+
+uniform sampler2D inputTexture;
+uniform float sharpness; // in stops, 0.0 is the strongest
+
+// Maximum lobe, larger values clip
+const float RCAS_LIMIT = 0.25 - (1.0 / 16.0);
+
+vec3 Tap(ivec2 p, ivec2 size)
+{
+    return texelFetch(inputTexture, clamp(p, ivec2(0), size - 1), 0).rgb;
+}
+
+float Luma(vec3 c)
+{
+    return c.b * 0.5 + (c.r * 0.5 + c.g);
+}
+
+void main()
+{
+    ivec2 size = textureSize(inputTexture, 0);
+    ivec2 p = ivec2(gl_FragCoord.xy);
+
+    vec3 b = Tap(p + ivec2( 0, -1), size);
+    vec3 d = Tap(p + ivec2(-1,  0), size);
+    vec3 e = Tap(p, size);
+    vec3 f = Tap(p + ivec2( 1,  0), size);
+    vec3 h = Tap(p + ivec2( 0,  1), size);
+
+    float bL = Luma(b), dL = Luma(d), eL = Luma(e), fL = Luma(f), hL = Luma(h);
+
+    // Noise detection, reduces sharpening on isolated pixels
+    float nz = 0.25 * (bL + dL + fL + hL) - eL;
+    float range = max(max(max(bL, dL), max(eL, fL)), hL) - min(min(min(bL, dL), min(eL, fL)), hL);
+    nz = clamp(abs(nz) / max(range, 1.0 / 32768.0), 0.0, 1.0);
+    nz = -0.5 * nz + 1.0;
+
+    // Min and max of the ring
+    vec3 mn4 = min(min(b, d), min(f, h));
+    vec3 mx4 = max(max(b, d), max(f, h));
+
+    // Limiters: the largest negative lobe that keeps the output inside [0, 1]
+    vec2 peakC = vec2(1.0, -4.0);
+    vec3 hitMin = min(mn4, e) / max(4.0 * mx4, vec3(1.0 / 32768.0));
+    vec3 hitMax = (peakC.x - max(mx4, e)) / min(4.0 * mn4 + peakC.y, vec3(-1.0 / 32768.0));
+    vec3 lobeRGB = max(-hitMin, hitMax);
+    float lobe = max(-RCAS_LIMIT, min(max(lobeRGB.r, max(lobeRGB.g, lobeRGB.b)), 0.0)) * exp2(-sharpness);
+    lobe *= nz;
+
+    // Resolve
+    vec3 color = (lobe * (b + d + f + h) + e) / (4.0 * lobe + 1.0);
+    FragColor = vec4(color, 1.0);
+}
@@ -1,7 +1,13 @@
 #version 330 core
+#ifdef PACKED_GBUFFER
+// Packed layout: the position is rebuilt from the depth buffer, the normal is octahedral-encoded into RG16
+layout(location = 0) out vec2 gNormal;
+layout(location = 1) out vec4 gAlbedoSpecular;
+#else
 layout(location = 0) out vec3 gPosition;
 layout(location = 1) out vec3 gNormal;
 layout(location = 2) out vec4 gAlbedoSpecular;
+#endif
 
 in vec3 FragPos;
 in vec3 Normal;
@@ -10,10 +16,23 @@ in vec2 TexCoords;
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
 
+// Folds the unit sphere onto the [-1, 1] square (lower hemisphere mirrored into the corners), stored as [0, 1]
+vec2 EncodeNormal(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 signs = vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+	vec2 e = n.z >= 0.0f ? n.xy : (1.0f - abs(n.yx)) * signs;
+	return e * 0.5f + 0.5f;
+}
+
 void main()
 {
+#ifdef PACKED_GBUFFER
+	gNormal = EncodeNormal(normalize(Normal));
+#else
 	gPosition = FragPos;
 	gNormal = normalize(Normal);
+#endif
 	gAlbedoSpecular.rgb = texture(texture_diffuse1, TexCoords).rgb;
 	gAlbedoSpecular.a = texture(texture_specular1, TexCoords).r;
-}
\ No newline at end of file
+}
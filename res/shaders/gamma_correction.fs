@@ -7,9 +7,26 @@ in vec2 TexCoords;
 
 uniform sampler2D floorTexture;
 uniform bool gamma;
-uniform vec3 viewPos;
-uniform vec3 lightPositions[4];
-uniform vec3 lightColors[4];
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+struct Light {
+    vec3 Position;
+    float Linear;
+    vec3 Color;
+    float Quadratic;
+};
+
+layout (std140) uniform Lights
+{
+    Light lights[32];
+    int lightCount;
+};
 
 vec3 BlinnPhong(vec3 normal, vec3 fragPos, vec3 lightPos, vec3 lightColor);
 
@@ -17,8 +34,8 @@ void main()
 {
     vec3 color = texture(floorTexture, TexCoords).rgb;
     vec3 lighting = vec3(0.0f);
-    for(int i = 0; i < 4; i++) {
-        lighting = BlinnPhong(Normal, FragPos, lightPositions[i], lightColors[i]);
+    for(int i = 0; i < lightCount; i++) {
+        lighting = BlinnPhong(Normal, FragPos, lights[i].Position, lights[i].Color);
         color += lighting;
     }
 
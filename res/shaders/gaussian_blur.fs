@@ -0,0 +1,27 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image;  // sampled with GL_LINEAR, the taps sit between texels
+uniform vec2 direction;   // (1, 0) for the horizontal pass, (0, 1) for the vertical one
+
+layout (std140) uniform BlurKernel
+{
+    vec4 taps[64]; // x: offset in texels, y: weight of the linear-sampled taps, center first
+    int tapCount;
+    int radius;
+};
+
+// One half of a separable Gaussian blur; the kernel comes from GaussianKernel on the CPU, so the width is a runtime
+// parameter and the cost is 2 * tapCount - 1 fetches
+void main()
+{
+    vec2 texel = direction / vec2(textureSize(image, 0));
+    vec4 result = texture(image, TexCoords) * taps[0].y;
+    for (int i = 1; i < tapCount; i++) {
+        vec2 offset = texel * taps[i].x;
+        result += (texture(image, TexCoords + offset) + texture(image, TexCoords - offset)) * taps[i].y;
+    }
+    FragColor = result;
+}
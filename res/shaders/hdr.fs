@@ -4,8 +4,13 @@ out vec4 FragColor;
 in vec2 TexCoords;
 
 uniform sampler2D hdrBuffer;
-uniform bool hdr;
-uniform float exposure;
+
+layout (std140) uniform PostParams
+{
+    float exposure;
+    int bloom;
+    int hdr;
+};
 
 void main()
 {             
@@ -14,7 +19,7 @@ void main()
     // Sample color from pre-rendered texture
     vec3 hdrColor = texture(hdrBuffer, TexCoords).rgb;
 
-    if (hdr) {
+    if (hdr != 0) {
         // Reinhard tone mapping (commented out)
         // Maps high dynamic range to low dynamic range, preserving details
         // -------------------------------------
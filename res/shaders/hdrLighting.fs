@@ -5,9 +5,25 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-uniform vec3 lightPositions[4];
-uniform vec3 lightColors[4];
-uniform vec3 viewPos;
+struct Light {
+    vec3 Position;
+    float Linear;
+    vec3 Color;
+    float Quadratic;
+};
+
+layout (std140) uniform Lights
+{
+    Light lights[32];
+    int lightCount;
+};
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
 
 uniform sampler2D woodTexture;
 
@@ -18,13 +34,13 @@ void main()
 	vec3 lighting = vec3(0.0f);
 
 	// For learning purpose, we only apply diffuse here (without ambient and specular)
-	for (int i = 0; i < 4; i++) {
-		vec3 lightDir = normalize(lightPositions[i] - FragPos);
+	for (int i = 0; i < lightCount; i++) {
+		vec3 lightDir = normalize(lights[i].Position - FragPos);
 		float diff = max(dot(lightDir, normal), 0.0);
-		vec3 diffuse = lightColors[i] * diff * color;
+		vec3 diffuse = lights[i].Color * diff * color;
 		vec3 result = diffuse;
 
-		float distance = length(FragPos - lightPositions[i]);
+		float distance = length(FragPos - lights[i].Position);
 		result *= 1.0f / (distance * distance);
 		lighting += result;
 	}
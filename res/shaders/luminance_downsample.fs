@@ -0,0 +1,30 @@
+#version 330 core
+out float logLuminance;
+
+in vec2 TexCoords;
+
+uniform sampler2D hdrInput;
+
+const int GRID = 4; // bilinear taps per side, each one averages 2x2 texels
+
+float Luminance(vec3 color)
+{
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Log2 luminance of a small grid over the screen, for the auto exposure histogram. Each output texel averages the
+// log of GRID x GRID bilinear taps spread over its footprint (a geometric mean), so a few very bright pixels do
+// not dominate the cell the way they would in a plain average.
+void main()
+{
+    vec2 footprint = fwidth(TexCoords); // one output texel in input UVs
+    vec2 origin = TexCoords - 0.5 * footprint;
+    float sum = 0.0;
+    for (int y = 0; y < GRID; y++) {
+        for (int x = 0; x < GRID; x++) {
+            vec2 uv = origin + (vec2(x, y) + 0.5) / float(GRID) * footprint;
+            sum += log2(max(Luminance(texture(hdrInput, uv).rgb), 0.00001));
+        }
+    }
+    logLuminance = sum / float(GRID * GRID);
+}
@@ -11,10 +11,14 @@ out vec3 tangentViewPos;
 out vec3 tangentFragPos;
 
 uniform vec3 lightPos;
-uniform vec3 viewPos;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
 uniform mat4 model;
 
 void main()
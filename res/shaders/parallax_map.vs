@@ -10,12 +10,16 @@ out vec3 tangentLightPos;
 out vec3 tangentViewPos;
 out vec3 tangentFragPos;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
 uniform mat4 model;
 
 uniform vec3 lightPos;
-uniform vec3 viewPos;
 
 void main()
 {
@@ -1,17 +1,30 @@
 #version 330 core
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec2 Velocity; // only attached when temporal filtering is on
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+in vec4 CurrentClip;
+in vec4 PreviousClip;
 
 uniform sampler2D diffuseTexture;
 uniform samplerCube depthMap;
 
-uniform vec3 viewPos;
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
 uniform vec3 lightPos;
 uniform float far_plane;
 uniform bool shadows;
+// PCF taps of gridSamplingDisk taken this frame, starting at shadowSampleOffset. All 20 without temporal
+// filtering; with it a few per frame, rotated so the accumulated history sees all of them
+uniform int shadowSamples;
+uniform int shadowSampleOffset;
 
 // array of offset direction for sampling
 vec3 gridSamplingDisk[20] = vec3[]
@@ -51,6 +64,7 @@ void main()
     vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;   
 
 	FragColor = vec4(lighting, 1.0f);
+	Velocity = (CurrentClip.xy / CurrentClip.w - PreviousClip.xy / PreviousClip.w) * 0.5f;
 }
 
 float ShadowCalculation()
@@ -62,13 +76,13 @@ float ShadowCalculation()
     float bias = 0.05;
     float shadow = 0.0f;
 
-    for(int i = 0; i < 20; i++) {
-        float closetDepth = texture(depthMap, fragToLight + 0.05f * gridSamplingDisk[i]).r;
+    for(int i = 0; i < shadowSamples; i++) {
+        float closetDepth = texture(depthMap, fragToLight + 0.05f * gridSamplingDisk[(shadowSampleOffset + i) % 20]).r;
         closetDepth *= far_plane; // Undo mapping [0, 1]
         shadow += (currentDepth - bias > closetDepth) ? 1.0f : 0.0f;
     }
         
-    return shadow / 20.0f;
+    return shadow / float(shadowSamples);
 }
 
 
@@ -6,10 +6,20 @@ layout (location = 2) in vec2 aTexCoords;
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+out vec4 CurrentClip;
+out vec4 PreviousClip;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
 
-uniform mat4 projection;
-uniform mat4 view;
 uniform mat4 model;
+// Unjittered, for the velocity output. The scene is static, so only the camera contributes motion
+uniform mat4 viewProjection;
+uniform mat4 previousViewProjection;
 
 uniform bool reverse_normals;
 
@@ -17,6 +27,8 @@ void main()
 {
     gl_Position = projection * view * model * vec4(aPos, 1.0f);
     FragPos = vec3(model * vec4(aPos, 1.0));
+    CurrentClip = viewProjection * vec4(FragPos, 1.0);
+    PreviousClip = previousViewProjection * vec4(FragPos, 1.0);
 
     // Adjusts the normals to render the inside surface of the cube, 
     // allowing proper lighting calculations as if you're looking from the inside of the cube, 
@@ -11,7 +11,13 @@ uniform sampler2D depthMap;
 
 uniform vec3 lightPosition;
 //uniform vec3 lightDirection;
-uniform vec3 viewPos;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
 
 float ShadowCalculation(vec4 fragPosLightSpace)
 {
@@ -3,25 +3,71 @@ out float FragColor;
 
 in vec2 TexCoords;
 
+#ifdef PACKED_GBUFFER
+uniform sampler2D gDepth;  // view-space positions are rebuilt from it
+uniform sampler2D gNormal; // octahedral-encoded
+#else
 uniform sampler2D gPosition;
 uniform sampler2D gNormal;
+#endif
 uniform sampler2D noiseTexture;
+// (cos, sin) of an angle the noise vectors are turned by, changed every frame for temporal accumulation
+uniform vec2 noiseRotation;
 
-uniform float kernelSize;
-uniform vec3 samples[16];
-uniform float radius;
+layout (std140) uniform SSAOKernel
+{
+    vec4 samples[64];
+    int kernelSize;
+    float radius;
+};
 
-uniform mat4 projection;
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
 
-// tile noise texture over screen based on screen dimensions divided by noise size
-const vec2 noiseScale = vec2(1920.0f / 4.0f, 1080.0f / 4.0f); 
+#ifdef PACKED_GBUFFER
+vec3 ViewPosition(vec2 uv)
+{
+    vec4 position = inverseProjection * vec4(vec3(uv, texture(gDepth, uv).r) * 2.0f - 1.0f, 1.0f);
+    return position.xyz / position.w;
+}
+
+vec3 DecodeNormal(vec2 e)
+{
+    e = e * 2.0f - 1.0f;
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
+#else
+vec3 ViewPosition(vec2 uv)
+{
+    return texture(gPosition, uv).xyz;
+}
+#endif
 
 void main()
 {
+    // tile noise texture over screen based on screen dimensions divided by noise size
+    // (taken from the G-buffer, so it follows the window size)
+    vec2 noiseScale = vec2(textureSize(gNormal, 0)) / vec2(textureSize(noiseTexture, 0));
+
     // Retrieve Position and Normal from G-Buffer, noise vector from noiseTexture
-    vec3 FragPos = texture(gPosition, TexCoords).xyz;
+    vec3 FragPos = ViewPosition(TexCoords);
+#ifdef PACKED_GBUFFER
+    vec3 Normal = DecodeNormal(texture(gNormal, TexCoords).rg);
+#else
     vec3 Normal = normalize(texture(gNormal, TexCoords).rgb);
-    vec3 randomVec = normalize(texture(noiseTexture, TexCoords * noiseScale).xyz);
+#endif
+    vec3 randomVec = texture(noiseTexture, TexCoords * noiseScale).xyz;
+    randomVec.xy = mat2(noiseRotation.x, noiseRotation.y, -noiseRotation.y, noiseRotation.x) * randomVec.xy;
+    randomVec = normalize(randomVec);
 
     // Create TBN change-of-basis matrix: from tangent-space to view-space
     // The TBN matrix is used to transform the sample points into an orientation
@@ -38,7 +84,7 @@ void main()
         // Transform the sample point from tangent space to view space.
         // The sample point is fetched from a pre-computed array of points that
         // are oriented along the z-axis in tangent space.
-        vec3 sample = TBN * samples[i]; // tangent space -> view space
+        vec3 sample = TBN * samples[i].xyz; // tangent space -> view space
         sample = FragPos + sample * radius;
 
         // project sample position (to sample texture) (to get position on screen/texture)
@@ -47,8 +93,8 @@ void main()
         offset.xyz /= offset.w; // perspective divide
         offset.xyz = offset.xyz * 0.5f + 0.5; // transform to range 0.0 - 1.0
 
-        // Retrieve the linearized depth value from the gPositionDepth texture.
-        float sampleDepth = texture(gPosition, offset.xy).z; 
+        // Retrieve the view-space depth of the surface at the sample's screen position.
+        float sampleDepth = ViewPosition(offset.xy).z; 
 
         // Introduce a rangeCheck to ensure that it only affect the occlusion factor when the measured depth value is within the radius
         float rangeCheck = smoothstep(0.0, 1.0, radius / abs(FragPos.z - sampleDepth));
@@ -61,6 +107,6 @@ void main()
 
     // Normalization & inversion for later use
     // serves as a coefficient can use to modulate the lighting
-    occlusion = 1.0 - (occlusion / kernelSize);
+    occlusion = 1.0 - (occlusion / float(kernelSize));
     FragColor = occlusion;
 }
\ No newline at end of file
@@ -0,0 +1,38 @@
+#version 330 core
+out float FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D ssaoInput;     // raw occlusion coefficient
+uniform sampler2D positionInput; // view-space positions at the same resolution
+uniform vec2 direction;          // (1, 0) for the horizontal pass, (0, 1) for the vertical one
+uniform float depthSharpness;    // how fast a tap's weight falls with its relative depth difference
+
+layout (std140) uniform BlurKernel
+{
+    vec4 taps[64]; // z: Gaussian weight of the texel at offset i
+    int tapCount;
+    int radius;
+};
+
+// One half of a separable depth-aware blur: a Gaussian of the given radius along direction, where each tap is also
+// weighted down by how far its depth is from the center's, so the occlusion of one surface doesn't bleed onto another.
+// The depth weight differs per texel, so the taps can't be merged into bilinear fetches.
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 last = textureSize(ssaoInput, 0) - 1;
+    ivec2 stride = ivec2(direction);
+    float centerDepth = texelFetch(positionInput, pixel, 0).z;
+
+    float result = 0.0f;
+    float weightSum = 0.0f;
+    for (int i = -radius; i <= radius; i++) {
+        ivec2 tap = clamp(pixel + stride * i, ivec2(0), last);
+        float depth = texelFetch(positionInput, tap, 0).z;
+        float weight = taps[abs(i)].z * exp(-abs(depth - centerDepth) / max(abs(centerDepth), 0.001f) * depthSharpness);
+        result += texelFetch(ssaoInput, tap, 0).r * weight;
+        weightSum += weight;
+    }
+    FragColor = result / weightSum;
+}
@@ -0,0 +1,70 @@
+#version 330 core
+layout(location = 0) out vec3 halfPosition;
+layout(location = 1) out vec3 halfNormal;
+
+in vec2 TexCoords;
+
+#ifdef PACKED_GBUFFER
+uniform sampler2D gDepth;  // view-space positions are rebuilt from it
+uniform sampler2D gNormal; // octahedral-encoded
+#else
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+#endif
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
+
+#ifdef PACKED_GBUFFER
+vec3 ViewPosition(ivec2 pixel)
+{
+    vec2 uv = (vec2(pixel) + 0.5f) / vec2(textureSize(gDepth, 0));
+    vec4 position = inverseProjection * vec4(vec3(uv, texelFetch(gDepth, pixel, 0).r) * 2.0f - 1.0f, 1.0f);
+    return position.xyz / position.w;
+}
+
+vec3 ViewNormal(ivec2 pixel)
+{
+    vec2 e = texelFetch(gNormal, pixel, 0).rg * 2.0f - 1.0f;
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
+#else
+vec3 ViewPosition(ivec2 pixel)
+{
+    return texelFetch(gPosition, pixel, 0).xyz;
+}
+
+vec3 ViewNormal(ivec2 pixel)
+{
+    return texelFetch(gNormal, pixel, 0).xyz;
+}
+#endif
+
+// Half-resolution view-space position and normal for SSAO. Each texel keeps the closest of its 2x2 full-resolution
+// pixels rather than their average, which across a depth edge would be a point on neither surface.
+void main()
+{
+    ivec2 last = textureSize(gNormal, 0) - 1;
+    ivec2 base = ivec2(gl_FragCoord.xy) * 2;
+    ivec2 closest = base;
+    vec3 closestPosition = ViewPosition(base);
+    for (int i = 1; i < 4; i++) {
+        ivec2 pixel = min(base + ivec2(i & 1, i >> 1), last);
+        vec3 position = ViewPosition(pixel);
+        if (position.z > closestPosition.z) {
+            closest = pixel;
+            closestPosition = position;
+        }
+    }
+    halfPosition = closestPosition;
+    halfNormal = ViewNormal(closest);
+}
@@ -1,16 +1,41 @@
 #version 330 core
+#ifdef PACKED_GBUFFER
+// Packed layout: the view-space position is rebuilt from the depth buffer, the normal is octahedral-encoded into RG16
+layout(location = 0) out vec2 gNormal;
+layout(location = 1) out vec3 gAlbedo;
+layout(location = 2) out vec2 gVelocity;
+#else
 layout(location = 0) out vec3 gPosition;
 layout(location = 1) out vec3 gNormal;
 layout(location = 2) out vec3 gAlbedo;
+layout(location = 3) out vec2 gVelocity; // only attached when temporal accumulation is on
+#endif
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+in vec4 CurrentClip;
+in vec4 PreviousClip;
+
+// Folds the unit sphere onto the [-1, 1] square (lower hemisphere mirrored into the corners), stored as [0, 1]
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 signs = vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    vec2 e = n.z >= 0.0f ? n.xy : (1.0f - abs(n.yx)) * signs;
+    return e * 0.5f + 0.5f;
+}
 
 void main()
 {
+#ifdef PACKED_GBUFFER
+    gNormal = EncodeNormal(normalize(Normal));
+#else
     // save fragPos in view space
     gPosition = FragPos;
     gNormal = normalize(Normal);
+#endif
     gAlbedo = vec3(0.95f);
-}
\ No newline at end of file
+    // screen-space motion in UV units, current minus previous position
+    gVelocity = (CurrentClip.xy / CurrentClip.w - PreviousClip.xy / PreviousClip.w) * 0.5f;
+}
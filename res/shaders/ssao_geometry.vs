@@ -6,10 +6,20 @@ layout(location = 2) in vec2 aTexCoords;
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+out vec4 CurrentClip;
+out vec4 PreviousClip;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
 
-uniform mat4 projection;
-uniform mat4 view;
 uniform mat4 model;
+// Unjittered, for the velocity target. The scene is static, so only the camera contributes motion
+uniform mat4 viewProjection;
+uniform mat4 previousViewProjection;
 
 uniform bool invertedNormals;
 
@@ -23,4 +33,7 @@ void main()
     Normal = normalMatrix * (invertedNormals ? -aNormal : aNormal);
     
     gl_Position = projection * viewPos;
+    vec4 worldPos = model * vec4(aPos, 1.0);
+    CurrentClip = viewProjection * worldPos;
+    PreviousClip = previousViewProjection * worldPos;
 }
\ No newline at end of file
@@ -3,31 +3,74 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
+#ifdef PACKED_GBUFFER
+uniform sampler2D gDepth;  // view-space positions are rebuilt from it
+uniform sampler2D gNormal; // octahedral-encoded
+#else
 uniform sampler2D gPosition;
 uniform sampler2D gNormal;
+#endif
 uniform sampler2D gAlbedo;
 uniform sampler2D ssao;
 
 uniform bool enableSSAO;
 
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
+
 struct Light {
     vec3 Position;
-    vec3 Color;
-    
     float Linear;
+    vec3 Color;
     float Quadratic;
 };
 
-uniform Light light;
+layout (std140) uniform Lights
+{
+    Light lights[32];
+    int lightCount;
+};
+
+#ifdef PACKED_GBUFFER
+vec3 ViewPosition(vec2 uv)
+{
+    vec4 position = inverseProjection * vec4(vec3(uv, texture(gDepth, uv).r) * 2.0f - 1.0f, 1.0f);
+    return position.xyz / position.w;
+}
+
+vec3 DecodeNormal(vec2 e)
+{
+    e = e * 2.0f - 1.0f;
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
+#endif
 
 void main()
 {             
     // retrieve data from gbuffer
+#ifdef PACKED_GBUFFER
+    vec3 FragPos = ViewPosition(TexCoords);
+    vec3 Normal = DecodeNormal(texture(gNormal, TexCoords).rg);
+#else
     vec3 FragPos = texture(gPosition, TexCoords).rgb;
     vec3 Normal = texture(gNormal, TexCoords).rgb;
+#endif
     vec3 Diffuse = texture(gAlbedo, TexCoords).rgb;
     float AmbientOcclusion = enableSSAO ? texture(ssao, TexCoords).r : 1.0;
     
+    // the light is stored in world space, lighting is done in view space
+    Light light = lights[0];
+    light.Position = vec3(view * vec4(light.Position, 1.0));
+
     // then calculate lighting as usual
     vec3 ambient = vec3(0.25 * Diffuse * AmbientOcclusion);
     vec3 lighting  = ambient; 
@@ -0,0 +1,68 @@
+#version 330 core
+out float FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D ssaoInput;    // blurred half-resolution occlusion
+uniform sampler2D halfPosition; // the view-space positions it was computed at
+#ifdef PACKED_GBUFFER
+uniform sampler2D gDepth;
+#else
+uniform sampler2D gPosition;
+#endif
+uniform float depthSharpness;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
+
+#ifdef PACKED_GBUFFER
+float ViewDepth(ivec2 pixel)
+{
+    vec2 uv = (vec2(pixel) + 0.5f) / vec2(textureSize(gDepth, 0));
+    vec4 position = inverseProjection * vec4(vec3(uv, texelFetch(gDepth, pixel, 0).r) * 2.0f - 1.0f, 1.0f);
+    return position.z / position.w;
+}
+#else
+float ViewDepth(ivec2 pixel)
+{
+    return texelFetch(gPosition, pixel, 0).z;
+}
+#endif
+
+// Joint bilateral upsample: the 2x2 half-resolution texels around the pixel are blended with bilinear weights,
+// each scaled down by how far its depth is from the full-resolution depth, so silhouettes stay as sharp as the
+// G-buffer. When every texel lies on another surface the one with the closest depth is taken.
+void main()
+{
+    float depth = ViewDepth(ivec2(gl_FragCoord.xy));
+    ivec2 last = textureSize(ssaoInput, 0) - 1;
+    vec2 coord = TexCoords * vec2(textureSize(ssaoInput, 0)) - 0.5f;
+    ivec2 base = ivec2(floor(coord));
+    vec2 fraction = coord - vec2(base);
+
+    float result = 0.0f;
+    float weightSum = 0.0f;
+    float closestDifference = 1e30f;
+    float closestValue = 1.0f;
+    for (int i = 0; i < 4; i++) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 tap = clamp(base + offset, ivec2(0), last);
+        vec2 bilinear = mix(1.0f - fraction, fraction, vec2(offset));
+        float difference = abs(texelFetch(halfPosition, tap, 0).z - depth);
+        float value = texelFetch(ssaoInput, tap, 0).r;
+        float weight = bilinear.x * bilinear.y * exp(-difference / max(abs(depth), 0.001f) * depthSharpness);
+        result += value * weight;
+        weightSum += weight;
+        if (difference < closestDifference) {
+            closestDifference = difference;
+            closestValue = value;
+        }
+    }
+    FragColor = weightSum > 0.0001f ? result / weightSum : closestValue;
+}
@@ -0,0 +1,46 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D currentInput;  // this frame, noisy (few samples, jittered)
+uniform sampler2D historyInput;  // last frame's resolved result, bilinear
+uniform sampler2D velocityInput; // screen-space motion in UV units, current minus previous position
+
+uniform float blendFactor;  // weight of the current frame
+uniform float clampGamma;   // half-width of the neighbourhood box in standard deviations
+uniform bool historyValid;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 last = textureSize(currentInput, 0) - 1;
+    vec4 current = texelFetch(currentInput, pixel, 0);
+
+    // Where this surface was last frame; off screen means there is nothing to reproject
+    vec2 previousUV = TexCoords - texelFetch(velocityInput, pixel, 0).xy;
+    if (!historyValid || any(lessThan(previousUV, vec2(0.0f))) || any(greaterThan(previousUV, vec2(1.0f)))) {
+        FragColor = current;
+        return;
+    }
+
+    // Mean and standard deviation of the 3x3 neighbourhood: a history value outside of that box belongs to a
+    // surface that is not visible here any more (disocclusion, lighting change), so it is pulled into the box
+    vec4 m1 = vec4(0.0f);
+    vec4 m2 = vec4(0.0f);
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            vec4 c = texelFetch(currentInput, clamp(pixel + ivec2(x, y), ivec2(0), last), 0);
+            m1 += c;
+            m2 += c * c;
+        }
+    }
+    m1 /= 9.0f;
+    m2 /= 9.0f;
+    vec4 sigma = sqrt(max(m2 - m1 * m1, vec4(0.0f)));
+
+    vec4 history = texture(historyInput, previousUV);
+    history = clamp(history, m1 - clampGamma * sigma, m1 + clampGamma * sigma);
+
+    FragColor = mix(history, current, blendFactor);
+}
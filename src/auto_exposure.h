@@ -0,0 +1,231 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+
+#include <GL/glew.h>
+
+#include "gl_state.h"
+#include "shader.h"
+#include "render_target.h"
+#include "geometry_renderers.h"
+#include "cpu_profiler.h"
+#include "timer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUTO_EXPOSURE_SSE
+#endif
+
+// The AutoExposure class adapts the exposure to the brightness of the HDR scene, like an eye or a camera would.
+// Every frame the scene is reduced on the GPU to a GRID_SIZE x GRID_SIZE grid of log2 luminance, which is copied
+// into one of READBACK_SLOTS pixel buffers behind a fence. Update() maps the buffers whose fence has signaled (one
+// or two frames later, never waiting on one), sorts the grid into a HISTOGRAM_BINS bin histogram over
+// [minLog, maxLog] and averages the bins between lowPercentile and highPercentile, which ignores the darkest
+// corners and the light sources themselves. The exposure then moves towards key / average luminance with an
+// exponential falloff: adaptUpSpeed when the scene got brighter, adaptDownSpeed when it got darker.
+//
+// Measure() renders into its own target, Render() + Readback() work inside a render graph pass that writes
+// GetTexture(). A slot whose previous copy is still in flight is skipped rather than waited on.
+//
+// Usage Example:
+// AutoExposure autoExposure;
+// autoExposure.Update(deltaTime);                                       // start of the frame, uses older frames
+// frameConstants.SetPostParams(autoExposure.GetExposure(), bloom, hdr);
+// ... render the scene into hdrTarget ...
+// autoExposure.Measure(hdrTarget.GetTexture(0));                        // read back in a later frame
+class AutoExposure
+{
+public:
+	static constexpr int GRID_SIZE = 64;
+	static constexpr int HISTOGRAM_BINS = 64;
+	static constexpr int READBACK_SLOTS = 3;
+
+	float minLog = -10.0f;        // log2 luminance range of the histogram, values outside go to the end bins
+	float maxLog = 6.0f;
+	float lowPercentile = 0.5f;   // the average only covers this part of the sorted pixels
+	float highPercentile = 0.95f;
+	float key = 0.18f;            // luminance the average is mapped to before tonemapping (middle grey)
+	float compensation = 0.0f;    // in stops
+	float adaptUpSpeed = 3.0f;    // 1/s, towards brighter scenes
+	float adaptDownSpeed = 1.0f;  // 1/s, towards darker scenes (eyes take longer)
+
+	AutoExposure()
+		: shader(SHADER_BLUR_VS, SHADER_LUMINANCE_DOWNSAMPLE_FS),
+		target({ GetDesc() })
+	{
+		shader.Bind();
+		shader.SetInt("hdrInput", 0);
+
+		glGenBuffers(READBACK_SLOTS, buffers);
+		for (int i = 0; i < READBACK_SLOTS; i++) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, GRID_SIZE * GRID_SIZE * sizeof(float), nullptr, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	~AutoExposure()
+	{
+		for (GLsync fence : fences)
+			if (fence)
+				glDeleteSync(fence);
+		glDeleteBuffers(READBACK_SLOTS, buffers);
+	}
+
+	AutoExposure(const AutoExposure&) = delete;
+	AutoExposure& operator=(const AutoExposure&) = delete;
+
+	static RenderTargetDesc GetDesc() { return { GL_R32F, GRID_SIZE, GRID_SIZE, GL_NEAREST }; }
+	unsigned int GetTexture() { return target.GetTexture(0); }
+
+	// Collects the finished readbacks and adapts the exposure; before the first one arrives the exposure stays at 1.
+	void Update(float _deltaTime)
+	{
+		CPU_PROFILE_SCOPE("auto exposure");
+		for (int i = 0; i < READBACK_SLOTS; i++) {
+			int slot = (next + i) % READBACK_SLOTS; // oldest first
+			if (!fences[slot])
+				continue;
+			GLenum status = glClientWaitSync(fences[slot], 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				break; // the later copies are not done either
+			glDeleteSync(fences[slot]);
+			fences[slot] = nullptr;
+
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+			const float* grid = (const float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GRID_SIZE * GRID_SIZE * sizeof(float), GL_MAP_READ_BIT);
+			if (grid) {
+				long long start = Timer::nowNanoseconds();
+				BuildHistogram(grid);
+				averageLog = AverageLog();
+				histogramMilliseconds = (Timer::nowNanoseconds() - start) / 1000000.0f;
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+				if (!measured)
+					adaptedLog = averageLog; // the first measurement is taken as is
+				measured = true;
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+		if (!measured)
+			return;
+
+		float speed = averageLog > adaptedLog ? adaptUpSpeed : adaptDownSpeed;
+		adaptedLog += (averageLog - adaptedLog) * (1.0f - std::exp(-std::max(_deltaTime, 0.0f) * speed));
+		exposure = key / std::exp2(adaptedLog) * std::exp2(compensation);
+	}
+
+	// Reduces _hdrTexture into the own target and starts its readback.
+	void Measure(unsigned int _hdrTexture)
+	{
+		target.Bind();
+		Render(_hdrTexture);
+		Readback();
+	}
+
+	// Draws the log2 luminance grid into the bound framebuffer, which must be GRID_SIZE x GRID_SIZE.
+	void Render(unsigned int _hdrTexture)
+	{
+		GLState::Get().Disable(GL_DEPTH_TEST);
+		shader.Bind();
+		GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, _hdrTexture);
+		quad.Render();
+		GLState::Get().Enable(GL_DEPTH_TEST); // the demos keep depth testing on by default
+	}
+
+	// Copies the bound read framebuffer into the next pixel buffer and fences it.
+	void Readback()
+	{
+		if (fences[next]) {
+			skippedReadbacks++;
+			return;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[next]);
+		glReadPixels(0, 0, GRID_SIZE, GRID_SIZE, GL_RED, GL_FLOAT, nullptr);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		fences[next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		next = (next + 1) % READBACK_SLOTS;
+	}
+
+	// Forgets the adapted state, the next measurement is taken as is.
+	void Reset() { measured = false; exposure = 1.0f; }
+
+	float GetExposure() const { return exposure; }
+	// Log2 of the luminance the exposure is currently adapted to, and of the last measured one.
+	float GetAdaptedLog() const { return adaptedLog; }
+	float GetAverageLog() const { return averageLog; }
+	const unsigned int* GetHistogram() const { return histogram; }
+	float GetHistogramMilliseconds() const { return histogramMilliseconds; }
+	// Frames whose readback was dropped because the GPU was READBACK_SLOTS frames behind.
+	unsigned int GetSkippedReadbacks() const { return skippedReadbacks; }
+
+private:
+	void BuildHistogram(const float* _grid)
+	{
+		const int count = GRID_SIZE * GRID_SIZE;
+		const float scale = HISTOGRAM_BINS / std::max(maxLog - minLog, 0.001f);
+		const float lastBin = (float)(HISTOGRAM_BINS - 1);
+
+		// One sub-histogram per lane, so the four increments of a group never hit the same counter back to back
+		unsigned int lanes[4][HISTOGRAM_BINS] = {};
+		int i = 0;
+#if defined(AUTO_EXPOSURE_SSE)
+		const __m128 minimum = _mm_set1_ps(minLog);
+		const __m128 scale4 = _mm_set1_ps(scale);
+		const __m128 last4 = _mm_set1_ps(lastBin);
+		alignas(16) int bins[4];
+		for (; i + 4 <= count; i += 4) {
+			__m128 bin = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(_grid + i), minimum), scale4);
+			bin = _mm_min_ps(_mm_max_ps(bin, _mm_setzero_ps()), last4);
+			_mm_store_si128((__m128i*)bins, _mm_cvttps_epi32(bin));
+			lanes[0][bins[0]]++;
+			lanes[1][bins[1]]++;
+			lanes[2][bins[2]]++;
+			lanes[3][bins[3]]++;
+		}
+#endif
+		for (; i < count; i++) {
+			float bin = std::min(std::max((_grid[i] - minLog) * scale, 0.0f), lastBin);
+			if (!(bin >= 0.0f))
+				bin = 0.0f; // NaN from an Inf/NaN pixel passes std::min/max; the SSE path sends it to bin 0 too
+			lanes[i & 3][(int)bin]++;
+		}
+		for (int b = 0; b < HISTOGRAM_BINS; b++)
+			histogram[b] = lanes[0][b] + lanes[1][b] + lanes[2][b] + lanes[3][b];
+	}
+
+	// Mean log2 luminance of the pixels between the two percentiles, each bin standing for its center.
+	float AverageLog() const
+	{
+		const float total = (float)(GRID_SIZE * GRID_SIZE);
+		const float low = std::min(lowPercentile, highPercentile) * total;
+		const float high = std::max(lowPercentile, highPercentile) * total;
+		const float binWidth = (maxLog - minLog) / HISTOGRAM_BINS;
+
+		float cumulative = 0.0f, weightSum = 0.0f, logSum = 0.0f;
+		for (int b = 0; b < HISTOGRAM_BINS; b++) {
+			float begin = cumulative;
+			cumulative += (float)histogram[b];
+			float weight = std::max(std::min(cumulative, high) - std::max(begin, low), 0.0f);
+			logSum += weight * (minLog + (b + 0.5f) * binWidth);
+			weightSum += weight;
+		}
+		return weightSum > 0.0f ? logSum / weightSum : averageLog;
+	}
+
+	Shader shader;
+	yzh::Quad quad;
+	RenderTarget target;
+
+	unsigned int buffers[READBACK_SLOTS] = {};
+	GLsync fences[READBACK_SLOTS] = {};
+	int next = 0;
+
+	unsigned int histogram[HISTOGRAM_BINS] = {};
+	float averageLog = 0.0f;
+	float adaptedLog = 0.0f;
+	float exposure = 1.0f;
+	bool measured = false;
+	float histogramMilliseconds = 0.0f;
+	unsigned int skippedReadbacks = 0;
+};
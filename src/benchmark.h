@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <random>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "camera.h"
+#include "timer.h"
+#include "gpu_profiler.h"
+#include "camera_path.h"
+
+// Command line options of the benchmark mode, parsed by Benchmark.
+struct BenchmarkOptions
+{
+	bool enabled = false;  // --benchmark
+	int warmupFrames = 60; // --warmup=N
+	int frames = 0;        // --frames=N, at most GpuProfiler::HISTORY_FRAMES; 0 = 300 or the whole camera path
+	std::string output;    // --output=path, benchmark_<demo>.json by default
+	bool egl = false;      // --egl, create the context through EGL instead of GLX/WGL; still needs a display
+	std::string cameraPath;       // --camera-path=file, replay a recorded camera path instead of the built-in loop
+	std::string recordCameraPath; // --record-camera-path=file, record the interactive camera, saved by Finish()
+	bool hasSeed = false;         // --seed=N, seed of the demos' random generators (light placement, SSAO kernel)
+	unsigned int seed = 0;
+};
+
+// The Benchmark class turns a demo into a non-interactive benchmark when it is started with --benchmark:
+// the window is hidden, vsync is off, glfwGetTime() advances by exactly 1/60 s per frame (so every animation and
+// deltaTime is deterministic) and the camera follows a fixed loop around its start pose.
+// The hidden window is still a GLFW window, so glfwInit() needs an X11/Wayland display even with --egl; on a
+// machine without one run the benchmark under a virtual display, e.g. xvfb-run ./bloom --benchmark.
+// After the warm-up frames it records the CPU time of every frame and the GpuProfiler timings, then writes JSON
+// with the per-frame samples and p50/p95/p99 of the frame and of every GPU pass, and makes NextFrame() return false.
+// Without --benchmark every call is a no-op and NextFrame() always returns true.
+//
+// --camera-path=file replays a path recorded with --record-camera-path=file (see CameraPath) on the same fixed
+// timestep, in the benchmark or on its own, and ends the run when the path is done. Demos seed their random
+// generators with GetSeed(), which is fixed in deterministic runs, so two builds render identical frames.
+//
+// Usage Example:
+// int main(int argc, char** argv)
+// {
+//     Benchmark benchmark("ssao", argc, argv);
+//     std::mt19937 gen(benchmark.GetSeed());
+//     benchmark.ApplyWindowHints();                 // before glfwCreateWindow
+//     ... glfwMakeContextCurrent(window); glewInit(); ...
+//     benchmark.ConfigureContext();                 // after the context is current
+//     while (!glfwWindowShouldClose(window) && benchmark.NextFrame(camera)) { ... }
+//     benchmark.Finish();                           // while the context is still alive
+// }
+class Benchmark
+{
+public:
+	static constexpr float FRAME_TIME = 1.0f / 60.0f;
+
+	Benchmark(const std::string& _demo, int argc, char** argv) : demo(_demo)
+	{
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			if (arg == "--benchmark")
+				options.enabled = true;
+			else if (arg == "--egl")
+				options.egl = true;
+			else if (arg.rfind("--warmup=", 0) == 0)
+				options.warmupFrames = std::max(0, std::stoi(arg.substr(9)));
+			else if (arg.rfind("--frames=", 0) == 0)
+				options.frames = std::max(1, std::stoi(arg.substr(9)));
+			else if (arg.rfind("--output=", 0) == 0)
+				options.output = arg.substr(9);
+			else if (arg.rfind("--camera-path=", 0) == 0)
+				options.cameraPath = arg.substr(14);
+			else if (arg.rfind("--record-camera-path=", 0) == 0)
+				options.recordCameraPath = arg.substr(21);
+			else if (arg.rfind("--seed=", 0) == 0) {
+				options.hasSeed = true;
+				options.seed = (unsigned int)std::stoul(arg.substr(7));
+			}
+			else
+				std::cerr << "Warning: unknown argument " << arg << "\n";
+		}
+		if (options.output.empty())
+			options.output = "benchmark_" + demo + ".json";
+
+		if (!options.cameraPath.empty() && !replay.Load(options.cameraPath))
+			std::cerr << "Error: camera path " << options.cameraPath << " has no keyframes, using the built-in loop\n";
+		if (options.frames == 0)
+			options.frames = replay.IsEmpty() ? 300 : (int)std::ceil(replay.GetDuration() / FRAME_TIME) + 1;
+		if (options.enabled && options.frames > GpuProfiler::HISTORY_FRAMES) {
+			std::cerr << "Warning: benchmark limited to " << GpuProfiler::HISTORY_FRAMES << " frames\n";
+			options.frames = GpuProfiler::HISTORY_FRAMES;
+		}
+	}
+
+	Benchmark(const Benchmark&) = delete;
+	Benchmark& operator=(const Benchmark&) = delete;
+
+	bool IsRunning() const { return options.enabled; }
+	bool IsReplaying() const { return !replay.IsEmpty(); }
+	const BenchmarkOptions& GetOptions() const { return options; }
+
+	// Seed for the demo's random generators: --seed=N, a fixed default in benchmark/replay runs, random otherwise.
+	unsigned int GetSeed() const
+	{
+		if (options.hasSeed)
+			return options.seed;
+		if (options.enabled || IsReplaying())
+			return std::mt19937::default_seed;
+		std::random_device rd;
+		return rd();
+	}
+
+	void ApplyWindowHints() const
+	{
+		if (!options.enabled)
+			return;
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		if (options.egl)
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+	}
+
+	void ConfigureContext() const
+	{
+		if (!options.enabled)
+			return;
+		glfwSwapInterval(0);
+		std::cout << "Benchmarking " << demo << " on " << glGetString(GL_RENDERER) << ": "
+			<< options.warmupFrames << " warm-up + " << options.frames << " frames\n";
+	}
+
+	// Call once at the top of every frame. Records the previous frame and poses the camera for this one.
+	// Returns false once all measured frames (or the replayed camera path) are done.
+	bool NextFrame(Camera& camera)
+	{
+		if (!options.recordCameraPath.empty())
+			recording.Record((float)glfwGetTime(), camera);
+		if (!options.enabled && !IsReplaying())
+			return true;
+
+		// Replay without --benchmark has no warm-up: it is for looking at, not measuring
+		int warmupFrames = options.enabled ? options.warmupFrames : 0;
+		long long now = Timer::nowNanoseconds();
+		if (frame == 0) {
+			startPosition = camera.position;
+			startYaw = camera.yaw;
+			startPitch = camera.pitch;
+		}
+		if (options.enabled && frame > warmupFrames)
+			cpuMilliseconds.push_back((now - lastFrameStart) / 1000000.0f);
+		if (frame == warmupFrames)
+			firstGpuFrame = GpuProfiler::Get().GetFrameIndex();
+		if (frame == warmupFrames + options.frames)
+			return false;
+		lastFrameStart = now;
+
+		if (IsReplaying()) {
+			// The warm-up holds the first keyframe
+			replay.Apply(std::max(0, frame - warmupFrames) * FRAME_TIME, camera);
+		}
+		else {
+			// One closed loop over the measured frames: sway around the start position and look around a little
+			float t = 2.0f * 3.14159265f * (frame - warmupFrames) / options.frames;
+			camera.position = startPosition + glm::vec3(std::sin(t), 0.25f * std::sin(2.0f * t), 0.5f * (1.0f - std::cos(t)));
+			camera.SetOrientation(startYaw + 15.0f * std::sin(t), startPitch + 5.0f * std::sin(2.0f * t));
+		}
+
+		glfwSetTime(frame * FRAME_TIME);
+		frame++;
+		return true;
+	}
+
+	// Saves the recorded camera path, waits for the outstanding GPU timings and writes the JSON report.
+	void Finish()
+	{
+		if (!options.recordCameraPath.empty() && recording.Save(options.recordCameraPath)) {
+			std::cout << "Recorded " << recording.GetKeyframes().size() << " camera keyframes ("
+				<< recording.GetDuration() << " s) -> " << options.recordCameraPath << "\n";
+		}
+		if (!options.enabled)
+			return;
+
+		GpuProfiler::Get().Flush();
+		std::vector<float> gpuFrame;
+		std::map<std::string, std::vector<float>> gpuPasses;
+		for (const GpuFrameRecord& record : GpuProfiler::Get().GetHistory()) {
+			if (record.frame < firstGpuFrame || record.frame >= firstGpuFrame + options.frames)
+				continue;
+			gpuFrame.push_back(record.milliseconds);
+			for (const GpuPassSample& sample : record.passes)
+				gpuPasses[GpuProfiler::Get().GetPass(sample.pass).name].push_back(sample.milliseconds);
+		}
+
+		std::ofstream file(options.output);
+		if (!file) {
+			std::cerr << "Error: could not write " << options.output << "\n";
+			return;
+		}
+		file << "{\n";
+		file << "  \"demo\": \"" << demo << "\",\n";
+		file << "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\",\n";
+		file << "  \"warmupFrames\": " << options.warmupFrames << ",\n";
+		file << "  \"frames\": " << options.frames << ",\n";
+		file << "  \"cameraPath\": \"" << (IsReplaying() ? options.cameraPath : "") << "\",\n";
+		file << "  \"seed\": " << GetSeed() << ",\n";
+		file << "  \"gpuFramesDropped\": " << options.frames - (int)gpuFrame.size() << ",\n";
+		file << "  \"cpuFrame\": ";
+		WriteSeries(file, cpuMilliseconds, "  ");
+		file << ",\n  \"gpuFrame\": ";
+		WriteSeries(file, gpuFrame, "  ");
+		file << ",\n  \"gpuPasses\": {";
+		bool first = true;
+		for (const auto& pass : gpuPasses) {
+			file << (first ? "\n    \"" : ",\n    \"") << pass.first << "\": ";
+			WriteSeries(file, pass.second, "    ");
+			first = false;
+		}
+		file << "\n  }\n}\n";
+
+		std::vector<float> sorted = cpuMilliseconds;
+		std::sort(sorted.begin(), sorted.end());
+		std::cout << "CPU frame p50 " << Percentile(sorted, 50.0f) << " ms, p99 " << Percentile(sorted, 99.0f) << " ms; ";
+		sorted = gpuFrame;
+		std::sort(sorted.begin(), sorted.end());
+		std::cout << "GPU frame p50 " << Percentile(sorted, 50.0f) << " ms, p99 " << Percentile(sorted, 99.0f) << " ms -> "
+			<< options.output << "\n";
+	}
+
+private:
+	// Nearest-rank percentile of sorted samples.
+	static float Percentile(const std::vector<float>& sorted, float percent)
+	{
+		if (sorted.empty())
+			return 0.0f;
+		int rank = (int)std::ceil(percent / 100.0f * sorted.size());
+		return sorted[std::clamp(rank - 1, 0, (int)sorted.size() - 1)];
+	}
+
+	// { "mean": .., "p50": .., "p95": .., "p99": .., "max": .., "samples": [..] } in milliseconds
+	static void WriteSeries(std::ofstream& file, const std::vector<float>& samples, const std::string& indent)
+	{
+		std::vector<float> sorted = samples;
+		std::sort(sorted.begin(), sorted.end());
+		float sum = 0.0f;
+		for (float sample : samples)
+			sum += sample;
+
+		file << "{\n" << indent << "  \"mean\": " << (samples.empty() ? 0.0f : sum / samples.size())
+			<< ", \"p50\": " << Percentile(sorted, 50.0f)
+			<< ", \"p95\": " << Percentile(sorted, 95.0f)
+			<< ", \"p99\": " << Percentile(sorted, 99.0f)
+			<< ", \"max\": " << (sorted.empty() ? 0.0f : sorted.back()) << ",\n"
+			<< indent << "  \"samples\": [";
+		for (size_t i = 0; i < samples.size(); i++)
+			file << (i ? ", " : "") << samples[i];
+		file << "]\n" << indent << "}";
+	}
+
+	std::string demo;
+	BenchmarkOptions options;
+
+	int frame = 0;
+	long long lastFrameStart = 0;
+	unsigned long long firstGpuFrame = 0;
+	std::vector<float> cpuMilliseconds;
+
+	glm::vec3 startPosition = glm::vec3(0.0f);
+	float startYaw = 0.0f, startPitch = 0.0f;
+
+	CameraPath replay;
+	CameraPath recording;
+};
@@ -3,6 +3,10 @@
 
 #include "camera.h"
 #include "shader.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "uniform_buffer.h"
 #include "model.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -48,9 +52,9 @@ int main()
     glewInit();
 
     // configure global opengl state
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::Get().Enable(GL_DEPTH_TEST);
+    GLState::Get().Enable(GL_BLEND);
+    GLState::Get().BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -69,7 +73,7 @@ int main()
     glGenVertexArrays(1, &planeVAO);
     glGenBuffers(1, &planeVBO);
 
-    glBindVertexArray(planeVAO);
+    GLState::Get().BindVertexArray(planeVAO);
     glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
 
@@ -79,17 +83,27 @@ int main()
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glBindVertexArray(0);
+    GLState::Get().BindVertexArray(0);
 
     glm::vec3 lightPos(0.0f, 0.0f, 0.0f);
 
     unsigned int floorTexture = LoadTexture("res/textures/wood.png");
 
-    Shader shader("res/shaders/blinn_phong.vs", "res/shaders/blinn_phong.fs");
+    Shader shader(SHADER_BLINN_PHONG_VS, SHADER_BLINN_PHONG_FS);
     shader.Bind();
     shader.SetInt("floorTexture", 0);
 
+    // Shared per-frame uniform blocks
+    FrameConstants frameConstants;
+
     while (!glfwWindowShouldClose(window)) {
+        // Publish last frame's state-cache counters and start counting this frame
+        GLState::Get().NewFrame();
+        // Read back the GPU timings of an older frame and start recording this one
+        GpuProfiler::Get().BeginFrame();
+        // Build the CPU call tree of the previous frame
+        CpuProfiler::Get().NewFrame();
+
         float currentFrame = (float)glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
@@ -103,11 +117,9 @@ int main()
         shader.Bind();
         glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)width / (float)height, 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        shader.SetMat4("projection", projection);
-        shader.SetMat4("view", view);
+        frameConstants.SetCamera(projection, view, camera.position);
         shader.SetMat4("model", glm::mat4(1.0f));
 
-        shader.SetVec3("viewPos", camera.position);
         shader.SetVec3("lightPos", lightPos);
         shader.SetInt("blinn", blinn);
 
@@ -116,17 +128,24 @@ int main()
         shader.SetVec3("light.specular", glm::vec3(0.3f));
 
         // floor
-        glBindVertexArray(planeVAO);
-        glActiveTexture(GL_TEXTURE0); // Optional since we have only one texture here
-        glBindTexture(GL_TEXTURE_2D, floorTexture);
+        GpuProfiler::Get().Begin("floor");
+        GLState::Get().BindVertexArray(planeVAO);
+        GLState::Get().ActiveTexture(GL_TEXTURE0); // Optional since we have only one texture here
+        GLState::Get().BindTexture(GL_TEXTURE_2D, floorTexture);
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        GpuProfiler::Get().End();
 
         if (mode_changed) {
             std::cout << "current render mode: " << (blinn ? "Blinn-Phong" : "Phong") << std::endl;
             mode_changed = false;
         }
 
-        glfwSwapBuffers(window);
+        GpuProfiler::Get().EndFrame();
+
+        {
+            CPU_PROFILE_SCOPE("glfwSwapBuffers"); // includes the vsync wait
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
     }
 }
@@ -147,6 +166,11 @@ void processInput(GLFWwindow* window)
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
 
+    // Print the GPU pass timings and write them to gpu_profile.csv by pressing P
+    GpuProfiler::Get().ReportOnKey(glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS);
+    // Write the CPU trace (chrome://tracing, ui.perfetto.dev) to cpu_trace.json by pressing T
+    CpuProfiler::Get().ExportOnKey(glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS);
+
     // Switch mode by pressing B
     if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS && !blinnKeyPressed) {
         blinn = !blinn;
@@ -164,7 +188,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    GLState::Get().Viewport(0, 0, width, height);
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -209,7 +233,7 @@ unsigned int LoadTexture(const std::string& path)
         else if (nrComponents == 3) format = GL_RGB;
         else if (nrComponents == 4) format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -1,28 +1,42 @@
 #include <iostream>
 #include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
 #include "camera.h"
 #include "shader.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "benchmark.h"
+#include "uniform_buffer.h"
+#include "render_graph.h"
+#include "dynamic_resolution.h"
+#include "spatial_upscaler.h"
 #include "geometry_renderers.h"
+#include "render_queue.h"
 #include "model.h"
+#include "auto_exposure.h"
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_glfw.h"
 #include "imgui/imgui_impl_opengl3.h"
 
 // Function declarations (callback functions)
-void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT);
+void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void ProcessInput(GLFWwindow* window);
 unsigned int LoadTexture(const std::string& path);
 
 // Scene settings
-constexpr int SCR_WIDTH = 1920;
-constexpr int SCR_HEIGHT = 1080;
+int SCR_WIDTH = 1920;
+int SCR_HEIGHT = 1080;
 
 // Camera configs
 Camera camera(0.0f, 0.0f, 5.0f);
@@ -37,15 +51,25 @@ float lastFrame = 0.0f;
 // Bloom configs (control them in ProcessInput())
 bool bloom = true;
 bool bloomKeyPressed = false;
-float exposure = 1.0f;
-
-int main()
+float exposure = 1.0f; // with auto exposure on, a factor on top of the adapted exposure
+bool autoExposureOn = true;
+float bloomThreshold = 1.0f;
+float bloomKnee = 0.5f;
+float bloomStrength = 1.0f;
+float bloomRadius = 1.0f;
+int bloomLevels = 6; // halvings below the render resolution
+
+int main(int argc, char** argv)
 {
+	// --benchmark runs a fixed, hidden, vsync-off camera loop and writes benchmark_bloom.json
+	Benchmark benchmark("bloom", argc, argv);
+
 	// glfw & glew configs
 	GLFWwindow* window = nullptr;
 	try {
 		if (!glfwInit())
 			throw std::runtime_error("failed to init glfw");
+		benchmark.ApplyWindowHints();
 		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "hnzz", nullptr, nullptr);
 		if (!window)
 			throw std::runtime_error("failed to create window");
@@ -57,9 +81,10 @@ int main()
 
 		if (glewInit() != GLEW_OK)
 			throw std::runtime_error("failed to init glew");
+		benchmark.ConfigureContext();
 
 		// OpenGL global status settings here
-		glEnable(GL_DEPTH_TEST);
+		GLState::Get().Enable(GL_DEPTH_TEST);
 		//glEnable(GL_CULL_FACE);
 	}
 	catch (const std::runtime_error& e) {
@@ -78,81 +103,25 @@ int main()
 	ImGui_ImplOpenGL3_Init("#version 330 core");
 
 	// Build & compile shader(s)
-	// shader: Renders the scene and extracts bright areas for bloom.
-	Shader shader("res/shaders/bloom.vs", "res/shaders/bloom.fs");
+	// shader: Renders the scene.
+	Shader shader(SHADER_BLOOM_VS, SHADER_BLOOM_FS);
+
+	// shaderLight: Renders light sources.
+	Shader shaderLight(SHADER_BLOOM_VS, SHADER_BLOOM_LIGHT_BOX_FS);
 
-	// shaderLight: Renders light sources and their bright areas.
-	Shader shaderLight("res/shaders/bloom.vs", "res/shaders/bloom_light_box.fs");
+	// shaderBloomDownsample: 13-tap downsample into the bloom mip chain, the first level also extracts the bright areas.
+	Shader shaderBloomDownsample(SHADER_BLUR_VS, SHADER_BLOOM_DOWNSAMPLE_FS);
 
-	// shaderBlur: Applies 2-pass Gaussian blur to bright areas.
-	Shader shaderBlur("res/shaders/blur.vs", "res/shaders/blur.fs");
+	// shaderBloomUpsample: tent-filtered upsample, added onto the next larger level.
+	Shader shaderBloomUpsample(SHADER_BLUR_VS, SHADER_BLOOM_UPSAMPLE_FS);
 
 	// shaderBloomFinal: Combines HDR scene and blurred bloom for final output.
-	Shader shaderBloomFinal("res/shaders/bloom_final.vs", "res/shaders/bloom_final.fs");
+	Shader shaderBloomFinal(SHADER_BLOOM_FINAL_VS, SHADER_BLOOM_FINAL_FS);
 
 	// Load texture(s)
 	unsigned int woodTexture = LoadTexture("res/textures/wood.png");
 	unsigned int containerTexture = LoadTexture("res/textures/container2.png");
 
-	// Configure floating point framebuffers
-	unsigned int hdrFBO;
-	glGenFramebuffers(1, &hdrFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-
-	// Create 2 floating point color buffers (1 for normal rendering, other for brightness threshold values)
-	unsigned int colorBuffers[2];
-	glGenTextures(2, colorBuffers);
-	for (size_t i = 0; i < 2; i++) {
-		glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-		// Attach color buffer to hdrFBO
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0);
-	}
-
-	// Create & attach rbo for depth
-	unsigned int rboDepth;
-	glGenRenderbuffers(1, &rboDepth);
-	glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-
-	// Explicitly tell OpenGL render to 2 color buffers
-	// Notice: the location in fragment shader corresponds to the index in this array
-	GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-	glDrawBuffers(2, drawBuffers);
-
-	// finally check if framebuffer is complete
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "Framebuffer not complete!" << std::endl;
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	// ping-pong-framebuffer for blurring
-	unsigned int pingpongFBO[2];
-	unsigned int pingpongColorbuffers[2];
-	glGenFramebuffers(2, pingpongFBO);
-	glGenTextures(2, pingpongColorbuffers);
-	for (size_t i = 0; i < 2; i++) {
-		glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-		glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		// clamp to the edge as the blur filter would otherwise sample repeated texture values
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongColorbuffers[i], 0);
-
-		// also check if framebuffers are complete (no need for depth buffer)
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-			std::cout << "Framebuffer not complete!" << std::endl;
-	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
 	// Light positions
 	std::vector<glm::vec3> lightPositions;
 	lightPositions.push_back(glm::vec3(0.0f, 0.5f, 1.5f));
@@ -167,163 +136,292 @@ int main()
 	lightColors.push_back(glm::vec3(0.0f, 0.0f, 15.0f));
 	lightColors.push_back(glm::vec3(0.0f, 5.0f, 0.0f));
 
+	// Shared per-frame uniform blocks; the lights are static so the Lights block is written only once
+	FrameConstants frameConstants;
+	std::vector<PointLight> lights(lightPositions.size());
+	for (size_t i = 0; i < lights.size(); i++) {
+		lights[i].position = lightPositions[i];
+		lights[i].color = lightColors[i];
+	}
+	frameConstants.SetLights(lights);
+
 	// Shader configs(textures)
 	shader.Bind();
 	shader.SetInt("diffuseTexture", 0);
-	shaderBlur.Bind();
-	shaderBlur.SetInt("image", 0);
+	shaderBloomDownsample.Bind();
+	shaderBloomDownsample.SetInt("sourceTexture", 0);
+	shaderBloomUpsample.Bind();
+	shaderBloomUpsample.SetInt("sourceTexture", 0);
 	shaderBloomFinal.Bind();
 	shaderBloomFinal.SetInt("scene", 0);
 	shaderBloomFinal.SetInt("bloomBlur", 1);
 
-	// Imgui settings
-	bool firstTime = true;
-
-	while (!glfwWindowShouldClose(window)) {
-		// Per-frame logic
-		float currentFrame = glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
-
-		// Render
-		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// Process input
-		ProcessInput(window);
-
-		// Step 1: Render the Scene into a Floating-Point Framebuffer
-        // ----------------------------------------------------------
-        // In this step, we render the scene into a framebuffer with two color attachments.
-        // 'colorBuffers[0]' will store the standard HDR color data.
-        // 'colorBuffers[1]' will store only the bright parts of the scene, which will be used for the bloom effect.
-		glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-		glm::mat4 view = camera.GetViewMatrix();
-		glm::mat4 model = glm::mat4(1.0f);
-
-		shader.Bind();
-		shader.SetMat4("projection", projection);
-		shader.SetMat4("view", view);
-		//shader.SetVec3("viewPos", camera.position);
-
-		// Light uniforms
-		if (lightPositions.size() == lightColors.size()) {
-			for (int i = 0; i < lightPositions.size(); ++i) {
-				std::string posName = "lightPositions[" + std::to_string(i) + "]";
-				std::string colName = "lightColors[" + std::to_string(i) + "]";
-				shader.SetVec3(posName, lightPositions[i]);
-				shader.SetVec3(colName, lightColors[i]);
-			}
-		}
-
-		yzh::Cube cube;   // Initialize 3D cube for rendering.
-		yzh::Sphere sphere; // Initialize 3D sphere for rendering.
-		yzh::Quad quad;   // Initialize 2D quad for rendering.
+	// Create the geometry once instead of rebuilding its buffers and VAOs every frame
+	yzh::Cube cube;   // Initialize 3D cube for rendering.
+	yzh::Sphere sphere; // Initialize 3D sphere for rendering.
+	yzh::Quad quad;   // Initialize 2D quad for rendering.
+
+	// Scene geometry drawn by the first pass of the render graph
+	// ------------------------------------------------------------
+	// The draws are queued in scene order and sorted by RenderQueue, which groups them by program, texture
+	// and VAO (or by depth, see "Draw order" in the UI) before anything reaches the driver.
+	RenderQueue renderQueue;
+	int sortMode = RenderQueue::SORT_STATE;
+	auto RenderScene = [&]() {
+		renderQueue.sortMode = (RenderQueue::SortMode)sortMode;
+		renderQueue.SetCamera(camera.position, 100.0f);
 
 		// create one large cube that acts as the floor
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, woodTexture);
-		model = glm::mat4(1.0f);
+		glm::mat4 model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(0.0f, -1.0f, 0.0));
 		model = glm::scale(model, glm::vec3(12.5f, 0.5f, 12.5f));
-		shader.SetMat4("model", model);
-		cube.Render();
+		cube.Submit(renderQueue, 0, shader, model, woodTexture);
 
 		// then create multiple cubes as the scenery
-		glBindTexture(GL_TEXTURE_2D, containerTexture);
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(0.0f, 1.5f, 0.0));
 		model = glm::scale(model, glm::vec3(0.5f));
-		shader.SetMat4("model", model);
-		cube.Render();
+		cube.Submit(renderQueue, 0, shader, model, containerTexture);
 
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(2.0f, 0.0f, 1.0));
 		model = glm::scale(model, glm::vec3(0.5f));
-		shader.SetMat4("model", model);
-		cube.Render();
+		cube.Submit(renderQueue, 0, shader, model, containerTexture);
 
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(-1.0f, -1.0f, 2.0));
 		model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
-		shader.SetMat4("model", model);
-		cube.Render();
+		cube.Submit(renderQueue, 0, shader, model, containerTexture);
 
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(0.0f, 2.7f, 4.0));
 		model = glm::rotate(model, glm::radians(23.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
 		model = glm::scale(model, glm::vec3(1.25));
-		shader.SetMat4("model", model);
-		cube.Render();
+		cube.Submit(renderQueue, 0, shader, model, containerTexture);
 
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(-2.0f, 1.0f, -3.0));
 		model = glm::rotate(model, glm::radians(124.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
-		shader.SetMat4("model", model);
-		cube.Render();
+		cube.Submit(renderQueue, 0, shader, model, containerTexture);
 
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(-3.0f, 0.0f, 0.0));
 		model = glm::scale(model, glm::vec3(0.5f));
-		shader.SetMat4("model", model);
-		cube.Render();
+		cube.Submit(renderQueue, 0, shader, model, containerTexture);
 
 		// finally show all the light sources as bright cubes
 		// this is where actually the bloom affect happens
-		shaderLight.Bind();
-		shaderLight.SetMat4("projection", projection);
-		shaderLight.SetMat4("view", view);
-
 		for (size_t i = 0; i < lightPositions.size(); i++) {
 			model = glm::mat4(1.0f);
 			model = glm::translate(model, glm::vec3(lightPositions[i]));
 			model = glm::scale(model, glm::vec3(0.05f));
-			shaderLight.SetMat4("model", model);
-			shaderLight.SetVec3("lightColor", lightColors[i]);
-			sphere.Render();
+			sphere.Submit(renderQueue, 0, shaderLight, model).SetColor("lightColor", lightColors[i]);
 		}
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		// Step 2: Apply Two-Pass Gaussian Blur to Bright Fragments
-        // --------------------------------------------------------
-        // This step is a post-processing stage, so we don't need to clear the color or depth buffers.
-        // We use two framebuffers (ping-pong technique) to alternate between horizontal and vertical blur passes.
-        // This allows us to read from one framebuffer while writing to the other, avoiding read-write conflicts.
-		bool horizontal = true, first_iteration = true;
-		int amount = 10;
-		shaderBlur.Bind();
-		for (size_t i = 0; i < amount; i++) {
-			// 1. Set the framebuffer to write the blurred output to
-			glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-			// 2. Set the blur direction (horizontal or vertical)
-			shaderBlur.SetInt("horizontal", horizontal); 
-			// 3. Bind the texture to read from (either the bright parts or the result of the previous blur pass)
-			// Notice: when the first iteration, we read texture from colorBuffers[1]
-			glBindTexture(GL_TEXTURE_2D, first_iteration ? colorBuffers[1] : pingpongColorbuffers[!horizontal]);
-			quad.Render();
-
-			horizontal = !horizontal;
-			first_iteration = false;
+
+		renderQueue.Execute();
+	};
+
+	// Dynamic resolution: scene, blur and tonemap run at renderWidth x renderHeight, EASU + RCAS upscale to the window
+	DynamicResolution dynamicResolution;
+	SpatialUpscaler upscaler;
+	int renderWidth = SCR_WIDTH, renderHeight = SCR_HEIGHT;
+
+	// Eye adaptation, measured by the "auto exposure" pass and applied a frame or two later
+	AutoExposure autoExposure;
+
+	// Render graph: HDR scene -> bloom mip chain down and up -> tonemap -> upscale to the default framebuffer
+	// ------------------------------------------------------------------------------------------------------
+	// The bloom levels are transient R11F_G11F_B10F targets of half, quarter... the render resolution: the first
+	// downsample thresholds the scene, the upsamples then add each level onto the next larger one, so the whole
+	// chain touches about a third of the pixels of one full-resolution pass. The upsamples add into mips the
+	// downsamples read, which culling cannot untangle, so when bloom is disabled the chain is left out of the graph
+	// altogether; the graph is rebuilt when that toggle, the window, the render scale or the number of levels changes. The auto exposure pass writes a texture owned by AutoExposure, so it is
+	// never culled even though no pass reads it.
+	RenderGraph graph;
+	RenderResource hdrColor, depth, ldrColor, upscaled;
+	std::vector<RenderResource> bloomMips;
+	bool graphBloom = bloom;
+	int graphWidth = 0, graphHeight = 0, graphRenderWidth = 0, graphRenderHeight = 0, graphBloomLevels = 0;
+
+	auto BuildRenderGraph = [&]() {
+		graphBloom = bloom;
+		graphBloomLevels = bloomLevels;
+		graphWidth = SCR_WIDTH;
+		graphHeight = SCR_HEIGHT;
+		graphRenderWidth = renderWidth;
+		graphRenderHeight = renderHeight;
+
+		graph.Reset();
+		RenderResource backbuffer = graph.ImportBackbuffer(SCR_WIDTH, SCR_HEIGHT);
+
+		// Step 1: Render the Scene into a Floating-Point Framebuffer
+		// ----------------------------------------------------------
+		// In this step, we render the scene into a framebuffer with a single HDR color attachment.
+		// The bright parts used for the bloom effect are extracted from it by the first downsample.
+		graph.AddPass("scene",
+			[&](RenderGraph::PassBuilder& builder) {
+				hdrColor = builder.Create("hdr color", { GL_RGBA16F, renderWidth, renderHeight, GL_LINEAR });
+				depth = builder.Create("depth", { GL_DEPTH_COMPONENT24, renderWidth, renderHeight });
+			},
+			[&](const RenderGraph&) {
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				RenderScene();
+			});
+
+		// Reduce the HDR scene to a small log-luminance grid and start its (fenced, non-blocking) readback
+		RenderResource luminance = graph.ImportTexture("luminance", autoExposure.GetTexture(), AutoExposure::GetDesc());
+		graph.AddPass("auto exposure",
+			[&](RenderGraph::PassBuilder& builder) {
+				builder.Read(hdrColor);
+				builder.Write(luminance);
+			},
+			[&](const RenderGraph& g) {
+				if (!autoExposureOn)
+					return;
+				autoExposure.Render(g.GetTexture(hdrColor));
+				autoExposure.Readback();
+			});
+
+		// Step 2: Bloom mip chain
+		// ------------------------
+		// This step is a post-processing stage, so we don't need to clear the color or depth buffers.
+		// Downsample: every level reads the one above it, the first reads the HDR scene and keeps only its bright parts.
+		bloomMips.clear();
+		RenderResource blurred; // stays invalid without bloom
+		if (bloom) {
+			bloomMips.assign(bloomLevels, RenderResource());
+			RenderResource source = hdrColor;
+			int levelWidth = renderWidth, levelHeight = renderHeight;
+			for (int i = 0; i < bloomLevels; i++) {
+				levelWidth = std::max(levelWidth / 2, 1);
+				levelHeight = std::max(levelHeight / 2, 1);
+				RenderResource input = source;
+				bool prefilter = i == 0;
+				graph.AddPass(prefilter ? "bloom prefilter" : "bloom downsample",
+					[&](RenderGraph::PassBuilder& builder) {
+						builder.Read(input);
+						bloomMips[i] = builder.Create("bloom mip", { GL_R11F_G11F_B10F, levelWidth, levelHeight, GL_LINEAR });
+					},
+					[&, input, prefilter](const RenderGraph& g) {
+						shaderBloomDownsample.Bind();
+						shaderBloomDownsample.SetInt("prefilter", prefilter);
+						shaderBloomDownsample.SetFloat("threshold", bloomThreshold);
+						shaderBloomDownsample.SetFloat("knee", bloomKnee);
+						GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(input));
+						quad.Render();
+					});
+				source = bloomMips[i];
+			}
+
+			// Upsample: from the smallest level up, each level is blurred with a tent filter and added onto the next
+			// larger one, which then holds the glow of every level below it
+			for (int i = bloomLevels - 2; i >= 0; i--) {
+				RenderResource input = bloomMips[i + 1], output = bloomMips[i];
+				graph.AddPass("bloom upsample",
+					[&](RenderGraph::PassBuilder& builder) {
+						builder.Read(input);
+						builder.Write(output);
+					},
+					[&, input](const RenderGraph& g) {
+						GLState::Get().Enable(GL_BLEND);
+						GLState::Get().BlendFunc(GL_ONE, GL_ONE);
+						shaderBloomUpsample.Bind();
+						shaderBloomUpsample.SetFloat("filterRadius", bloomRadius);
+						GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(input));
+						quad.Render();
+						GLState::Get().Disable(GL_BLEND);
+					});
+			}
+			blurred = bloomMips[0];
 		}
-		
-		// 3. Render floating point color buffer to 2D quad & tonemap HDR colors to default framebuffer
-		// --------------------------------------------------------------------------------------------
-        // In this step, we render the HDR color buffer onto a 2D quad.
-        // We also apply tone mapping to convert HDR colors to the default framebuffer's color range.
-		glBindFramebuffer(GL_FRAMEBUFFER, 0); // Switch to default framebuffer
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		shaderBloomFinal.Bind();
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, colorBuffers[0]);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[!horizontal]);
-		shaderBloomFinal.SetInt("bloom", bloom);
-		shaderBloomFinal.SetFloat("exposure", exposure);
-		quad.Render();
+
+		// Step 3: Render floating point color buffer to 2D quad & tonemap HDR colors to LDR
+		// ----------------------------------------------------------------------------------
+		// In this step, we render the HDR color buffer onto a 2D quad.
+		// We also apply tone mapping to convert HDR colors to the displayable color range.
+		graph.AddPass("tonemap",
+			[&](RenderGraph::PassBuilder& builder) {
+				builder.Read(hdrColor);
+				if (blurred.IsValid())
+					builder.Read(blurred);
+				ldrColor = builder.Create("ldr color", { GL_RGBA8, renderWidth, renderHeight });
+			},
+			[&, blurred](const RenderGraph& g) {
+				glClear(GL_COLOR_BUFFER_BIT);
+				shaderBloomFinal.Bind();
+				// Every level adds its own copy of the bright areas, keep the total independent of the level count
+				shaderBloomFinal.SetFloat("bloomStrength", bloomStrength / (float)graphBloomLevels);
+				GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(hdrColor));
+				GLState::Get().BindTextureUnit(1, GL_TEXTURE_2D, blurred.IsValid() ? g.GetTexture(blurred) : 0);
+				quad.Render();
+			});
+
+		// Step 4: Upscale the tonemapped image to the default framebuffer (FSR1 EASU, then RCAS)
+		// ---------------------------------------------------------------------------------------
+		graph.AddPass("easu",
+			[&](RenderGraph::PassBuilder& builder) {
+				builder.Read(ldrColor);
+				upscaled = builder.Create("upscaled", { GL_RGBA8, SCR_WIDTH, SCR_HEIGHT });
+			},
+			[&](const RenderGraph& g) {
+				upscaler.RenderEASU(g.GetTexture(ldrColor), SCR_WIDTH, SCR_HEIGHT);
+			});
+
+		graph.AddPass("rcas",
+			[&](RenderGraph::PassBuilder& builder) {
+				builder.Read(upscaled);
+				builder.Write(backbuffer);
+			},
+			[&](const RenderGraph& g) {
+				upscaler.RenderRCAS(g.GetTexture(upscaled));
+			});
+
+		graph.Compile();
+	};
+	BuildRenderGraph();
+
+	// Imgui settings
+	bool firstTime = true;
+
+	while (!glfwWindowShouldClose(window) && benchmark.NextFrame(camera)) {
+		// Publish last frame's state-cache counters and start counting this frame
+		GLState::Get().NewFrame();
+		// Drop render targets that stayed idle since the last resize
+		RenderTargetPool::Get().NewFrame();
+		// Read back the GPU timings of an older frame and start recording this one
+		GpuProfiler::Get().BeginFrame();
+		// Build the CPU call tree of the previous frame
+		CpuProfiler::Get().NewFrame();
+
+		// Per-frame logic
+		float currentFrame = glfwGetTime();
+		deltaTime = currentFrame - lastFrame;
+		lastFrame = currentFrame;
+
+		// Render
+		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+
+		// Process input
+		ProcessInput(window);
+
+		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+		glm::mat4 view = camera.GetViewMatrix();
+
+		frameConstants.SetCamera(projection, view, camera.position);
+		// Adapt to the luminance measured in earlier frames
+		if (autoExposureOn)
+			autoExposure.Update(deltaTime);
+		frameConstants.SetPostParams(autoExposureOn ? autoExposure.GetExposure() * exposure : exposure, bloom, true);
+
+		// Internal resolution for this frame, from the GPU time measured a few frames ago
+		dynamicResolution.Update(GpuProfiler::Get().GetLastFrameMilliseconds());
+		renderWidth = dynamicResolution.Scale(SCR_WIDTH);
+		renderHeight = dynamicResolution.Scale(SCR_HEIGHT);
+
+		bool sizeChanged = SCR_WIDTH != graphWidth || SCR_HEIGHT != graphHeight || renderWidth != graphRenderWidth || renderHeight != graphRenderHeight;
+		if (bloom != graphBloom || bloomLevels != graphBloomLevels || (sizeChanged && SCR_WIDTH > 0 && SCR_HEIGHT > 0))
+			BuildRenderGraph();
+		graph.Execute();
 
 		// ImGui code here
 		// ---------------
@@ -342,19 +440,66 @@ int main()
 		}
 		ImGui::Begin("hnzz");
 		ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
+		ImGui::Text("GL state changes: %u issued, %u filtered", GLState::Get().GetFrameCounters().issued, GLState::Get().GetFrameCounters().filtered);
+		ImGui::Text("Shader stages: %u compiled, %u reused", ShaderCache::Get().GetStats().stagesCompiled, ShaderCache::Get().GetStats().stageHits);
+		ImGui::Text("Shader sources: %u embedded, %u file opens, %.2f ms", Shader::GetLoadStats().embeddedSources, Shader::GetLoadStats().fileOpens, Shader::GetLoadStats().loadMicroseconds / 1000.0f);
+		ImGui::Text("Render targets: %.1f MB (%.1f MB unaliased), %u/%u passes culled", graph.GetStats().allocatedBytes / (1024.0f * 1024.0f), graph.GetStats().unaliasedBytes / (1024.0f * 1024.0f), graph.GetStats().culledPasses, graph.GetStats().passes);
+		ImGui::Text("Render target pool: %u textures (%.1f MB), %u idle", RenderTargetPool::Get().GetStats().textures, RenderTargetPool::Get().GetStats().bytes / (1024.0f * 1024.0f), RenderTargetPool::Get().GetStats().idleTextures);
+		ImGui::Checkbox("Dynamic resolution", &dynamicResolution.enabled);
+		ImGui::SliderFloat("Target GPU time (ms)", &dynamicResolution.targetMilliseconds, 2.0f, 33.0f);
+		ImGui::SliderFloat("Manual scale", &dynamicResolution.manualScale, dynamicResolution.minScale, dynamicResolution.maxScale);
+		ImGui::SliderFloat("Sharpness (stops)", &upscaler.sharpness, 0.0f, 2.0f);
+		ImGui::Text("Render scale: %.2f (%d x %d)", dynamicResolution.GetScale(), renderWidth, renderHeight);
+		ImGui::Combo("Draw order", &sortMode, "State\0Front to back\0Back to front\0");
+		ImGui::Text("Draw queue: %u draws, %u program / %u texture / %u VAO changes", renderQueue.GetStats().packets, renderQueue.GetStats().programChanges, renderQueue.GetStats().materialChanges, renderQueue.GetStats().vertexArrayChanges);
 		ImGui::Checkbox("Enable Bloom", &bloom);
 		ImGui::SliderFloat("Exposure", &exposure, 0.1f, 5.0f);
+		ImGui::Checkbox("Auto exposure", &autoExposureOn);
+		if (autoExposureOn) {
+			ImGui::SliderFloat("Exposure compensation (stops)", &autoExposure.compensation, -4.0f, 4.0f);
+			ImGui::SliderFloat("Adapt up speed", &autoExposure.adaptUpSpeed, 0.1f, 10.0f);
+			ImGui::SliderFloat("Adapt down speed", &autoExposure.adaptDownSpeed, 0.1f, 10.0f);
+			ImGui::DragFloatRange2("Luminance range (log2)", &autoExposure.minLog, &autoExposure.maxLog, 0.1f, -16.0f, 16.0f);
+			ImGui::DragFloatRange2("Percentiles", &autoExposure.lowPercentile, &autoExposure.highPercentile, 0.005f, 0.0f, 1.0f);
+			ImGui::PlotHistogram("Luminance histogram",
+				[](void* data, int i) { return (float)((const unsigned int*)data)[i]; },
+				(void*)autoExposure.GetHistogram(), AutoExposure::HISTOGRAM_BINS, 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+			ImGui::Text("Adapted exposure: %.3f (average luminance %.4f, adapted to %.4f)", autoExposure.GetExposure(), std::exp2(autoExposure.GetAverageLog()), std::exp2(autoExposure.GetAdaptedLog()));
+			ImGui::Text("Histogram: %.4f ms CPU, %u readbacks skipped", autoExposure.GetHistogramMilliseconds(), autoExposure.GetSkippedReadbacks());
+		}
+		ImGui::SliderFloat("Bloom threshold", &bloomThreshold, 0.0f, 10.0f);
+		ImGui::SliderFloat("Bloom knee", &bloomKnee, 0.0f, 2.0f);
+		ImGui::SliderFloat("Bloom strength", &bloomStrength, 0.0f, 4.0f);
+		ImGui::SliderFloat("Bloom radius (texels)", &bloomRadius, 0.5f, 3.0f);
+		ImGui::SliderInt("Bloom levels", &bloomLevels, 1, 8);
+		ImGui::End();
+
+		// GPU pass timings and the CPU call tree
+		ImGui::SetNextWindowSize(ImVec2(400, 500), ImGuiCond_FirstUseEver);
+		ImGui::SetNextWindowPos(ImVec2(600, 50), ImGuiCond_FirstUseEver);
+		ImGui::Begin("Profiler");
+		GpuProfiler::Get().DrawImGui();
+		CpuProfiler::Get().DrawImGui();
 		ImGui::End();
 
 		// ImGui Rendering
 		ImGui::Render();
+		GpuProfiler::Get().Begin("imgui");
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		GpuProfiler::Get().End();
+
+		GpuProfiler::Get().EndFrame();
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-		glfwSwapBuffers(window);
+		{
+			CPU_PROFILE_SCOPE("glfwSwapBuffers"); // includes the vsync wait
+			glfwSwapBuffers(window);
+		}
 		glfwPollEvents();
 	}
 
+	benchmark.Finish();
+
 	// Optional: release all the resources of OpenGL (VAO, VBO, etc.)
 
 	glfwTerminate();
@@ -366,11 +511,13 @@ int main()
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
-void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT)
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
 	// make sure the viewport matches the new window dimensions; note that SCR_WIDTH and 
 	// SCR_HEIGHT will be significantly larger than specified on retina displays.
-	glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+	GLState::Get().Viewport(0, 0, width, height);
+	SCR_WIDTH = width;
+	SCR_HEIGHT = height;
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -459,7 +606,7 @@ unsigned int LoadTexture(const std::string& path)
 			return -1;
 		}
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -0,0 +1,574 @@
+#pragma once
+
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "frustum_culling.h"
+#include "timer.h"
+
+// Axis-aligned bounding box, empty (min > max) until something is added to it.
+struct AABB
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	AABB() = default;
+	AABB(const glm::vec3& _min, const glm::vec3& _max) : min(_min), max(_max) {}
+
+	// World-space AABB of the local box _min/_max transformed by _model (Arvo).
+	static AABB Transformed(const glm::vec3& _min, const glm::vec3& _max, const glm::mat4& _model)
+	{
+		glm::vec3 center = glm::vec3(_model * glm::vec4(0.5f * (_min + _max), 1.0f));
+		glm::vec3 extent = 0.5f * (_max - _min);
+		glm::mat3 absolute(glm::abs(glm::vec3(_model[0])), glm::abs(glm::vec3(_model[1])), glm::abs(glm::vec3(_model[2])));
+		extent = absolute * extent;
+		return AABB(center - extent, center + extent);
+	}
+
+	void Grow(const glm::vec3& _point) { min = glm::min(min, _point); max = glm::max(max, _point); }
+	void Grow(const AABB& _box) { min = glm::min(min, _box.min); max = glm::max(max, _box.max); }
+
+	glm::vec3 Center() const { return 0.5f * (min + max); }
+	glm::vec3 Extent() const { return 0.5f * (max - min); }
+
+	bool IsEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+	// Half the surface area, which is all the SAH needs.
+	float HalfArea() const
+	{
+		if (IsEmpty())
+			return 0.0f;
+		glm::vec3 size = max - min;
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	bool Overlaps(const AABB& _box) const
+	{
+		return min.x <= _box.max.x && max.x >= _box.min.x && min.y <= _box.max.y && max.y >= _box.min.y &&
+			min.z <= _box.max.z && max.z >= _box.min.z;
+	}
+};
+
+// A ray with its reciprocal direction precomputed for the slab tests. Direction does not need to be normalized:
+// hit distances are in units of the direction's length, so a ray moved into an object's local space with
+// Transformed() reports the same distances as the world-space one.
+struct Ray
+{
+	glm::vec3 origin = glm::vec3(0.0f);
+	glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+	glm::vec3 invDirection = glm::vec3(0.0f, 0.0f, -1.0f);
+
+	Ray() = default;
+	Ray(const glm::vec3& _origin, const glm::vec3& _direction)
+		: origin(_origin), direction(_direction), invDirection(1.0f / _direction) {}
+
+	// The ray through window pixel (_x, _y), top-left origin as GLFW reports the cursor.
+	// _inverseViewProjection is glm::inverse(projection * view).
+	static Ray FromScreen(float _x, float _y, float _width, float _height, const glm::mat4& _inverseViewProjection)
+	{
+		const glm::mat4& inverseViewProjection = _inverseViewProjection;
+		float ndcX = 2.0f * _x / _width - 1.0f;
+		float ndcY = 1.0f - 2.0f * _y / _height;
+		glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+		glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+		glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+		return Ray(origin, glm::normalize(glm::vec3(farPoint) / farPoint.w - origin));
+	}
+
+	// The same ray in the space _inverseModel maps to (usually an object's local space).
+	Ray Transformed(const glm::mat4& _inverseModel) const
+	{
+		return Ray(glm::vec3(_inverseModel * glm::vec4(origin, 1.0f)), glm::vec3(_inverseModel * glm::vec4(direction, 0.0f)));
+	}
+
+	glm::vec3 At(float _distance) const { return origin + _distance * direction; }
+
+	// Entry distance into the box, or FLT_MAX if the ray misses it or only reaches it beyond _maxDistance.
+	float IntersectBox(const glm::vec3& _min, const glm::vec3& _max, float _maxDistance) const
+	{
+		glm::vec3 t0 = (_min - origin) * invDirection;
+		glm::vec3 t1 = (_max - origin) * invDirection;
+		glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+		float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, _maxDistance));
+		return enter <= exit ? enter : FLT_MAX;
+	}
+
+	// Moller-Trumbore, returns the distance or FLT_MAX. Both faces count as hits.
+	float IntersectTriangle(const glm::vec3& _a, const glm::vec3& _b, const glm::vec3& _c) const
+	{
+		glm::vec3 edge1 = _b - _a, edge2 = _c - _a;
+		glm::vec3 p = glm::cross(direction, edge2);
+		float determinant = glm::dot(edge1, p);
+		if (std::abs(determinant) < 1e-12f)
+			return FLT_MAX;
+		float inverseDeterminant = 1.0f / determinant;
+		glm::vec3 s = origin - _a;
+		float u = glm::dot(s, p) * inverseDeterminant;
+		if (u < 0.0f || u > 1.0f)
+			return FLT_MAX;
+		glm::vec3 q = glm::cross(s, edge1);
+		float v = glm::dot(direction, q) * inverseDeterminant;
+		if (v < 0.0f || u + v > 1.0f)
+			return FLT_MAX;
+		float distance = glm::dot(edge2, q) * inverseDeterminant;
+		return distance > 0.0f ? distance : FLT_MAX;
+	}
+};
+
+// Closest hit of a ray query. 'distance' doubles as the search limit: queries only report hits closer than it.
+struct RayHit
+{
+	static constexpr unsigned int NONE = ~0u;
+
+	float distance = FLT_MAX;
+	unsigned int object = NONE;   // SceneBVH object index
+	unsigned int mesh = NONE;     // mesh of the object's Model
+	unsigned int triangle = NONE; // triangle of that mesh (index into its indices / 3)
+
+	bool IsValid() const { return object != NONE || triangle != NONE; }
+};
+
+// The BVH class is a bounding volume hierarchy over any list of primitive bounds, built top-down with the binned
+// surface area heuristic (SAH). Nodes are 32 bytes; the two children of a node are stored next to each other and
+// always after their parent, so Refit() can recompute all bounds bottom-up in a single reverse pass when the
+// primitives move but the tree topology is kept. Cost() returns the SAH cost of the current tree, which grows as
+// refits degrade it; comparing it to the cost right after Build() tells when a rebuild pays off.
+//
+// The queries are templates taking the primitive test as a callable, so the same tree serves triangles (TriangleBVH)
+// and scene objects (SceneBVH).
+//
+// Usage Example:
+// BVH bvh;
+// bvh.Build(primitiveBounds, 4);
+// float closest = FLT_MAX;
+// bvh.Raycast(ray, closest, [&](unsigned int primitive, float& distance) {
+//     distance = std::min(distance, IntersectPrimitive(ray, primitive));
+// });
+class BVH
+{
+public:
+	struct Node
+	{
+		glm::vec3 min;
+		unsigned int first; // leaf: first entry in the primitive list, interior: index of the left child
+		glm::vec3 max;
+		unsigned int count; // leaf: number of primitives, interior: 0
+
+		bool IsLeaf() const { return count > 0; }
+	};
+
+	void Build(const std::vector<AABB>& _bounds, unsigned int _maxLeafSize)
+	{
+		nodes.clear();
+		depth = 0;
+		primitives.resize(_bounds.size());
+		for (unsigned int i = 0; i < (unsigned int)_bounds.size(); i++)
+			primitives[i] = i;
+		maxLeafSize = std::max(_maxLeafSize, 1u);
+		if (_bounds.empty())
+			return;
+
+		centroids.resize(_bounds.size());
+		for (size_t i = 0; i < _bounds.size(); i++)
+			centroids[i] = _bounds[i].Center();
+
+		nodes.reserve(2 * _bounds.size());
+		nodes.push_back(Node());
+		nodes[0].first = 0;
+		nodes[0].count = (unsigned int)_bounds.size();
+		Subdivide(0, _bounds, 0);
+	}
+
+	// Recomputes every node's bounds from the new primitive bounds, keeping the topology.
+	void Refit(const std::vector<AABB>& _bounds)
+	{
+		for (size_t i = nodes.size(); i-- > 0;) {
+			Node& node = nodes[i];
+			AABB box;
+			if (node.IsLeaf()) {
+				for (unsigned int p = node.first; p < node.first + node.count; p++)
+					box.Grow(_bounds[primitives[p]]);
+			}
+			else {
+				box = AABB(nodes[node.first].min, nodes[node.first].max);
+				box.Grow(AABB(nodes[node.first + 1].min, nodes[node.first + 1].max));
+			}
+			node.min = box.min;
+			node.max = box.max;
+		}
+	}
+
+	// SAH cost: expected number of node visits plus primitive tests for a random ray hitting the root.
+	float Cost() const
+	{
+		if (nodes.empty())
+			return 0.0f;
+		float rootArea = std::max(AABB(nodes[0].min, nodes[0].max).HalfArea(), FLT_MIN);
+		float cost = 0.0f;
+		for (const Node& node : nodes)
+			cost += AABB(node.min, node.max).HalfArea() / rootArea * (node.IsLeaf() ? (float)node.count : TRAVERSAL_COST);
+		return cost;
+	}
+
+	// Calls _intersect(primitive, distance) for every primitive whose node the ray enters closer than 'distance';
+	// the callable lowers 'distance' on a hit, which prunes the rest of the traversal. Near child first.
+	template<typename Intersect>
+	void Raycast(const Ray& _ray, float& _distance, Intersect&& _intersect) const
+	{
+		if (nodes.empty() || _ray.IntersectBox(nodes[0].min, nodes[0].max, _distance) == FLT_MAX)
+			return;
+		unsigned int stack[STACK_SIZE];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Node& node = nodes[stack[--top]];
+			if (node.IsLeaf()) {
+				for (unsigned int p = node.first; p < node.first + node.count; p++)
+					_intersect(primitives[p], _distance);
+				continue;
+			}
+			unsigned int nearChild = node.first, farChild = node.first + 1;
+			float nearDistance = _ray.IntersectBox(nodes[nearChild].min, nodes[nearChild].max, _distance);
+			float farDistance = _ray.IntersectBox(nodes[farChild].min, nodes[farChild].max, _distance);
+			if (farDistance < nearDistance) {
+				std::swap(nearChild, farChild);
+				std::swap(nearDistance, farDistance);
+			}
+			// Far child first on the stack, so the near one is popped (and can shrink _distance) before it
+			if (farDistance != FLT_MAX)
+				stack[top++] = farChild;
+			if (nearDistance != FLT_MAX)
+				stack[top++] = nearChild;
+		}
+	}
+
+	// Calls _visit(primitive) for every primitive in a leaf whose bounds pass _test(min, max).
+	template<typename Test, typename Visit>
+	void Query(Test&& _test, Visit&& _visit) const
+	{
+		if (nodes.empty())
+			return;
+		unsigned int stack[STACK_SIZE];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Node& node = nodes[stack[--top]];
+			if (!_test(node.min, node.max))
+				continue;
+			if (node.IsLeaf()) {
+				for (unsigned int p = node.first; p < node.first + node.count; p++)
+					_visit(primitives[p]);
+			}
+			else {
+				stack[top++] = node.first + 1;
+				stack[top++] = node.first;
+			}
+		}
+	}
+
+	bool IsEmpty() const { return nodes.empty(); }
+	size_t GetNodeCount() const { return nodes.size(); }
+	// Deepest leaf, root = 0; never more than MAX_DEPTH.
+	int GetDepth() const { return depth; }
+	const std::vector<Node>& GetNodes() const { return nodes; }
+
+private:
+	static constexpr int BINS = 12;
+	static constexpr int STACK_SIZE = 64;
+	// The traversal stacks hold at most one pending sibling per level plus two children, i.e. depth + 1 entries.
+	// Degenerate splits (coincident centroids) could go deeper, so nodes at this depth stay leaves.
+	static constexpr int MAX_DEPTH = STACK_SIZE - 1;
+	static constexpr float TRAVERSAL_COST = 1.0f; // relative to one primitive test
+
+	void Subdivide(unsigned int _nodeIndex, const std::vector<AABB>& _bounds, int _depth)
+	{
+		// Copy, not a reference: push_back below may reallocate 'nodes'
+		Node node = nodes[_nodeIndex];
+		AABB box, centroidBox;
+		for (unsigned int p = node.first; p < node.first + node.count; p++) {
+			box.Grow(_bounds[primitives[p]]);
+			centroidBox.Grow(centroids[primitives[p]]);
+		}
+		nodes[_nodeIndex].min = box.min;
+		nodes[_nodeIndex].max = box.max;
+		depth = std::max(depth, _depth);
+		if (node.count <= maxLeafSize || _depth >= MAX_DEPTH)
+			return;
+
+		// Binned SAH over the centroid bounds, on every axis
+		int bestAxis = -1, bestSplit = 0;
+		float bestCost = FLT_MAX;
+		for (int axis = 0; axis < 3; axis++) {
+			float low = centroidBox.min[axis], high = centroidBox.max[axis];
+			if (high - low <= 0.0f)
+				continue;
+			AABB binBoxes[BINS];
+			unsigned int binCounts[BINS] = {};
+			float scale = BINS / (high - low);
+			for (unsigned int p = node.first; p < node.first + node.count; p++) {
+				int bin = std::min(BINS - 1, (int)((centroids[primitives[p]][axis] - low) * scale));
+				binBoxes[bin].Grow(_bounds[primitives[p]]);
+				binCounts[bin]++;
+			}
+
+			// Sweep from both sides: cost of splitting after bin i
+			float leftArea[BINS - 1], rightArea[BINS - 1];
+			unsigned int leftCount[BINS - 1], rightCount[BINS - 1];
+			AABB leftBox, rightBox;
+			unsigned int leftSum = 0, rightSum = 0;
+			for (int i = 0; i < BINS - 1; i++) {
+				leftSum += binCounts[i];
+				leftCount[i] = leftSum;
+				leftBox.Grow(binBoxes[i]);
+				leftArea[i] = leftBox.HalfArea();
+				rightSum += binCounts[BINS - 1 - i];
+				rightCount[BINS - 2 - i] = rightSum;
+				rightBox.Grow(binBoxes[BINS - 1 - i]);
+				rightArea[BINS - 2 - i] = rightBox.HalfArea();
+			}
+			for (int i = 0; i < BINS - 1; i++) {
+				if (leftCount[i] == 0 || rightCount[i] == 0)
+					continue;
+				float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = i;
+				}
+			}
+		}
+
+		unsigned int middle;
+		if (bestAxis < 0) {
+			// All centroids coincide: no plane separates them, split the list in half
+			middle = node.first + node.count / 2;
+		}
+		else {
+			// Not worth splitting when the leaf is cheaper than traversal plus both children
+			float leafCost = box.HalfArea() * node.count;
+			if (bestCost + TRAVERSAL_COST * box.HalfArea() >= leafCost && node.count <= 4 * maxLeafSize)
+				return;
+			float low = centroidBox.min[bestAxis];
+			float scale = BINS / (centroidBox.max[bestAxis] - low);
+			unsigned int* begin = primitives.data() + node.first;
+			unsigned int* split = std::partition(begin, begin + node.count, [&](unsigned int primitive) {
+				return std::min(BINS - 1, (int)((centroids[primitive][bestAxis] - low) * scale)) <= bestSplit;
+			});
+			middle = (unsigned int)(split - primitives.data());
+		}
+
+		unsigned int left = (unsigned int)nodes.size();
+		nodes.push_back(Node());
+		nodes.push_back(Node());
+		nodes[left].first = node.first;
+		nodes[left].count = middle - node.first;
+		nodes[left + 1].first = middle;
+		nodes[left + 1].count = node.first + node.count - middle;
+		nodes[_nodeIndex].first = left;
+		nodes[_nodeIndex].count = 0;
+		Subdivide(left, _bounds, _depth + 1);
+		Subdivide(left + 1, _bounds, _depth + 1);
+	}
+
+private:
+	std::vector<Node> nodes;
+	std::vector<unsigned int> primitives; // leaves reference ranges of this list
+	std::vector<glm::vec3> centroids;     // build scratch
+	unsigned int maxLeafSize = 4;
+	int depth = 0;
+};
+
+// The TriangleBVH class is a static BVH over the triangles of one mesh, built once at import (see Model), for exact
+// ray casts against the geometry. Positions are copied in, the GPU buffers stay untouched.
+//
+// Usage Example:
+// TriangleBVH bvh;
+// bvh.Build(positions, indices);
+// RayHit hit;
+// if (bvh.Raycast(localRay, hit)) ... // hit.triangle, hit.distance
+class TriangleBVH
+{
+public:
+	void Build(const std::vector<glm::vec3>& _positions, const std::vector<unsigned int>& _indices)
+	{
+		long long start = Timer::nowNanoseconds();
+		size_t triangleCount = _indices.size() / 3;
+		corners.resize(triangleCount * 3);
+		std::vector<AABB> bounds(triangleCount);
+		for (size_t i = 0; i < triangleCount; i++) {
+			for (int corner = 0; corner < 3; corner++) {
+				corners[i * 3 + corner] = _positions[_indices[i * 3 + corner]];
+				bounds[i].Grow(corners[i * 3 + corner]);
+			}
+		}
+		bvh.Build(bounds, 4);
+		buildMilliseconds = (Timer::nowNanoseconds() - start) / 1000000.0f;
+	}
+
+	// Closest triangle closer than hit.distance; fills hit.distance and hit.triangle and returns true if found.
+	bool Raycast(const Ray& _ray, RayHit& _hit) const
+	{
+		unsigned int closest = RayHit::NONE;
+		bvh.Raycast(_ray, _hit.distance, [&](unsigned int triangle, float& distance) {
+			float t = _ray.IntersectTriangle(corners[triangle * 3], corners[triangle * 3 + 1], corners[triangle * 3 + 2]);
+			if (t < distance) {
+				distance = t;
+				closest = triangle;
+			}
+		});
+		if (closest == RayHit::NONE)
+			return false;
+		_hit.triangle = closest;
+		return true;
+	}
+
+	size_t GetTriangleCount() const { return corners.size() / 3; }
+	size_t GetNodeCount() const { return bvh.GetNodeCount(); }
+	float GetBuildMilliseconds() const { return buildMilliseconds; }
+
+private:
+	BVH bvh;
+	std::vector<glm::vec3> corners; // three per triangle
+	float buildMilliseconds = 0.0f;
+};
+
+// Build/refit statistics of a SceneBVH.
+struct SceneBVHStats
+{
+	float buildMilliseconds = 0.0f; // last full SAH build
+	float refitMilliseconds = 0.0f; // last refit
+	unsigned int builds = 0;
+	unsigned int refits = 0;
+	unsigned int nodes = 0;
+	float cost = 0.0f;      // SAH cost of the current tree
+	float builtCost = 0.0f; // SAH cost right after the last build
+};
+
+// The SceneBVH class indexes the world-space bounds of the scene's objects for ray casts, frustum queries and box
+// overlaps. Objects that move only update their bounds; Update() refits the tree in place, which is much cheaper
+// than building it, and falls back to a full SAH build once the refitted tree's cost exceeds rebuildThreshold times
+// its cost after the last build (or when objects were added). The narrow phase of a ray cast is left to the caller,
+// e.g. Model::Raycast against the per-mesh triangle BVHs.
+//
+// Usage Example:
+// SceneBVH scene;
+// unsigned int id = scene.Add(AABB::Transformed(localMin, localMax, model));
+// scene.SetBounds(id, AABB::Transformed(localMin, localMax, newModel)); // it moved
+// scene.Update(); // once per frame, after the moves
+// RayHit hit;
+// scene.Raycast(ray, hit, [&](unsigned int object, const Ray& ray, RayHit& hit) {
+//     return models[object].Raycast(ray.Transformed(inverseModels[object]), hit);
+// });
+class SceneBVH
+{
+public:
+	// Rebuild when the refitted SAH cost grows past this factor of the freshly built cost.
+	float rebuildThreshold = 1.3f;
+
+	// Returns the object index, which the queries report. Takes effect at the next Update().
+	unsigned int Add(const AABB& _bounds)
+	{
+		objectBounds.push_back(_bounds);
+		structureChanged = true;
+		return (unsigned int)objectBounds.size() - 1;
+	}
+
+	void SetBounds(unsigned int _object, const AABB& _bounds)
+	{
+		objectBounds[_object] = _bounds;
+		moved = true;
+	}
+
+	const AABB& GetBounds(unsigned int _object) const { return objectBounds[_object]; }
+	size_t Size() const { return objectBounds.size(); }
+
+	void Update()
+	{
+		if (structureChanged) {
+			Rebuild();
+			return;
+		}
+		if (!moved)
+			return;
+		long long start = Timer::nowNanoseconds();
+		bvh.Refit(objectBounds);
+		stats.refitMilliseconds = (Timer::nowNanoseconds() - start) / 1000000.0f;
+		stats.refits++;
+		stats.cost = bvh.Cost();
+		moved = false;
+		if (stats.cost > rebuildThreshold * stats.builtCost)
+			Rebuild();
+	}
+
+	void Rebuild()
+	{
+		long long start = Timer::nowNanoseconds();
+		bvh.Build(objectBounds, 1);
+		stats.buildMilliseconds = (Timer::nowNanoseconds() - start) / 1000000.0f;
+		stats.builds++;
+		stats.nodes = (unsigned int)bvh.GetNodeCount();
+		stats.cost = stats.builtCost = bvh.Cost();
+		structureChanged = moved = false;
+	}
+
+	// Closest hit among the objects whose bounds the ray enters. _narrowPhase(object, ray, hit) tests the object's
+	// actual geometry, and on a hit closer than hit.distance updates hit (distance, mesh, triangle) and returns true.
+	// Objects without finer geometry can simply return their box distance.
+	template<typename NarrowPhase>
+	bool Raycast(const Ray& _ray, RayHit& _hit, NarrowPhase&& _narrowPhase) const
+	{
+		unsigned int closest = RayHit::NONE;
+		bvh.Raycast(_ray, _hit.distance, [&](unsigned int object, float& distance) {
+			const AABB& box = objectBounds[object];
+			if (_ray.IntersectBox(box.min, box.max, distance) == FLT_MAX)
+				return;
+			RayHit candidate;
+			candidate.distance = distance;
+			if (_narrowPhase(object, _ray, candidate) && candidate.distance < distance) {
+				distance = candidate.distance;
+				_hit = candidate;
+				closest = object;
+			}
+		});
+		if (closest == RayHit::NONE)
+			return false;
+		_hit.object = closest;
+		return true;
+	}
+
+	// Objects whose bounds intersect the frustum, appended to _objects.
+	void QueryFrustum(const Frustum& _frustum, std::vector<unsigned int>& _objects) const
+	{
+		bvh.Query([&](const glm::vec3& min, const glm::vec3& max) {
+			return _frustum.TestBox(0.5f * (min + max), 0.5f * (max - min));
+		}, [&](unsigned int object) {
+			if (_frustum.TestBox(objectBounds[object].Center(), objectBounds[object].Extent()))
+				_objects.push_back(object);
+		});
+	}
+
+	// Objects whose bounds overlap _box, appended to _objects.
+	void QueryBox(const AABB& _box, std::vector<unsigned int>& _objects) const
+	{
+		bvh.Query([&](const glm::vec3& min, const glm::vec3& max) {
+			return _box.Overlaps(AABB(min, max));
+		}, [&](unsigned int object) {
+			if (_box.Overlaps(objectBounds[object]))
+				_objects.push_back(object);
+		});
+	}
+
+	const SceneBVHStats& GetStats() const { return stats; }
+
+private:
+	BVH bvh;
+	std::vector<AABB> objectBounds;
+	bool structureChanged = false;
+	bool moved = false;
+	SceneBVHStats stats;
+};
@@ -63,6 +63,9 @@ public:
     // processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
     void ProcessMouseScroll(float yoffset);
 
+    // sets the Euler angles (in degrees) directly, e.g. for scripted camera paths
+    void SetOrientation(float _yaw, float _pitch);
+
 private:
     // calculates the front vector from the Camera's (updated) Euler Angles
     void UpdateCameraVectors();
@@ -127,6 +130,13 @@ void Camera::ProcessMouseScroll(float yoffset)
         fov = 45.0f;
 }
 
+void Camera::SetOrientation(float _yaw, float _pitch)
+{
+    yaw = _yaw;
+    pitch = _pitch;
+    UpdateCameraVectors();
+}
+
 void Camera::UpdateCameraVectors()
 {
     // calculate the new direction vector
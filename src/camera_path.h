@@ -0,0 +1,148 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+
+// One recorded camera pose. time is in seconds from the start of the recording.
+struct CameraKeyframe
+{
+	float time;
+	glm::vec3 position;
+	float yaw;
+	float pitch;
+	float fov;
+};
+
+// The CameraPath class records camera poses as timestamped keyframes, saves/loads them as text and evaluates
+// the path at any time with a Catmull-Rom spline through the keyframes, so a replay is smooth even when the
+// recording was made at an uneven frame rate.
+//
+// File format, one keyframe per line (lines starting with # are comments):
+// time x y z yaw pitch fov
+//
+// Usage Example:
+// CameraPath path;
+// path.Record(glfwGetTime(), camera);   // every frame while recording
+// path.Save("camera_path.txt");
+// ...
+// path.Load("camera_path.txt");
+// path.Apply(frame / 60.0f, camera);    // replay at a fixed timestep
+class CameraPath
+{
+public:
+	static constexpr float MIN_KEYFRAME_INTERVAL = 1.0f / 30.0f;
+
+	// Adds the current pose, keyframes closer than MIN_KEYFRAME_INTERVAL to the previous one are skipped.
+	void Record(float time, const Camera& camera)
+	{
+		if (keyframes.empty())
+			startTime = time;
+		else if (time - startTime - keyframes.back().time < MIN_KEYFRAME_INTERVAL)
+			return;
+		keyframes.push_back({ time - startTime, camera.position, camera.yaw, camera.pitch, camera.fov });
+	}
+
+	bool Save(const std::string& path) const
+	{
+		std::ofstream file(path);
+		if (!file) {
+			std::cerr << "Error: could not write camera path " << path << "\n";
+			return false;
+		}
+		file << "# time x y z yaw pitch fov\n";
+		file.precision(9);
+		for (const CameraKeyframe& key : keyframes) {
+			file << key.time << " " << key.position.x << " " << key.position.y << " " << key.position.z << " "
+				<< key.yaw << " " << key.pitch << " " << key.fov << "\n";
+		}
+		return true;
+	}
+
+	bool Load(const std::string& path)
+	{
+		std::ifstream file(path);
+		if (!file) {
+			std::cerr << "Error: could not open camera path " << path << "\n";
+			return false;
+		}
+		keyframes.clear();
+		std::string line;
+		while (std::getline(file, line)) {
+			if (line.empty() || line[0] == '#')
+				continue;
+			std::istringstream stream(line);
+			CameraKeyframe key;
+			if (stream >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch >> key.fov)
+				keyframes.push_back(key);
+#ifdef _DEBUG
+			else
+				std::cerr << "Warning: skipped malformed camera path line: " << line << "\n";
+#endif
+		}
+		return !keyframes.empty();
+	}
+
+	bool IsEmpty() const { return keyframes.empty(); }
+	float GetDuration() const { return keyframes.empty() ? 0.0f : keyframes.back().time; }
+	const std::vector<CameraKeyframe>& GetKeyframes() const { return keyframes; }
+
+	// Interpolated pose at the given time, clamped to the ends of the path.
+	CameraKeyframe Evaluate(float time) const
+	{
+		if (keyframes.empty())
+			return { time, glm::vec3(0.0f), -90.0f, 0.0f, 45.0f };
+		if (time <= keyframes.front().time)
+			return keyframes.front();
+		if (time >= keyframes.back().time)
+			return keyframes.back();
+
+		// Segment [i, i + 1] containing time
+		auto it = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+			[](float t, const CameraKeyframe& key) { return t < key.time; });
+		int i = (int)(it - keyframes.begin()) - 1;
+		int last = (int)keyframes.size() - 1;
+		const CameraKeyframe& k0 = keyframes[std::max(i - 1, 0)];
+		const CameraKeyframe& k1 = keyframes[i];
+		const CameraKeyframe& k2 = keyframes[i + 1];
+		const CameraKeyframe& k3 = keyframes[std::min(i + 2, last)];
+		float u = (time - k1.time) / std::max(k2.time - k1.time, 1e-6f);
+
+		CameraKeyframe result;
+		result.time = time;
+		result.position = CatmullRom(k0.position, k1.position, k2.position, k3.position, u);
+		result.yaw = CatmullRom(k0.yaw, k1.yaw, k2.yaw, k3.yaw, u);
+		result.pitch = glm::clamp(CatmullRom(k0.pitch, k1.pitch, k2.pitch, k3.pitch, u), -89.0f, 89.0f);
+		result.fov = glm::clamp(CatmullRom(k0.fov, k1.fov, k2.fov, k3.fov, u), 1.0f, 45.0f);
+		return result;
+	}
+
+	// Moves the camera to the interpolated pose.
+	void Apply(float time, Camera& camera) const
+	{
+		CameraKeyframe key = Evaluate(time);
+		camera.position = key.position;
+		camera.SetOrientation(key.yaw, key.pitch);
+		camera.fov = key.fov;
+	}
+
+private:
+	// Uniform Catmull-Rom between p1 and p2.
+	template<typename T>
+	static T CatmullRom(const T& p0, const T& p1, const T& p2, const T& p3, float u)
+	{
+		float u2 = u * u;
+		float u3 = u2 * u;
+		return 0.5f * ((2.0f * p1) + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+	}
+
+	std::vector<CameraKeyframe> keyframes;
+	float startTime = 0.0f;
+};
@@ -0,0 +1,411 @@
+#pragma once
+
+#include <map>
+#include <cstdint>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <unordered_set>
+
+#include "timer.h"
+#include "imgui/imgui.h"
+
+// One finished CPU scope. Names must outlive the profiler: string literals, __FUNCTION__ or CpuProfiler::Intern().
+struct CpuProfileEvent
+{
+	const char* name;
+	long long begin; // Timer::nowNanoseconds()
+	long long end;
+	unsigned int depth;
+};
+
+// A node of the aggregated per-frame call tree. Identical scopes under the same parent are merged.
+struct CpuProfileNode
+{
+	const char* name;
+	int parent;
+	int depth;
+	std::vector<int> children;
+	float lastMilliseconds = 0.0f;    // total of the last frame
+	unsigned int lastCalls = 0;
+	float averageMilliseconds = 0.0f; // exponential moving average over frames
+	long long frameNanoseconds = 0;   // accumulators of the frame being built
+	unsigned int frameCalls = 0;
+};
+
+// The CpuProfiler class collects hierarchical CPU scopes from any thread.
+// Every thread writes finished scopes into its own single-producer ring buffer without locking; NewFrame() drains
+// all rings on the main thread, merges the events into a call tree per thread and keeps them for the trace.
+// The trace records from startup (so model import and shader creation are in it) until TRACE_CAPACITY events, and
+// can be restarted with StartCapture(). ExportChromeTrace() writes JSON for chrome://tracing or ui.perfetto.dev.
+//
+// A disabled profiler costs one relaxed atomic load per scope; defining DISABLE_CPU_PROFILER compiles the
+// scopes out entirely. A full ring drops events instead of blocking.
+//
+// Usage Example:
+// void LoadScene() { CPU_PROFILE_FUNCTION(); ... }
+// { CPU_PROFILE_SCOPE("uniform setup"); ... }
+// CpuProfiler::Get().NewFrame();      // once at the start of every frame, on the main thread
+// CpuProfiler::Get().DrawImGui();     // inside an ImGui window
+// CpuProfiler::Get().ExportChromeTrace("cpu_trace.json");
+class CpuProfiler
+{
+public:
+	static constexpr unsigned int BUFFER_CAPACITY = 1 << 16; // events per thread between two NewFrame() calls
+	static constexpr size_t TRACE_CAPACITY = 1 << 18;
+
+	static CpuProfiler& Get()
+	{
+		static CpuProfiler instance;
+		return instance;
+	}
+
+	CpuProfiler(const CpuProfiler&) = delete;
+	CpuProfiler& operator=(const CpuProfiler&) = delete;
+
+	static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+	static void SetEnabled(bool _enabled) { enabled.store(_enabled, std::memory_order_relaxed); }
+
+	// Names the calling thread in the tree and the trace.
+	void SetThreadName(const std::string& name)
+	{
+		ThreadBuffer& buffer = LocalBuffer();
+		std::lock_guard<std::mutex> lock(mutex);
+		buffer.name = name;
+		buffer.named = true;
+	}
+
+	// Returns a pointer that stays valid for the lifetime of the program, for scope names built at runtime.
+	const char* Intern(const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return internedNames.insert(name).first->c_str();
+	}
+
+	// Drains every thread's buffer and rebuilds the call tree of the frame that just ended.
+	void NewFrame()
+	{
+		ThreadBuffer& self = LocalBuffer();
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!self.named) {
+			self.name = "main";
+			self.named = true;
+		}
+		for (auto& buffer : buffers) {
+			events.clear();
+			buffer->Drain(events);
+			if (recordingTrace) {
+				for (const CpuProfileEvent& event : events) {
+					if (trace.size() >= TRACE_CAPACITY) {
+						recordingTrace = false;
+						break;
+					}
+					trace.push_back({ event, buffer->index });
+				}
+			}
+			AddToTree(*buffer, events);
+		}
+
+		for (CpuProfileNode& node : nodes) {
+			node.lastMilliseconds = node.frameNanoseconds / 1000000.0f;
+			node.lastCalls = node.frameCalls;
+			node.averageMilliseconds += (node.lastMilliseconds - node.averageMilliseconds) * 0.1f;
+			node.frameNanoseconds = 0;
+			node.frameCalls = 0;
+		}
+	}
+
+	// Clears the trace and records again from now on.
+	void StartCapture()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		trace.clear();
+		recordingTrace = true;
+	}
+
+	// Writes the trace as Chrome trace event JSON. Returns the number of events written, -1 on failure.
+	int ExportChromeTrace(const std::string& path)
+	{
+		std::ofstream file(path);
+		if (!file) {
+			std::cerr << "Error: could not write " << path << "\n";
+			return -1;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+		bool first = true;
+		for (const auto& buffer : buffers) {
+			file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->index
+				<< ",\"args\":{\"name\":\"" << Escape(buffer->name) << "\"}}";
+			first = false;
+		}
+		file.setf(std::ios::fixed);
+		file.precision(3);
+		for (const TraceEvent& traceEvent : trace) {
+			const CpuProfileEvent& event = traceEvent.event;
+			file << ",\n{\"name\":\"" << Escape(event.name) << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << traceEvent.thread
+				<< ",\"ts\":" << (event.begin - epoch) / 1000.0 << ",\"dur\":" << (event.end - event.begin) / 1000.0 << "}";
+		}
+		file << "\n]}\n";
+		return (int)trace.size();
+	}
+
+	// Call tree of the last frame, one subtree per thread, plus the trace controls.
+	void DrawImGui()
+	{
+		if (!ImGui::CollapsingHeader("CPU profiler", ImGuiTreeNodeFlags_DefaultOpen))
+			return;
+
+		bool isEnabled = IsEnabled();
+		if (ImGui::Checkbox("Enabled##cpu", &isEnabled))
+			SetEnabled(isEnabled);
+		ImGui::SameLine();
+		if (ImGui::Button("Restart capture"))
+			StartCapture();
+		ImGui::SameLine();
+		if (ImGui::Button("Export trace"))
+			lastExportEvents = ExportChromeTrace("cpu_trace.json");
+
+		size_t traceEvents;
+		bool recording;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			traceEvents = trace.size();
+			recording = recordingTrace;
+		}
+		ImGui::Text("Trace: %zu events%s, %u dropped", traceEvents, recording ? " (recording)" : "", GetDroppedEvents());
+		if (lastExportEvents >= 0)
+			ImGui::Text("%d events -> cpu_trace.json", lastExportEvents);
+
+		for (size_t i = 0; i < nodes.size(); i++) {
+			if (nodes[i].parent < 0)
+				DrawNode((int)i);
+		}
+	}
+
+	// Writes cpu_trace.json once per key press. Call every frame with the key state.
+	void ExportOnKey(bool keyDown)
+	{
+		if (keyDown && !exportKeyDown) {
+			int count = ExportChromeTrace("cpu_trace.json");
+			if (count >= 0)
+				std::cout << count << " CPU events written to cpu_trace.json\n";
+		}
+		exportKeyDown = keyDown;
+	}
+
+	unsigned int GetDroppedEvents()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		unsigned int dropped = 0;
+		for (const auto& buffer : buffers)
+			dropped += buffer->dropped.load(std::memory_order_relaxed);
+		return dropped;
+	}
+
+	const std::vector<CpuProfileNode>& GetNodes() const { return nodes; }
+
+private:
+	friend class CpuProfileScope;
+
+	// Single-producer (the owning thread) / single-consumer (NewFrame) ring.
+	struct ThreadBuffer
+	{
+		CpuProfileEvent events[BUFFER_CAPACITY];
+		std::atomic<unsigned int> head{ 0 }; // written by the owner
+		std::atomic<unsigned int> tail{ 0 }; // written by the consumer
+		std::atomic<unsigned int> dropped{ 0 };
+		unsigned int depth = 0;             // owner only
+		unsigned int index = 0;
+		int root = -1;                      // tree node of this thread, consumer only
+		std::string name;
+		bool named = false;                 // set by SetThreadName(), otherwise "thread N"
+
+		void Push(const CpuProfileEvent& event)
+		{
+			unsigned int h = head.load(std::memory_order_relaxed);
+			if (h - tail.load(std::memory_order_acquire) == BUFFER_CAPACITY) {
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			events[h % BUFFER_CAPACITY] = event;
+			head.store(h + 1, std::memory_order_release);
+		}
+
+		void Drain(std::vector<CpuProfileEvent>& out)
+		{
+			unsigned int h = head.load(std::memory_order_acquire);
+			unsigned int t = tail.load(std::memory_order_relaxed);
+			for (; t != h; t++)
+				out.push_back(events[t % BUFFER_CAPACITY]);
+			tail.store(h, std::memory_order_release);
+		}
+	};
+
+	struct TraceEvent
+	{
+		CpuProfileEvent event;
+		unsigned int thread;
+	};
+
+	CpuProfiler() : epoch(Timer::nowNanoseconds()) {}
+
+	ThreadBuffer& LocalBuffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (!buffer) {
+			std::lock_guard<std::mutex> lock(mutex);
+			buffers.push_back(std::make_unique<ThreadBuffer>());
+			buffer = buffers.back().get();
+			buffer->index = (unsigned int)buffers.size() - 1;
+			buffer->name = "thread " + std::to_string(buffer->index);
+		}
+		return *buffer;
+	}
+
+	// Children are pushed before their parents (a scope is recorded when it ends), so sort by start time
+	// and rebuild the nesting with a stack of the enclosing scopes.
+	void AddToTree(ThreadBuffer& buffer, std::vector<CpuProfileEvent>& threadEvents)
+	{
+		if (threadEvents.empty())
+			return;
+		if (buffer.root < 0)
+			buffer.root = AddNode(-1, internedNames.insert(buffer.name).first->c_str());
+
+		std::sort(threadEvents.begin(), threadEvents.end(), [](const CpuProfileEvent& a, const CpuProfileEvent& b) {
+			return a.begin != b.begin ? a.begin < b.begin : a.depth < b.depth;
+		});
+
+		struct Open { long long end; int node; };
+		std::vector<Open> stack;
+		for (const CpuProfileEvent& event : threadEvents) {
+			while (!stack.empty() && stack.back().end <= event.begin)
+				stack.pop_back();
+			int parent = stack.empty() ? buffer.root : stack.back().node;
+			int node = FindOrAddNode(parent, event.name);
+			nodes[node].frameNanoseconds += event.end - event.begin;
+			nodes[node].frameCalls++;
+			if (stack.empty()) {
+				nodes[buffer.root].frameNanoseconds += event.end - event.begin;
+				nodes[buffer.root].frameCalls = 1;
+			}
+			stack.push_back({ event.end, node });
+		}
+	}
+
+	int FindOrAddNode(int parent, const char* name)
+	{
+		auto it = nodeIndices.find({ parent, name });
+		if (it != nodeIndices.end())
+			return it->second;
+		int node = AddNode(parent, name);
+		nodeIndices[{ parent, name }] = node;
+		return node;
+	}
+
+	int AddNode(int parent, const char* name)
+	{
+		CpuProfileNode node;
+		node.name = name;
+		node.parent = parent;
+		node.depth = parent < 0 ? 0 : nodes[parent].depth + 1;
+		nodes.push_back(node);
+		int index = (int)nodes.size() - 1;
+		if (parent >= 0)
+			nodes[parent].children.push_back(index);
+		return index;
+	}
+
+	// Nodes that did not run in the last frame (startup work, disabled passes) are hidden.
+	void DrawNode(int index)
+	{
+		const CpuProfileNode& node = nodes[index];
+		if (node.lastCalls == 0)
+			return;
+		ImGuiTreeNodeFlags flags = node.children.empty() ? ImGuiTreeNodeFlags_Leaf : ImGuiTreeNodeFlags_DefaultOpen;
+		bool open = ImGui::TreeNodeEx((void*)(intptr_t)index, flags, "%s  %.3f ms (avg %.3f)  x%u",
+			node.name, node.lastMilliseconds, node.averageMilliseconds, node.lastCalls);
+		if (open) {
+			for (int child : node.children)
+				DrawNode(child);
+			ImGui::TreePop();
+		}
+	}
+
+	static std::string Escape(const char* text)
+	{
+		std::string result;
+		for (; *text; text++) {
+			if (*text == '"' || *text == '\\')
+				result += '\\';
+			result += *text;
+		}
+		return result;
+	}
+
+	static std::string Escape(const std::string& text) { return Escape(text.c_str()); }
+
+	static inline std::atomic<bool> enabled{ true };
+
+	std::mutex mutex; // guards buffers, the trace and internedNames; never taken when recording a scope
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	std::unordered_set<std::string> internedNames;
+	std::vector<CpuProfileEvent> events;
+	std::vector<TraceEvent> trace;
+	bool recordingTrace = true;
+	long long epoch;
+
+	std::vector<CpuProfileNode> nodes;
+	std::map<std::pair<int, const char*>, int> nodeIndices;
+	int lastExportEvents = -1;
+	bool exportKeyDown = false;
+};
+
+// Records the enclosing block as a CpuProfiler scope; use the macros below rather than this class directly.
+class CpuProfileScope
+{
+public:
+	explicit CpuProfileScope(const char* _name)
+	{
+		if (!CpuProfiler::IsEnabled())
+			return;
+		name = _name;
+		buffer = &CpuProfiler::Get().LocalBuffer();
+		depth = buffer->depth++;
+		begin = Timer::nowNanoseconds();
+	}
+
+	~CpuProfileScope()
+	{
+		if (!buffer)
+			return;
+		buffer->Push({ name, begin, Timer::nowNanoseconds(), depth });
+		buffer->depth--;
+	}
+
+	CpuProfileScope(const CpuProfileScope&) = delete;
+	CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+	CpuProfiler::ThreadBuffer* buffer = nullptr;
+	const char* name = nullptr;
+	long long begin = 0;
+	unsigned int depth = 0;
+};
+
+#define CPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_INNER(a, b)
+
+#ifndef DISABLE_CPU_PROFILER
+#define CPU_PROFILE_SCOPE(name) CpuProfileScope CPU_PROFILE_CONCAT(cpuProfileScope, __LINE__)(name)
+#define CPU_PROFILE_FUNCTION() CPU_PROFILE_SCOPE(__FUNCTION__)
+#else
+#define CPU_PROFILE_SCOPE(name) ((void)0)
+#define CPU_PROFILE_FUNCTION() ((void)0)
+#endif
@@ -7,8 +7,20 @@
 
 #include "camera.h"
 #include "shader.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "benchmark.h"
+#include "uniform_buffer.h"
+#include "render_target.h"
+#include "dynamic_resolution.h"
+#include "spatial_upscaler.h"
 #include "geometry_renderers.h"
 #include "model.h"
+#include "frustum_culling.h"
+#include "bvh.h"
+#include "light_clusters.h"
+#include "texture_buffer.h"
 #include "timer.h"
 
 #include "imgui/imgui.h"
@@ -16,15 +28,15 @@
 #include "imgui/imgui_impl_opengl3.h"
 
 // Function declarations (callback functions)
-void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT);
+void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void ProcessInput(GLFWwindow* window);
 unsigned int LoadTexture(const std::string& path);
 
 // Scene settings
-constexpr int SCR_WIDTH = 1920;
-constexpr int SCR_HEIGHT = 1080;
+int SCR_WIDTH = 1920;
+int SCR_HEIGHT = 1080;
 
 // Camera configs
 Camera camera(0.0f, 0.0f, 5.0f);
@@ -36,8 +48,11 @@ bool mouseButtonPressed = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char** argv)
 {
+	// --benchmark runs a fixed, hidden, vsync-off camera loop and writes benchmark_deferred_shading.json
+	Benchmark benchmark("deferred_shading", argc, argv);
+
 	Timer timer;
 	timer.start();
 
@@ -46,6 +61,7 @@ int main()
 	try {
 		if (!glfwInit())
 			throw std::runtime_error("failed to init glfw");
+		benchmark.ApplyWindowHints();
 		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "hnzz", nullptr, nullptr);
 		if (!window)
 			throw std::runtime_error("failed to create window");
@@ -57,9 +73,10 @@ int main()
 
 		if (glewInit() != GLEW_OK)
 			throw std::runtime_error("failed to init glew");
+		benchmark.ConfigureContext();
 
 		// OpenGL global status settings here
-		glEnable(GL_DEPTH_TEST);
+		GLState::Get().Enable(GL_DEPTH_TEST);
 		//glEnable(GL_CULL_FACE);
 	}
 	catch (const std::runtime_error& e) {
@@ -77,9 +94,16 @@ int main()
 	ImGui_ImplOpenGL3_Init("#version 330 core");
 
 	// Build & compile shader(s)
-	Shader shaderGeometryPass("res/shaders/g_buffer.vs", "res/shaders/g_buffer.fs");
-	Shader shaderLightingPass("res/shaders/deferred_shading.vs", "res/shaders/deferred_shading.fs");
-	Shader shaderLightBox("res/shaders/deferred_light_box.vs", "res/shaders/deferred_light_box.fs");
+	Shader shaderGeometryPass(SHADER_G_BUFFER_VS, SHADER_G_BUFFER_FS);
+	Shader shaderLightingPass(SHADER_DEFERRED_SHADING_VS, SHADER_DEFERRED_SHADING_FS);
+	Shader shaderLightBox(SHADER_DEFERRED_LIGHT_BOX_VS, SHADER_DEFERRED_LIGHT_BOX_FS);
+	Shader shaderAmbient(SHADER_DEFERRED_SHADING_VS, SHADER_DEFERRED_AMBIENT_FS);
+	Shader shaderLightStencil(SHADER_DEFERRED_LIGHT_VOLUME_VS, SHADER_DEFERRED_LIGHT_STENCIL_FS);
+	Shader shaderLightVolume(SHADER_DEFERRED_LIGHT_VOLUME_VS, SHADER_DEFERRED_LIGHT_VOLUME_FS);
+	// the same passes for the packed G-buffer layout
+	Shader packedGeometryPass(SHADER_G_BUFFER_VS, SHADER_G_BUFFER_FS, EMBEDDED_SHADER_NONE, { "PACKED_GBUFFER" });
+	Shader packedLightingPass(SHADER_DEFERRED_SHADING_VS, SHADER_DEFERRED_SHADING_FS, EMBEDDED_SHADER_NONE, { "PACKED_GBUFFER" });
+	Shader packedLightVolume(SHADER_DEFERRED_LIGHT_VOLUME_VS, SHADER_DEFERRED_LIGHT_VOLUME_FS, EMBEDDED_SHADER_NONE, { "PACKED_GBUFFER" });
 
 	// Load model(s)
 	//Model backpack("res/models/backpack/backpack.obj");
@@ -93,167 +117,371 @@ int main()
 			objectPositions.emplace_back(glm::vec3(x, -0.5f, z));
 	}
 
-	// configure g-buffer framebuffer with position, normal and albedo
-	unsigned int gBuffer;
-	glGenFramebuffers(1, &gBuffer);
-	glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-
-	unsigned int gPosition, gNormal, gAlbedoSpec;
-	glGenTextures(1, &gPosition);
-	glBindTexture(GL_TEXTURE_2D, gPosition);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-
-	glGenTextures(1, &gNormal);
-	glBindTexture(GL_TEXTURE_2D, gNormal);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-
-	// rgb for albedo, a for specular (rgba)
-	glGenTextures(1, &gAlbedoSpec);
-	glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedoSpec, 0);
-
-	unsigned int attachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-	glDrawBuffers(3, attachments);
-
-	unsigned int rboDepth;
-	glGenRenderbuffers(1, &rboDepth);
-	glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-
-	// finally check if framebuffer is complete
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "Framebuffer not complete!" << std::endl;
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// Per-frame object matrices and their world bounds, for culling
+	std::vector<glm::mat4> objectModels;
+	BoundsBatch objectBounds;
+	std::vector<uint8_t> objectVisible;
+	bool animateObjects = false;
+
+	// configure g-buffer framebuffer with position, normal and albedo (rgb for albedo, a for specular)
+	// the targets come from the pool and follow the window size
+	std::vector<RenderTargetDesc> gBufferLayout = {
+		{ GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT },
+		{ GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT },
+		{ GL_RGBA8, SCR_WIDTH, SCR_HEIGHT },
+		{ GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT }
+	};
+	RenderTarget gBuffer(gBufferLayout);
+
+	// Packed layout, half the bytes per pixel: no position target (the lighting rebuilds it from the depth and the
+	// inverse camera matrices) and an octahedral-encoded normal in RG16
+	std::vector<RenderTargetDesc> packedGBufferLayout = {
+		{ GL_RG16, SCR_WIDTH, SCR_HEIGHT },
+		{ GL_RGBA8, SCR_WIDTH, SCR_HEIGHT },
+		{ GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT }
+	};
+	RenderTarget packedGBuffer(packedGBufferLayout);
+	bool usePackedGBuffer = false;
+
+	auto BytesPerPixel = [](const std::vector<RenderTargetDesc>& layout) {
+		unsigned int bytes = 0;
+		for (const RenderTargetDesc& desc : layout)
+			bytes += GetRenderTargetFormatInfo(desc.internalFormat).bytesPerPixel;
+		return bytes;
+	};
+
+	// Lit scene at the internal resolution, upscaled to the window by EASU + RCAS.
+	// The depth attachment receives the G-buffer depth before lighting, so the light volumes can test against it
+	// and the light boxes are still occluded; its stencil marks the pixels inside light volumes.
+	RenderTarget sceneTarget({
+		{ GL_RGBA8, SCR_WIDTH, SCR_HEIGHT },
+		{ GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT }
+	});
+	DynamicResolution dynamicResolution;
+	SpatialUpscaler upscaler;
 
 	// Lighting info (as well as generating positions, colors, and radius of lights)
 	float linear = 0.7f;
 	float quadratic = 1.8f;
 	float constant = 1.0f;
 
-	std::random_device rd;
-	std::mt19937 gen(rd());
+	std::mt19937 gen(benchmark.GetSeed());
 	std::uniform_real_distribution<float> dis(-1, 1);
 
-	const unsigned int nrLights = 32;
+	// The lights are regenerated when their count changes in the UI. The area they cover grows with the count,
+	// so the light density around the nanosuits, and with it the work per pixel, stays the same.
+	int lightCount = 32;
+	bool animateLights = false;
+	bool showLightSpheres = true;
+	std::vector<glm::vec3>lightBasePositions;
 	std::vector<glm::vec3>lightPositions;
 	std::vector<glm::vec3>lightColors;
 	std::vector<float>lightRadius;
-	lightPositions.reserve(nrLights);
-	lightColors.reserve(nrLights);
-	lightRadius.reserve(nrLights);
-
-	for (size_t i = 0; i < nrLights; i++) {
-		float x = 3.0f * dis(gen);
-		float y = 3.0f * dis(gen) - 1.0f;
-		float z = 3.0f * dis(gen);
-		lightPositions.emplace_back(glm::vec3(x, y, z));
-
-		float r = 0.5f * dis(gen) + 0.5f;
-		float g = 0.5f * dis(gen) + 0.5f;
-		float b = 0.5f * dis(gen) + 0.5f;
-		lightColors.emplace_back(glm::vec3(r, g, b));
-		float maxBrightness = std::max(std::max(r, g), b);
-		float radius = (-linear + std::sqrt(linear * linear - 4 * quadratic * (constant - (256.0f / 5.0f) * maxBrightness))) / (2.0f * quadratic);
-		lightRadius.push_back(radius);
-	}
+	std::vector<float>lightPhases;
+	std::vector<PointLight> lights;
+
+	// Scene BVH for picking: the nanosuits first (refit when they move), then the light spheres
+	SceneBVH sceneBVH;
+	std::vector<glm::mat4> objectInverseModels(objectPositions.size());
+	float raysPerSecond = 0.0f;
+
+	auto GenerateLights = [&]() {
+		gen.seed(benchmark.GetSeed());
+		float spread = 3.0f * std::sqrt(lightCount / 32.0f);
+		lightBasePositions.clear();
+		lightColors.clear();
+		lightRadius.clear();
+		lightPhases.clear();
+		for (int i = 0; i < lightCount; i++) {
+			float x = spread * dis(gen);
+			float y = 3.0f * dis(gen) - 1.0f;
+			float z = spread * dis(gen);
+			lightBasePositions.emplace_back(glm::vec3(x, y, z));
+
+			float r = 0.5f * dis(gen) + 0.5f;
+			float g = 0.5f * dis(gen) + 0.5f;
+			float b = 0.5f * dis(gen) + 0.5f;
+			lightColors.emplace_back(glm::vec3(r, g, b));
+			float maxBrightness = std::max(std::max(r, g), b);
+			float radius = (-linear + std::sqrt(linear * linear - 4 * quadratic * (constant - (256.0f / 5.0f) * maxBrightness))) / (2.0f * quadratic);
+			lightRadius.push_back(radius);
+			lightPhases.push_back(3.14159265f * dis(gen));
+		}
+		lightPositions = lightBasePositions;
+
+		lights.assign(lightCount, PointLight());
+		for (int i = 0; i < lightCount; i++) {
+			lights[i].position = lightPositions[i];
+			lights[i].color = lightColors[i];
+			lights[i].linear = linear;
+			lights[i].quadratic = quadratic;
+		}
+
+		sceneBVH = SceneBVH();
+		for (size_t i = 0; i < objectPositions.size(); i++)
+			sceneBVH.Add(AABB(objectPositions[i], objectPositions[i]));
+		for (int i = 0; i < lightCount; i++)
+			sceneBVH.Add(AABB(lightPositions[i] - glm::vec3(0.05f), lightPositions[i] + glm::vec3(0.05f)));
+	};
+	GenerateLights();
+	int generatedLightCount = lightCount;
 
 	// Set VAO for geometry shape for later use
 	yzh::Quad quad;
 	yzh::Cube cube;
 	yzh::Sphere sphere;
 
+	// Light-volume mode: instead of one fullscreen pass walking the cluster lists, every visible light rasterizes
+	// a low-poly sphere of its radius, and only the pixels it covers are shaded (additively, on top of an ambient pass).
+	// The UV sphere's faces lie inside its vertices, the scale makes the faces enclose the radius.
+	bool lightVolumes = false;
+	const int volumeSegmentsX = 16, volumeSegmentsY = 12;
+	yzh::Sphere lightVolume(volumeSegmentsX, volumeSegmentsY);
+	const float volumeProxyScale = 1.0f / (yzh::Sphere::RADIUS * std::cos(3.14159265f / volumeSegmentsX) * std::cos(3.14159265f / (2 * volumeSegmentsY)));
+	TextureBuffer volumeLightData(GL_RGBA32F);
+	std::vector<glm::vec4> volumeLightTexels;
+	unsigned int volumeLightCount = 0;
+
+	// Shared per-frame uniform blocks. The lights don't go through the 32-entry Lights block, they are binned
+	// into the cluster grid every frame and read from texture buffers.
+	FrameConstants frameConstants;
+	LightClusters lightClusters;
+
+	// Closest object under a ray: triangle-exact for the nanosuits, box-exact for the small light spheres
+	auto CastRay = [&](const Ray& ray, RayHit& hit) {
+		return sceneBVH.Raycast(ray, hit, [&](unsigned int object, const Ray& worldRay, RayHit& candidate) {
+			if (object < objectPositions.size())
+				return nanosuit.Raycast(worldRay.Transformed(objectInverseModels[object]), candidate);
+			const AABB& box = sceneBVH.GetBounds(object);
+			candidate.distance = worldRay.IntersectBox(box.min, box.max, candidate.distance);
+			return candidate.distance != FLT_MAX;
+		});
+	};
+
 	// shader configs
 	shaderLightingPass.Bind();
 	shaderLightingPass.SetInt("gPosition", 0);
 	shaderLightingPass.SetInt("gNormal", 1);
 	shaderLightingPass.SetInt("gAlbedoSpec", 2);
+	packedLightingPass.Bind();
+	packedLightingPass.SetInt("gDepth", 0);
+	packedLightingPass.SetInt("gNormal", 1);
+	packedLightingPass.SetInt("gAlbedoSpec", 2);
+	shaderAmbient.Bind();
+	shaderAmbient.SetInt("gAlbedoSpec", 2);
+	shaderLightStencil.Bind();
+	shaderLightStencil.SetInt("lightData", 3);
+	shaderLightStencil.SetFloat("proxyScale", volumeProxyScale);
+	shaderLightVolume.Bind();
+	shaderLightVolume.SetInt("gPosition", 0);
+	shaderLightVolume.SetInt("gNormal", 1);
+	shaderLightVolume.SetInt("gAlbedoSpec", 2);
+	shaderLightVolume.SetInt("lightData", 3);
+	shaderLightVolume.SetFloat("proxyScale", volumeProxyScale);
+	packedLightVolume.Bind();
+	packedLightVolume.SetInt("gDepth", 0);
+	packedLightVolume.SetInt("gNormal", 1);
+	packedLightVolume.SetInt("gAlbedoSpec", 2);
+	packedLightVolume.SetInt("lightData", 3);
+	packedLightVolume.SetFloat("proxyScale", volumeProxyScale);
 
 	timer.stop();
 
 	// Imgui settings
 	bool firstTime = true;
 	double cursor_x, cursor_y;
-	unsigned char pixel[4];
-	while (!glfwWindowShouldClose(window)) {
+	while (!glfwWindowShouldClose(window) && benchmark.NextFrame(camera)) {
+		// Publish last frame's state-cache counters and start counting this frame
+		GLState::Get().NewFrame();
+		// Drop render targets that stayed idle since the last resize
+		RenderTargetPool::Get().NewFrame();
+		// Read back the GPU timings of an older frame and start recording this one
+		GpuProfiler::Get().BeginFrame();
+		// Build the CPU call tree of the previous frame
+		CpuProfiler::Get().NewFrame();
+		// Publish last frame's culling counters
+		FrustumCuller::Get().NewFrame();
+
 		// Per-frame logic
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
-		// Render
+		if (lightCount != generatedLightCount) {
+			GenerateLights();
+			generatedLightCount = lightCount;
+		}
+
+		// Lights circle around their spawn points
+		if (animateLights) {
+			for (int i = 0; i < lightCount; i++) {
+				float angle = currentFrame + lightPhases[i];
+				lightPositions[i] = lightBasePositions[i] + 0.5f * glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+				lights[i].position = lightPositions[i];
+				sceneBVH.SetBounds((unsigned int)(objectPositions.size() + i), AABB(lightPositions[i] - glm::vec3(0.05f), lightPositions[i] + glm::vec3(0.05f)));
+			}
+		}
+
+		// Render (the upscaler overwrites the whole default framebuffer, no need to clear it)
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// Process input
 		ProcessInput(window);
 
+		// Internal resolution for this frame, from the GPU time measured a few frames ago
+		dynamicResolution.Update(GpuProfiler::Get().GetLastFrameMilliseconds());
+		int renderWidth = dynamicResolution.Scale(SCR_WIDTH);
+		int renderHeight = dynamicResolution.Scale(SCR_HEIGHT);
+
+		// The passes of the selected G-buffer layout
+		RenderTarget& activeGBuffer = usePackedGBuffer ? packedGBuffer : gBuffer;
+		Shader& geometryPass = usePackedGBuffer ? packedGeometryPass : shaderGeometryPass;
+		Shader& lightingPass = usePackedGBuffer ? packedLightingPass : shaderLightingPass;
+		Shader& lightVolumePass = usePackedGBuffer ? packedLightVolume : shaderLightVolume;
+
 		// 1. geometry pass: render scene's geometry/color data into gbuffer
-		glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+		GpuProfiler::Get().Begin("geometry");
+		activeGBuffer.Resize(renderWidth, renderHeight);
+		activeGBuffer.Bind();
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		shaderGeometryPass.Bind();
+		geometryPass.Bind();
 
 		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 		glm::mat4 view = camera.GetViewMatrix();
 		glm::mat4 model = glm::mat4(1.0f);
-		shaderGeometryPass.SetMat4("projection", projection);
-		shaderGeometryPass.SetMat4("view", view);
+		frameConstants.SetCamera(projection, view, camera.position);
+		Frustum frustum(projection * view);
 
+		// Bin the lights into the cluster grid on the workers while nothing else needs them,
+		// or, in light-volume mode, upload the lights whose sphere reaches into the frustum as instances
+		if (!lightVolumes)
+			lightClusters.Build(lights, lightRadius, view, glm::radians(camera.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+		else {
+			volumeLightTexels.clear();
+			for (int i = 0; i < lightCount; i++) {
+				if (FrustumCuller::Get().enabled && !frustum.TestSphere(lights[i].position, lightRadius[i]))
+					continue;
+				volumeLightTexels.emplace_back(lights[i].position, lightRadius[i]);
+				volumeLightTexels.emplace_back(lights[i].color, lights[i].linear);
+				volumeLightTexels.emplace_back(lights[i].quadratic, 0.0f, 0.0f, 0.0f);
+			}
+			volumeLightCount = (unsigned int)(volumeLightTexels.size() / 3);
+			volumeLightData.Update(volumeLightTexels.data(), volumeLightTexels.size() * sizeof(glm::vec4));
+		}
+
+		// Cull whole objects first, then the meshes of the visible ones inside Model::Render
+		objectModels.clear();
+		objectBounds.Clear();
 		for (size_t i = 0; i < objectPositions.size(); i++) {
+			glm::vec3 position = objectPositions[i];
+			if (animateObjects)
+				position += glm::vec3(0.0f, 0.5f * std::sin(currentFrame + i), 0.0f);
 			model = glm::mat4(1.0f);
-			model = glm::translate(model, objectPositions[i]);
+			model = glm::translate(model, position);
 			model = glm::scale(model, glm::vec3(0.5f));
-			shaderGeometryPass.SetMat4("model", model);
-			nanosuit.Render(shaderGeometryPass, {"texture_diffuse", "texture_specular"});
+			objectModels.push_back(model);
+			objectInverseModels[i] = glm::inverse(model);
+			objectBounds.AddBox(nanosuit.GetBounds().first, nanosuit.GetBounds().second, model);
+			sceneBVH.SetBounds((unsigned int)i, AABB::Transformed(nanosuit.GetBounds().first, nanosuit.GetBounds().second, model));
 		}
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		// 2. lighting pass: calculate lighting by iterating over a screen filled quad pixel-by-pixel using the gbuffer's content.
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		shaderLightingPass.Bind();
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, gPosition);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, gNormal);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-
-		if (lightColors.size() == lightPositions.size()) {
-			for (size_t i = 0; i < lightPositions.size(); i++) {
-				shaderLightingPass.SetVec3("lights[" + std::to_string(i) + "].Position", lightPositions[i]);
-				shaderLightingPass.SetVec3("lights[" + std::to_string(i) + "].Color", lightColors[i]);
-				shaderLightingPass.SetFloat("lights[" + std::to_string(i) + "].Linear", linear);
-				shaderLightingPass.SetFloat("lights[" + std::to_string(i) + "].Quadratic", quadratic);
-			}
+		sceneBVH.Update(); // refits, or rebuilds once the moves degraded the tree
+		size_t visibleObjects = objectModels.size();
+		if (FrustumCuller::Get().enabled)
+			visibleObjects = objectBounds.Cull(frustum, objectVisible);
+		else
+			objectVisible.assign(objectModels.size(), 1);
+		FrustumCuller::Get().Count(objectModels.size(), visibleObjects);
+
+		for (size_t i = 0; i < objectModels.size(); i++) {
+			if (!objectVisible[i])
+				continue;
+			geometryPass.SetMat4("model", objectModels[i]);
+			nanosuit.Render(geometryPass, objectModels[i], frustum, TEXTURE_DIFFUSE_BIT | TEXTURE_SPECULAR_BIT);
+		}
+		GpuProfiler::Get().End();
+
+		// 2. copy content of geometry's depth buffer to the scene target's depth buffer
+		// both are GL_DEPTH24_STENCIL8 of the same size, so unlike a blit to the default framebuffer this always works
+		sceneTarget.Resize(renderWidth, renderHeight);
+		activeGBuffer.Bind(GL_READ_FRAMEBUFFER);
+		sceneTarget.Bind(GL_DRAW_FRAMEBUFFER);
+		glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		sceneTarget.Bind();
+		glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+		// 3. lighting pass, the fullscreen passes must not be depth tested against the copied depth
+		GpuProfiler::Get().Begin("lighting");
+		// units 0-2: position (the depth in the packed layout), normal, albedo + specular
+		if (!usePackedGBuffer) {
+			GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, gBuffer.GetTexture(0));
+			GLState::Get().BindTextureUnit(1, GL_TEXTURE_2D, gBuffer.GetTexture(1));
+			GLState::Get().BindTextureUnit(2, GL_TEXTURE_2D, gBuffer.GetTexture(2));
+		}
+		else {
+			GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, packedGBuffer.GetTexture(2));
+			GLState::Get().BindTextureUnit(1, GL_TEXTURE_2D, packedGBuffer.GetTexture(0));
+			GLState::Get().BindTextureUnit(2, GL_TEXTURE_2D, packedGBuffer.GetTexture(1));
+		}
+		GLState::Get().Disable(GL_DEPTH_TEST);
+		if (!lightVolumes) {
+			// calculate lighting by iterating over a screen filled quad pixel-by-pixel, over the lights of the pixel's cluster
+			lightingPass.Bind();
+			lightClusters.Bind(lightingPass, 3);
+			quad.Render();
+			GLState::Get().Enable(GL_DEPTH_TEST);
 		}
-		shaderLightingPass.SetVec3("viewPos", camera.position);
-		quad.Render();
-
-		// 2.5. copy content of geometry's depth buffer to default framebuffer's depth buffer
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); // write to default framebuffer
-		// blit to default framebuffer. Note that this may or may not work as the internal formats of both the FBO and default framebuffer have to match.
-		// the internal formats are implementation defined. This works on all of my systems, but if it doesn't on yours you'll likely have to write to the 		
-		// depth buffer in another shader stage (or somehow see to match the default framebuffer's internal format with the FBO's internal format).
-		glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	    // 3. render lights on top of scene
+		else {
+			// ambient for every pixel, then each light's volume adds its light to the pixels it covers
+			shaderAmbient.Bind();
+			quad.Render();
+			volumeLightData.Bind(3);
+
+			GLState::Get().Enable(GL_DEPTH_TEST);
+			glDepthMask(GL_FALSE);
+			glEnable(GL_STENCIL_TEST);
+			glFrontFace(GL_CW); // see yzh::Sphere::RADIUS
+
+			// 3a. stencil pass (z-fail): with both faces drawn, a back face behind the surface increments and a front
+			// face behind it decrements, so the stencil is non-zero only where the surface lies inside a volume.
+			// Unlike counting the passing faces this stays right when the near plane clips the front faces.
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			glStencilFunc(GL_ALWAYS, 0, 0xFF);
+			glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+			glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+			shaderLightStencil.Bind();
+			lightVolume.RenderInstanced(volumeLightCount);
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+			// 3b. shading pass: the back faces of each volume, kept only where they are behind the surface (which rejects
+			// surfaces beyond the light) on pixels the stencil marked; the shader drops the rest by distance
+			glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+			glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+			glDepthFunc(GL_GEQUAL);
+			GLState::Get().Enable(GL_CULL_FACE);
+			GLState::Get().CullFace(GL_FRONT);
+			GLState::Get().Enable(GL_BLEND);
+			GLState::Get().BlendFunc(GL_ONE, GL_ONE);
+			lightVolumePass.Bind();
+			lightVolume.RenderInstanced(volumeLightCount);
+
+			GLState::Get().Disable(GL_BLEND);
+			GLState::Get().CullFace(GL_BACK);
+			GLState::Get().Disable(GL_CULL_FACE);
+			glDepthFunc(GL_LESS);
+			glFrontFace(GL_CCW);
+			glDisable(GL_STENCIL_TEST);
+			glDepthMask(GL_TRUE);
+		}
+		GpuProfiler::Get().End();
+
+	    // 4. render lights on top of scene
+		GpuProfiler::Get().Begin("light boxes");
 		shaderLightBox.Bind();
-		shaderLightBox.SetMat4("projection", projection);
-		shaderLightBox.SetMat4("view", view);
 
-		if (lightPositions.size() == lightColors.size()) {
+		if (showLightSpheres && lightPositions.size() == lightColors.size()) {
 			for (size_t i = 0; i < lightPositions.size(); i++) {
+				if (FrustumCuller::Get().enabled && !frustum.TestSphere(lightPositions[i], 0.1f))
+					continue;
 				model = glm::mat4(1.0f);
 				model = glm::translate(model, lightPositions[i]);
 				model = glm::scale(model, glm::vec3(0.05f));
@@ -262,6 +490,12 @@ int main()
 				sphere.Render();
 			}
 		}
+		GpuProfiler::Get().End();
+
+		// 5. upscale to the window
+		GpuProfiler::Get().Begin("upscale");
+		upscaler.Render(sceneTarget.GetTexture(0), SCR_WIDTH, SCR_HEIGHT);
+		GpuProfiler::Get().End();
 
 		// ImGui code here
 		// ---------------
@@ -278,26 +512,94 @@ int main()
 		}
 		ImGui::Begin("hnzz");
 		ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
+		ImGui::Text("GL state changes: %u issued, %u filtered", GLState::Get().GetFrameCounters().issued, GLState::Get().GetFrameCounters().filtered);
+		ImGui::Text("Render target pool: %u textures (%.1f MB), %u idle", RenderTargetPool::Get().GetStats().textures, RenderTargetPool::Get().GetStats().bytes / (1024.0f * 1024.0f), RenderTargetPool::Get().GetStats().idleTextures);
+		ImGui::Checkbox("Dynamic resolution", &dynamicResolution.enabled);
+		ImGui::SliderFloat("Target GPU time (ms)", &dynamicResolution.targetMilliseconds, 2.0f, 33.0f);
+		ImGui::SliderFloat("Manual scale", &dynamicResolution.manualScale, dynamicResolution.minScale, dynamicResolution.maxScale);
+		ImGui::SliderFloat("Sharpness (stops)", &upscaler.sharpness, 0.0f, 2.0f);
+		ImGui::Text("Render scale: %.2f (%d x %d)", dynamicResolution.GetScale(), renderWidth, renderHeight);
+		ImGui::Checkbox("Packed G-buffer", &usePackedGBuffer);
+		unsigned int gBufferBytes = BytesPerPixel(usePackedGBuffer ? packedGBufferLayout : gBufferLayout);
+		ImGui::Text("G-buffer: %u bytes per pixel, %.1f MB", gBufferBytes, gBufferBytes * (float)renderWidth * renderHeight / (1024.0f * 1024.0f));
 		ImGui::Text("Number of Objects: %u", (unsigned int)objectPositions.size());
-		ImGui::Text("Number of Lights: %u", (unsigned int)lightPositions.size());
+		ImGui::Checkbox("Frustum culling", &FrustumCuller::Get().enabled);
+		ImGui::Text("Culling: %u objects visible, %u of %u bounds tested visible", (unsigned int)visibleObjects, FrustumCuller::Get().GetFrameCounters().visible, FrustumCuller::Get().GetFrameCounters().tested);
+		ImGui::SliderInt("Number of Lights", &lightCount, 32, 8192);
+		ImGui::Checkbox("Animate lights", &animateLights);
+		ImGui::SameLine();
+		ImGui::Checkbox("Show light spheres", &showLightSpheres);
+		ImGui::Checkbox("Light volumes (instead of clusters)", &lightVolumes);
+		if (!lightVolumes) {
+			const LightClusterStats& clusterStats = lightClusters.GetStats();
+			ImGui::Text("Clusters: %u lights visible, %u occupied, avg %.1f / max %u lights per occupied cluster", clusterStats.visibleLights, clusterStats.occupiedClusters,
+				clusterStats.occupiedClusters ? (float)clusterStats.indices / clusterStats.occupiedClusters : 0.0f, clusterStats.maxLightsPerCluster);
+			ImGui::Text("Cluster build: %.3f ms on the CPU", clusterStats.buildMilliseconds);
+		}
+		else
+			ImGui::Text("Light volumes: %u of %u lights drawn, 2 instanced draws", volumeLightCount, (unsigned int)lightCount);
 		
-		// Retrieve and display the cursor position and the RGBA color of the pixel under the cursor
+		// Pick the object under the cursor with a CPU ray cast, no GPU readback
 		glfwGetCursorPos(window, &cursor_x, &cursor_y);
-		glReadPixels(cursor_x, SCR_HEIGHT - cursor_y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+		glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+		Ray cursorRay = Ray::FromScreen((float)cursor_x, (float)cursor_y, (float)SCR_WIDTH, (float)SCR_HEIGHT, inverseViewProjection);
+		RayHit picked;
 		ImGui::Text("Cursor position: (%f, %f)", cursor_x, cursor_y);
-		ImGui::Text("RGBA: (%d, %d, %d, %d)", pixel[0], pixel[1], pixel[2], pixel[3]);
+		if (!CastRay(cursorRay, picked))
+			ImGui::Text("Picked: nothing");
+		else if (picked.object < objectPositions.size())
+			ImGui::Text("Picked: nanosuit %u, mesh %u, triangle %u at %.2f", picked.object, picked.mesh, picked.triangle, picked.distance);
+		else
+			ImGui::Text("Picked: light %u at %.2f", picked.object - (unsigned int)objectPositions.size(), picked.distance);
+
+		ImGui::Checkbox("Animate objects", &animateObjects);
+		const SceneBVHStats& bvhStats = sceneBVH.GetStats();
+		ImGui::Text("Scene BVH: %u nodes, build %.3f ms, refit %.3f ms (%u builds, %u refits)", bvhStats.nodes, bvhStats.buildMilliseconds, bvhStats.refitMilliseconds, bvhStats.builds, bvhStats.refits);
+		ImGui::Text("SAH cost: %.2f (%.2f after build)", bvhStats.cost, bvhStats.builtCost);
+		ImGui::Text("Triangle BVHs: %.2f ms at load", nanosuit.GetBVHBuildMilliseconds());
+		if (ImGui::Button("Measure ray throughput")) {
+			// A grid of rays covering the window, through the full scene + triangle query
+			const int raysX = 192, raysY = 108;
+			long long start = Timer::nowNanoseconds();
+			for (int y = 0; y < raysY; y++) {
+				for (int x = 0; x < raysX; x++) {
+					RayHit hit;
+					CastRay(Ray::FromScreen((x + 0.5f) * SCR_WIDTH / raysX, (y + 0.5f) * SCR_HEIGHT / raysY, (float)SCR_WIDTH, (float)SCR_HEIGHT, inverseViewProjection), hit);
+				}
+			}
+			raysPerSecond = raysX * raysY / ((Timer::nowNanoseconds() - start) / 1e9f);
+		}
+		if (raysPerSecond > 0.0f)
+			ImGui::Text("Rays: %.0f per second", raysPerSecond);
 
 		ImGui::End();
 
+		// GPU pass timings and the CPU call tree
+		ImGui::SetNextWindowSize(ImVec2(400, 500), ImGuiCond_FirstUseEver);
+		ImGui::SetNextWindowPos(ImVec2(600, 50), ImGuiCond_FirstUseEver);
+		ImGui::Begin("Profiler");
+		GpuProfiler::Get().DrawImGui();
+		CpuProfiler::Get().DrawImGui();
+		ImGui::End();
+
 		// ImGui Rendering
 		ImGui::Render();
+		GpuProfiler::Get().Begin("imgui");
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		GpuProfiler::Get().End();
+
+		GpuProfiler::Get().EndFrame();
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-		glfwSwapBuffers(window);
+		{
+			CPU_PROFILE_SCOPE("glfwSwapBuffers"); // includes the vsync wait
+			glfwSwapBuffers(window);
+		}
 		glfwPollEvents();
 	}
 
+	benchmark.Finish();
+
 	// Optional: release all the resources of OpenGL (VAO, VBO, etc.)
 	glfwTerminate();
 
@@ -308,11 +610,13 @@ int main()
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
-void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT)
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
 	// make sure the viewport matches the new window dimensions; note that SCR_WIDTH and 
 	// SCR_HEIGHT will be significantly larger than specified on retina displays.
-	glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+	GLState::Get().Viewport(0, 0, width, height);
+	SCR_WIDTH = width;
+	SCR_HEIGHT = height;
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -381,7 +685,7 @@ unsigned int LoadTexture(const std::string& path)
 			return -1;
 		}
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
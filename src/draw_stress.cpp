@@ -0,0 +1,474 @@
+#include <iostream>
+#include <stdexcept>
+#include <random>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "camera.h"
+#include "shader.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "benchmark.h"
+#include "uniform_buffer.h"
+#include "geometry_renderers.h"
+#include "render_queue.h"
+#include "job_system.h"
+#include "frustum_culling.h"
+#include "timer.h"
+#include "model.h"
+
+#include "imgui/imgui.h"
+#include "imgui/imgui_impl_glfw.h"
+#include "imgui/imgui_impl_opengl3.h"
+
+// Function declarations (callback functions)
+void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+void mouse_callback(GLFWwindow* window, double xpos, double ypos);
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void ProcessInput(GLFWwindow* window);
+unsigned int LoadTexture(const std::string& path);
+
+// Scene settings
+int SCR_WIDTH = 1920;
+int SCR_HEIGHT = 1080;
+const float FAR_PLANE = 200.0f;
+
+// Camera configs
+Camera camera(0.0f, 12.0f, 70.0f);
+float lastX = (float)SCR_WIDTH / 2.0;
+float lastY = (float)SCR_HEIGHT / 2.0;
+bool mouseButtonPressed = true;
+
+// Timing
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+
+// One animated instance of the stress scene
+struct StressObject
+{
+	glm::vec3 position;
+	glm::vec3 axis;
+	float speed;
+	float phase;
+	float scale;
+	unsigned int state; // index into the prepared DrawStates
+};
+
+// One orbiting point light, drawn as a small emissive sphere
+struct StressLight
+{
+	glm::vec3 center;
+	float radius;
+	float speed;
+	float phase;
+	glm::vec3 color;
+};
+
+// Draw-call stress test: thousands of animated instances and orbiting lights. Every frame the worker threads
+// animate, cull and record them into per-thread command lists (matrices, colors and sort keys included); the GL
+// thread only merges the lists, sorts them and issues the draws. Compare the record time with 0 workers and with
+// all of them, the per-thread busy times show how evenly the chunks are spread.
+int main(int argc, char** argv)
+{
+	// --benchmark runs a fixed, hidden, vsync-off camera loop and writes benchmark_draw_stress.json
+	Benchmark benchmark("draw_stress", argc, argv);
+
+	// glfw & glew configs
+	GLFWwindow* window = nullptr;
+	try {
+		if (!glfwInit())
+			throw std::runtime_error("failed to init glfw");
+		benchmark.ApplyWindowHints();
+		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "hnzz", nullptr, nullptr);
+		if (!window)
+			throw std::runtime_error("failed to create window");
+
+		glfwMakeContextCurrent(window);
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+		glfwSetCursorPosCallback(window, mouse_callback);
+		glfwSetScrollCallback(window, scroll_callback);
+
+		if (glewInit() != GLEW_OK)
+			throw std::runtime_error("failed to init glew");
+		benchmark.ConfigureContext();
+
+		// OpenGL global status settings here
+		GLState::Get().Enable(GL_DEPTH_TEST);
+	}
+	catch (const std::runtime_error& e) {
+		std::cerr << e.what() << std::endl;
+		return -1;
+	}
+
+	// ImGui Initialization
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+	ImGui::StyleColorsDark();
+	ImGui_ImplGlfw_InitForOpenGL(window, true);
+	ImGui_ImplOpenGL3_Init("#version 330 core");
+
+	// Build & compile shader(s): the bloom scene shaders
+	Shader shader(SHADER_BLOOM_VS, SHADER_BLOOM_FS);
+	Shader shaderLight(SHADER_BLOOM_VS, SHADER_BLOOM_LIGHT_BOX_FS);
+	shader.Bind();
+	shader.SetInt("diffuseTexture", 0);
+
+	// Load texture(s)
+	unsigned int woodTexture = LoadTexture("res/textures/wood.png");
+	unsigned int containerTexture = LoadTexture("res/textures/container2.png");
+
+	// Low-poly geometry, the point is the number of draws, not the triangles
+	yzh::Cube cube;
+	yzh::Sphere sphere(16, 16);
+
+	FrameConstants frameConstants;
+
+	// Every object uses one of a few pipeline states. They are prepared here on the GL thread,
+	// the workers only reference them.
+	RenderQueue renderQueue;
+	std::vector<DrawState> objectStates = {
+		renderQueue.PrepareState(shader, cube.GetGeometry(), woodTexture),
+		renderQueue.PrepareState(shader, cube.GetGeometry(), containerTexture),
+		renderQueue.PrepareState(shader, sphere.GetGeometry(), woodTexture),
+		renderQueue.PrepareState(shader, sphere.GetGeometry(), containerTexture)
+	};
+	DrawState lightState = renderQueue.PrepareState(shaderLight, sphere.GetGeometry());
+
+	// One command list per thread (index 0 is this thread), plus the scratch space of its culling batches
+	std::vector<CommandList> commandLists(JobSystem::Get().GetThreadCount(), CommandList(renderQueue));
+	struct alignas(64) ThreadScratch
+	{
+		BoundsBatch bounds;
+		std::vector<uint8_t> visible;
+		std::vector<glm::vec3> positions;
+	};
+	std::vector<ThreadScratch> scratch(JobSystem::Get().GetThreadCount());
+	CullingThroughput cullingThroughput;
+
+	// Scene generation, repeated when the counts change in the UI
+	int objectCount = 20000;
+	int lightCount = 2048;
+	std::vector<StressObject> objects;
+	std::vector<StressLight> lights;
+	std::vector<glm::vec3> lightPositions;
+	auto GenerateScene = [&]() {
+		std::mt19937 gen(benchmark.GetSeed());
+		std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+
+		objects.resize(objectCount);
+		for (StressObject& object : objects) {
+			object.position = glm::vec3(50.0f * dis(gen), 8.0f * dis(gen), 50.0f * dis(gen));
+			object.axis = glm::normalize(glm::vec3(dis(gen), dis(gen), dis(gen)) + glm::vec3(0.0f, 0.01f, 0.0f));
+			object.speed = 0.5f + 0.5f * dis(gen);
+			object.phase = 3.14159265f * dis(gen);
+			object.scale = 0.3f + 0.15f * dis(gen);
+			object.state = (unsigned int)(0.5f * (dis(gen) + 1.0f) * objectStates.size()) % objectStates.size();
+		}
+
+		lights.resize(lightCount);
+		lightPositions.resize(lightCount);
+		for (StressLight& light : lights) {
+			light.center = glm::vec3(50.0f * dis(gen), 10.0f + 2.0f * dis(gen), 50.0f * dis(gen));
+			light.radius = 2.0f + dis(gen);
+			light.speed = dis(gen);
+			light.phase = 3.14159265f * dis(gen);
+			light.color = 3.0f * glm::vec3(0.5f * dis(gen) + 0.5f, 0.5f * dis(gen) + 0.5f, 0.5f * dis(gen) + 0.5f);
+		}
+	};
+	GenerateScene();
+	int generatedObjects = objectCount, generatedLights = lightCount;
+
+	// Per-frame CPU timings of the three stages, in milliseconds
+	float recordMilliseconds = 0.0f, mergeMilliseconds = 0.0f, executeMilliseconds = 0.0f;
+	unsigned int visibleObjects = 0, visibleLights = 0;
+	std::vector<PointLight> shadingLights(MAX_LIGHTS);
+	camera.movementSpeed = 10.0f;
+
+	while (!glfwWindowShouldClose(window) && benchmark.NextFrame(camera)) {
+		// Publish last frame's state-cache counters and start counting this frame
+		GLState::Get().NewFrame();
+		// Read back the GPU timings of an older frame and start recording this one
+		GpuProfiler::Get().BeginFrame();
+		// Build the CPU call tree of the previous frame
+		CpuProfiler::Get().NewFrame();
+		// Publish the per-thread busy times of the previous frame
+		JobSystem::Get().NewFrame();
+		// Publish last frame's culling counters
+		FrustumCuller::Get().NewFrame();
+
+		// Per-frame logic
+		float currentFrame = glfwGetTime();
+		deltaTime = currentFrame - lastFrame;
+		lastFrame = currentFrame;
+
+		// Process input
+		ProcessInput(window);
+
+		if (objectCount != generatedObjects || lightCount != generatedLights) {
+			GenerateScene();
+			generatedObjects = objectCount;
+			generatedLights = lightCount;
+		}
+
+		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, FAR_PLANE);
+		glm::mat4 view = camera.GetViewMatrix();
+		frameConstants.SetCamera(projection, view, camera.position);
+		renderQueue.SetCamera(camera.position, FAR_PLANE);
+		Frustum frustum(projection * view);
+
+		// Culls the bounding spheres a chunk put into its batch in one SIMD pass, the flags end up in local.visible
+		auto CullChunk = [&](ThreadScratch& local) {
+			size_t count = local.bounds.Size();
+			size_t visibleCount = count;
+			if (FrustumCuller::Get().enabled)
+				visibleCount = local.bounds.Cull(frustum, local.visible);
+			else
+				local.visible.assign(count, 1);
+			FrustumCuller::Get().Count(count, visibleCount);
+		};
+
+		// 1. Record: animate, cull and build packets on every thread
+		// ----------------------------------------------------------
+		long long start = Timer::nowNanoseconds();
+		JobSystem::Get().ParallelFor(objects.size(), 256, [&](size_t begin, size_t end, unsigned int thread) {
+			CPU_PROFILE_SCOPE("record objects");
+			CommandList& list = commandLists[thread];
+			ThreadScratch& local = scratch[thread];
+			local.positions.resize(end - begin);
+			local.bounds.Clear();
+			for (size_t i = begin; i < end; i++) {
+				const StressObject& object = objects[i];
+				local.positions[i - begin] = object.position + glm::vec3(0.0f, 0.5f * std::sin(currentFrame * object.speed + object.phase), 0.0f);
+				local.bounds.AddSphere(local.positions[i - begin], 1.75f * object.scale);
+			}
+			CullChunk(local);
+
+			for (size_t i = begin; i < end; i++) {
+				if (!local.visible[i - begin])
+					continue;
+				const StressObject& object = objects[i];
+				glm::mat4 model = glm::translate(glm::mat4(1.0f), local.positions[i - begin]);
+				model = glm::rotate(model, currentFrame * object.speed + object.phase, object.axis);
+				model = glm::scale(model, glm::vec3(object.scale));
+				list.Submit(0, objectStates[object.state], model);
+			}
+		});
+		size_t recordedObjects = 0;
+		for (const CommandList& list : commandLists)
+			recordedObjects += list.Size();
+
+		JobSystem::Get().ParallelFor(lights.size(), 256, [&](size_t begin, size_t end, unsigned int thread) {
+			CPU_PROFILE_SCOPE("record lights");
+			CommandList& list = commandLists[thread];
+			ThreadScratch& local = scratch[thread];
+			local.bounds.Clear();
+			for (size_t i = begin; i < end; i++) {
+				const StressLight& light = lights[i];
+				float angle = currentFrame * light.speed + light.phase;
+				lightPositions[i] = light.center + light.radius * glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+				local.bounds.AddSphere(lightPositions[i], 0.2f);
+			}
+			CullChunk(local);
+
+			for (size_t i = begin; i < end; i++) {
+				if (!local.visible[i - begin])
+					continue;
+				glm::mat4 model = glm::translate(glm::mat4(1.0f), lightPositions[i]);
+				model = glm::scale(model, glm::vec3(0.1f));
+				list.Submit(0, lightState, model).SetColor("lightColor", lights[i].color);
+			}
+		});
+		long long recorded = Timer::nowNanoseconds();
+		recordMilliseconds = (recorded - start) / 1000000.0f;
+
+		// 2. Merge the per-thread lists on the GL thread
+		// -----------------------------------------------
+		size_t recordedTotal = 0;
+		for (CommandList& list : commandLists) {
+			recordedTotal += list.Size();
+			renderQueue.Append(list);
+		}
+		visibleObjects = (unsigned int)recordedObjects;
+		visibleLights = (unsigned int)(recordedTotal - recordedObjects);
+		long long merged = Timer::nowNanoseconds();
+		mergeMilliseconds = (merged - recorded) / 1000000.0f;
+
+		// The forward shader only takes MAX_LIGHTS lights, the rest are just drawn
+		size_t shadingCount = std::min<size_t>(lights.size(), MAX_LIGHTS);
+		shadingLights.resize(shadingCount);
+		for (size_t i = 0; i < shadingCount; i++) {
+			shadingLights[i].position = lightPositions[i];
+			shadingLights[i].color = lights[i].color;
+		}
+		frameConstants.SetLights(shadingLights);
+
+		// 3. Sort and submit
+		// ------------------
+		GpuProfiler::Get().Begin("scene");
+		GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::Get().Viewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+		glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		renderQueue.Execute();
+		GpuProfiler::Get().End();
+		executeMilliseconds = (Timer::nowNanoseconds() - merged) / 1000000.0f;
+
+		// ImGui code here
+		// ---------------
+		ImGui_ImplOpenGL3_NewFrame();
+		ImGui_ImplGlfw_NewFrame();
+		ImGui::NewFrame();
+
+		ImGui::SetNextWindowSize(ImVec2(500, 400), ImGuiCond_FirstUseEver);
+		ImGui::SetNextWindowPos(ImVec2(50, 50), ImGuiCond_FirstUseEver);
+		ImGui::Begin("hnzz");
+		ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
+		ImGui::SliderInt("Objects", &objectCount, 0, 100000);
+		ImGui::SliderInt("Lights", &lightCount, 0, 16384);
+		ImGui::SliderInt("Worker threads", &JobSystem::Get().activeWorkers, 0, (int)JobSystem::Get().GetWorkerCount());
+		ImGui::Checkbox("Frustum culling", &FrustumCuller::Get().enabled);
+		ImGui::Text("Visible: %u objects, %u lights (%u of %u bounds)", visibleObjects, visibleLights, FrustumCuller::Get().GetFrameCounters().visible, FrustumCuller::Get().GetFrameCounters().tested);
+		if (ImGui::Button("Measure culling throughput"))
+			cullingThroughput = FrustumCuller::MeasureThroughput();
+		if (cullingThroughput.simdBoxesPerMillisecond > 0.0f)
+			ImGui::Text("Culling: %.0f boxes/ms SIMD, %.0f boxes/ms scalar", cullingThroughput.simdBoxesPerMillisecond, cullingThroughput.scalarBoxesPerMillisecond);
+		ImGui::Text("Record %.2f ms, merge %.2f ms, sort + submit %.2f ms", recordMilliseconds, mergeMilliseconds, executeMilliseconds);
+		ImGui::Text("Draw queue: %u draws, %u program / %u texture / %u VAO changes", renderQueue.GetStats().packets, renderQueue.GetStats().programChanges, renderQueue.GetStats().materialChanges, renderQueue.GetStats().vertexArrayChanges);
+		ImGui::Text("GL state changes: %u issued, %u filtered", GLState::Get().GetFrameCounters().issued, GLState::Get().GetFrameCounters().filtered);
+		ImGui::Separator();
+		ImGui::Text("Busy time per thread (last frame)");
+		const std::vector<float>& threadMilliseconds = JobSystem::Get().GetThreadMilliseconds();
+		float busiest = *std::max_element(threadMilliseconds.begin(), threadMilliseconds.end());
+		for (size_t i = 0; i < threadMilliseconds.size(); i++) {
+			std::string label = (i == 0 ? std::string("main") : "worker " + std::to_string(i)) + ": " + std::to_string(threadMilliseconds[i]).substr(0, 5) + " ms";
+			ImGui::ProgressBar(busiest > 0.0f ? threadMilliseconds[i] / busiest : 0.0f, ImVec2(-1.0f, 0.0f), label.c_str());
+		}
+		ImGui::End();
+
+		// GPU pass timings and the CPU call tree
+		ImGui::SetNextWindowSize(ImVec2(400, 500), ImGuiCond_FirstUseEver);
+		ImGui::SetNextWindowPos(ImVec2(600, 50), ImGuiCond_FirstUseEver);
+		ImGui::Begin("Profiler");
+		GpuProfiler::Get().DrawImGui();
+		CpuProfiler::Get().DrawImGui();
+		ImGui::End();
+
+		// ImGui Rendering
+		ImGui::Render();
+		GpuProfiler::Get().Begin("imgui");
+		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		GpuProfiler::Get().End();
+
+		GpuProfiler::Get().EndFrame();
+
+		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+		{
+			CPU_PROFILE_SCOPE("glfwSwapBuffers"); // includes the vsync wait
+			glfwSwapBuffers(window);
+		}
+		glfwPollEvents();
+	}
+
+	benchmark.Finish();
+
+	glfwTerminate();
+
+	// ImGui Cleanup
+	ImGui_ImplOpenGL3_Shutdown();
+	ImGui_ImplGlfw_Shutdown();
+	ImGui::DestroyContext();
+}
+
+// glfw: whenever the window size changed (by OS or user resize) this callback function executes
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+	GLState::Get().Viewport(0, 0, width, height);
+	SCR_WIDTH = width;
+	SCR_HEIGHT = height;
+}
+
+// glfw: whenever the mouse moves, this callback is called
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
+{
+	// Check if the left mouse button is pressed
+	if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+		float xpos = static_cast<float>(xposIn);
+		float ypos = static_cast<float>(yposIn);
+
+		if (mouseButtonPressed) {
+			lastX = xpos;
+			lastY = ypos;
+			mouseButtonPressed = false;
+		}
+
+		float xoffset = xpos - lastX;
+		float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+
+		lastX = xpos;
+		lastY = ypos;
+
+		camera.ProcessMouseMovement(xoffset, yoffset);
+	}
+	else
+		mouseButtonPressed = true;
+}
+
+// glfw: whenever the mouse scroll wheel scrolls, this callback is called
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+	camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+// Process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
+void ProcessInput(GLFWwindow* window)
+{
+	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+		glfwSetWindowShouldClose(window, true);
+
+	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+		camera.ProcessKeyboard(FORWARD, deltaTime);
+	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+		camera.ProcessKeyboard(BACKWARD, deltaTime);
+	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+		camera.ProcessKeyboard(LEFT, deltaTime);
+	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+		camera.ProcessKeyboard(RIGHT, deltaTime);
+}
+
+// Utility function for loading a 2D texture from file
+unsigned int LoadTexture(const std::string& path)
+{
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+
+	int width, height, nrComponents;
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
+	if (data) {
+		GLenum format = GL_RGBA;
+		if (nrComponents == 1) format = GL_RED;
+		else if (nrComponents == 3) format = GL_RGB;
+		else if (nrComponents == 4) format = GL_RGBA;
+		else {
+			std::cerr << "Invalid texture format: Unsupported number of components!\n";
+			return -1;
+		}
+
+		GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		stbi_image_free(data);
+	}
+	else {
+		std::cerr << "Texture failed to load at path: " << path << std::endl;
+		stbi_image_free(data);
+		return -1;
+	}
+
+	return textureID;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+
+// The DynamicResolution class picks the internal render scale from the measured GPU frame time (GpuProfiler),
+// steering it toward targetMilliseconds. CPU frame time is no use here, it is bound by vsync.
+// GPU cost grows roughly with the pixel count, so the correction is the square root of the time ratio; it is
+// damped and snapped to 5% steps so the pooled render targets are not reallocated every frame.
+//
+// Usage Example:
+// DynamicResolution dynamicResolution;
+// dynamicResolution.Update(GpuProfiler::Get().GetLastFrameMilliseconds()); // once per frame, before rendering
+// int width = dynamicResolution.Scale(SCR_WIDTH), height = dynamicResolution.Scale(SCR_HEIGHT);
+// ... render at width x height, upscale to SCR_WIDTH x SCR_HEIGHT ...
+class DynamicResolution
+{
+public:
+	bool enabled = true;              // when disabled the scale is manualScale
+	float targetMilliseconds = 16.6f; // GPU budget for the whole frame
+	float manualScale = 1.0f;
+	float minScale = 0.5f;
+	float maxScale = 1.0f;
+
+	// @param gpuMilliseconds GPU time of a recent frame, 0 while none is known yet.
+	void Update(float gpuMilliseconds)
+	{
+		if (!enabled) {
+			smoothedScale = std::clamp(manualScale, minScale, maxScale);
+			scale = smoothedScale;
+			return;
+		}
+
+		if (gpuMilliseconds <= 0.0f)
+			return; // no results yet
+
+		float desired = scale * std::sqrt(targetMilliseconds / gpuMilliseconds);
+		smoothedScale += (desired - smoothedScale) * 0.1f;
+		smoothedScale = std::clamp(smoothedScale, minScale, maxScale);
+
+		// Snap with a little hysteresis, so noise around a step boundary does not flip back and forth
+		if (std::abs(smoothedScale - scale) > 0.035f)
+			scale = std::clamp(std::round(smoothedScale * 20.0f) / 20.0f, minScale, maxScale);
+	}
+
+	float GetScale() const { return scale; }
+
+	// Scaled size of one dimension, never below one pixel.
+	int Scale(int size) const { return std::max(1, (int)(size * scale + 0.5f)); }
+
+private:
+	float scale = 1.0f;
+	float smoothedScale = 1.0f;
+};
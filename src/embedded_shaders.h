@@ -0,0 +1,2450 @@
+// Generated by tools/embed_shaders.py from res/shaders, do not edit by hand.
+
+#pragma once
+
+enum EmbeddedShaderID : int
+{
+	EMBEDDED_SHADER_NONE = -1,
+	SHADER_BLINN_PHONG_FS = 0,
+	SHADER_BLINN_PHONG_VS = 1,
+	SHADER_BLOOM_FS = 2,
+	SHADER_BLOOM_VS = 3,
+	SHADER_BLOOM_DOWNSAMPLE_FS = 4,
+	SHADER_BLOOM_FINAL_FS = 5,
+	SHADER_BLOOM_FINAL_VS = 6,
+	SHADER_BLOOM_LIGHT_BOX_FS = 7,
+	SHADER_BLOOM_UPSAMPLE_FS = 8,
+	SHADER_BLUR_VS = 9,
+	SHADER_DEBUG_QUAD_FS = 10,
+	SHADER_DEBUG_QUAD_VS = 11,
+	SHADER_DEFERRED_AMBIENT_FS = 12,
+	SHADER_DEFERRED_LIGHT_BOX_FS = 13,
+	SHADER_DEFERRED_LIGHT_BOX_VS = 14,
+	SHADER_DEFERRED_LIGHT_STENCIL_FS = 15,
+	SHADER_DEFERRED_LIGHT_VOLUME_FS = 16,
+	SHADER_DEFERRED_LIGHT_VOLUME_VS = 17,
+	SHADER_DEFERRED_SHADING_FS = 18,
+	SHADER_DEFERRED_SHADING_VS = 19,
+	SHADER_FSR_EASU_FS = 20,
+	SHADER_FSR_RCAS_FS = 21,
+	SHADER_G_BUFFER_FS = 22,
+	SHADER_G_BUFFER_VS = 23,
+	SHADER_GAMMA_CORRECTION_FS = 24,
+	SHADER_GAMMA_CORRECTION_VS = 25,
+	SHADER_GAUSSIAN_BLUR_FS = 26,
+	SHADER_HDR_FS = 27,
+	SHADER_HDR_VS = 28,
+	SHADER_HDRLIGHTING_FS = 29,
+	SHADER_HDRLIGHTING_VS = 30,
+	SHADER_LIGHT_FS = 31,
+	SHADER_LIGHT_VS = 32,
+	SHADER_LUMINANCE_DOWNSAMPLE_FS = 33,
+	SHADER_NORMAL_MAP_FS = 34,
+	SHADER_NORMAL_MAP_VS = 35,
+	SHADER_PARALLAX_MAP_FS = 36,
+	SHADER_PARALLAX_MAP_VS = 37,
+	SHADER_POINT_SHADOW_FS = 38,
+	SHADER_POINT_SHADOW_VS = 39,
+	SHADER_POINT_SHADOW_DEPTH_FS = 40,
+	SHADER_POINT_SHADOW_DEPTH_GS = 41,
+	SHADER_POINT_SHADOW_DEPTH_VS = 42,
+	SHADER_SHADOW_MAP_FS = 43,
+	SHADER_SHADOW_MAP_VS = 44,
+	SHADER_SHADOW_MAP_DEPTH_FS = 45,
+	SHADER_SHADOW_MAP_DEPTH_VS = 46,
+	SHADER_SSAO_FS = 47,
+	SHADER_SSAO_VS = 48,
+	SHADER_SSAO_BILATERAL_BLUR_FS = 49,
+	SHADER_SSAO_BLUR_FS = 50,
+	SHADER_SSAO_DOWNSAMPLE_FS = 51,
+	SHADER_SSAO_GEOMETRY_FS = 52,
+	SHADER_SSAO_GEOMETRY_VS = 53,
+	SHADER_SSAO_LIGHTING_FS = 54,
+	SHADER_SSAO_UPSAMPLE_FS = 55,
+	SHADER_TEMPORAL_RESOLVE_FS = 56,
+	EMBEDDED_SHADER_COUNT = 57
+};
+
+struct EmbeddedShader
+{
+	const char* path; // path the source was embedded from, relative to the project directory
+	const char* source;
+};
+
+inline constexpr EmbeddedShader embeddedShaders[EMBEDDED_SHADER_COUNT] = {
+	{ "res/shaders/blinn_phong.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+struct Light {
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform sampler2D floorTexture;
+uniform vec3 lightPos;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform bool blinn;
+
+uniform Light light;
+
+void main()
+{
+    // Properties
+	vec3 normal = normalize(Normal);
+	vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 lightDir = normalize(lightPos - FragPos);
+
+	// Ambient
+	vec3 ambient = light.ambient * texture(floorTexture, TexCoords).rgb;
+
+	// Diffuse
+	float diff = max(dot(normal, lightDir), 0.0f);
+	vec3 diffuse = light.diffuse * diff * texture(floorTexture, TexCoords).rgb;
+
+	// Specular
+	float spec = 0.0f;
+	if(blinn) {
+		vec3 reflect = reflect(-lightDir, normal);
+		spec = pow(max(dot(reflect, viewDir), 0.0f), 64.0f);
+	}
+	else {
+		vec3 halfWayVector = normalize(viewDir + lightDir);
+		spec = pow(max(dot(normal, halfWayVector), 0.0f), 8.0f);
+	}
+	vec3 specular = light.specular * spec; // Assuming bright white light
+
+	// Combine
+	vec3 result = ambient + diffuse + specular;
+	FragColor = vec4(result, 1.0f);
+})glsl" },
+	{ "res/shaders/blinn_phong.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform mat4 model;
+
+void main()
+{
+    FragPos = aPos;
+    Normal = aNormal;
+    TexCoords = aTexCoords;
+    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+})glsl" },
+	{ "res/shaders/bloom.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+struct Light {
+    vec3 Position;
+    float Linear;
+    vec3 Color;
+    float Quadratic;
+};
+
+layout (std140) uniform Lights
+{
+    Light lights[32];
+    int lightCount;
+};
+uniform sampler2D diffuseTexture;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+void main()
+{           
+    vec3 color = texture(diffuseTexture, TexCoords).rgb;
+    vec3 normal = normalize(Normal);
+
+    // ambient
+    vec3 ambient = 0.1 * color;
+    // lighting
+    vec3 lighting = vec3(0.0);
+    vec3 viewDir = normalize(viewPos - FragPos);
+
+    for (int i = 0; i < lightCount; i++) {
+        // diffuse
+        vec3 lightDir = normalize(lights[i].Position - FragPos);
+        float diff = max(dot(lightDir, normal), 0.0);
+        vec3 result = lights[i].Color * diff * color;      
+
+        // attenuation (use quadratic as we have gamma correction)
+        float distance = length(FragPos - lights[i].Position);
+        result *= 1.0 / (distance * distance);
+        lighting += result;
+    }
+    vec3 result = ambient + lighting;
+
+    // the bright parts are extracted by the first bloom downsample, not here
+    FragColor = vec4(result, 1.0);
+})glsl" },
+	{ "res/shaders/bloom.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform mat4 model;
+
+void main()
+{
+    FragPos = vec3(model * vec4(aPos, 1.0));   
+    TexCoords = aTexCoords;
+        
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
+    Normal = normalize(normalMatrix * aNormal);
+    
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+})glsl" },
+	{ "res/shaders/bloom_downsample.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D sourceTexture;
+uniform bool prefilter; // first level: bright-pass and Karis average, reading the full-resolution HDR scene
+uniform float threshold;
+uniform float knee;     // width of the soft transition below the threshold
+
+float Luminance(vec3 color)
+{
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Keeps the part of the color above the threshold, with a quadratic curve in [threshold - knee, threshold + knee]
+vec3 BrightPass(vec3 color)
+{
+    float brightness = Luminance(color);
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 0.00001);
+    float contribution = max(soft, brightness - threshold) / max(brightness, 0.00001);
+    return color * contribution;
+}
+
+// Weighting each 2x2 box by 1 / (1 + luma) keeps single very bright pixels from flickering as the camera moves
+vec3 KarisAverage(vec3 a, vec3 b, vec3 c, vec3 d)
+{
+    vec4 sum = vec4(0.0);
+    sum += vec4(a, 1.0) / (1.0 + Luminance(a));
+    sum += vec4(b, 1.0) / (1.0 + Luminance(b));
+    sum += vec4(c, 1.0) / (1.0 + Luminance(c));
+    sum += vec4(d, 1.0) / (1.0 + Luminance(d));
+    return sum.rgb / sum.a;
+}
+
+// 13 bilinear taps covering a 6x6 source texel footprint as five overlapping 2x2 boxes (one centered, four in the
+// corners), a box filter with a wider support that does not shimmer when halving the resolution
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(sourceTexture, 0));
+
+    vec3 a = texture(sourceTexture, TexCoords + texel * vec2(-2.0,  2.0)).rgb;
+    vec3 b = texture(sourceTexture, TexCoords + texel * vec2( 0.0,  2.0)).rgb;
+    vec3 c = texture(sourceTexture, TexCoords + texel * vec2( 2.0,  2.0)).rgb;
+    vec3 d = texture(sourceTexture, TexCoords + texel * vec2(-2.0,  0.0)).rgb;
+    vec3 e = texture(sourceTexture, TexCoords).rgb;
+    vec3 f = texture(sourceTexture, TexCoords + texel * vec2( 2.0,  0.0)).rgb;
+    vec3 g = texture(sourceTexture, TexCoords + texel * vec2(-2.0, -2.0)).rgb;
+    vec3 h = texture(sourceTexture, TexCoords + texel * vec2( 0.0, -2.0)).rgb;
+    vec3 i = texture(sourceTexture, TexCoords + texel * vec2( 2.0, -2.0)).rgb;
+    vec3 j = texture(sourceTexture, TexCoords + texel * vec2(-1.0,  1.0)).rgb;
+    vec3 k = texture(sourceTexture, TexCoords + texel * vec2( 1.0,  1.0)).rgb;
+    vec3 l = texture(sourceTexture, TexCoords + texel * vec2(-1.0, -1.0)).rgb;
+    vec3 m = texture(sourceTexture, TexCoords + texel * vec2( 1.0, -1.0)).rgb;
+
+    vec3 result;
+    if (prefilter) {
+        result = KarisAverage(j, k, l, m) * 0.5;
+        result += KarisAverage(a, b, d, e) * 0.125;
+        result += KarisAverage(b, c, e, f) * 0.125;
+        result += KarisAverage(d, e, g, h) * 0.125;
+        result += KarisAverage(e, f, h, i) * 0.125;
+        result = BrightPass(result);
+    }
+    else {
+        result = e * 0.125;
+        result += (a + c + g + i) * 0.03125;
+        result += (b + d + f + h) * 0.0625;
+        result += (j + k + l + m) * 0.125;
+    }
+    FragColor = vec4(max(result, 0.0001), 1.0);
+}
+)glsl" },
+	{ "res/shaders/bloom_final.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D scene;
+uniform sampler2D bloomBlur;
+uniform float bloomStrength;
+
+layout (std140) uniform PostParams
+{
+    float exposure;
+    int bloom;
+    int hdr;
+};
+
+void main()
+{
+	const float gamma = 2.2f;
+	vec3 hdrColor = texture(scene, TexCoords).rgb;
+	vec3 bloomColor = texture(bloomBlur, TexCoords).rgb;
+
+	if (bloom != 0) 
+	    hdrColor += bloomStrength * bloomColor; // additive blending
+    
+    // tone mapping
+    vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
+
+    // also gamma correct while we're at it       
+    result = pow(result, vec3(1.0 / gamma));
+    FragColor = vec4(result, 1.0);
+})glsl" },
+	{ "res/shaders/bloom_final.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+    TexCoords = aTexCoords;
+    gl_Position = vec4(aPos, 1.0);
+})glsl" },
+	{ "res/shaders/bloom_light_box.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform vec3 lightColor;
+
+void main()
+{           
+    FragColor = vec4(lightColor, 1.0);
+})glsl" },
+	{ "res/shaders/bloom_upsample.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D sourceTexture; // the next smaller level, already combined with everything below it
+uniform float filterRadius;      // in source texels
+
+// 3x3 tent filter from 9 bilinear taps, blended additively onto the level this pass renders into
+void main()
+{
+    vec2 offset = filterRadius / vec2(textureSize(sourceTexture, 0));
+
+    vec3 result = texture(sourceTexture, TexCoords).rgb * 4.0;
+    result += (texture(sourceTexture, TexCoords + vec2(-offset.x, 0.0)).rgb +
+               texture(sourceTexture, TexCoords + vec2( offset.x, 0.0)).rgb +
+               texture(sourceTexture, TexCoords + vec2(0.0, -offset.y)).rgb +
+               texture(sourceTexture, TexCoords + vec2(0.0,  offset.y)).rgb) * 2.0;
+    result += texture(sourceTexture, TexCoords + vec2(-offset.x, -offset.y)).rgb +
+              texture(sourceTexture, TexCoords + vec2( offset.x, -offset.y)).rgb +
+              texture(sourceTexture, TexCoords + vec2(-offset.x,  offset.y)).rgb +
+              texture(sourceTexture, TexCoords + vec2( offset.x,  offset.y)).rgb;
+    FragColor = vec4(result / 16.0, 1.0);
+}
+)glsl" },
+	{ "res/shaders/blur.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+    TexCoords = aTexCoords;
+    gl_Position = vec4(aPos, 1.0);
+}
+)glsl" },
+	{ "res/shaders/debug_quad.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D depthMap;
+uniform float near_plane;
+uniform float far_plane;
+
+// required when using a perspective projection matrix
+float LinearizeDepth(float depth)
+{
+    float z = depth * 2.0 - 1.0; // Back to NDC 
+    return (2.0 * near_plane * far_plane) / (far_plane + near_plane - z * (far_plane - near_plane));	
+}
+
+void main()
+{             
+    float depthValue = texture(depthMap, TexCoords).r;
+    // FragColor = vec4(vec3(LinearizeDepth(depthValue) / far_plane), 1.0); // perspective
+    FragColor = vec4(vec3(depthValue), 1.0); // orthographic
+})glsl" },
+	{ "res/shaders/debug_quad.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+    TexCoords = aTexCoords;
+    gl_Position = vec4(aPos, 1.0);
+})glsl" },
+	{ "res/shaders/deferred_ambient.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D gAlbedoSpec;
+
+// Ambient term of the light-volume mode, the volumes add each light on top of it
+void main()
+{
+	FragColor = vec4(vec3(0.3f) * texture(gAlbedoSpec, TexCoords).rgb, 1.0f);
+}
+)glsl" },
+	{ "res/shaders/deferred_light_box.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+uniform vec3 lightColor;
+
+void main()
+{
+	FragColor = vec4(lightColor, 1.0f);
+})glsl" },
+	{ "res/shaders/deferred_light_box.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+})glsl" },
+	{ "res/shaders/deferred_light_stencil.fs",
+R"glsl(#version 330 core
+
+// Stencil-only pass of the light volumes: depth and stencil do all the work, no color is written
+void main()
+{
+}
+)glsl" },
+	{ "res/shaders/deferred_light_volume.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+flat in int lightTexel;
+
+#ifdef PACKED_GBUFFER
+uniform sampler2D gDepth;  // world positions are rebuilt from it
+uniform sampler2D gNormal; // octahedral-encoded
+#else
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+#endif
+uniform sampler2D gAlbedoSpec;
+uniform samplerBuffer lightData;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
+
+#ifdef PACKED_GBUFFER
+vec3 WorldPosition(ivec2 pixel)
+{
+	vec2 uv = (vec2(pixel) + 0.5f) / vec2(textureSize(gDepth, 0));
+	vec4 position = inverseProjection * vec4(vec3(uv, texelFetch(gDepth, pixel, 0).r) * 2.0f - 1.0f, 1.0f);
+	return (inverseView * vec4(position.xyz / position.w, 1.0f)).xyz;
+}
+
+vec3 DecodeNormal(vec2 e)
+{
+	e = e * 2.0f - 1.0f;
+	vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0f);
+	n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+	return normalize(n);
+}
+#endif
+
+void main()
+{
+	// The volumes are drawn at the G-buffer's resolution, the fragment addresses its texel directly
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+#ifdef PACKED_GBUFFER
+	vec3 FragPos = WorldPosition(pixel);
+#else
+	vec3 FragPos = texelFetch(gPosition, pixel, 0).rgb;
+#endif
+	vec4 positionRadius = texelFetch(lightData, lightTexel);
+
+	// The stencil only keeps pixels inside some light's volume, not necessarily this one's
+	float distance = length(positionRadius.xyz - FragPos);
+	if (distance > positionRadius.w)
+		discard;
+
+#ifdef PACKED_GBUFFER
+	vec3 Normal = DecodeNormal(texelFetch(gNormal, pixel, 0).rg);
+#else
+	vec3 Normal = texelFetch(gNormal, pixel, 0).rgb;
+#endif
+	vec4 AlbedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+	vec4 colorLinear = texelFetch(lightData, lightTexel + 1);
+	float quadratic = texelFetch(lightData, lightTexel + 2).r;
+	vec3 lightDir = (positionRadius.xyz - FragPos) / distance;
+	vec3 viewDir = normalize(viewPos - FragPos);
+
+	// Diffuse
+	vec3 diffuse = colorLinear.rgb * AlbedoSpec.rgb * max(dot(Normal, lightDir), 0.0f) * 1.5f;
+	// Specular
+	vec3 halfwayDir = normalize(lightDir + viewDir);
+	float spec = pow(max(dot(halfwayDir, Normal), 0.0f), 32.0f);
+	vec3 specular = colorLinear.rgb * spec * AlbedoSpec.a;
+	// Attenuation
+	float attenuation = 1.0f / (1.0f + colorLinear.a * distance + quadratic * distance * distance);
+
+	// Added to the ambient term by the blending
+	FragColor = vec4((diffuse + specular) * attenuation, 1.0f);
+}
+)glsl" },
+	{ "res/shaders/deferred_light_volume.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
+
+// One instance per light, 3 texels each: (position, radius), (color, linear), (quadratic)
+uniform samplerBuffer lightData;
+uniform float proxyScale; // scales the sphere mesh so it encloses a sphere of radius 1
+
+flat out int lightTexel;
+
+void main()
+{
+	lightTexel = gl_InstanceID * 3;
+	vec4 positionRadius = texelFetch(lightData, lightTexel);
+	gl_Position = projection * view * vec4(positionRadius.xyz + aPos * (positionRadius.w * proxyScale), 1.0);
+}
+)glsl" },
+	{ "res/shaders/deferred_shading.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+#ifdef PACKED_GBUFFER
+uniform sampler2D gDepth;  // world positions are rebuilt from it
+uniform sampler2D gNormal; // octahedral-encoded
+#else
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+#endif
+uniform sampler2D gAlbedoSpec;
+
+// Clustered lights (see LightClusters): the lights of the pixel's cluster are listed in lightIndices
+uniform samplerBuffer lightData;     // 3 texels per light: (position, radius), (color, linear), (quadratic)
+uniform usamplerBuffer lightGrid;    // per cluster: (first index, light count)
+uniform usamplerBuffer lightIndices; // light indices, grouped by cluster
+uniform vec3 clusterGrid;            // tiles in x and y, depth slices
+uniform float clusterNear;
+uniform float clusterSliceScale;     // slices / log(far / near)
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
+
+#ifdef PACKED_GBUFFER
+vec3 WorldPosition(vec2 uv)
+{
+	vec4 position = inverseProjection * vec4(vec3(uv, texture(gDepth, uv).r) * 2.0f - 1.0f, 1.0f);
+	return (inverseView * vec4(position.xyz / position.w, 1.0f)).xyz;
+}
+
+vec3 DecodeNormal(vec2 e)
+{
+	e = e * 2.0f - 1.0f;
+	vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0f);
+	n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+	return normalize(n);
+}
+#endif
+
+int ClusterIndex(vec3 worldPos)
+{
+	ivec3 grid = ivec3(clusterGrid);
+	float depth = max(-(view * vec4(worldPos, 1.0f)).z, clusterNear);
+	int slice = clamp(int(log(depth / clusterNear) * clusterSliceScale), 0, grid.z - 1);
+	ivec2 tile = clamp(ivec2(TexCoords * clusterGrid.xy), ivec2(0), grid.xy - 1);
+	return (slice * grid.y + tile.y) * grid.x + tile.x;
+}
+
+void main()
+{
+	// Retrieve g-Buffer data
+#ifdef PACKED_GBUFFER
+	vec3 FragPos = WorldPosition(TexCoords);
+	vec3 Normal = DecodeNormal(texture(gNormal, TexCoords).rg);
+#else
+	vec3 FragPos = texture(gPosition, TexCoords).rgb;
+	vec3 Normal = texture(gNormal, TexCoords).rgb;
+#endif
+	vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
+	float Specular = texture(gAlbedoSpec, TexCoords).a;
+
+	// Calculate lighting
+	vec3 lighting = vec3(0.3f) * Diffuse;
+	vec3 viewDir = normalize(viewPos - FragPos);
+	uvec2 cluster = texelFetch(lightGrid, ClusterIndex(FragPos)).rg;
+	for(uint i = 0u; i < cluster.y; i++) {
+		int light = int(texelFetch(lightIndices, int(cluster.x + i)).r) * 3;
+		vec4 positionRadius = texelFetch(lightData, light);
+		vec4 colorLinear = texelFetch(lightData, light + 1);
+		float quadratic = texelFetch(lightData, light + 2).r;
+
+		// Beyond the radius the light is below 5/256 of its brightness, the clusters were cut there too
+		float distance = length(positionRadius.xyz - FragPos);
+		if (distance > positionRadius.w)
+			continue;
+		vec3 lightDir = (positionRadius.xyz - FragPos) / distance;
+
+		// Diffuse
+		vec3 diffuse = colorLinear.rgb * Diffuse * max(dot(Normal, lightDir), 0.0f) * 1.5f;
+        // Specular
+		vec3 halfwayDir = normalize(lightDir + viewDir);
+		float spec = pow(max(dot(halfwayDir, Normal), 0.0f), 32.0f);
+		vec3 specular = colorLinear.rgb * spec * Specular;
+		// Attenuation
+		float attenuation = 1.0f / (1.0f + colorLinear.a * distance + quadratic * distance * distance);
+		diffuse *= attenuation;
+		specular *= attenuation;
+		lighting += diffuse + specular;
+	}
+
+	FragColor = vec4(lighting, 1.0f);
+})glsl" },
+	{ "res/shaders/deferred_shading.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+    TexCoords = aTexCoords;
+    gl_Position = vec4(aPos, 1.0);
+})glsl" },
+	{ "res/shaders/fsr_easu.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+// Edge Adaptive Spatial Upsampling, a GLSL 330 port of AMD FidelityFX Super Resolution 1.0 (EASU).
+// 12 taps around the output position are weighted with an approximated Lanczos-2 kernel that is
+// rotated along the local edge direction and stretched with the edge strength, then clamped to the
+// min/max of the 4 nearest texels to avoid ringing. Expects a perceptual (tonemapped, gamma) input.
+//
+//    b c
+//  e f g h
+//  i j k l
+//    n o
+
+uniform sampler2D inputTexture;
+uniform vec2 outputSize;
+
+vec3 Tap(ivec2 p, ivec2 size)
+{
+    return texelFetch(inputTexture, clamp(p, ivec2(0), size - 1), 0).rgb;
+}
+
+// Luma times 2
+float Luma(vec3 c)
+{
+    return c.b * 0.5 + (c.r * 0.5 + c.g);
+}
+
+// Accumulates direction and edge length of one bilinear quadrant, w is its bilinear weight.
+//    a
+//  b c d
+//    e
+void EasuSet(inout vec2 dir, inout float len, float w, float lA, float lB, float lC, float lD, float lE)
+{
+    // Direction is the '+' diff, the length converts gradient reversal to 0
+    float dc = lD - lC;
+    float cb = lC - lB;
+    float lenX = max(abs(dc), abs(cb));
+    lenX = 1.0 / max(lenX, 1.0 / 32768.0);
+    float dirX = lD - lB;
+    dir.x += dirX * w;
+    lenX = clamp(abs(dirX) * lenX, 0.0, 1.0);
+    len += lenX * lenX * w;
+
+    float ec = lE - lC;
+    float ca = lC - lA;
+    float lenY = max(abs(ec), abs(ca));
+    lenY = 1.0 / max(lenY, 1.0 / 32768.0);
+    float dirY = lE - lA;
+    dir.y += dirY * w;
+    lenY = clamp(abs(dirY) * lenY, 0.0, 1.0);
+    len += lenY * lenY * w;
+}
+
+void EasuTap(inout vec3 aC, inout float aW, vec2 off, vec2 dir, vec2 len, float lob, float clp, vec3 c)
+{
+    // Rotate offset by direction, then apply the anisotropy
+    vec2 v = vec2(off.x * dir.x + off.y * dir.y, off.x * -dir.y + off.y * dir.x);
+    v *= len;
+
+    // Distance^2, limited to the window as at the corners 2 taps can easily be outside
+    float d2 = min(dot(v, v), clp);
+
+    // Lanczos-2 approximation without sin(), rcp() or sqrt():
+    //  (25/16 * (2/5 * x^2 - 1)^2 - (25/16 - 1)) * (lob * x^2 - 1)^2
+    float wB = 2.0 / 5.0 * d2 - 1.0;
+    float wA = lob * d2 - 1.0;
+    wB *= wB;
+    wA *= wA;
+    wB = 25.0 / 16.0 * wB - (25.0 / 16.0 - 1.0);
+    float w = wB * wA;
+    aC += c * w;
+    aW += w;
+}
+
+void main()
+{
+    ivec2 size = textureSize(inputTexture, 0);
+
+    // Output pixel center in input texel space, split into the top-left texel 'f' and the fraction
+    vec2 pp = gl_FragCoord.xy * vec2(size) / outputSize - 0.5;
+    vec2 fp = floor(pp);
+    pp -= fp;
+    ivec2 f = ivec2(fp);
+
+    vec3 bC = Tap(f + ivec2( 0, -1), size);
+    vec3 cC = Tap(f + ivec2( 1, -1), size);
+    vec3 eC = Tap(f + ivec2(-1,  0), size);
+    vec3 fC = Tap(f + ivec2( 0,  0), size);
+    vec3 gC = Tap(f + ivec2( 1,  0), size);
+    vec3 hC = Tap(f + ivec2( 2,  0), size);
+    vec3 iC = Tap(f + ivec2(-1,  1), size);
+    vec3 jC = Tap(f + ivec2( 0,  1), size);
+    vec3 kC = Tap(f + ivec2( 1,  1), size);
+    vec3 lC = Tap(f + ivec2( 2,  1), size);
+    vec3 nC = Tap(f + ivec2( 0,  2), size);
+    vec3 oC = Tap(f + ivec2( 1,  2), size);
+
+    float bL = Luma(bC), cL = Luma(cC), eL = Luma(eC), fL = Luma(fC);
+    float gL = Luma(gC), hL = Luma(hC), iL = Luma(iC), jL = Luma(jC);
+    float kL = Luma(kC), lL = Luma(lC), nL = Luma(nC), oL = Luma(oC);
+
+    // Direction and length from the 4 bilinear quadrants around the output position
+    vec2 dir = vec2(0.0);
+    float len = 0.0;
+    EasuSet(dir, len, (1.0 - pp.x) * (1.0 - pp.y), bL, eL, fL, gL, jL);
+    EasuSet(dir, len, pp.x * (1.0 - pp.y), cL, fL, gL, hL, kL);
+    EasuSet(dir, len, (1.0 - pp.x) * pp.y, fL, iL, jL, kL, nL);
+    EasuSet(dir, len, pp.x * pp.y, gL, jL, kL, lL, oL);
+
+    // Normalize the direction, falling back to horizontal on flat areas
+    float dirR = dot(dir, dir);
+    bool zro = dirR < 1.0 / 32768.0;
+    dirR = zro ? 1.0 : inversesqrt(dirR);
+    dir.x = zro ? 1.0 : dir.x;
+    dir *= dirR;
+
+    // Transform length from {0 to 2} to {0 to 1} and shape with a square
+    len = len * 0.5;
+    len *= len;
+
+    // Stretch the kernel {1.0 vert|horz, to sqrt(2.0) on diagonal}
+    float stretch = dot(dir, dir) / max(abs(dir.x), abs(dir.y));
+    // Anisotropic length after rotation: x from 1.0 to 'stretch' on edges, y from 1.0 to 0.5 on edges
+    vec2 len2 = vec2(1.0 + (stretch - 1.0) * len, 1.0 - 0.5 * len);
+    // The window shifts from +/-sqrt(2.0) to slightly beyond 2.0 with the amount of edge
+    float lob = 0.5 + ((1.0 / 4.0 - 0.04) - 0.5) * len;
+    float clp = 1.0 / lob;
+
+    vec3 min4 = min(min(fC, gC), min(jC, kC));
+    vec3 max4 = max(max(fC, gC), max(jC, kC));
+
+    vec3 aC = vec3(0.0);
+    float aW = 0.0;
+    EasuTap(aC, aW, vec2( 0.0, -1.0) - pp, dir, len2, lob, clp, bC);
+    EasuTap(aC, aW, vec2( 1.0, -1.0) - pp, dir, len2, lob, clp, cC);
+    EasuTap(aC, aW, vec2(-1.0,  1.0) - pp, dir, len2, lob, clp, iC);
+    EasuTap(aC, aW, vec2( 0.0,  1.0) - pp, dir, len2, lob, clp, jC);
+    EasuTap(aC, aW, vec2( 0.0,  0.0) - pp, dir, len2, lob, clp, fC);
+    EasuTap(aC, aW, vec2(-1.0,  0.0) - pp, dir, len2, lob, clp, eC);
+    EasuTap(aC, aW, vec2( 1.0,  1.0) - pp, dir, len2, lob, clp, kC);
+    EasuTap(aC, aW, vec2( 2.0,  1.0) - pp, dir, len2, lob, clp, lC);
+    EasuTap(aC, aW, vec2( 2.0,  0.0) - pp, dir, len2, lob, clp, hC);
+    EasuTap(aC, aW, vec2( 1.0,  0.0) - pp, dir, len2, lob, clp, gC);
+    EasuTap(aC, aW, vec2( 1.0,  2.0) - pp, dir, len2, lob, clp, oC);
+    EasuTap(aC, aW, vec2( 0.0,  2.0) - pp, dir, len2, lob, clp, nC);
+
+    // Normalize and dering
+    FragColor = vec4(min(max4, max(min4, aC / aW)), 1.0);
+}
+)glsl" },
+	{ "res/shaders/fsr_rcas.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+// Robust Contrast Adaptive Sharpening, a GLSL 330 port of AMD FidelityFX Super Resolution 1.0 (RCAS).
+// Runs at output resolution after EASU. The sharpening lobe is limited per pixel so the result never
+// leaves the min/max of the '+' neighborhood, and it is reduced on noise.
+//
+//    b
+//  d e f
+//    h
+
+uniform sampler2D inputTexture;
+uniform float sharpness; // in stops, 0.0 is the strongest
+
+// Maximum lobe, larger values clip
+const float RCAS_LIMIT = 0.25 - (1.0 / 16.0);
+
+vec3 Tap(ivec2 p, ivec2 size)
+{
+    return texelFetch(inputTexture, clamp(p, ivec2(0), size - 1), 0).rgb;
+}
+
+float Luma(vec3 c)
+{
+    return c.b * 0.5 + (c.r * 0.5 + c.g);
+}
+
+void main()
+{
+    ivec2 size = textureSize(inputTexture, 0);
+    ivec2 p = ivec2(gl_FragCoord.xy);
+
+    vec3 b = Tap(p + ivec2( 0, -1), size);
+    vec3 d = Tap(p + ivec2(-1,  0), size);
+    vec3 e = Tap(p, size);
+    vec3 f = Tap(p + ivec2( 1,  0), size);
+    vec3 h = Tap(p + ivec2( 0,  1), size);
+
+    float bL = Luma(b), dL = Luma(d), eL = Luma(e), fL = Luma(f), hL = Luma(h);
+
+    // Noise detection, reduces sharpening on isolated pixels
+    float nz = 0.25 * (bL + dL + fL + hL) - eL;
+    float range = max(max(max(bL, dL), max(eL, fL)), hL) - min(min(min(bL, dL), min(eL, fL)), hL);
+    nz = clamp(abs(nz) / max(range, 1.0 / 32768.0), 0.0, 1.0);
+    nz = -0.5 * nz + 1.0;
+
+    // Min and max of the ring
+    vec3 mn4 = min(min(b, d), min(f, h));
+    vec3 mx4 = max(max(b, d), max(f, h));
+
+    // Limiters: the largest negative lobe that keeps the output inside [0, 1]
+    vec2 peakC = vec2(1.0, -4.0);
+    vec3 hitMin = min(mn4, e) / max(4.0 * mx4, vec3(1.0 / 32768.0));
+    vec3 hitMax = (peakC.x - max(mx4, e)) / min(4.0 * mn4 + peakC.y, vec3(-1.0 / 32768.0));
+    vec3 lobeRGB = max(-hitMin, hitMax);
+    float lobe = max(-RCAS_LIMIT, min(max(lobeRGB.r, max(lobeRGB.g, lobeRGB.b)), 0.0)) * exp2(-sharpness);
+    lobe *= nz;
+
+    // Resolve
+    vec3 color = (lobe * (b + d + f + h) + e) / (4.0 * lobe + 1.0);
+    FragColor = vec4(color, 1.0);
+}
+)glsl" },
+	{ "res/shaders/g_buffer.fs",
+R"glsl(#version 330 core
+#ifdef PACKED_GBUFFER
+// Packed layout: the position is rebuilt from the depth buffer, the normal is octahedral-encoded into RG16
+layout(location = 0) out vec2 gNormal;
+layout(location = 1) out vec4 gAlbedoSpecular;
+#else
+layout(location = 0) out vec3 gPosition;
+layout(location = 1) out vec3 gNormal;
+layout(location = 2) out vec4 gAlbedoSpecular;
+#endif
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform sampler2D texture_diffuse1;
+uniform sampler2D texture_specular1;
+
+// Folds the unit sphere onto the [-1, 1] square (lower hemisphere mirrored into the corners), stored as [0, 1]
+vec2 EncodeNormal(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 signs = vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+	vec2 e = n.z >= 0.0f ? n.xy : (1.0f - abs(n.yx)) * signs;
+	return e * 0.5f + 0.5f;
+}
+
+void main()
+{
+#ifdef PACKED_GBUFFER
+	gNormal = EncodeNormal(normalize(Normal));
+#else
+	gPosition = FragPos;
+	gNormal = normalize(Normal);
+#endif
+	gAlbedoSpecular.rgb = texture(texture_diffuse1, TexCoords).rgb;
+	gAlbedoSpecular.a = texture(texture_specular1, TexCoords).r;
+}
+)glsl" },
+	{ "res/shaders/g_buffer.vs",
+R"glsl(#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform mat4 model;
+
+void main()
+{
+    FragPos = vec3(model * vec4(aPos, 1.0f));
+    Normal = transpose(inverse(mat3(model))) * aNormal;
+    TexCoords = aTexCoords;
+
+    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+})glsl" },
+	{ "res/shaders/gamma_correction.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform sampler2D floorTexture;
+uniform bool gamma;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+struct Light {
+    vec3 Position;
+    float Linear;
+    vec3 Color;
+    float Quadratic;
+};
+
+layout (std140) uniform Lights
+{
+    Light lights[32];
+    int lightCount;
+};
+
+vec3 BlinnPhong(vec3 normal, vec3 fragPos, vec3 lightPos, vec3 lightColor);
+
+void main()
+{
+    vec3 color = texture(floorTexture, TexCoords).rgb;
+    vec3 lighting = vec3(0.0f);
+    for(int i = 0; i < lightCount; i++) {
+        lighting = BlinnPhong(Normal, FragPos, lights[i].Position, lights[i].Color);
+        color += lighting;
+    }
+
+    if(gamma) {
+        color = pow(color, vec3(1.0 / 2.2));
+    }
+    FragColor = vec4(color, 1.0f);
+}
+
+vec3 BlinnPhong(vec3 normal, vec3 fragPos, vec3 lightPos, vec3 lightColor)
+{
+    // Properties
+    vec3 norm = normalize(normal);
+    vec3 lightDir = normalize(lightPos - fragPos);
+    vec3 viewDir = normalize(viewPos - fragPos);
+
+    // Ambient
+    // ignore here
+
+    // Diffuse
+    float diff = max(dot(norm, lightDir), 0.0f);
+    vec3 diffuse = diff * lightColor;
+
+    // Specular
+    vec3 halfwayDir = normalize(viewDir + lightDir);
+    float spec = pow(max(dot(halfwayDir, norm), 0.0f) , 64.0f);
+    vec3 specular = spec * lightColor;
+
+    // Simple attenuation
+    float attenuation = 0.0f;
+    float distance = length(lightPos - fragPos);
+
+    // Attenuation
+    //if(gamma) 
+        attenuation = 1.0 / (distance * distance);
+    //else 
+        //attenuation = 1.0 / distance;
+    
+    //attenuation = 1.0 / (1 + 0.09 * distance + 0.032 * distance * distance);
+    diffuse *= attenuation;
+    specular *= attenuation;
+
+    return diffuse + specular;
+})glsl" },
+	{ "res/shaders/gamma_correction.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform mat4 model;
+
+void main()
+{
+    FragPos = aPos;
+    Normal = aNormal;
+    TexCoords = aTexCoords;
+    gl_Position = projection * view * model * vec4(aPos, 1.0f); 
+})glsl" },
+	{ "res/shaders/gaussian_blur.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image;  // sampled with GL_LINEAR, the taps sit between texels
+uniform vec2 direction;   // (1, 0) for the horizontal pass, (0, 1) for the vertical one
+
+layout (std140) uniform BlurKernel
+{
+    vec4 taps[64]; // x: offset in texels, y: weight of the linear-sampled taps, center first
+    int tapCount;
+    int radius;
+};
+
+// One half of a separable Gaussian blur; the kernel comes from GaussianKernel on the CPU, so the width is a runtime
+// parameter and the cost is 2 * tapCount - 1 fetches
+void main()
+{
+    vec2 texel = direction / vec2(textureSize(image, 0));
+    vec4 result = texture(image, TexCoords) * taps[0].y;
+    for (int i = 1; i < tapCount; i++) {
+        vec2 offset = texel * taps[i].x;
+        result += (texture(image, TexCoords + offset) + texture(image, TexCoords - offset)) * taps[i].y;
+    }
+    FragColor = result;
+}
+)glsl" },
+	{ "res/shaders/hdr.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D hdrBuffer;
+
+layout (std140) uniform PostParams
+{
+    float exposure;
+    int bloom;
+    int hdr;
+};
+
+void main()
+{             
+    const float gamma = 2.2;
+
+    // Sample color from pre-rendered texture
+    vec3 hdrColor = texture(hdrBuffer, TexCoords).rgb;
+
+    if (hdr != 0) {
+        // Reinhard tone mapping (commented out)
+        // Maps high dynamic range to low dynamic range, preserving details
+        // -------------------------------------
+        // vec3 result = hdrColor / (hdrColor + vec3(1.0));
+
+        // Exposure tone mapping
+        // ---------------------
+        // Darkens bright areas and brightens dark areas based on exposure value
+        vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
+        
+        // Gamma correction
+        // ----------------
+        // Corrects the brightness to better match human perception
+        result = pow(result, vec3(1.0 / gamma));
+        FragColor = vec4(result, 1.0);
+    }
+    else {
+        vec3 result = pow(hdrColor, vec3(1.0 / gamma));
+        FragColor = vec4(result, 1.0);
+    }
+})glsl" },
+	{ "res/shaders/hdr.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+    TexCoords = aTexCoords;
+    gl_Position = vec4(aPos, 1.0);
+})glsl" },
+	{ "res/shaders/hdrLighting.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+struct Light {
+    vec3 Position;
+    float Linear;
+    vec3 Color;
+    float Quadratic;
+};
+
+layout (std140) uniform Lights
+{
+    Light lights[32];
+    int lightCount;
+};
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform sampler2D woodTexture;
+
+void main()
+{
+	vec3 color = texture(woodTexture, TexCoords).rgb;
+	vec3 normal = normalize(Normal);
+	vec3 lighting = vec3(0.0f);
+
+	// For learning purpose, we only apply diffuse here (without ambient and specular)
+	for (int i = 0; i < lightCount; i++) {
+		vec3 lightDir = normalize(lights[i].Position - FragPos);
+		float diff = max(dot(lightDir, normal), 0.0);
+		vec3 diffuse = lights[i].Color * diff * color;
+		vec3 result = diffuse;
+
+		float distance = length(FragPos - lights[i].Position);
+		result *= 1.0f / (distance * distance);
+		lighting += result;
+	}
+
+	FragColor = vec4(lighting, 1.0f);
+})glsl" },
+	{ "res/shaders/hdrLighting.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform mat4 model;
+
+uniform bool inverse_normals;
+
+void main()
+{
+    FragPos = vec3(model * vec4(aPos, 1.0));   
+    TexCoords = aTexCoords;
+    
+    vec3 n = inverse_normals ? -aNormal : aNormal;
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
+    Normal = normalize(normalMatrix * n);
+    
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+})glsl" },
+	{ "res/shaders/light.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+void main()
+{
+	FragColor = vec4(1.0f);
+})glsl" },
+	{ "res/shaders/light.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+})glsl" },
+	{ "res/shaders/luminance_downsample.fs",
+R"glsl(#version 330 core
+out float logLuminance;
+
+in vec2 TexCoords;
+
+uniform sampler2D hdrInput;
+
+const int GRID = 4; // bilinear taps per side, each one averages 2x2 texels
+
+float Luminance(vec3 color)
+{
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Log2 luminance of a small grid over the screen, for the auto exposure histogram. Each output texel averages the
+// log of GRID x GRID bilinear taps spread over its footprint (a geometric mean), so a few very bright pixels do
+// not dominate the cell the way they would in a plain average.
+void main()
+{
+    vec2 footprint = fwidth(TexCoords); // one output texel in input UVs
+    vec2 origin = TexCoords - 0.5 * footprint;
+    float sum = 0.0;
+    for (int y = 0; y < GRID; y++) {
+        for (int x = 0; x < GRID; x++) {
+            vec2 uv = origin + (vec2(x, y) + 0.5) / float(GRID) * footprint;
+            sum += log2(max(Luminance(texture(hdrInput, uv).rgb), 0.00001));
+        }
+    }
+    logLuminance = sum / float(GRID * GRID);
+}
+)glsl" },
+	{ "res/shaders/normal_map.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec3 tangentLightPos;
+in vec3 tangentViewPos;
+in vec3 tangentFragPos;
+
+uniform sampler2D texture_diffuse;
+uniform sampler2D texture_normal;
+uniform float lightIntensity;
+
+void main()
+{
+	// Fetch and normalize the normal from the normal map
+	vec3 normal = texture(texture_normal, TexCoords).rgb;
+	normal = normalize(normal * 2.0f - 1.0f);
+
+	// Compute the light direction in tangent space
+	vec3 lightDir = normalize(tangentLightPos - tangentFragPos);
+
+	// Compute the view direction in tangent space
+	vec3 viewDir = normalize(tangentViewPos - tangentFragPos);
+
+	// Fetch the color from the diffuse map
+	vec3 color = texture(texture_diffuse, TexCoords).rgb;
+
+	// Compute ambient, diffuse, and specular components
+	vec3 ambient = 0.1 * color;
+	float diff = max(dot(lightDir, normal), 0.0);
+	vec3 diffuse = diff * color;
+	vec3 halfwayDir = normalize(lightDir + viewDir);  
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
+	vec3 specular = vec3(0.2) * spec;
+
+	// Use lightIntensity to control light, ambient keeps the same
+	vec3 lighting = ambient + lightIntensity * (diffuse + specular);
+	FragColor = vec4(lighting, 1.0);
+})glsl" },
+	{ "res/shaders/normal_map.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 texCoords;
+layout (location = 3) in vec3 tangent;
+layout (location = 4) in vec3 bitangent;
+
+out vec2 TexCoords;
+out vec3 tangentLightPos;
+out vec3 tangentViewPos;
+out vec3 tangentFragPos;
+
+uniform vec3 lightPos;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(position, 1.0f);
+    vec3 FragPos = vec3(model * vec4(position, 1.0f));
+    TexCoords = texCoords;
+    
+    // Compute the normal matrix from the model matrix
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
+
+    // Transform tangent, bitangent, and normal vectors to world space
+    vec3 T = normalize(normalMatrix * tangent);
+    vec3 B = normalize(normalMatrix * bitangent);
+    vec3 N = normalize(normalMatrix * normal);   
+
+    // Construct the TBN matrix. 
+    // *** IMPORTANT: Transpose is optional and depends on your specific needs.
+    // It's used here to transform lightPos, viewPos, and FragPos to tangent space.
+    mat3 TBN = transpose(mat3(T, B, N));  
+
+    // Transform lightPos, viewPos, and FragPos from world space to tangent space
+    tangentLightPos = TBN * lightPos;
+    tangentViewPos = TBN * viewPos;
+    tangentFragPos = TBN * FragPos;
+})glsl" },
+	{ "res/shaders/parallax_map.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec3 tangentLightPos;
+in vec3 tangentViewPos;
+in vec3 tangentFragPos;
+
+uniform sampler2D diffuseMap;
+uniform sampler2D normalMap;
+uniform sampler2D depthMap;
+
+uniform float height_scale;
+uniform float minLayers;
+uniform float maxLayers;
+
+layout (std140) uniform LightProperties {
+    float lightIntensity;
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+vec2 ParallaxMapping(vec2 texCoords, vec3 viewDir);
+vec2 SteepParallaxMapping(vec2 texCoords, vec3 viewDir);
+
+void main()
+{
+	vec3 viewDir = normalize(tangentViewPos - tangentFragPos);
+
+    // Retrieving texCoords from depth(height) map
+	vec2 texCoords = SteepParallaxMapping(TexCoords, viewDir);
+
+    // Notice: this can only work on a squad
+    if (texCoords.x > 1.0 || texCoords.y > 1.0 || texCoords.x < 0.0 || texCoords.y < 0.0) 
+        discard;
+
+	// normal
+    vec3 normal = texture(normalMap, texCoords).rgb;
+	normal = normalize(normal * 2.0f - 1.0f);
+
+	// Calculate ambient, diffuse and specular coefficients
+    vec3 color = texture(diffuseMap, texCoords).rgb;
+    vec3 ambient = 0.1 * color;
+    vec3 lightDir = normalize(tangentLightPos - tangentFragPos);
+    float diff = max(dot(lightDir, normal), 0.0);
+    vec3 diffuse = diff * color;  
+    vec3 reflectDir = reflect(-lightDir, normal);
+    vec3 halfwayDir = normalize(lightDir + viewDir);  
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
+    vec3 specular = vec3(0.2) * spec;
+
+    // Attenuation
+    float distance = length(tangentLightPos - tangentFragPos);
+    float attenuation = 1.0 / (constant + linear * distance + quadratic * distance * distance);
+    vec3 lighting = ambient + lightIntensity * attenuation * (diffuse + specular);
+    FragColor = vec4(lighting, 1.0f);
+}
+
+vec2 ParallaxMapping(vec2 texCoords, vec3 viewDir)
+{ 
+    float height =  texture(depthMap, texCoords).r;     
+    return texCoords - viewDir.xy * (height * height_scale); // use minus here since we use depth map(not height map)        
+}
+
+vec2 SteepParallaxMapping(vec2 texCoords, vec3 viewDir)
+{
+    // Dynamic layer adjustment using uniform variables
+    float numLayers = mix(maxLayers, minLayers, abs(dot(vec3(0.0, 0.0, 1.0), viewDir)));
+
+    vec2 deltaTexCoords = viewDir.xy / (viewDir.z * numLayers);
+    float deltaLayerDepth = 1.0f / numLayers;
+    vec2 currentTexCoords = texCoords;
+    float currentLayerDepth = 0.0;
+    float currentHeight = 0.0;
+
+    // Ray marching loop
+    for (int i = 0; i < numLayers; ++i) {
+        currentHeight = texture(depthMap, currentTexCoords).r * height_scale;
+        if (currentHeight < currentLayerDepth) {
+            // We found the intersection point
+            break;
+        }
+        currentTexCoords -= deltaTexCoords;
+        currentLayerDepth += deltaLayerDepth;
+    }
+
+    // Calculate depths for interpolation
+    vec2 prevTexCoords = currentTexCoords + deltaTexCoords;
+    float afterDepth = currentHeight - currentLayerDepth;
+    float beforeDepth = texture(depthMap, prevTexCoords).r * height_scale - currentLayerDepth + deltaLayerDepth;
+
+    // Interpolation weight
+    float weight = afterDepth / (afterDepth - beforeDepth);
+
+    // Final texture coordinates
+    vec2 finalTexCoords = prevTexCoords * weight + currentTexCoords * (1.0 - weight);
+
+    return finalTexCoords;
+})glsl" },
+	{ "res/shaders/parallax_map.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec3 tangent;
+layout (location = 4) in vec3 bitangent;
+
+out vec2 TexCoords;
+out vec3 tangentLightPos;
+out vec3 tangentViewPos;
+out vec3 tangentFragPos;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform mat4 model;
+
+uniform vec3 lightPos;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(position, 1.0f);
+    vec3 FragPos = vec3(model * vec4(position, 1.0));  
+    TexCoords = aTexCoords;
+
+    vec3 T   = normalize(mat3(model) * tangent);
+    vec3 B   = normalize(mat3(model) * bitangent);
+    vec3 N   = normalize(mat3(model) * normal);
+    mat3 TBN = transpose(mat3(T, B, N));
+
+    tangentLightPos = TBN * lightPos;
+    tangentViewPos = TBN * viewPos;
+    tangentFragPos = TBN * FragPos;
+})glsl" },
+	{ "res/shaders/point_shadow.fs",
+R"glsl(#version 330 core
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec2 Velocity; // only attached when temporal filtering is on
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+in vec4 CurrentClip;
+in vec4 PreviousClip;
+
+uniform sampler2D diffuseTexture;
+uniform samplerCube depthMap;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform vec3 lightPos;
+uniform float far_plane;
+uniform bool shadows;
+// PCF taps of gridSamplingDisk taken this frame, starting at shadowSampleOffset. All 20 without temporal
+// filtering; with it a few per frame, rotated so the accumulated history sees all of them
+uniform int shadowSamples;
+uniform int shadowSampleOffset;
+
+// array of offset direction for sampling
+vec3 gridSamplingDisk[20] = vec3[]
+(
+   vec3(1, 1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1, 1,  1), 
+   vec3(1, 1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1, 1, -1),
+   vec3(1, 1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1, 1,  0),
+   vec3(1, 0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1, 0, -1),
+   vec3(0, 1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0, 1, -1)
+);
+
+float ShadowCalculation();
+float ShadowCalculation_3dimensions();
+
+void main()
+{
+	vec3 lightDir = normalize(lightPos - FragPos);
+	vec3 normal = normalize(Normal);
+	vec3 viewDir = normalize(viewPos - FragPos);
+	vec3 color = texture(diffuseTexture, TexCoords).rgb;
+	vec3 lightColor = vec3(0.5f);
+
+	// Ambient
+	vec3 ambient = 0.3 * lightColor;
+
+	// Diffuse
+	float diff = max(dot(lightDir, normal), 0.0);
+    vec3 diffuse = diff * lightColor;
+
+	// Specular
+    vec3 halfwayDir = normalize(lightDir + viewDir);  
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
+    vec3 specular = spec * lightColor; 
+	
+	// Calculate shadow
+    float shadow = shadows ? ShadowCalculation() : 0.0f;                      
+    vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;   
+
+	FragColor = vec4(lighting, 1.0f);
+	Velocity = (CurrentClip.xy / CurrentClip.w - PreviousClip.xy / PreviousClip.w) * 0.5f;
+}
+
+float ShadowCalculation()
+{
+    // We use a vector from light to fragment as texture coordinates
+    vec3 fragToLight = FragPos - lightPos;
+    float currentDepth = length(fragToLight);
+
+    float bias = 0.05;
+    float shadow = 0.0f;
+
+    for(int i = 0; i < shadowSamples; i++) {
+        float closetDepth = texture(depthMap, fragToLight + 0.05f * gridSamplingDisk[(shadowSampleOffset + i) % 20]).r;
+        closetDepth *= far_plane; // Undo mapping [0, 1]
+        shadow += (currentDepth - bias > closetDepth) ? 1.0f : 0.0f;
+    }
+        
+    return shadow / float(shadowSamples);
+}
+
+
+float ShadowCalculation_3dimensions()
+{
+    vec3 frag_light = FragPos - lightPos;
+    float current = length(frag_light);
+
+    float shadow = 0.0f;
+    float bias = 0.05;
+    for(float i = -0.05; i <= 0.05; i += 0.05) {
+        for(float j = -0.05; j <= 0.05; j += 0.05) {
+            for(float k = -0.05; k <= 0.05; k += 0.05) {
+                float closet = texture(depthMap, frag_light + vec3(i, j, k)).r;
+                closet *= far_plane; // Undo mapping [0, 1]
+                shadow += (current - bias > closet) ? 1.0f : 0.0f;
+            }
+        }
+    }
+    return shadow / 27;
+})glsl" },
+	{ "res/shaders/point_shadow.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+out vec4 CurrentClip;
+out vec4 PreviousClip;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform mat4 model;
+// Unjittered, for the velocity output. The scene is static, so only the camera contributes motion
+uniform mat4 viewProjection;
+uniform mat4 previousViewProjection;
+
+uniform bool reverse_normals;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    CurrentClip = viewProjection * vec4(FragPos, 1.0);
+    PreviousClip = previousViewProjection * vec4(FragPos, 1.0);
+
+    // Adjusts the normals to render the inside surface of the cube, 
+    // allowing proper lighting calculations as if you're looking from the inside of the cube, 
+    // rather than the default outside view.
+    if(reverse_normals) 
+        Normal = transpose(inverse(mat3(model))) * (-1.0 * aNormal);
+    else
+        Normal = transpose(inverse(mat3(model))) * aNormal;
+
+    TexCoords = aTexCoords;
+})glsl" },
+	{ "res/shaders/point_shadow_depth.fs",
+R"glsl(#version 330 core
+in vec4 FragPos;
+
+uniform vec3 lightPos;
+uniform float far_plane;
+
+void main()
+{
+	// Calculate distance between fragment and light source and map to [0;1] 
+	float lightDistance = length(FragPos.xyz - lightPos) / far_plane;
+
+	// Write this as modified depth
+	gl_FragDepth = lightDistance;
+})glsl" },
+	{ "res/shaders/point_shadow_depth.gs",
+R"glsl(#version 330 core
+layout (triangles) in;
+layout (triangle_strip, max_vertices=18) out;
+
+uniform mat4 shadowMatrices[6];
+
+out vec4 FragPos; // FragPos from GS (output per emitvertex)
+
+void main()
+{
+    for(int face = 0; face < 6; ++face) {
+        gl_Layer = face; // built-in variable that specifies to which face we render.
+        for(int i = 0; i < 3; ++i) {
+            // for each triangle's vertices
+            FragPos = gl_in[i].gl_Position;
+            gl_Position = shadowMatrices[face] * FragPos;
+            EmitVertex();
+        }    
+        EndPrimitive();
+    }
+})glsl" },
+	{ "res/shaders/point_shadow_depth.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = model * vec4(aPos, 1.0f);
+})glsl" },
+	{ "res/shaders/shadow_map.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+in vec4 FragPosLightSpace;
+
+uniform sampler2D diffuseTexture;
+uniform sampler2D depthMap;
+
+uniform vec3 lightPosition;
+//uniform vec3 lightDirection;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+float ShadowCalculation(vec4 fragPosLightSpace)
+{
+    // Perform perspective divide and transform to [0,1] range
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
+
+    // Get closest depth value from light's perspective (using [0,1] range fragPosLight as coords)
+    //float closestDepth = texture(depthMap, projCoords.xy).r; 
+
+    // Get depth of current fragment from light's perspective
+    float currentDepth = projCoords.z;
+
+    // Keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
+    if (projCoords.z > 1.0f) 
+        return 0.0f;
+    
+    vec3 normal = normalize(Normal);
+    vec3 lightDir = normalize(+lightPosition - vec3(0.0f));
+    float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
+
+    // Check whether current frag pos is in shadow
+    // float shadow = currentDepth - bias > closestDepth  ? 1.0 : 0.0;
+    // PCF
+    float shadow = 0.0f;
+    vec2 texelSize = 1.0f / textureSize(depthMap, 0);
+    for(int x = -2; x <= 2; x++) {
+        for(int y = -2; y <= 2; y++) {
+            float pcfDepth = texture(depthMap, projCoords.xy + vec2(x, y) * texelSize).r;
+            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+        }
+    }
+
+    return shadow /= 25.0f;
+}
+
+void main()
+{           
+    vec3 color = texture(diffuseTexture, TexCoords).rgb;
+    vec3 normal = normalize(Normal);
+    vec3 lightColor = vec3(0.7);
+
+    // ambient
+    vec3 ambient = 0.5 * lightColor;
+
+    // diffuse
+    vec3 lightDir = normalize(+lightPosition - vec3(0.0f)); // directinoal light when lightDir is fixed
+    float diff = max(dot(lightDir, normal), 0.0);
+    vec3 diffuse = diff * lightColor;
+
+    // specular
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = 0.0;
+    vec3 halfwayDir = normalize(lightDir + viewDir);  
+    spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
+    vec3 specular = spec * lightColor;   
+    
+    // calculate shadow
+    float shadow = ShadowCalculation(FragPosLightSpace);                      
+    vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;    
+    
+    FragColor = vec4(lighting, 1.0);
+})glsl" },
+	{ "res/shaders/shadow_map.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+out vec4 FragPosLightSpace;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform mat4 model;
+uniform mat4 lightSpaceMatrix;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+    FragPos = vec3(model * vec4(aPos, 1.0f));
+    Normal = transpose(inverse(mat3(model))) * aNormal;
+    TexCoords = aTexCoords;
+    FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0f); // Need to be converted to NDC space later
+})glsl" },
+	{ "res/shaders/shadow_map_depth.fs",
+R"glsl(#version 330 core
+
+void main()
+{
+	//gl_FragDepth = gl_FragCoord.z;
+})glsl" },
+	{ "res/shaders/shadow_map_depth.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 lightSpaceMatrix;
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0f);
+})glsl" },
+	{ "res/shaders/ssao.fs",
+R"glsl(#version 330 core
+out float FragColor;
+
+in vec2 TexCoords;
+
+#ifdef PACKED_GBUFFER
+uniform sampler2D gDepth;  // view-space positions are rebuilt from it
+uniform sampler2D gNormal; // octahedral-encoded
+#else
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+#endif
+uniform sampler2D noiseTexture;
+// (cos, sin) of an angle the noise vectors are turned by, changed every frame for temporal accumulation
+uniform vec2 noiseRotation;
+
+layout (std140) uniform SSAOKernel
+{
+    vec4 samples[64];
+    int kernelSize;
+    float radius;
+};
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
+
+#ifdef PACKED_GBUFFER
+vec3 ViewPosition(vec2 uv)
+{
+    vec4 position = inverseProjection * vec4(vec3(uv, texture(gDepth, uv).r) * 2.0f - 1.0f, 1.0f);
+    return position.xyz / position.w;
+}
+
+vec3 DecodeNormal(vec2 e)
+{
+    e = e * 2.0f - 1.0f;
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
+#else
+vec3 ViewPosition(vec2 uv)
+{
+    return texture(gPosition, uv).xyz;
+}
+#endif
+
+void main()
+{
+    // tile noise texture over screen based on screen dimensions divided by noise size
+    // (taken from the G-buffer, so it follows the window size)
+    vec2 noiseScale = vec2(textureSize(gNormal, 0)) / vec2(textureSize(noiseTexture, 0));
+
+    // Retrieve Position and Normal from G-Buffer, noise vector from noiseTexture
+    vec3 FragPos = ViewPosition(TexCoords);
+#ifdef PACKED_GBUFFER
+    vec3 Normal = DecodeNormal(texture(gNormal, TexCoords).rg);
+#else
+    vec3 Normal = normalize(texture(gNormal, TexCoords).rgb);
+#endif
+    vec3 randomVec = texture(noiseTexture, TexCoords * noiseScale).xyz;
+    randomVec.xy = mat2(noiseRotation.x, noiseRotation.y, -noiseRotation.y, noiseRotation.x) * randomVec.xy;
+    randomVec = normalize(randomVec);
+
+    // Create TBN change-of-basis matrix: from tangent-space to view-space
+    // The TBN matrix is used to transform the sample points into an orientation
+    // that aligns with the fragment's normal. This is essential for correct SSAO.
+    // The TBN matrix also incorporates randomness through randomVec to make
+    // the SSAO look more natural and avoid visual artifacts.
+    vec3 tangent = normalize(randomVec - Normal * dot(randomVec, Normal));
+    vec3 bitangent = cross(Normal, tangent);
+    mat3 TBN = mat3(tangent, bitangent, Normal);
+
+    // SSAO Kernel Loop
+    float occlusion = 0.0f;
+    for(int i = 0; i < kernelSize; i++) {
+        // Transform the sample point from tangent space to view space.
+        // The sample point is fetched from a pre-computed array of points that
+        // are oriented along the z-axis in tangent space.
+        vec3 sample = TBN * samples[i].xyz; // tangent space -> view space
+        sample = FragPos + sample * radius;
+
+        // project sample position (to sample texture) (to get position on screen/texture)
+        vec4 offset = vec4(sample, 1.0f);
+        offset = projection * offset; // view space -> clip space
+        offset.xyz /= offset.w; // perspective divide
+        offset.xyz = offset.xyz * 0.5f + 0.5; // transform to range 0.0 - 1.0
+
+        // Retrieve the view-space depth of the surface at the sample's screen position.
+        float sampleDepth = ViewPosition(offset.xy).z; 
+
+        // Introduce a rangeCheck to ensure that it only affect the occlusion factor when the measured depth value is within the radius
+        float rangeCheck = smoothstep(0.0, 1.0, radius / abs(FragPos.z - sampleDepth));
+
+        // Compare the actual depth of the scene at the sample point (sampleDepth)
+        // with the depth of the sample point itself (sample.z).
+        // If sampleDepth is greater, it means the sample point is not occluded.
+        occlusion += (sampleDepth >= sample.z + 0.025f ? 1.0 : 0.0) * rangeCheck;   
+    }
+
+    // Normalization & inversion for later use
+    // serves as a coefficient can use to modulate the lighting
+    occlusion = 1.0 - (occlusion / float(kernelSize));
+    FragColor = occlusion;
+})glsl" },
+	{ "res/shaders/ssao.vs",
+R"glsl(#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 2) in vec2 texCoords;
+
+out vec2 TexCoords;
+
+void main()
+{
+    gl_Position = vec4(position, 1.0f);
+    TexCoords = texCoords;
+})glsl" },
+	{ "res/shaders/ssao_bilateral_blur.fs",
+R"glsl(#version 330 core
+out float FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D ssaoInput;     // raw occlusion coefficient
+uniform sampler2D positionInput; // view-space positions at the same resolution
+uniform vec2 direction;          // (1, 0) for the horizontal pass, (0, 1) for the vertical one
+uniform float depthSharpness;    // how fast a tap's weight falls with its relative depth difference
+
+layout (std140) uniform BlurKernel
+{
+    vec4 taps[64]; // z: Gaussian weight of the texel at offset i
+    int tapCount;
+    int radius;
+};
+
+// One half of a separable depth-aware blur: a Gaussian of the given radius along direction, where each tap is also
+// weighted down by how far its depth is from the center's, so the occlusion of one surface doesn't bleed onto another.
+// The depth weight differs per texel, so the taps can't be merged into bilinear fetches.
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 last = textureSize(ssaoInput, 0) - 1;
+    ivec2 stride = ivec2(direction);
+    float centerDepth = texelFetch(positionInput, pixel, 0).z;
+
+    float result = 0.0f;
+    float weightSum = 0.0f;
+    for (int i = -radius; i <= radius; i++) {
+        ivec2 tap = clamp(pixel + stride * i, ivec2(0), last);
+        float depth = texelFetch(positionInput, tap, 0).z;
+        float weight = taps[abs(i)].z * exp(-abs(depth - centerDepth) / max(abs(centerDepth), 0.001f) * depthSharpness);
+        result += texelFetch(ssaoInput, tap, 0).r * weight;
+        weightSum += weight;
+    }
+    FragColor = result / weightSum;
+}
+)glsl" },
+	{ "res/shaders/ssao_blur.fs",
+R"glsl(#version 330 core
+out float FragColor; // only red channel in texture
+
+in vec2 TexCoords;
+uniform sampler2D ssaoInput; // raw occlusion coefficient
+
+void main()
+{
+	vec2 texelSize = 1.0f / vec2(textureSize(ssaoInput, 0));
+	float result = 0.0f;
+
+	for (int x = -2; x < 2; ++x) {
+        for (int y = -2; y < 2; ++y) {
+            vec2 offset = vec2(float(x), float(y)) * texelSize;
+            result += texture(ssaoInput, TexCoords + offset).r;
+        }
+    }
+    FragColor = result / (4.0 * 4.0);
+})glsl" },
+	{ "res/shaders/ssao_downsample.fs",
+R"glsl(#version 330 core
+layout(location = 0) out vec3 halfPosition;
+layout(location = 1) out vec3 halfNormal;
+
+in vec2 TexCoords;
+
+#ifdef PACKED_GBUFFER
+uniform sampler2D gDepth;  // view-space positions are rebuilt from it
+uniform sampler2D gNormal; // octahedral-encoded
+#else
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+#endif
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
+
+#ifdef PACKED_GBUFFER
+vec3 ViewPosition(ivec2 pixel)
+{
+    vec2 uv = (vec2(pixel) + 0.5f) / vec2(textureSize(gDepth, 0));
+    vec4 position = inverseProjection * vec4(vec3(uv, texelFetch(gDepth, pixel, 0).r) * 2.0f - 1.0f, 1.0f);
+    return position.xyz / position.w;
+}
+
+vec3 ViewNormal(ivec2 pixel)
+{
+    vec2 e = texelFetch(gNormal, pixel, 0).rg * 2.0f - 1.0f;
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
+#else
+vec3 ViewPosition(ivec2 pixel)
+{
+    return texelFetch(gPosition, pixel, 0).xyz;
+}
+
+vec3 ViewNormal(ivec2 pixel)
+{
+    return texelFetch(gNormal, pixel, 0).xyz;
+}
+#endif
+
+// Half-resolution view-space position and normal for SSAO. Each texel keeps the closest of its 2x2 full-resolution
+// pixels rather than their average, which across a depth edge would be a point on neither surface.
+void main()
+{
+    ivec2 last = textureSize(gNormal, 0) - 1;
+    ivec2 base = ivec2(gl_FragCoord.xy) * 2;
+    ivec2 closest = base;
+    vec3 closestPosition = ViewPosition(base);
+    for (int i = 1; i < 4; i++) {
+        ivec2 pixel = min(base + ivec2(i & 1, i >> 1), last);
+        vec3 position = ViewPosition(pixel);
+        if (position.z > closestPosition.z) {
+            closest = pixel;
+            closestPosition = position;
+        }
+    }
+    halfPosition = closestPosition;
+    halfNormal = ViewNormal(closest);
+}
+)glsl" },
+	{ "res/shaders/ssao_geometry.fs",
+R"glsl(#version 330 core
+#ifdef PACKED_GBUFFER
+// Packed layout: the view-space position is rebuilt from the depth buffer, the normal is octahedral-encoded into RG16
+layout(location = 0) out vec2 gNormal;
+layout(location = 1) out vec3 gAlbedo;
+layout(location = 2) out vec2 gVelocity;
+#else
+layout(location = 0) out vec3 gPosition;
+layout(location = 1) out vec3 gNormal;
+layout(location = 2) out vec3 gAlbedo;
+layout(location = 3) out vec2 gVelocity; // only attached when temporal accumulation is on
+#endif
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+in vec4 CurrentClip;
+in vec4 PreviousClip;
+
+// Folds the unit sphere onto the [-1, 1] square (lower hemisphere mirrored into the corners), stored as [0, 1]
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 signs = vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    vec2 e = n.z >= 0.0f ? n.xy : (1.0f - abs(n.yx)) * signs;
+    return e * 0.5f + 0.5f;
+}
+
+void main()
+{
+#ifdef PACKED_GBUFFER
+    gNormal = EncodeNormal(normalize(Normal));
+#else
+    // save fragPos in view space
+    gPosition = FragPos;
+    gNormal = normalize(Normal);
+#endif
+    gAlbedo = vec3(0.95f);
+    // screen-space motion in UV units, current minus previous position
+    gVelocity = (CurrentClip.xy / CurrentClip.w - PreviousClip.xy / PreviousClip.w) * 0.5f;
+}
+)glsl" },
+	{ "res/shaders/ssao_geometry.vs",
+R"glsl(#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+out vec4 CurrentClip;
+out vec4 PreviousClip;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+uniform mat4 model;
+// Unjittered, for the velocity target. The scene is static, so only the camera contributes motion
+uniform mat4 viewProjection;
+uniform mat4 previousViewProjection;
+
+uniform bool invertedNormals;
+
+void main()
+{
+    vec4 viewPos = view * model * vec4(aPos, 1.0);
+    FragPos = viewPos.xyz; 
+    TexCoords = aTexCoords;
+    
+    mat3 normalMatrix = transpose(inverse(mat3(view * model)));
+    Normal = normalMatrix * (invertedNormals ? -aNormal : aNormal);
+    
+    gl_Position = projection * viewPos;
+    vec4 worldPos = model * vec4(aPos, 1.0);
+    CurrentClip = viewProjection * worldPos;
+    PreviousClip = previousViewProjection * worldPos;
+})glsl" },
+	{ "res/shaders/ssao_lighting.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+#ifdef PACKED_GBUFFER
+uniform sampler2D gDepth;  // view-space positions are rebuilt from it
+uniform sampler2D gNormal; // octahedral-encoded
+#else
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+#endif
+uniform sampler2D gAlbedo;
+uniform sampler2D ssao;
+
+uniform bool enableSSAO;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
+
+struct Light {
+    vec3 Position;
+    float Linear;
+    vec3 Color;
+    float Quadratic;
+};
+
+layout (std140) uniform Lights
+{
+    Light lights[32];
+    int lightCount;
+};
+
+#ifdef PACKED_GBUFFER
+vec3 ViewPosition(vec2 uv)
+{
+    vec4 position = inverseProjection * vec4(vec3(uv, texture(gDepth, uv).r) * 2.0f - 1.0f, 1.0f);
+    return position.xyz / position.w;
+}
+
+vec3 DecodeNormal(vec2 e)
+{
+    e = e * 2.0f - 1.0f;
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0f);
+    n.xy += vec2(n.x >= 0.0f ? -t : t, n.y >= 0.0f ? -t : t);
+    return normalize(n);
+}
+#endif
+
+void main()
+{             
+    // retrieve data from gbuffer
+#ifdef PACKED_GBUFFER
+    vec3 FragPos = ViewPosition(TexCoords);
+    vec3 Normal = DecodeNormal(texture(gNormal, TexCoords).rg);
+#else
+    vec3 FragPos = texture(gPosition, TexCoords).rgb;
+    vec3 Normal = texture(gNormal, TexCoords).rgb;
+#endif
+    vec3 Diffuse = texture(gAlbedo, TexCoords).rgb;
+    float AmbientOcclusion = enableSSAO ? texture(ssao, TexCoords).r : 1.0;
+    
+    // the light is stored in world space, lighting is done in view space
+    Light light = lights[0];
+    light.Position = vec3(view * vec4(light.Position, 1.0));
+
+    // then calculate lighting as usual
+    vec3 ambient = vec3(0.25 * Diffuse * AmbientOcclusion);
+    vec3 lighting  = ambient; 
+    vec3 viewDir  = normalize(-FragPos); // viewpos is (0.0.0)
+    // diffuse
+    vec3 lightDir = normalize(light.Position - FragPos);
+    vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * light.Color;
+    // specular
+    vec3 halfwayDir = normalize(lightDir + viewDir);  
+    float spec = pow(max(dot(Normal, halfwayDir), 0.0), 8.0);
+    vec3 specular = light.Color * spec;
+    // attenuation
+    float distance = length(light.Position - FragPos);
+    float attenuation = 1.0 / (1.0f + light.Linear * distance + light.Quadratic * distance * distance);
+    diffuse *= attenuation;
+    specular *= attenuation;
+    lighting += diffuse + specular;
+
+    FragColor = vec4(lighting, 1.0);
+})glsl" },
+	{ "res/shaders/ssao_upsample.fs",
+R"glsl(#version 330 core
+out float FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D ssaoInput;    // blurred half-resolution occlusion
+uniform sampler2D halfPosition; // the view-space positions it was computed at
+#ifdef PACKED_GBUFFER
+uniform sampler2D gDepth;
+#else
+uniform sampler2D gPosition;
+#endif
+uniform float depthSharpness;
+
+layout (std140) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
+
+#ifdef PACKED_GBUFFER
+float ViewDepth(ivec2 pixel)
+{
+    vec2 uv = (vec2(pixel) + 0.5f) / vec2(textureSize(gDepth, 0));
+    vec4 position = inverseProjection * vec4(vec3(uv, texelFetch(gDepth, pixel, 0).r) * 2.0f - 1.0f, 1.0f);
+    return position.z / position.w;
+}
+#else
+float ViewDepth(ivec2 pixel)
+{
+    return texelFetch(gPosition, pixel, 0).z;
+}
+#endif
+
+// Joint bilateral upsample: the 2x2 half-resolution texels around the pixel are blended with bilinear weights,
+// each scaled down by how far its depth is from the full-resolution depth, so silhouettes stay as sharp as the
+// G-buffer. When every texel lies on another surface the one with the closest depth is taken.
+void main()
+{
+    float depth = ViewDepth(ivec2(gl_FragCoord.xy));
+    ivec2 last = textureSize(ssaoInput, 0) - 1;
+    vec2 coord = TexCoords * vec2(textureSize(ssaoInput, 0)) - 0.5f;
+    ivec2 base = ivec2(floor(coord));
+    vec2 fraction = coord - vec2(base);
+
+    float result = 0.0f;
+    float weightSum = 0.0f;
+    float closestDifference = 1e30f;
+    float closestValue = 1.0f;
+    for (int i = 0; i < 4; i++) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 tap = clamp(base + offset, ivec2(0), last);
+        vec2 bilinear = mix(1.0f - fraction, fraction, vec2(offset));
+        float difference = abs(texelFetch(halfPosition, tap, 0).z - depth);
+        float value = texelFetch(ssaoInput, tap, 0).r;
+        float weight = bilinear.x * bilinear.y * exp(-difference / max(abs(depth), 0.001f) * depthSharpness);
+        result += value * weight;
+        weightSum += weight;
+        if (difference < closestDifference) {
+            closestDifference = difference;
+            closestValue = value;
+        }
+    }
+    FragColor = weightSum > 0.0001f ? result / weightSum : closestValue;
+}
+)glsl" },
+	{ "res/shaders/temporal_resolve.fs",
+R"glsl(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D currentInput;  // this frame, noisy (few samples, jittered)
+uniform sampler2D historyInput;  // last frame's resolved result, bilinear
+uniform sampler2D velocityInput; // screen-space motion in UV units, current minus previous position
+
+uniform float blendFactor;  // weight of the current frame
+uniform float clampGamma;   // half-width of the neighbourhood box in standard deviations
+uniform bool historyValid;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 last = textureSize(currentInput, 0) - 1;
+    vec4 current = texelFetch(currentInput, pixel, 0);
+
+    // Where this surface was last frame; off screen means there is nothing to reproject
+    vec2 previousUV = TexCoords - texelFetch(velocityInput, pixel, 0).xy;
+    if (!historyValid || any(lessThan(previousUV, vec2(0.0f))) || any(greaterThan(previousUV, vec2(1.0f)))) {
+        FragColor = current;
+        return;
+    }
+
+    // Mean and standard deviation of the 3x3 neighbourhood: a history value outside of that box belongs to a
+    // surface that is not visible here any more (disocclusion, lighting change), so it is pulled into the box
+    vec4 m1 = vec4(0.0f);
+    vec4 m2 = vec4(0.0f);
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            vec4 c = texelFetch(currentInput, clamp(pixel + ivec2(x, y), ivec2(0), last), 0);
+            m1 += c;
+            m2 += c * c;
+        }
+    }
+    m1 /= 9.0f;
+    m2 /= 9.0f;
+    vec4 sigma = sqrt(max(m2 - m1 * m1, vec4(0.0f)));
+
+    vec4 history = texture(historyInput, previousUV);
+    history = clamp(history, m1 - clampGamma * sigma, m1 + clampGamma * sigma);
+
+    FragColor = mix(history, current, blendFactor);
+}
+)glsl" },
+};
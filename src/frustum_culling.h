@@ -0,0 +1,305 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <random>
+#include <cstdint>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLING_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLING_SSE
+#endif
+
+#include "timer.h"
+
+// The six planes of a view frustum (xyz = inward normal, w = distance), extracted from projection * view with the
+// Gribb/Hartmann method and normalized, so plane distances are in world units. Works for perspective and ortho
+// projections alike, e.g. a shadow map's lightProjection * lightView.
+//
+// Usage Example:
+// Frustum frustum(projection * view);
+// if (frustum.TestSphere(center, radius)) ...
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	Frustum() = default;
+
+	explicit Frustum(const glm::mat4& viewProjection)
+	{
+		const glm::mat4& m = viewProjection;
+		for (int i = 0; i < 3; i++) {
+			planes[i * 2 + 0] = glm::vec4(m[0][3] + m[0][i], m[1][3] + m[1][i], m[2][3] + m[2][i], m[3][3] + m[3][i]);
+			planes[i * 2 + 1] = glm::vec4(m[0][3] - m[0][i], m[1][3] - m[1][i], m[2][3] - m[2][i], m[3][3] - m[3][i]);
+		}
+		for (glm::vec4& plane : planes)
+			plane /= glm::length(glm::vec3(plane));
+	}
+
+	bool TestSphere(const glm::vec3& center, float radius) const
+	{
+		for (const glm::vec4& plane : planes) {
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+				return false;
+		}
+		return true;
+	}
+
+	// Box given by center and half extents.
+	bool TestBox(const glm::vec3& center, const glm::vec3& extent) const
+	{
+		for (const glm::vec4& plane : planes) {
+			glm::vec3 normal(plane);
+			if (glm::dot(normal, center) + plane.w < -glm::dot(glm::abs(normal), extent))
+				return false;
+		}
+		return true;
+	}
+};
+
+// The BoundsBatch class holds world-space bounding volumes in structure-of-arrays form and tests them all against
+// a frustum at once: 8 per instruction with AVX, 4 with SSE2 (the x64 baseline), one at a time otherwise.
+// Boxes and spheres share one kernel: an entry is visible unless, for some plane,
+// dot(n, center) + w < -(dot(|n|, extent) + radius), with radius 0 for boxes and extent 0 for spheres.
+//
+// Usage Example:
+// BoundsBatch batch;
+// batch.AddBox(mesh.boundsMin, mesh.boundsMax, model); // local AABB, transformed to world space
+// batch.AddSphere(lightPosition, lightRadius);
+// std::vector<uint8_t> visible;
+// size_t visibleCount = batch.Cull(Frustum(projection * view), visible);
+class BoundsBatch
+{
+public:
+	// Keeps the memory, batches are meant to be refilled every frame.
+	void Clear() { count = 0; }
+
+	size_t Size() const { return count; }
+
+	void Reserve(size_t _count)
+	{
+		for (std::vector<float>* lane : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius })
+			lane->reserve(_count + LANES);
+	}
+
+	// World-space axis-aligned box.
+	void AddBox(const glm::vec3& _min, const glm::vec3& _max)
+	{
+		Add(0.5f * (_min + _max), 0.5f * (_max - _min), 0.0f);
+	}
+
+	// Local box transformed by _model; the result is the world-space AABB of the transformed box (Arvo).
+	void AddBox(const glm::vec3& _min, const glm::vec3& _max, const glm::mat4& _model)
+	{
+		glm::vec3 center = glm::vec3(_model * glm::vec4(0.5f * (_min + _max), 1.0f));
+		glm::vec3 extent = 0.5f * (_max - _min);
+		glm::mat3 absolute(glm::abs(glm::vec3(_model[0])), glm::abs(glm::vec3(_model[1])), glm::abs(glm::vec3(_model[2])));
+		Add(center, absolute * extent, 0.0f);
+	}
+
+	void AddSphere(const glm::vec3& _center, float _radius)
+	{
+		Add(_center, glm::vec3(0.0f), _radius);
+	}
+
+	// Writes 1 (visible) or 0 (culled) per entry into _visible and returns the number of visible entries.
+	size_t Cull(const Frustum& _frustum, std::vector<uint8_t>& _visible) const
+	{
+		_visible.resize(count);
+		size_t visibleCount = 0;
+#if defined(FRUSTUM_CULLING_AVX)
+		__m256 px[6], py[6], pz[6], pw[6], ax[6], ay[6], az[6];
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = _frustum.planes[p];
+			px[p] = _mm256_set1_ps(plane.x); py[p] = _mm256_set1_ps(plane.y); pz[p] = _mm256_set1_ps(plane.z);
+			pw[p] = _mm256_set1_ps(plane.w);
+			ax[p] = _mm256_set1_ps(std::abs(plane.x)); ay[p] = _mm256_set1_ps(std::abs(plane.y)); az[p] = _mm256_set1_ps(std::abs(plane.z));
+		}
+		for (size_t i = 0; i < count; i += 8) {
+			__m256 cx = _mm256_loadu_ps(&centerX[i]), cy = _mm256_loadu_ps(&centerY[i]), cz = _mm256_loadu_ps(&centerZ[i]);
+			__m256 ex = _mm256_loadu_ps(&extentX[i]), ey = _mm256_loadu_ps(&extentY[i]), ez = _mm256_loadu_ps(&extentZ[i]);
+			__m256 r = _mm256_loadu_ps(&radius[i]);
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], cx), _mm256_mul_ps(py[p], cy)), _mm256_add_ps(_mm256_mul_ps(pz[p], cz), pw[p]));
+				__m256 reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)), _mm256_add_ps(_mm256_mul_ps(az[p], ez), r));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+			}
+			visibleCount += WriteMask(_mm256_movemask_ps(inside), 8, i, _visible);
+		}
+#elif defined(FRUSTUM_CULLING_SSE)
+		__m128 px[6], py[6], pz[6], pw[6], ax[6], ay[6], az[6];
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = _frustum.planes[p];
+			px[p] = _mm_set1_ps(plane.x); py[p] = _mm_set1_ps(plane.y); pz[p] = _mm_set1_ps(plane.z);
+			pw[p] = _mm_set1_ps(plane.w);
+			ax[p] = _mm_set1_ps(std::abs(plane.x)); ay[p] = _mm_set1_ps(std::abs(plane.y)); az[p] = _mm_set1_ps(std::abs(plane.z));
+		}
+		for (size_t i = 0; i < count; i += 4) {
+			__m128 cx = _mm_loadu_ps(&centerX[i]), cy = _mm_loadu_ps(&centerY[i]), cz = _mm_loadu_ps(&centerZ[i]);
+			__m128 ex = _mm_loadu_ps(&extentX[i]), ey = _mm_loadu_ps(&extentY[i]), ez = _mm_loadu_ps(&extentZ[i]);
+			__m128 r = _mm_loadu_ps(&radius[i]);
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], cx), _mm_mul_ps(py[p], cy)), _mm_add_ps(_mm_mul_ps(pz[p], cz), pw[p]));
+				__m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_add_ps(_mm_mul_ps(az[p], ez), r));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+			}
+			visibleCount += WriteMask(_mm_movemask_ps(inside), 4, i, _visible);
+		}
+#else
+		visibleCount = CullScalar(_frustum, _visible);
+#endif
+		return visibleCount;
+	}
+
+	// Reference implementation, one entry at a time. Same results as Cull().
+	size_t CullScalar(const Frustum& _frustum, std::vector<uint8_t>& _visible) const
+	{
+		_visible.resize(count);
+		size_t visibleCount = 0;
+		for (size_t i = 0; i < count; i++) {
+			bool inside = true;
+			for (const glm::vec4& plane : _frustum.planes) {
+				float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+				float reach = std::abs(plane.x) * extentX[i] + std::abs(plane.y) * extentY[i] + std::abs(plane.z) * extentZ[i] + radius[i];
+				inside = inside && distance + reach >= 0.0f;
+			}
+			_visible[i] = inside;
+			visibleCount += inside;
+		}
+		return visibleCount;
+	}
+
+private:
+	static constexpr size_t LANES = 8;
+
+	// The lanes grow in steps of LANES, so the last SIMD load of a batch never leaves them.
+	// Entries past 'count' are leftovers and never reported.
+	void Add(const glm::vec3& _center, const glm::vec3& _extent, float _radius)
+	{
+		if (count == centerX.size()) {
+			for (std::vector<float>* lane : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius })
+				lane->resize(count + LANES, 0.0f);
+		}
+		centerX[count] = _center.x; centerY[count] = _center.y; centerZ[count] = _center.z;
+		extentX[count] = _extent.x; extentY[count] = _extent.y; extentZ[count] = _extent.z;
+		radius[count] = _radius;
+		count++;
+	}
+
+	static size_t WriteMask(int mask, int lanes, size_t first, std::vector<uint8_t>& visible)
+	{
+		size_t written = 0;
+		for (int lane = 0; lane < lanes && first + lane < visible.size(); lane++) {
+			uint8_t inside = (mask >> lane) & 1;
+			visible[first + lane] = inside;
+			written += inside;
+		}
+		return written;
+	}
+
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+	std::vector<float> radius;
+	size_t count = 0;
+};
+
+// Per-frame counters of the frustum tests.
+struct CullingCounters
+{
+	unsigned int tested = 0;
+	unsigned int visible = 0;
+};
+
+// Boxes tested per millisecond by BoundsBatch::Cull() and by the scalar reference.
+struct CullingThroughput
+{
+	float simdBoxesPerMillisecond = 0.0f;
+	float scalarBoxesPerMillisecond = 0.0f;
+};
+
+// The FrustumCuller class collects the tested/visible counts of every culling call site (Model::Render, the scene
+// loops) for display, and holds the global switch to compare against drawing everything.
+// Count() may be called from any thread.
+//
+// Usage Example:
+// FrustumCuller::Get().NewFrame(); // once per frame
+// const CullingCounters& counters = FrustumCuller::Get().GetFrameCounters(); // counters of the last frame
+class FrustumCuller
+{
+public:
+	static FrustumCuller& Get()
+	{
+		static FrustumCuller instance;
+		return instance;
+	}
+
+	FrustumCuller(const FrustumCuller&) = delete;
+	FrustumCuller& operator=(const FrustumCuller&) = delete;
+
+	bool enabled = true;
+
+	void NewFrame()
+	{
+		lastFrameCounters.tested = tested.exchange(0, std::memory_order_relaxed);
+		lastFrameCounters.visible = visible.exchange(0, std::memory_order_relaxed);
+	}
+
+	void Count(size_t _tested, size_t _visible)
+	{
+		tested.fetch_add((unsigned int)_tested, std::memory_order_relaxed);
+		visible.fetch_add((unsigned int)_visible, std::memory_order_relaxed);
+	}
+
+	const CullingCounters& GetFrameCounters() const { return lastFrameCounters; }
+
+	// Microbenchmark: culls _boxes random boxes (about half of them visible) _iterations times with both kernels.
+	static CullingThroughput MeasureThroughput(size_t _boxes = 1 << 16, int _iterations = 50)
+	{
+		std::mt19937 gen(1);
+		std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+		BoundsBatch batch;
+		batch.Reserve(_boxes);
+		for (size_t i = 0; i < _boxes; i++) {
+			glm::vec3 center(50.0f * dis(gen), 50.0f * dis(gen), 50.0f * dis(gen));
+			glm::vec3 extent(0.5f + 0.4f * dis(gen));
+			batch.AddBox(center - extent, center + extent);
+		}
+		Frustum frustum(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f)
+			* glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+		std::vector<uint8_t> visibleFlags;
+		size_t sink = 0; // keeps the loops from being optimized away
+		CullingThroughput throughput;
+		long long start = Timer::nowNanoseconds();
+		for (int i = 0; i < _iterations; i++)
+			sink += batch.Cull(frustum, visibleFlags);
+		long long simd = Timer::nowNanoseconds();
+		for (int i = 0; i < _iterations; i++)
+			sink += batch.CullScalar(frustum, visibleFlags);
+		long long scalar = Timer::nowNanoseconds();
+
+		float boxes = (float)_boxes * _iterations;
+		if (sink == 0)
+			std::cerr << "Warning: culling benchmark saw no visible boxes\n";
+		throughput.simdBoxesPerMillisecond = boxes / std::max((simd - start) / 1000000.0f, 1e-6f);
+		throughput.scalarBoxesPerMillisecond = boxes / std::max((scalar - simd) / 1000000.0f, 1e-6f);
+		return throughput;
+	}
+
+private:
+	FrustumCuller() = default;
+
+	std::atomic<unsigned int> tested{ 0 }, visible{ 0 };
+	CullingCounters lastFrameCounters;
+};
@@ -3,6 +3,10 @@
 
 #include "camera.h"
 #include "shader.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "uniform_buffer.h"
 #include "model.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -46,9 +50,9 @@ int main()
     glewInit();
 
     // configure global opengl state
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::Get().Enable(GL_DEPTH_TEST);
+    GLState::Get().Enable(GL_BLEND);
+    GLState::Get().BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -68,7 +72,7 @@ int main()
     glGenVertexArrays(1, &planeVAO);
     glGenBuffers(1, &planeVBO);
 
-    glBindVertexArray(planeVAO);
+    GLState::Get().BindVertexArray(planeVAO);
     glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
 
@@ -78,7 +82,7 @@ int main()
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glBindVertexArray(0);
+    GLState::Get().BindVertexArray(0);
 
     // lighting info
     // -------------
@@ -95,13 +99,29 @@ int main()
         glm::vec3(1.00)
     };
 
-    Shader shader("res/shaders/gamma_correction.vs", "res/shaders/gamma_correction.fs");
+    Shader shader(SHADER_GAMMA_CORRECTION_VS, SHADER_GAMMA_CORRECTION_FS);
     unsigned int floorTexture = LoadTexture("res/textures/wood.png", false);
     unsigned int floorTextureGammaCorrected = LoadTexture("res/textures/wood.png", true);
     shader.Bind();
     shader.SetInt("floorTexture", 0);
 
+    // Shared per-frame uniform blocks; the lights are static so the Lights block is written only once
+    FrameConstants frameConstants;
+    std::vector<PointLight> lights(4);
+    for (size_t i = 0; i < lights.size(); i++) {
+        lights[i].position = lightPositions[i];
+        lights[i].color = lightColors[i];
+    }
+    frameConstants.SetLights(lights);
+
     while (!glfwWindowShouldClose(window)) {
+        // Publish last frame's state-cache counters and start counting this frame
+        GLState::Get().NewFrame();
+        // Read back the GPU timings of an older frame and start recording this one
+        GpuProfiler::Get().BeginFrame();
+        // Build the CPU call tree of the previous frame
+        CpuProfiler::Get().NewFrame();
+
         float currentFrame = (float)glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
@@ -115,29 +135,30 @@ int main()
         glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)width / (float)height, 0.01f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
         glm::mat4 model = glm::mat4(1.0f);
-        shader.SetMat4("projection", projection);
-        shader.SetMat4("view", view);
+        frameConstants.SetCamera(projection, view, camera.position);
         shader.SetMat4("model", model);
-
-        // set light uniforms
-        glUniform3fv(glGetUniformLocation(shader.GetShaderID(), "lightPositions"), 4, &lightPositions[0][0]);
-        glUniform3fv(glGetUniformLocation(shader.GetShaderID(), "lightColors"), 4, &lightColors[0][0]);
-        shader.SetVec3("viewPos", camera.position);
         shader.SetInt("gamma", gammaEnabled);
 
         // floor
-        glBindVertexArray(planeVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gammaEnabled ? floorTextureGammaCorrected : floorTexture);
+        GpuProfiler::Get().Begin("floor");
+        GLState::Get().BindVertexArray(planeVAO);
+        GLState::Get().ActiveTexture(GL_TEXTURE0);
+        GLState::Get().BindTexture(GL_TEXTURE_2D, gammaEnabled ? floorTextureGammaCorrected : floorTexture);
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        GpuProfiler::Get().End();
 
         std::cout << "press space to switch mode\n";
         std::cout << (gammaEnabled ? "Gamma enabled" : "Gamma disabled") << std::endl;
 
-        glfwSwapBuffers(window);
+        GpuProfiler::Get().EndFrame();
+
+        {
+            CPU_PROFILE_SCOPE("glfwSwapBuffers"); // includes the vsync wait
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
     }
-    glDeleteVertexArrays(1, &planeVAO);
+    GLState::Get().DeleteVertexArrays(1, &planeVAO);
     glDeleteBuffers(1, &planeVBO);
 
     glfwTerminate();
@@ -159,6 +180,11 @@ void processInput(GLFWwindow* window)
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
 
+    // Print the GPU pass timings and write them to gpu_profile.csv by pressing P
+    GpuProfiler::Get().ReportOnKey(glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS);
+    // Write the CPU trace (chrome://tracing, ui.perfetto.dev) to cpu_trace.json by pressing T
+    CpuProfiler::Get().ExportOnKey(glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS);
+
     if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && !gammaKeyPressed)
     {
         gammaEnabled = !gammaEnabled;
@@ -176,7 +202,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    GLState::Get().Viewport(0, 0, width, height);
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -232,7 +258,7 @@ unsigned int LoadTexture(const char* path, bool gammaCorrection)
             dataFormat = GL_RGBA;
         }
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+// One tap of a symmetric separable blur: read at +-offset texels from the center along the blur direction.
+struct BlurTap
+{
+	float offset;
+	float weight;
+};
+
+// The GaussianKernel class computes normalized 1D Gaussian weights for any sigma and radius, and folds them for
+// linear sampling: texels i and i + 1 with weights wi and wj are read by one bilinear fetch at i + wj / (wi + wj)
+// with weight wi + wj, so a blur of radius r costs 1 + 2 * ceil(r / 2) fetches per pass instead of 1 + 2 * r.
+// The input must be sampled with GL_LINEAR for the folded taps. Shaders that weight every texel on their own
+// (bilateral filters) take GetWeights() instead. Radii are clamped to RadiusForSigma(), beyond which the weights
+// are negligible (and underflow to 0 for small sigmas), and to MAX_RADIUS, the size of the BlurKernel uniform
+// block, so every generated kernel fits it and stays normalized.
+//
+// Usage Example:
+// GaussianKernel kernel(2.0f, GaussianKernel::RadiusForSigma(2.0f));
+// frameConstants.SetBlurKernel(kernel); // shaders read it from the BlurKernel uniform block
+class GaussianKernel
+{
+public:
+	static constexpr int MAX_RADIUS = 63;
+
+	GaussianKernel(float _sigma, int _radius) { Generate(_sigma, _radius); }
+
+	// Radius that keeps all taps above ~1% of the center weight.
+	static int RadiusForSigma(float _sigma) { return std::min((int)std::ceil(3.0f * _sigma), MAX_RADIUS); }
+
+	void Generate(float _sigma, int _radius)
+	{
+		sigma = _sigma > 0.01f ? _sigma : 0.01f;
+		radius = std::min(std::max(_radius, 0), RadiusForSigma(sigma));
+
+		weights.resize(radius + 1);
+		float sum = 0.0f;
+		for (int i = 0; i <= radius; i++) {
+			weights[i] = std::exp(-(float)(i * i) / (2.0f * sigma * sigma));
+			sum += i == 0 ? weights[i] : 2.0f * weights[i];
+		}
+		for (float& weight : weights)
+			weight /= sum;
+
+		// The center stays on its own, then texels (1, 2), (3, 4)... share a fetch; an odd radius leaves the last alone
+		linearTaps.clear();
+		linearTaps.push_back({ 0.0f, weights[0] });
+		for (int i = 1; i <= radius; i += 2) {
+			float first = weights[i];
+			float second = i + 1 <= radius ? weights[i + 1] : 0.0f;
+			float weight = first + second;
+			// Both weights can still underflow to 0 for tiny sigmas, keep the offset finite
+			linearTaps.push_back({ weight > 0.0f ? (float)i + second / weight : (float)i, weight });
+		}
+	}
+
+	float GetSigma() const { return sigma; }
+	// May be smaller than requested, see RadiusForSigma().
+	int GetRadius() const { return radius; }
+	// Weight of the texel at offset i, for i in [0, radius]; weights[0] + 2 * (weights[1] + ...) == 1.
+	const std::vector<float>& GetWeights() const { return weights; }
+	// Center first.
+	const std::vector<BlurTap>& GetLinearTaps() const { return linearTaps; }
+	// Per pass, with linear sampling.
+	int GetFetchCount() const { return 2 * (int)linearTaps.size() - 1; }
+
+private:
+	float sigma = 1.0f;
+	int radius = 0;
+	std::vector<float> weights;
+	std::vector<BlurTap> linearTaps;
+};
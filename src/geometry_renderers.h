@@ -16,6 +16,9 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "gl_state.h"
+#include "render_queue.h"
+
 namespace yzh {
 
 	// Base class for all shapes with pure virual functions
@@ -26,6 +29,15 @@ namespace yzh {
 		virtual ~GeometryShape() {}
 		virtual void Render() = 0;
 
+		// Vertex array and draw range, for submitting the shape into a RenderQueue.
+		virtual DrawGeometry GetGeometry() const { return DrawGeometry(); }
+
+		// Queues the shape instead of drawing it now, with an optional texture bound to unit 0 (see RenderQueue).
+		DrawPacket& Submit(RenderQueue& queue, unsigned int pass, Shader& shader, const glm::mat4& model, unsigned int texture = 0) const
+		{
+			return queue.Submit(pass, shader, GetGeometry(), model, texture);
+		}
+
 		virtual float SurfaceArea() const { return 0.0f; }
 		virtual float Volume() const { return 0.0f; }
 	};
@@ -90,7 +102,7 @@ namespace yzh {
 				glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
 				glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 				// link vertex attributes
-				glBindVertexArray(this->VAO);
+				GLState::Get().BindVertexArray(this->VAO);
 				glEnableVertexAttribArray(0);
 				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 				glEnableVertexAttribArray(1);
@@ -98,7 +110,7 @@ namespace yzh {
 				glEnableVertexAttribArray(2);
 				glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 				glBindBuffer(GL_ARRAY_BUFFER, 0);
-				glBindVertexArray(0);
+				GLState::Get().BindVertexArray(0);
 			}
 		}
 
@@ -108,7 +120,7 @@ namespace yzh {
 		~Cube() override
 		{
 			if (this->VAO != 0) {
-				glDeleteVertexArrays(1, &this->VAO);
+				GLState::Get().DeleteVertexArrays(1, &this->VAO);
 				glDeleteBuffers(1, &this->VBO);
 				this->VAO = 0;
 			}
@@ -117,12 +129,13 @@ namespace yzh {
 		void Render() override
 		{
 			if (this->VAO != 0) {
-				glBindVertexArray(this->VAO);
+				GLState::Get().BindVertexArray(this->VAO);
 				glDrawArrays(GL_TRIANGLES, 0, 36);
-				glBindVertexArray(0);
 			}
 		}
 
+		DrawGeometry GetGeometry() const override { return { this->VAO, GL_TRIANGLES, 36, 0 }; }
+
 	private:
 		unsigned int VAO = 0, VBO;
 	};
@@ -149,7 +162,7 @@ namespace yzh {
 				const unsigned int X_SEGMENTS = x_segments;
 				const unsigned int Y_SEGMENTS = y_segments;
 				const float PI = 3.14159265359;
-				float radius = 2.0f;
+				float radius = RADIUS;
 				for (unsigned int y = 0; y <= Y_SEGMENTS; ++y) {
 					for (unsigned int x = 0; x <= X_SEGMENTS; ++x) {
 						float xSegment = (float)x / (float)X_SEGMENTS;
@@ -191,18 +204,19 @@ namespace yzh {
 					oddRow = !oddRow;
 				}
 
-				glBindVertexArray(this->VAO);
+				GLState::Get().BindVertexArray(this->VAO);
 				glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
 				glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
 				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->IBO);
 				glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+				this->indexCount = (int)indices.size();
 				glEnableVertexAttribArray(0);
 				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 				glEnableVertexAttribArray(1);
 				glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
 				glEnableVertexAttribArray(2);
 				glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-				glBindVertexArray(0);
+				GLState::Get().BindVertexArray(0);
 			}
 		}
 
@@ -210,7 +224,7 @@ namespace yzh {
 		{
 			// Prevent multiple de-allocation
 			if (this->VAO != 0) {
-				glDeleteVertexArrays(1, &this->VAO);
+				GLState::Get().DeleteVertexArrays(1, &this->VAO);
 				glDeleteBuffers(1, &this->VBO);
 				glDeleteBuffers(1, &this->IBO);
 				this->VAO = 0;
@@ -223,16 +237,31 @@ namespace yzh {
 		void Render() override
 		{
 			if (this->VAO != 0) {
-				glBindVertexArray(this->VAO);
-				glDrawElements(GL_TRIANGLE_STRIP, (64 + 1) * 64 * 2, GL_UNSIGNED_INT, 0);
-				glBindVertexArray(0);
+				GLState::Get().BindVertexArray(this->VAO);
+				glDrawElements(GL_TRIANGLE_STRIP, this->indexCount, GL_UNSIGNED_INT, 0);
 			}
 		}
 
+		// Draws _instances copies in one call, the vertex shader tells them apart with gl_InstanceID.
+		void RenderInstanced(int _instances)
+		{
+			if (this->VAO != 0 && _instances > 0) {
+				GLState::Get().BindVertexArray(this->VAO);
+				glDrawElementsInstanced(GL_TRIANGLE_STRIP, this->indexCount, GL_UNSIGNED_INT, 0, _instances);
+			}
+		}
+
+		// Radius of the mesh's vertices (the faces lie slightly inside it). Seen from outside, the strip's
+		// triangles wind clockwise, so face-dependent state (culling, two-sided stencil) needs glFrontFace(GL_CW).
+		static constexpr float RADIUS = 2.0f;
+
+		DrawGeometry GetGeometry() const override { return { this->VAO, GL_TRIANGLE_STRIP, this->indexCount, GL_UNSIGNED_INT }; }
+
 		const unsigned int GetVAO() const { return VAO; }
 
 	private:
 		unsigned int VAO = 0, VBO, IBO;
+		int indexCount = 0;
 	};
 
 	// This class provides a 2D quad in OpenGL with dimensions of 2 * 2 units.
@@ -254,7 +283,7 @@ namespace yzh {
 
 				glGenVertexArrays(1, &this->VAO);
 				glGenBuffers(1, &this->VBO);
-				glBindVertexArray(this->VAO);
+				GLState::Get().BindVertexArray(this->VAO);
 				glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
 				glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
 
@@ -270,14 +299,14 @@ namespace yzh {
 				glEnableVertexAttribArray(2);
 				glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 
-				glBindVertexArray(0);
+				GLState::Get().BindVertexArray(0);
 			}
 		}
 
 		~Quad() override
 		{
 			if (VAO != 0) {
-				glDeleteVertexArrays(1, &this->VAO);
+				GLState::Get().DeleteVertexArrays(1, &this->VAO);
 				glDeleteBuffers(1, &this->VBO);
 				this->VAO = 0;
 			}
@@ -286,11 +315,12 @@ namespace yzh {
 		void Render() override
 		{
 			if (VAO != 0) {
-				glBindVertexArray(this->VAO);
+				GLState::Get().BindVertexArray(this->VAO);
 				glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-				glBindVertexArray(0);
 			}
 		}
+
+		DrawGeometry GetGeometry() const override { return { this->VAO, GL_TRIANGLE_STRIP, 4, 0 }; }
 	    
 		const unsigned int GetVAO() const { return this->VAO; }
 
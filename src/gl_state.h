@@ -0,0 +1,265 @@
+#pragma once
+
+#include <array>
+
+#include <GL/glew.h>
+
+// Per-frame counters of state changes that reached the driver vs. the ones dropped as redundant.
+struct GLStateCounters
+{
+	unsigned int issued = 0;
+	unsigned int filtered = 0;
+};
+
+// The GLState class is a thin tracker of the OpenGL binding state this project touches: the current program,
+// vertex array, per-unit 2D/cube map textures, read/draw framebuffers, depth test/face culling/blending and viewport.
+// Every call mirrors the matching gl* function but only reaches the driver when the value actually changes.
+//
+// All state changes in Shader, Mesh, the yzh primitives and the demos go through this class, so the cache
+// stays in sync with the driver. Code that changes the state behind its back must call Invalidate() afterwards.
+//
+// Usage Example:
+// GLState::Get().NewFrame(); // once at the start of every frame
+// GLState::Get().UseProgram(program);
+// GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, texture);
+// const GLStateCounters& counters = GLState::Get().GetFrameCounters(); // counters of the last finished frame
+class GLState
+{
+public:
+	static constexpr unsigned int MAX_TEXTURE_UNITS = 32;
+
+	static GLState& Get()
+	{
+		static GLState instance;
+		return instance;
+	}
+
+	GLState(const GLState&) = delete;
+	GLState& operator=(const GLState&) = delete;
+
+	// Publishes the counters of the frame that just ended and starts counting a new one.
+	void NewFrame()
+	{
+		lastFrameCounters = counters;
+		counters = GLStateCounters();
+	}
+
+	const GLStateCounters& GetFrameCounters() const { return lastFrameCounters; }
+
+	// Forgets every cached value, the next call of each kind always reaches the driver.
+	void Invalidate()
+	{
+		program = UNKNOWN;
+		vertexArray = UNKNOWN;
+		activeUnit = UNKNOWN;
+		readFramebuffer = UNKNOWN;
+		drawFramebuffer = UNKNOWN;
+		textures2D.fill(UNKNOWN);
+		texturesCube.fill(UNKNOWN);
+		depthTest = cullFace = blend = UNKNOWN;
+		cullFaceMode = UNKNOWN;
+		blendSrc = blendDst = UNKNOWN;
+		viewportValid = false;
+	}
+
+	void UseProgram(unsigned int _program)
+	{
+		if (Filter(program, _program))
+			return;
+		glUseProgram(_program);
+	}
+
+	void BindVertexArray(unsigned int _vertexArray)
+	{
+		if (Filter(vertexArray, _vertexArray))
+			return;
+		glBindVertexArray(_vertexArray);
+	}
+
+	// @param _unit GL_TEXTURE0 + N, exactly like glActiveTexture.
+	void ActiveTexture(GLenum _unit)
+	{
+		if (Filter(activeUnit, _unit - GL_TEXTURE0))
+			return;
+		glActiveTexture(_unit);
+	}
+
+	// Binds to the active texture unit. Only GL_TEXTURE_2D and GL_TEXTURE_CUBE_MAP bindings are tracked,
+	// other targets are always forwarded.
+	void BindTexture(GLenum _target, unsigned int _texture)
+	{
+		unsigned int* slot = TextureSlot(activeUnit, _target);
+		if (slot != nullptr && Filter(*slot, _texture))
+			return;
+		if (slot == nullptr)
+			counters.issued++;
+		glBindTexture(_target, _texture);
+	}
+
+	// Convenience for the common glActiveTexture + glBindTexture pair.
+	// The active unit only changes when the texture binding itself has to change.
+	void BindTextureUnit(unsigned int _unit, GLenum _target, unsigned int _texture)
+	{
+		unsigned int* slot = TextureSlot(_unit, _target);
+		if (slot != nullptr && *slot == _texture) {
+			counters.filtered++;
+			return;
+		}
+		ActiveTexture(GL_TEXTURE0 + _unit);
+		BindTexture(_target, _texture);
+	}
+
+	// GL_FRAMEBUFFER binds both the read and the draw framebuffer, just like glBindFramebuffer.
+	void BindFramebuffer(GLenum _target, unsigned int _framebuffer)
+	{
+		bool read = _target == GL_FRAMEBUFFER || _target == GL_READ_FRAMEBUFFER;
+		bool draw = _target == GL_FRAMEBUFFER || _target == GL_DRAW_FRAMEBUFFER;
+		if ((!read || readFramebuffer == _framebuffer) && (!draw || drawFramebuffer == _framebuffer)) {
+			counters.filtered++;
+			return;
+		}
+		if (read) readFramebuffer = _framebuffer;
+		if (draw) drawFramebuffer = _framebuffer;
+		counters.issued++;
+		glBindFramebuffer(_target, _framebuffer);
+	}
+
+	void Viewport(int _x, int _y, int _width, int _height)
+	{
+		if (viewportValid && viewport[0] == _x && viewport[1] == _y && viewport[2] == _width && viewport[3] == _height) {
+			counters.filtered++;
+			return;
+		}
+		viewport = { _x, _y, _width, _height };
+		viewportValid = true;
+		counters.issued++;
+		glViewport(_x, _y, _width, _height);
+	}
+
+	// GL_DEPTH_TEST, GL_CULL_FACE and GL_BLEND are tracked, other capabilities are always forwarded.
+	void Enable(GLenum _capability)
+	{
+		unsigned int* slot = CapabilitySlot(_capability);
+		if (slot != nullptr && Filter(*slot, 1u))
+			return;
+		if (slot == nullptr)
+			counters.issued++;
+		glEnable(_capability);
+	}
+
+	void Disable(GLenum _capability)
+	{
+		unsigned int* slot = CapabilitySlot(_capability);
+		if (slot != nullptr && Filter(*slot, 0u))
+			return;
+		if (slot == nullptr)
+			counters.issued++;
+		glDisable(_capability);
+	}
+
+	void CullFace(GLenum _mode)
+	{
+		if (Filter(cullFaceMode, _mode))
+			return;
+		glCullFace(_mode);
+	}
+
+	void BlendFunc(GLenum _sfactor, GLenum _dfactor)
+	{
+		if (blendSrc == _sfactor && blendDst == _dfactor) {
+			counters.filtered++;
+			return;
+		}
+		blendSrc = _sfactor;
+		blendDst = _dfactor;
+		counters.issued++;
+		glBlendFunc(_sfactor, _dfactor);
+	}
+
+	// Deleting an object resets its bindings to 0 in the driver, so the cache has to forget it as well,
+	// otherwise a recycled name would be treated as already bound.
+	void DeleteProgram(unsigned int _program)
+	{
+		if (program == _program)
+			program = UNKNOWN;
+		glDeleteProgram(_program);
+	}
+
+	void DeleteVertexArrays(int _count, const unsigned int* _vertexArrays)
+	{
+		for (int i = 0; i < _count; i++)
+			if (vertexArray == _vertexArrays[i])
+				vertexArray = UNKNOWN;
+		glDeleteVertexArrays(_count, _vertexArrays);
+	}
+
+	void DeleteTextures(int _count, const unsigned int* _textures)
+	{
+		for (int i = 0; i < _count; i++) {
+			for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+				if (textures2D[unit] == _textures[i]) textures2D[unit] = UNKNOWN;
+				if (texturesCube[unit] == _textures[i]) texturesCube[unit] = UNKNOWN;
+			}
+		}
+		glDeleteTextures(_count, _textures);
+	}
+
+	void DeleteFramebuffers(int _count, const unsigned int* _framebuffers)
+	{
+		for (int i = 0; i < _count; i++) {
+			if (readFramebuffer == _framebuffers[i]) readFramebuffer = UNKNOWN;
+			if (drawFramebuffer == _framebuffers[i]) drawFramebuffer = UNKNOWN;
+		}
+		glDeleteFramebuffers(_count, _framebuffers);
+	}
+
+private:
+	GLState() { Invalidate(); }
+
+	// Returns true (and counts a filtered call) if the cached value already matches,
+	// otherwise stores the new value and counts an issued call.
+	bool Filter(unsigned int& cached, unsigned int value)
+	{
+		if (cached == value) {
+			counters.filtered++;
+			return true;
+		}
+		cached = value;
+		counters.issued++;
+		return false;
+	}
+
+	unsigned int* TextureSlot(unsigned int _unit, GLenum _target)
+	{
+		if (_unit >= MAX_TEXTURE_UNITS)
+			return nullptr;
+		if (_target == GL_TEXTURE_2D)
+			return &textures2D[_unit];
+		if (_target == GL_TEXTURE_CUBE_MAP)
+			return &texturesCube[_unit];
+		return nullptr;
+	}
+
+	unsigned int* CapabilitySlot(GLenum _capability)
+	{
+		switch (_capability) {
+		case GL_DEPTH_TEST: return &depthTest;
+		case GL_CULL_FACE: return &cullFace;
+		case GL_BLEND: return &blend;
+		default: return nullptr;
+		}
+	}
+
+private:
+	static constexpr unsigned int UNKNOWN = 0xFFFFFFFF; // no GL name or enum ever takes this value
+
+	unsigned int program, vertexArray, activeUnit;
+	unsigned int readFramebuffer, drawFramebuffer;
+	std::array<unsigned int, MAX_TEXTURE_UNITS> textures2D, texturesCube;
+	unsigned int depthTest, cullFace, blend;
+	unsigned int cullFaceMode, blendSrc, blendDst;
+	std::array<int, 4> viewport = {};
+	bool viewportValid = false;
+
+	GLStateCounters counters, lastFrameCounters;
+};
@@ -0,0 +1,471 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include <GL/glew.h>
+
+#include "imgui/imgui.h"
+
+// Rolling statistics of one named GPU pass. Passes with the same name in one frame are summed.
+struct GpuPassStats
+{
+	std::string name;
+	int depth = 0;                    // nesting level of the first scope with this name
+	float lastMilliseconds = 0.0f;    // latest resolved frame
+	float averageMilliseconds = 0.0f; // over the last GpuProfiler::AVERAGE_FRAMES frames the pass ran in
+	float maxMilliseconds = 0.0f;     // over the same window
+};
+
+// GPU time of one pass in one resolved frame; pass indexes GpuProfiler::GetPass().
+struct GpuPassSample
+{
+	int pass;
+	float milliseconds;
+};
+
+// All timings of one resolved frame. frame counts EndFrame() calls, see GpuProfiler::GetFrameIndex().
+struct GpuFrameRecord
+{
+	unsigned long long frame;
+	float milliseconds;
+	std::vector<GpuPassSample> passes;
+};
+
+// The GpuProfiler class times named GPU scopes with glQueryCounter(GL_TIMESTAMP). Timestamps (unlike GL_TIME_ELAPSED)
+// may nest, so a "lighting" scope can contain a "point lights" one.
+// The queries of each frame live in one slot of a ring of FRAME_LATENCY slots; a slot is read back when it comes
+// around again, so the CPU never waits on the GPU. If its results are still not available the frame is dropped.
+//
+// Every scope is also pushed as a KHR_debug group when available, so the same markers show up in RenderDoc/Nsight.
+// RenderGraph::Execute() opens a scope for every pass on its own.
+//
+// Usage Example:
+// GpuProfiler::Get().BeginFrame();           // once at the start of every frame
+// {
+//     GpuProfileScope scope("geometry");
+//     ... draw calls ...
+// }
+// GpuProfiler::Get().Begin("bloom"); ... GpuProfiler::Get().End(); // when a scope spans several blocks
+// GpuProfiler::Get().EndFrame();             // right before glfwSwapBuffers
+// GpuProfiler::Get().DrawImGui();            // inside an ImGui window
+// GpuProfiler::Get().ExportCSV("gpu_profile.csv");
+// GpuProfiler::Get().ReportOnKey(glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS); // demos without ImGui
+class GpuProfiler
+{
+public:
+	static constexpr int FRAME_LATENCY = 4;
+	static constexpr int AVERAGE_FRAMES = 64;
+	static constexpr int HISTORY_FRAMES = 1024; // frames kept for ExportCSV()
+
+	static GpuProfiler& Get()
+	{
+		static GpuProfiler instance;
+		return instance;
+	}
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	bool enabled = true;
+
+	// Collects the oldest frame of the ring and starts recording a new one.
+	void BeginFrame()
+	{
+#ifdef _DEBUG
+		if (inFrame)
+			std::cerr << "Warning: GpuProfiler::BeginFrame() called twice without EndFrame()\n";
+#endif
+		FrameSlot& slot = slots[current];
+		if (slot.pending) {
+			Collect(slot);
+			slot.pending = false;
+		}
+		slot.scopes.clear();
+		slot.usedQueries = 0;
+
+		inFrame = true;
+		recording = enabled;
+		if (recording)
+			Timestamp(slot);
+	}
+
+	void EndFrame()
+	{
+		while (!stack.empty()) {
+#ifdef _DEBUG
+			std::cerr << "Warning: GPU scope \"" << slots[current].scopes[stack.back()].name << "\" was not closed\n";
+#endif
+			End();
+		}
+		FrameSlot& slot = slots[current];
+		if (recording) {
+			Timestamp(slot);
+			slot.pending = true;
+			slot.frame = frameIndex;
+		}
+		inFrame = false;
+		recording = false;
+		current = (current + 1) % FRAME_LATENCY;
+		frameIndex++;
+	}
+
+	void Begin(const char* name)
+	{
+		if (!recording)
+			return;
+		FrameSlot& slot = slots[current];
+		Scope scope;
+		scope.name = name;
+		scope.depth = (int)stack.size();
+		scope.begin = Timestamp(slot);
+		stack.push_back((int)slot.scopes.size());
+		slot.scopes.push_back(scope);
+
+		if (GLEW_KHR_debug)
+			glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+	}
+
+	void End()
+	{
+		if (!recording)
+			return;
+		if (stack.empty()) {
+#ifdef _DEBUG
+			std::cerr << "Warning: GpuProfiler::End() without a matching Begin()\n";
+#endif
+			return;
+		}
+		FrameSlot& slot = slots[current];
+		slot.scopes[stack.back()].end = Timestamp(slot);
+		stack.pop_back();
+
+		if (GLEW_KHR_debug)
+			glPopDebugGroup();
+	}
+
+	// Blocks until every frame still in flight is resolved, e.g. before reading the history at the end of a benchmark.
+	void Flush()
+	{
+		for (int i = 0; i < FRAME_LATENCY; i++) {
+			FrameSlot& slot = slots[(current + i) % FRAME_LATENCY];
+			if (slot.pending) {
+				Collect(slot, true);
+				slot.pending = false;
+			}
+		}
+	}
+
+	// Index of the frame the next BeginFrame() starts.
+	unsigned long long GetFrameIndex() const { return frameIndex; }
+
+	// The last HISTORY_FRAMES resolved frames, oldest first.
+	const std::deque<GpuFrameRecord>& GetHistory() const { return history; }
+	const GpuPassStats& GetPass(int index) const { return passes[index]; }
+
+	// Latest resolved time of a pass, 0 if it never ran. The value is FRAME_LATENCY frames old.
+	float GetMilliseconds(const std::string& name) const
+	{
+		auto it = passIndices.find(name);
+		return it != passIndices.end() ? passes[it->second].lastMilliseconds : 0.0f;
+	}
+
+	float GetAverageMilliseconds(const std::string& name) const
+	{
+		auto it = passIndices.find(name);
+		return it != passIndices.end() ? passes[it->second].averageMilliseconds : 0.0f;
+	}
+
+	// GPU time from BeginFrame() to EndFrame(), of the latest resolved frame and averaged.
+	float GetLastFrameMilliseconds() const { return frameStats.lastMilliseconds; }
+	float GetFrameMilliseconds() const { return frameStats.averageMilliseconds; }
+	unsigned int GetDroppedFrames() const { return droppedFrames; }
+
+	// Passes of the latest resolved frame in submission order.
+	std::vector<const GpuPassStats*> GetPasses() const
+	{
+		std::vector<const GpuPassStats*> result;
+		for (int index : lastFramePasses)
+			result.push_back(&passes[index]);
+		return result;
+	}
+
+	// A timeline of the latest resolved frame (one row per nesting level) and a bar per pass with its rolling average.
+	void DrawImGui()
+	{
+		if (!ImGui::CollapsingHeader("GPU profiler", ImGuiTreeNodeFlags_DefaultOpen))
+			return;
+
+		ImGui::Checkbox("Enabled", &enabled);
+		ImGui::SameLine();
+		if (ImGui::Button("Export CSV"))
+			lastExportRows = ExportCSV("gpu_profile.csv");
+		if (lastExportRows >= 0) {
+			ImGui::SameLine();
+			ImGui::Text("%d rows -> gpu_profile.csv", lastExportRows);
+		}
+		ImGui::Text("GPU frame: %.2f ms avg, %.2f ms max (%u frames dropped)",
+			frameStats.averageMilliseconds, frameStats.maxMilliseconds, droppedFrames);
+
+		// Timeline
+		const float rowHeight = ImGui::GetTextLineHeight() + 2.0f;
+		int rows = 1;
+		for (const auto& span : lastFrameSpans)
+			rows = std::max(rows, span.depth + 1);
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		drawList->AddRectFilled(origin, ImVec2(origin.x + width, origin.y + rows * rowHeight), IM_COL32(40, 40, 40, 255));
+		float scale = lastFrameMilliseconds > 0.0f ? width / lastFrameMilliseconds : 0.0f;
+		for (const auto& span : lastFrameSpans) {
+			ImVec2 min(origin.x + span.start * scale, origin.y + span.depth * rowHeight);
+			ImVec2 max(origin.x + (span.start + span.milliseconds) * scale, min.y + rowHeight - 1.0f);
+			ImU32 color = ColorOf(passes[span.pass].name);
+			drawList->AddRectFilled(min, max, color);
+			drawList->PushClipRect(min, max, true);
+			drawList->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32(255, 255, 255, 255), passes[span.pass].name.c_str());
+			drawList->PopClipRect();
+		}
+		ImGui::Dummy(ImVec2(width, rows * rowHeight));
+		for (const auto& span : lastFrameSpans) {
+			if (ImGui::IsMouseHoveringRect(ImVec2(origin.x + span.start * scale, origin.y + span.depth * rowHeight),
+				ImVec2(origin.x + (span.start + span.milliseconds) * scale, origin.y + (span.depth + 1) * rowHeight)))
+				ImGui::SetTooltip("%s: %.3f ms", passes[span.pass].name.c_str(), span.milliseconds);
+		}
+
+		// Rolling averages
+		float total = std::max(frameStats.averageMilliseconds, 0.001f);
+		char label[128];
+		for (int index : lastFramePasses) {
+			const GpuPassStats& pass = passes[index];
+			snprintf(label, sizeof(label), "%*s%s  %.2f ms", pass.depth * 2, "", pass.name.c_str(), pass.averageMilliseconds);
+			ImGui::PushStyleColor(ImGuiCol_PlotHistogram, ColorOf(pass.name));
+			ImGui::ProgressBar(pass.averageMilliseconds / total, ImVec2(-1.0f, 0.0f), label);
+			ImGui::PopStyleColor();
+		}
+	}
+
+	// Rolling averages as text, for the demos without ImGui.
+	void PrintSummary(std::ostream& out) const
+	{
+		char line[160];
+		snprintf(line, sizeof(line), "GPU frame: %.2f ms avg, %.2f ms max (%u frames dropped)\n",
+			frameStats.averageMilliseconds, frameStats.maxMilliseconds, droppedFrames);
+		out << line;
+		for (int index : lastFramePasses) {
+			const GpuPassStats& pass = passes[index];
+			snprintf(line, sizeof(line), "  %*s%-24s %7.3f ms avg %7.3f ms max\n", pass.depth * 2, "", pass.name.c_str(),
+				pass.averageMilliseconds, pass.maxMilliseconds);
+			out << line;
+		}
+	}
+
+	// Prints the summary and writes gpu_profile.csv once per key press. Call every frame with the key state.
+	void ReportOnKey(bool keyDown)
+	{
+		if (keyDown && !reportKeyDown) {
+			PrintSummary(std::cout);
+			int rows = ExportCSV("gpu_profile.csv");
+			if (rows >= 0)
+				std::cout << rows << " rows written to gpu_profile.csv\n";
+		}
+		reportKeyDown = keyDown;
+	}
+
+	// Writes every kept frame as "frame,pass,depth,milliseconds" rows; the whole frame is the "frame" pass at depth -1.
+	// Returns the number of rows written, -1 if the file could not be opened.
+	int ExportCSV(const std::string& path) const
+	{
+		std::ofstream file(path);
+		if (!file) {
+			std::cerr << "Error: could not write " << path << "\n";
+			return -1;
+		}
+		int rows = 0;
+		file << "frame,pass,depth,milliseconds\n";
+		for (const auto& frame : history) {
+			file << frame.frame << ",frame,-1," << frame.milliseconds << "\n";
+			rows++;
+			for (const auto& sample : frame.passes) {
+				file << frame.frame << "," << passes[sample.pass].name << "," << passes[sample.pass].depth << "," << sample.milliseconds << "\n";
+				rows++;
+			}
+		}
+		return rows;
+	}
+
+private:
+	struct Scope
+	{
+		std::string name;
+		int depth = 0;
+		int begin = -1, end = -1; // indices into FrameSlot::queries
+	};
+
+	struct FrameSlot
+	{
+		std::vector<unsigned int> queries;
+		int usedQueries = 0;
+		std::vector<Scope> scopes;
+		unsigned long long frame = 0;
+		bool pending = false;
+	};
+
+	struct Samples
+	{
+		float values[AVERAGE_FRAMES] = {};
+		int count = 0, next = 0;
+
+		void Add(float value, float& average, float& max)
+		{
+			values[next] = value;
+			next = (next + 1) % AVERAGE_FRAMES;
+			count = std::min(count + 1, AVERAGE_FRAMES);
+			float sum = 0.0f;
+			max = 0.0f;
+			for (int i = 0; i < count; i++) {
+				sum += values[i];
+				max = std::max(max, values[i]);
+			}
+			average = sum / count;
+		}
+	};
+
+	struct Span
+	{
+		int pass;
+		int depth;
+		float start, milliseconds; // relative to the frame start
+	};
+
+	// The queries are never deleted: the singleton outlives the GL context, which frees them with it.
+	GpuProfiler() = default;
+
+	int Timestamp(FrameSlot& slot)
+	{
+		if (slot.usedQueries == (int)slot.queries.size()) {
+			unsigned int query;
+			glGenQueries(1, &query);
+			slot.queries.push_back(query);
+		}
+		glQueryCounter(slot.queries[slot.usedQueries], GL_TIMESTAMP);
+		return slot.usedQueries++;
+	}
+
+	// @param wait block until the results are available instead of dropping the frame
+	void Collect(const FrameSlot& slot, bool wait = false)
+	{
+		// Timestamps complete in order, so the last one being available means all of them are
+		GLint available = 0;
+		if (!wait)
+			glGetQueryObjectiv(slot.queries[slot.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!wait && !available) {
+			droppedFrames++;
+			return;
+		}
+
+		timestamps.resize(slot.usedQueries);
+		for (int i = 0; i < slot.usedQueries; i++)
+			glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+
+		auto ToMilliseconds = [&](int from, int to) { return (timestamps[to] - timestamps[from]) / 1000000.0f; };
+
+		GpuFrameRecord record;
+		record.frame = slot.frame;
+		record.milliseconds = ToMilliseconds(0, slot.usedQueries - 1);
+		frameStats.lastMilliseconds = record.milliseconds;
+		frameSamples.Add(record.milliseconds, frameStats.averageMilliseconds, frameStats.maxMilliseconds);
+
+		lastFramePasses.clear();
+		lastFrameSpans.clear();
+		lastFrameMilliseconds = record.milliseconds;
+		for (const Scope& scope : slot.scopes) {
+			if (scope.end < 0)
+				continue;
+			int index = FindOrAddPass(scope.name, scope.depth);
+			float milliseconds = ToMilliseconds(scope.begin, scope.end);
+			lastFrameSpans.push_back({ index, scope.depth, ToMilliseconds(0, scope.begin), milliseconds });
+
+			auto it = std::find_if(record.passes.begin(), record.passes.end(), [&](const GpuPassSample& s) { return s.pass == index; });
+			if (it != record.passes.end()) {
+				it->milliseconds += milliseconds;
+			}
+			else {
+				record.passes.push_back({ index, milliseconds });
+				lastFramePasses.push_back(index);
+			}
+		}
+		for (const GpuPassSample& sample : record.passes) {
+			GpuPassStats& pass = passes[sample.pass];
+			pass.lastMilliseconds = sample.milliseconds;
+			passSamples[sample.pass].Add(sample.milliseconds, pass.averageMilliseconds, pass.maxMilliseconds);
+		}
+
+		history.push_back(std::move(record));
+		if ((int)history.size() > HISTORY_FRAMES)
+			history.pop_front();
+	}
+
+	int FindOrAddPass(const std::string& name, int depth)
+	{
+		auto it = passIndices.find(name);
+		if (it != passIndices.end())
+			return it->second;
+		GpuPassStats pass;
+		pass.name = name;
+		pass.depth = depth;
+		passes.push_back(pass);
+		passSamples.emplace_back();
+		passIndices[name] = (int)passes.size() - 1;
+		return (int)passes.size() - 1;
+	}
+
+	// Stable color per pass name, so a pass keeps its color across frames and between the timeline and the bars.
+	static ImU32 ColorOf(const std::string& name)
+	{
+		unsigned int hash = (unsigned int)std::hash<std::string>()(name);
+		float hue = (hash % 360) / 360.0f;
+		float r, g, b;
+		ImGui::ColorConvertHSVtoRGB(hue, 0.55f, 0.75f, r, g, b);
+		return ImGui::ColorConvertFloat4ToU32(ImVec4(r, g, b, 1.0f));
+	}
+
+	FrameSlot slots[FRAME_LATENCY];
+	int current = 0;
+	unsigned long long frameIndex = 0;
+	bool inFrame = false, recording = false;
+	std::vector<int> stack;
+	std::vector<GLuint64> timestamps;
+
+	std::vector<GpuPassStats> passes;
+	std::vector<Samples> passSamples;
+	std::unordered_map<std::string, int> passIndices;
+	GpuPassStats frameStats;
+	Samples frameSamples;
+	unsigned int droppedFrames = 0;
+
+	std::vector<int> lastFramePasses;
+	std::vector<Span> lastFrameSpans;
+	float lastFrameMilliseconds = 0.0f;
+	std::deque<GpuFrameRecord> history;
+	int lastExportRows = -1;
+	bool reportKeyDown = false;
+};
+
+// Times the enclosing block as a GpuProfiler scope.
+class GpuProfileScope
+{
+public:
+	explicit GpuProfileScope(const char* name) { GpuProfiler::Get().Begin(name); }
+	~GpuProfileScope() { GpuProfiler::Get().End(); }
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+};
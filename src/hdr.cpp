@@ -7,9 +7,16 @@
 #include "camera.h"
 #include "model.h"
 #include "shader.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "benchmark.h"
+#include "uniform_buffer.h"
+#include "render_target.h"
+#include "auto_exposure.h"
 
 // Function declarations
-void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT);
+void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void ProcessInput(GLFWwindow* window);
@@ -17,8 +24,8 @@ unsigned int LoadTexture(const std::string& path);
 void RenderCube();
 
 // Scene settings
-constexpr int SCR_WIDTH = 800;
-constexpr int SCR_HEIGHT = 800;
+int SCR_WIDTH = 800;
+int SCR_HEIGHT = 800;
 
 // Camera settings
 Camera camera(0.0f, 0.0f, 15.0f);
@@ -34,15 +41,21 @@ float lastFrame = 0.0f;
 // control them in ProcessInput()
 bool hdr = true;
 bool hdrKeyPressed = false;
-float exposure = 1.0f;
+float exposure = 1.0f; // with auto exposure on, a factor on top of the adapted exposure
+bool autoExposureOn = true;
+bool autoExposureKeyPressed = false;
 
-int main()
+int main(int argc, char** argv)
 {
+	// --benchmark runs a fixed, hidden, vsync-off camera loop and writes benchmark_hdr.json
+	Benchmark benchmark("hdr", argc, argv);
+
 	// glfw & glew configs
 	GLFWwindow* window = nullptr;
 	try {
 		if (!glfwInit())
 			throw std::runtime_error("failed to init glfw");
+		benchmark.ApplyWindowHints();
 		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "hnzz", nullptr, nullptr);
 		if (!window)
 			throw std::runtime_error("failed to create window");
@@ -55,9 +68,10 @@ int main()
 
 		if (glewInit() != GLEW_OK)
 			throw std::runtime_error("failed to init glew");
+		benchmark.ConfigureContext();
 
 		// OpenGL global status settings here
-		glEnable(GL_DEPTH_TEST);
+		GLState::Get().Enable(GL_DEPTH_TEST);
 		//glEnable(GL_CULL_FACE);
 	}
 	catch (const std::runtime_error& e) {
@@ -76,60 +90,31 @@ int main()
 	unsigned int quadVAO, quadVBO;
 	glGenVertexArrays(1, &quadVAO);
 	glGenBuffers(1, &quadVBO);
-	glBindVertexArray(quadVAO);
+	GLState::Get().BindVertexArray(quadVAO);
 	glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(1);
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-	glBindVertexArray(0);
+	GLState::Get().BindVertexArray(0);
 
 	// Build & compile shader(s)
-	Shader shader("res/shaders/hdrLighting.vs", "res/shaders/hdrLighting.fs");
-	Shader hdrShader("res/shaders/hdr.vs", "res/shaders/hdr.fs");
+	Shader shader(SHADER_HDRLIGHTING_VS, SHADER_HDRLIGHTING_FS);
+	Shader hdrShader(SHADER_HDR_VS, SHADER_HDR_FS);
 
 	// Load texture(s)
 	unsigned int woodTexture = LoadTexture("res/textures/wood.png");
 
-	// Generate and bind the HDR framebuffer
-	unsigned int hdrFBO;
-	glGenFramebuffers(1, &hdrFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-
-	// Generate texture for color buffer
-	unsigned int colorBuffer;
-	glGenTextures(1, &colorBuffer);
-
-	// Configure and bind the color buffer texture
-	glBindTexture(GL_TEXTURE_2D, colorBuffer);
+	// HDR framebuffer from the render target pool, resized with the window
 	// Use GL_RGBA16F for HDR rendering to capture a wide range of brightness (greater than 1.0f).
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);  
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);  
-	glBindTexture(GL_TEXTURE_2D, 0);  
-	glBindRenderbuffer(GL_RENDERBUFFER, 0);  
-
-	// Generate and configure depth buffer (Renderbuffer)
-	unsigned int rboDepth;
-	glGenRenderbuffers(1, &rboDepth);
-	glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-	glBindRenderbuffer(GL_RENDERBUFFER, 0);  
-
-	// Attach color buffer and depth buffer to framebuffer
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorBuffer, 0);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-
-	// Check if framebuffer is complete
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "Framebuffer not complete!" << std::endl;
-	else std::cout << "Framebuffer completed\n";
-
-	// Unbind the framebuffer to revert to default framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	RenderTarget hdrTarget({
+		{ GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, GL_LINEAR },
+		{ GL_DEPTH_COMPONENT24, SCR_WIDTH, SCR_HEIGHT }
+	});
+
+	// Eye adaptation: measures the HDR target every frame and adapts the exposure a frame or two later
+	AutoExposure autoExposure;
 
     // Light positions
 	std::vector<glm::vec3> lightPositions;
@@ -145,6 +130,15 @@ int main()
 	lightColors.push_back(glm::vec3(0.0f, 0.0f, 0.2f));
 	lightColors.push_back(glm::vec3(0.0f, 0.1f, 0.0f));
 
+	// Shared per-frame uniform blocks; the lights are static so the Lights block is written only once
+	FrameConstants frameConstants;
+	std::vector<PointLight> lights(lightPositions.size());
+	for (size_t i = 0; i < lights.size(); i++) {
+		lights[i].position = lightPositions[i];
+		lights[i].color = lightColors[i];
+	}
+	frameConstants.SetLights(lights);
+
 	// Config shader(s)
 	shader.Bind();
 	shader.SetInt("woodTexture", 0);
@@ -153,14 +147,23 @@ int main()
 	
 	int counter = 0;
 	const int maxPrints = 50;
-	while (!glfwWindowShouldClose(window)) {
+	while (!glfwWindowShouldClose(window) && benchmark.NextFrame(camera)) {
+		// Publish last frame's state-cache counters and start counting this frame
+		GLState::Get().NewFrame();
+		// Drop render targets that stayed idle since the last resize
+		RenderTargetPool::Get().NewFrame();
+		// Read back the GPU timings of an older frame and start recording this one
+		GpuProfiler::Get().BeginFrame();
+		// Build the CPU call tree of the previous frame
+		CpuProfiler::Get().NewFrame();
+
 		// Per-frame logic
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
 		// fps printing
-		if (counter < maxPrints) {
+		if (counter < maxPrints && !benchmark.IsRunning()) {
 			std::cout << "fps: " << 1.0f / deltaTime << "\n";
 			counter++;
 		}
@@ -172,8 +175,15 @@ int main()
 		// Process input
 		ProcessInput(window);
 
+		// Adapt to the luminance measured in earlier frames
+		if (autoExposureOn)
+			autoExposure.Update(deltaTime);
+		float frameExposure = autoExposureOn ? autoExposure.GetExposure() * exposure : exposure;
+
 		// 1. render scene into floating point framebuffer
-		glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
+		GpuProfiler::Get().Begin("scene");
+		hdrTarget.Resize(SCR_WIDTH, SCR_HEIGHT);
+		hdrTarget.Bind();
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		shader.Bind();
@@ -182,58 +192,64 @@ int main()
 		glm::mat4 model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(0.0f, 0.0f, 25.0));
 		model = glm::scale(model, glm::vec3(2.5f, 2.5f, 27.5f));
-		shader.SetMat4("projection", projection);
-		shader.SetMat4("view", view);
+		frameConstants.SetCamera(projection, view, camera.position);
+		frameConstants.SetPostParams(frameExposure, false, hdr);
 		shader.SetMat4("model", model);
-		//shader.SetVec3("viewPos", camera.position);
 		shader.SetInt("inverse_normals", true);
-		
-		// Light uniforms
-		if (lightPositions.size() == lightColors.size()) {
-			for (int i = 0; i < lightPositions.size(); ++i) {
-				std::string posName = "lightPositions[" + std::to_string(i) + "]";
-				std::string colName = "lightColors[" + std::to_string(i) + "]";
-				shader.SetVec3(posName, lightPositions[i]);
-				shader.SetVec3(colName, lightColors[i]);
-			}
-		}
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, woodTexture);
+		GLState::Get().ActiveTexture(GL_TEXTURE0);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, woodTexture);
 		RenderCube();
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GpuProfiler::Get().End();
+
+		// Reduce the HDR image to a small log-luminance grid and start its (fenced, non-blocking) readback
+		if (autoExposureOn) {
+			GpuProfiler::Get().Begin("auto exposure");
+			autoExposure.Measure(hdrTarget.GetTexture(0));
+			GpuProfiler::Get().End();
+		}
+		GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::Get().Viewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 
 		// 2. Render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
+		GpuProfiler::Get().Begin("tonemap");
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		hdrShader.Bind();
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, colorBuffer);
-		hdrShader.SetInt("hdr", hdr);
-		hdrShader.SetFloat("exposure", exposure);
-		glBindVertexArray(quadVAO);
+		GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, hdrTarget.GetTexture(0));
+		GLState::Get().BindVertexArray(quadVAO);
 		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-		glBindVertexArray(0);
+		GpuProfiler::Get().End();
 
 		// Print HDR status and current exposure value to the console
-		std::cout << "HDR: " << (hdr ? "enabled" : "not enabled") << " | Current exposure value: " << exposure << std::endl;
+		if (!benchmark.IsRunning())
+			std::cout << "HDR: " << (hdr ? "enabled" : "not enabled") << " | Auto exposure: " << (autoExposureOn ? "enabled" : "not enabled") << " | Current exposure value: " << frameExposure << std::endl;
+
+		GpuProfiler::Get().EndFrame();
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-		glfwSwapBuffers(window);
+		{
+			CPU_PROFILE_SCOPE("glfwSwapBuffers"); // includes the vsync wait
+			glfwSwapBuffers(window);
+		}
 		glfwPollEvents();
 	}
 
+	benchmark.Finish();
+
 	// Delete all resources of OpenGL
 	glDeleteBuffers(1, &quadVBO);
-	glDeleteVertexArrays(1, &quadVAO);
+	GLState::Get().DeleteVertexArrays(1, &quadVAO);
 	glfwTerminate();
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
-void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT)
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
 	// make sure the viewport matches the new window dimensions; note that SCR_WIDTH and 
 	// SCR_HEIGHT will be significantly larger than specified on retina displays.
-	glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+	GLState::Get().Viewport(0, 0, width, height);
+	SCR_WIDTH = width;
+	SCR_HEIGHT = height;
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -278,6 +294,11 @@ void ProcessInput(GLFWwindow* window)
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
 		camera.ProcessKeyboard(RIGHT, deltaTime);
 
+	// Print the GPU pass timings and write them to gpu_profile.csv by pressing P
+	GpuProfiler::Get().ReportOnKey(glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS);
+	// Write the CPU trace (chrome://tracing, ui.perfetto.dev) to cpu_trace.json by pressing T
+	CpuProfiler::Get().ExportOnKey(glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS);
+
 	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && !hdrKeyPressed) {
 		hdr = !hdr;
 		hdrKeyPressed = true;
@@ -286,6 +307,15 @@ void ProcessInput(GLFWwindow* window)
 		hdrKeyPressed = false;
 	}
 
+	// Toggle auto exposure by pressing X; Q/E then scale the adapted exposure
+	if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS && !autoExposureKeyPressed) {
+		autoExposureOn = !autoExposureOn;
+		autoExposureKeyPressed = true;
+	}
+	if (glfwGetKey(window, GLFW_KEY_X) == GLFW_RELEASE) {
+		autoExposureKeyPressed = false;
+	}
+
 	if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
 		if (exposure > 0.0f)
 			exposure -= 0.01f;
@@ -314,7 +344,7 @@ unsigned int LoadTexture(const std::string& path)
 		else if (nrComponents == 4)
 			format = GL_RGBA;
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -392,7 +422,7 @@ void RenderCube()
 		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 		// link vertex attributes
-		glBindVertexArray(cubeVAO);
+		GLState::Get().BindVertexArray(cubeVAO);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(1);
@@ -400,10 +430,9 @@ void RenderCube()
 		glEnableVertexAttribArray(2);
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		GLState::Get().BindVertexArray(0);
 	}
 	// render Cube
-	glBindVertexArray(cubeVAO);
+	GLState::Get().BindVertexArray(cubeVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
 }
\ No newline at end of file
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+#include "timer.h"
+#include "cpu_profiler.h"
+
+// The JobSystem class is a small pool of worker threads for data-parallel frame work (building draw packets,
+// culling, animating thousands of objects). ParallelFor() splits [0, count) into chunks that the workers and the
+// calling thread pull from a shared counter, and returns once every chunk is done, so the caller can use the
+// results right away. Workers never touch OpenGL: they fill plain CPU structures that the GL thread then submits.
+//
+// Each thread has a fixed index (0 = the calling thread, 1..N = workers) that ParallelFor passes to the job, so a
+// job can write into per-thread storage without locks. Busy time is accumulated per thread index and published by
+// NewFrame(); the workers are also named in the CpuProfiler, so their scopes show up as separate trace rows.
+//
+// Usage Example:
+// JobSystem::Get().NewFrame(); // once per frame
+// std::vector<CommandList> lists(JobSystem::Get().GetThreadCount());
+// JobSystem::Get().ParallelFor(objects.size(), 256, [&](size_t begin, size_t end, unsigned int thread) {
+//     for (size_t i = begin; i < end; i++)
+//         BuildPacket(objects[i], lists[thread]);
+// });
+class JobSystem
+{
+public:
+	static JobSystem& Get()
+	{
+		static JobSystem instance;
+		return instance;
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Worker threads taking part in ParallelFor, 0 runs everything on the calling thread. At most GetWorkerCount().
+	int activeWorkers;
+
+	unsigned int GetWorkerCount() const { return (unsigned int)workers.size(); }
+
+	// Workers plus the calling thread, the size per-thread storage needs.
+	unsigned int GetThreadCount() const { return GetWorkerCount() + 1; }
+
+	// Publishes the busy time of every thread over the frame that just ended.
+	void NewFrame()
+	{
+		for (unsigned int i = 0; i < GetThreadCount(); i++)
+			lastFrameMilliseconds[i] = busyNanoseconds[i].exchange(0, std::memory_order_relaxed) / 1000000.0f;
+	}
+
+	// Time each thread index spent in ParallelFor jobs during the last frame, index 0 is the calling thread.
+	const std::vector<float>& GetThreadMilliseconds() const { return lastFrameMilliseconds; }
+
+	// Calls _job(begin, end, threadIndex) for chunks of at most _chunkSize items covering [0, _count).
+	// Blocks until all chunks are done. Not reentrant: call it from one thread only, never from inside a job.
+	void ParallelFor(size_t _count, size_t _chunkSize, const std::function<void(size_t, size_t, unsigned int)>& _job)
+	{
+		if (_count == 0)
+			return;
+		Job job;
+		job.function = &_job;
+		job.count = _count;
+		job.chunkSize = std::max<size_t>(_chunkSize, 1);
+		job.threads = (unsigned int)std::clamp(activeWorkers, 0, (int)GetWorkerCount());
+
+		if (job.threads == 0 || _count <= job.chunkSize) {
+			RunChunks(job, 0);
+			return;
+		}
+
+		job.pendingWorkers.store((int)GetWorkerCount(), std::memory_order_relaxed);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			currentJob = &job;
+			generation++;
+		}
+		wakeCondition.notify_all();
+
+		RunChunks(job, 0);
+
+		// Every worker acknowledges the job, even the ones that sat it out, so none of them still holds
+		// a pointer to it once this returns
+		std::unique_lock<std::mutex> lock(mutex);
+		doneCondition.wait(lock, [&] { return job.pendingWorkers.load(std::memory_order_acquire) == 0; });
+		currentJob = nullptr;
+	}
+
+private:
+	struct Job
+	{
+		const std::function<void(size_t, size_t, unsigned int)>* function = nullptr;
+		size_t count = 0;
+		size_t chunkSize = 1;
+		unsigned int threads = 0;
+		std::atomic<size_t> nextChunk{ 0 };
+		std::atomic<int> pendingWorkers{ 0 };
+	};
+
+	JobSystem()
+	{
+		CpuProfiler::Get(); // constructed first, so it outlives the workers
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		unsigned int workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		activeWorkers = (int)workerCount;
+		busyNanoseconds = std::vector<std::atomic<long long>>(workerCount + 1);
+		lastFrameMilliseconds.assign(workerCount + 1, 0.0f);
+		for (unsigned int i = 0; i < workerCount; i++)
+			workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+	}
+
+	~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wakeCondition.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	void WorkerLoop(unsigned int index)
+	{
+		CpuProfiler::Get().SetThreadName("Worker " + std::to_string(index));
+		unsigned long long seenGeneration = 0;
+		while (true) {
+			Job* job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+				if (stopping)
+					return;
+				seenGeneration = generation;
+				job = currentJob;
+			}
+
+			if (index <= job->threads)
+				RunChunks(*job, index);
+
+			if (job->pendingWorkers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				std::lock_guard<std::mutex> lock(mutex);
+				doneCondition.notify_one();
+			}
+		}
+	}
+
+	void RunChunks(Job& job, unsigned int index)
+	{
+		CPU_PROFILE_SCOPE("JobSystem::RunChunks");
+		long long start = Timer::nowNanoseconds();
+		while (true) {
+			size_t begin = job.nextChunk.fetch_add(job.chunkSize, std::memory_order_relaxed);
+			if (begin >= job.count)
+				break;
+			(*job.function)(begin, std::min(begin + job.chunkSize, job.count), index);
+		}
+		busyNanoseconds[index].fetch_add(Timer::nowNanoseconds() - start, std::memory_order_relaxed);
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wakeCondition, doneCondition;
+	Job* currentJob = nullptr;
+	unsigned long long generation = 0;
+	bool stopping = false;
+
+	std::vector<std::atomic<long long>> busyNanoseconds;
+	std::vector<float> lastFrameMilliseconds;
+};
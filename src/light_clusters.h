@@ -0,0 +1,270 @@
+#pragma once
+
+#include <vector>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+#include "uniform_buffer.h"
+#include "texture_buffer.h"
+#include "job_system.h"
+#include "cpu_profiler.h"
+#include "timer.h"
+
+// Per-frame statistics of the light grid.
+struct LightClusterStats
+{
+	unsigned int lights = 0;             // lights uploaded
+	unsigned int visibleLights = 0;      // lights touching at least one cluster
+	unsigned int indices = 0;            // light references over all clusters
+	unsigned int occupiedClusters = 0;
+	unsigned int maxLightsPerCluster = 0;
+	float buildMilliseconds = 0.0f;      // CPU binning, without the upload
+};
+
+// The LightClusters class implements clustered light culling for the deferred lighting pass. The view frustum is cut
+// into GRID_X * GRID_Y screen tiles and GRID_Z depth slices (exponentially spaced, so clusters stay roughly cubic),
+// and every frame each point light is binned into the clusters its sphere of influence overlaps. The lighting
+// shader looks up the cluster of its pixel and only shades the lights listed there, so the cost per pixel follows
+// the local light density instead of the total light count.
+//
+// Binning runs on the CPU: the lights are bucketed by depth slice, the JobSystem then fills one slice per job
+// (each slice owns its clusters, so there is no sharing between threads), and the per-slice lists are concatenated.
+// The lights, the per-cluster (offset, count) pairs and the light index list are uploaded to texture buffers, which
+// unlike the Lights uniform block have no 32-light ceiling.
+//
+// GLSL side (see deferred_shading.fs):
+// uniform samplerBuffer lightData;     // 3 texels per light: (position, radius), (color, linear), (quadratic)
+// uniform usamplerBuffer lightGrid;    // per cluster: (first index, light count)
+// uniform usamplerBuffer lightIndices; // light indices, grouped by cluster
+// uniform vec3 clusterGrid;            // GRID_X, GRID_Y, GRID_Z
+// uniform float clusterNear;           // near plane of the grid
+// uniform float clusterSliceScale;     // GRID_Z / log(far / near)
+//
+// Usage Example:
+// LightClusters clusters;
+// clusters.Build(lights, radii, view, glm::radians(camera.fov), aspect, 0.1f, 100.0f); // once per frame
+// clusters.Bind(shaderLightingPass, 3); // texture units 3, 4 and 5
+class LightClusters
+{
+public:
+	static constexpr int GRID_X = 16;
+	static constexpr int GRID_Y = 9;
+	static constexpr int GRID_Z = 24;
+	static constexpr int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+	LightClusters()
+		: lightBuffer(GL_RGBA32F), gridBuffer(GL_RG32UI), indexBuffer(GL_R32UI)
+	{
+		sliceBins.resize(GRID_Z);
+		for (SliceBin& bin : sliceBins)
+			bin.clusterLights.resize(GRID_X * GRID_Y);
+	}
+
+	// Bins _lights (world space, with their radius of influence in _radii) for the given camera and uploads the result.
+	void Build(const std::vector<PointLight>& _lights, const std::vector<float>& _radii, const glm::mat4& _view,
+		float _fovY, float _aspect, float _near, float _far)
+	{
+		CPU_PROFILE_SCOPE("LightClusters::Build");
+		long long start = Timer::nowNanoseconds();
+		UpdateGrid(_fovY, _aspect, _near, _far);
+
+		// 1. View-space spheres, their cluster ranges, and one bucket of lights per depth slice
+		for (SliceBin& bin : sliceBins)
+			bin.lights.clear();
+		bounds.resize(_lights.size());
+		stats.visibleLights = 0;
+		for (size_t i = 0; i < _lights.size(); i++) {
+			LightBounds& light = bounds[i];
+			light.center = glm::vec3(_view * glm::vec4(_lights[i].position, 1.0f));
+			light.radius = _radii[i];
+			if (!ComputeRange(light))
+				continue;
+			stats.visibleLights++;
+			for (int z = light.minZ; z <= light.maxZ; z++)
+				sliceBins[z].lights.push_back((unsigned int)i);
+		}
+
+		// 2. Per slice, on the workers: exact sphere / cluster box tests
+		JobSystem::Get().ParallelFor(GRID_Z, 1, [&](size_t begin, size_t end, unsigned int) {
+			CPU_PROFILE_SCOPE("bin light slice");
+			for (size_t z = begin; z < end; z++)
+				BinSlice((int)z);
+		});
+
+		// 3. Concatenate into (offset, count) pairs and one index list
+		grid.resize(CLUSTER_COUNT * 2);
+		indices.clear();
+		stats.occupiedClusters = 0;
+		stats.maxLightsPerCluster = 0;
+		for (int z = 0; z < GRID_Z; z++) {
+			for (int tile = 0; tile < GRID_X * GRID_Y; tile++) {
+				const std::vector<unsigned int>& clusterLights = sliceBins[z].clusterLights[tile];
+				int cluster = z * GRID_X * GRID_Y + tile;
+				grid[cluster * 2] = (unsigned int)indices.size();
+				grid[cluster * 2 + 1] = (unsigned int)clusterLights.size();
+				indices.insert(indices.end(), clusterLights.begin(), clusterLights.end());
+				stats.occupiedClusters += !clusterLights.empty();
+				stats.maxLightsPerCluster = std::max(stats.maxLightsPerCluster, (unsigned int)clusterLights.size());
+			}
+		}
+		stats.lights = (unsigned int)_lights.size();
+		stats.indices = (unsigned int)indices.size();
+		stats.buildMilliseconds = (Timer::nowNanoseconds() - start) / 1000000.0f;
+
+		// 4. Upload
+		lightTexels.resize(_lights.size() * 3);
+		for (size_t i = 0; i < _lights.size(); i++) {
+			lightTexels[i * 3 + 0] = glm::vec4(_lights[i].position, _radii[i]);
+			lightTexels[i * 3 + 1] = glm::vec4(_lights[i].color, _lights[i].linear);
+			lightTexels[i * 3 + 2] = glm::vec4(_lights[i].quadratic, 0.0f, 0.0f, 0.0f);
+		}
+		lightBuffer.Update(lightTexels.data(), lightTexels.size() * sizeof(glm::vec4));
+		gridBuffer.Update(grid.data(), grid.size() * sizeof(unsigned int));
+		indexBuffer.Update(indices.data(), indices.size() * sizeof(unsigned int));
+	}
+
+	// Binds the three buffers to _firstUnit.._firstUnit + 2 and sets the grid uniforms of _shader (bound by the caller).
+	void Bind(Shader& _shader, unsigned int _firstUnit) const
+	{
+		lightBuffer.Bind(_firstUnit);
+		gridBuffer.Bind(_firstUnit + 1);
+		indexBuffer.Bind(_firstUnit + 2);
+		_shader.SetInt("lightData", _firstUnit);
+		_shader.SetInt("lightGrid", _firstUnit + 1);
+		_shader.SetInt("lightIndices", _firstUnit + 2);
+		_shader.SetVec3("clusterGrid", (float)GRID_X, (float)GRID_Y, (float)GRID_Z);
+		_shader.SetFloat("clusterNear", nearPlane);
+		_shader.SetFloat("clusterSliceScale", GRID_Z / std::log(farPlane / nearPlane));
+	}
+
+	const LightClusterStats& GetStats() const { return stats; }
+
+private:
+	struct LightBounds
+	{
+		glm::vec3 center; // view space
+		float radius;
+		int minX, maxX, minY, maxY, minZ, maxZ; // inclusive cluster range
+	};
+
+	struct SliceBin
+	{
+		std::vector<unsigned int> lights;                     // lights overlapping the slice
+		std::vector<std::vector<unsigned int>> clusterLights; // per tile of the slice
+	};
+
+	// View-space boxes of all clusters, recomputed only when the projection changes.
+	void UpdateGrid(float _fovY, float _aspect, float _near, float _far)
+	{
+		if (_fovY == fovY && _aspect == aspect && _near == nearPlane && _far == farPlane)
+			return;
+		fovY = _fovY;
+		aspect = _aspect;
+		nearPlane = _near;
+		farPlane = _far;
+		tanHalfFovY = std::tan(0.5f * fovY);
+
+		clusterMin.resize(CLUSTER_COUNT);
+		clusterMax.resize(CLUSTER_COUNT);
+		for (int z = 0; z < GRID_Z; z++) {
+			float depths[2] = { SliceDepth(z), SliceDepth(z + 1) };
+			for (int y = 0; y < GRID_Y; y++) {
+				for (int x = 0; x < GRID_X; x++) {
+					glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+					for (float depth : depths) {
+						for (int corner = 0; corner < 4; corner++) {
+							float ndcX = -1.0f + 2.0f * (x + (corner & 1)) / GRID_X;
+							float ndcY = -1.0f + 2.0f * (y + (corner >> 1)) / GRID_Y;
+							glm::vec3 point(ndcX * depth * tanHalfFovY * aspect, ndcY * depth * tanHalfFovY, -depth);
+							boxMin = glm::min(boxMin, point);
+							boxMax = glm::max(boxMax, point);
+						}
+					}
+					int cluster = (z * GRID_Y + y) * GRID_X + x;
+					clusterMin[cluster] = boxMin;
+					clusterMax[cluster] = boxMax;
+				}
+			}
+		}
+	}
+
+	float SliceDepth(int _slice) const
+	{
+		return nearPlane * std::pow(farPlane / nearPlane, (float)_slice / GRID_Z);
+	}
+
+	int SliceOf(float _depth) const
+	{
+		int slice = (int)std::floor(std::log(_depth / nearPlane) / std::log(farPlane / nearPlane) * GRID_Z);
+		return std::clamp(slice, 0, GRID_Z - 1);
+	}
+
+	// Conservative cluster range of a light; false if it is entirely in front of the near or behind the far plane.
+	bool ComputeRange(LightBounds& _light) const
+	{
+		float depth = -_light.center.z;
+		float nearest = depth - _light.radius, farthest = depth + _light.radius;
+		if (farthest < nearPlane || nearest > farPlane)
+			return false;
+		_light.minZ = SliceOf(std::max(nearest, nearPlane));
+		_light.maxZ = SliceOf(std::min(farthest, farPlane));
+
+		_light.minX = 0; _light.maxX = GRID_X - 1;
+		_light.minY = 0; _light.maxY = GRID_Y - 1;
+		if (nearest <= nearPlane)
+			return true; // the sphere reaches the camera plane, its projection is unbounded
+
+		// Projected bounds of the sphere's view-space box: x / depth is extreme at the nearest or farthest depth
+		float scaleX = 1.0f / (tanHalfFovY * aspect), scaleY = 1.0f / tanHalfFovY;
+		float left = std::min((_light.center.x - _light.radius) / nearest, (_light.center.x - _light.radius) / farthest) * scaleX;
+		float right = std::max((_light.center.x + _light.radius) / nearest, (_light.center.x + _light.radius) / farthest) * scaleX;
+		float bottom = std::min((_light.center.y - _light.radius) / nearest, (_light.center.y - _light.radius) / farthest) * scaleY;
+		float top = std::max((_light.center.y + _light.radius) / nearest, (_light.center.y + _light.radius) / farthest) * scaleY;
+		if (left > 1.0f || right < -1.0f || bottom > 1.0f || top < -1.0f)
+			return false;
+		_light.minX = std::clamp((int)std::floor((left * 0.5f + 0.5f) * GRID_X), 0, GRID_X - 1);
+		_light.maxX = std::clamp((int)std::floor((right * 0.5f + 0.5f) * GRID_X), 0, GRID_X - 1);
+		_light.minY = std::clamp((int)std::floor((bottom * 0.5f + 0.5f) * GRID_Y), 0, GRID_Y - 1);
+		_light.maxY = std::clamp((int)std::floor((top * 0.5f + 0.5f) * GRID_Y), 0, GRID_Y - 1);
+		return true;
+	}
+
+	void BinSlice(int _z)
+	{
+		SliceBin& bin = sliceBins[_z];
+		for (std::vector<unsigned int>& clusterLights : bin.clusterLights)
+			clusterLights.clear();
+		for (unsigned int index : bin.lights) {
+			const LightBounds& light = bounds[index];
+			float radiusSquared = light.radius * light.radius;
+			for (int y = light.minY; y <= light.maxY; y++) {
+				for (int x = light.minX; x <= light.maxX; x++) {
+					int cluster = (_z * GRID_Y + y) * GRID_X + x;
+					// Squared distance from the sphere center to the cluster box
+					glm::vec3 closest = glm::clamp(light.center, clusterMin[cluster], clusterMax[cluster]);
+					glm::vec3 offset = closest - light.center;
+					if (glm::dot(offset, offset) <= radiusSquared)
+						bin.clusterLights[y * GRID_X + x].push_back(index);
+				}
+			}
+		}
+	}
+
+private:
+	float fovY = 0.0f, aspect = 0.0f, nearPlane = 0.1f, farPlane = 100.0f, tanHalfFovY = 1.0f;
+	std::vector<glm::vec3> clusterMin, clusterMax;
+
+	std::vector<LightBounds> bounds;
+	std::vector<SliceBin> sliceBins;
+	std::vector<unsigned int> grid;    // (offset, count) per cluster
+	std::vector<unsigned int> indices;
+	std::vector<glm::vec4> lightTexels;
+
+	TextureBuffer lightBuffer, gridBuffer, indexBuffer;
+	LightClusterStats stats;
+};
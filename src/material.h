@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "gl_state.h"
+#include "shader.h"
+
+// Fixed texture slots of a Material. A slot is also the texture unit its texture is bound to.
+enum MaterialSlot : unsigned int
+{
+	MATERIAL_SLOT_DIFFUSE = 0,
+	MATERIAL_SLOT_SPECULAR = 1,
+	MATERIAL_SLOT_NORMAL = 2,
+	MATERIAL_SLOT_HEIGHT = 3,
+	MATERIAL_SLOT_COUNT = 4
+};
+
+// Bitmask used to pick which texture types a draw uses, e.g. TEXTURE_DIFFUSE_BIT | TEXTURE_SPECULAR_BIT.
+enum MaterialTextureBits : unsigned int
+{
+	TEXTURE_DIFFUSE_BIT = 1 << MATERIAL_SLOT_DIFFUSE,
+	TEXTURE_SPECULAR_BIT = 1 << MATERIAL_SLOT_SPECULAR,
+	TEXTURE_NORMAL_BIT = 1 << MATERIAL_SLOT_NORMAL,
+	TEXTURE_HEIGHT_BIT = 1 << MATERIAL_SLOT_HEIGHT,
+	TEXTURE_ALL_BITS = (1 << MATERIAL_SLOT_COUNT) - 1
+};
+
+// The Material class holds the texture handles of a mesh in fixed slots (diffuse, specular, normal, height).
+// The sampler uniforms of a program are looked up and pointed at the slot units once per (material, program) pair;
+// after that a draw is just the texture binds, without any string building or uniform location queries.
+//
+// Reminder for GLSL code:
+//   - Samplers keep the old naming convention: texture_diffuse1, texture_specular1, texture_normal1, texture_height1.
+//
+// Usage Example:
+// Material material;
+// material.SetTexture(MATERIAL_SLOT_DIFFUSE, diffuseTexture);
+// shader.Bind();
+// material.Bind(shader, TEXTURE_DIFFUSE_BIT | TEXTURE_SPECULAR_BIT);
+class Material
+{
+public:
+	void SetTexture(MaterialSlot slot, unsigned int texture)
+	{
+		textures[slot] = texture;
+		if (texture != 0)
+			textureMask |= 1u << slot;
+		else
+			textureMask &= ~(1u << slot);
+	}
+
+	unsigned int GetTexture(MaterialSlot slot) const { return textures[slot]; }
+
+	// Bitmask of the slots that hold a texture.
+	unsigned int GetTextureMask() const { return textureMask; }
+
+	// Binds the textures selected by _typeMask to their slot units. The shader must be bound.
+	void Bind(const Shader& shader, unsigned int _typeMask = TEXTURE_ALL_BITS) const
+	{
+		unsigned int mask = textureMask & _typeMask & ResolveSamplers(shader);
+		for (unsigned int slot = 0; slot < MATERIAL_SLOT_COUNT; slot++) {
+			if (mask & (1u << slot))
+				GLState::Get().BindTextureUnit(slot, GL_TEXTURE_2D, textures[slot]);
+		}
+	}
+
+private:
+	// Returns the mask of the slots the program samples, assigning their units on first use.
+	unsigned int ResolveSamplers(const Shader& shader) const
+	{
+		unsigned int program = shader.GetID();
+		for (const auto& binding : programBindings) {
+			if (binding.program == program)
+				return binding.samplerMask;
+		}
+
+		static const char* samplerNames[MATERIAL_SLOT_COUNT] = {
+			"texture_diffuse1", "texture_specular1", "texture_normal1", "texture_height1"
+		};
+
+		unsigned int samplerMask = 0;
+		for (unsigned int slot = 0; slot < MATERIAL_SLOT_COUNT; slot++) {
+			GLint location = glGetUniformLocation(program, samplerNames[slot]);
+			if (location != -1) {
+				glUniform1i(location, slot);
+				samplerMask |= 1u << slot;
+			}
+		}
+		programBindings.push_back({ program, samplerMask });
+		return samplerMask;
+	}
+
+private:
+	struct ProgramBinding
+	{
+		unsigned int program;
+		unsigned int samplerMask;
+	};
+
+	unsigned int textures[MATERIAL_SLOT_COUNT] = {};
+	unsigned int textureMask = 0;
+	mutable std::vector<ProgramBinding> programBindings; // usually one or two programs per material
+};
@@ -6,6 +6,10 @@
 #include <GL/glew.h>
 
 #include "shader.h"
+#include "gl_state.h"
+#include "material.h"
+#include "render_queue.h"
+#include "cpu_profiler.h"
 
 struct Vertex
 {
@@ -30,7 +34,7 @@ public:
 	Mesh() = delete;  // Deleted default constructor
 	Mesh(const std::vector<Vertex>& vertices,
 		const std::vector<unsigned int>& indices,
-		const std::vector<Texture>& textures,
+		const Material& material,
 		bool hasTangentAndBitangent);  // Parameterized constructor
 	~Mesh();  // Destructor
 
@@ -47,16 +51,24 @@ public:
     // 
     // Usage:
     //   - To draw the mesh using only specific types of textures:
-    //       mesh.Draw(shader, {"texture_diffuse", "texture_specular"});
+    //       mesh.Render(shader, TEXTURE_DIFFUSE_BIT | TEXTURE_SPECULAR_BIT);
     //   - To draw the mesh using all available textures:
-    //       mesh.Draw(shader);
+    //       mesh.Render(shader);
     //
     // Reminder for GLSL code:
-    //   - The uniform sampler2D variables in the GLSL code should be named according
-    //     to the following format: "texture_diffuseN" or "texture_specularN", where
-    //     N is the texture number starting from 1.
+    //   - The uniform sampler2D variables in the GLSL code should be named
+    //     "texture_diffuse1", "texture_specular1", "texture_normal1" or "texture_height1".
     //
-	void Render(Shader& shader, const std::vector<std::string>& textureTypesToUse = {}) const;
+	void Render(Shader& shader, unsigned int textureMask = TEXTURE_ALL_BITS) const;
+
+	// Queues the mesh with its material instead of drawing it now (see RenderQueue).
+	DrawPacket& Submit(RenderQueue& queue, unsigned int pass, Shader& shader, const glm::mat4& model,
+		unsigned int textureMask = TEXTURE_ALL_BITS) const
+	{
+		return queue.Submit(pass, shader, GetGeometry(), model, &material, textureMask);
+	}
+
+	DrawGeometry GetGeometry() const { return { VAO, GL_TRIANGLES, (int)indices.size(), GL_UNSIGNED_INT }; }
 
 	// Accessors
 	unsigned int GetVAO() { return VAO; }
@@ -65,7 +77,8 @@ public:
 	// Public Members
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
-	std::vector<Texture> textures;
+	Material material;
+	glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f); // local AABB, for culling
 
 private:
 	// Private Methods
@@ -78,20 +91,28 @@ private:
 
 Mesh::Mesh(const std::vector<Vertex>& _vertices,
 	const std::vector<unsigned int>& _indices,
-	const std::vector<Texture>& _textures,
+	const Material& _material,
 	bool _hasTangentAndBitangent)
 {
 	this->vertices = _vertices;
 	this->indices = _indices;
-	this->textures = _textures;
+	this->material = _material;
 	this->hasTangentAndBitangent = _hasTangentAndBitangent;
 
+	if (!vertices.empty()) {
+		boundsMin = boundsMax = vertices[0].position;
+		for (const Vertex& vertex : vertices) {
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+	}
+
 	SetupMesh();
 }
 
 Mesh::~Mesh()
 {
-	glDeleteVertexArrays(1, &VAO);
+	GLState::Get().DeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 	glDeleteBuffers(1, &IBO);
 }
@@ -100,7 +121,8 @@ Mesh::~Mesh()
 Mesh::Mesh(Mesh&& other) noexcept
 	: VAO(other.VAO), VBO(other.VBO), IBO(other.IBO),
 	vertices(std::move(other.vertices)), indices(std::move(other.indices)),
-	textures(std::move(other.textures)), hasTangentAndBitangent(other.hasTangentAndBitangent)
+	material(other.material), boundsMin(other.boundsMin), boundsMax(other.boundsMax),
+	hasTangentAndBitangent(other.hasTangentAndBitangent)
 {
 	// Invalidate the moved-from object's OpenGL handles
 	other.VAO = 0;
@@ -114,7 +136,7 @@ Mesh& Mesh::operator=(Mesh&& other) noexcept
 	if (this != &other)
 	{
 		// Release any resources held by *this
-		glDeleteVertexArrays(1, &VAO);
+		GLState::Get().DeleteVertexArrays(1, &VAO);
 		glDeleteBuffers(1, &VBO);
 		glDeleteBuffers(1, &IBO);
 
@@ -124,7 +146,9 @@ Mesh& Mesh::operator=(Mesh&& other) noexcept
 		IBO = other.IBO;
 		vertices = std::move(other.vertices);
 		indices = std::move(other.indices);
-		textures = std::move(other.textures);
+		material = other.material;
+		boundsMin = other.boundsMin;
+		boundsMax = other.boundsMax;
 		hasTangentAndBitangent = other.hasTangentAndBitangent;
 
 		// Invalidate the moved-from object's OpenGL handles
@@ -135,43 +159,14 @@ Mesh& Mesh::operator=(Mesh&& other) noexcept
 	return *this;
 }
 
-void Mesh::Render(Shader& shader, const std::vector<std::string>& textureTypesToUse) const
+void Mesh::Render(Shader& shader, unsigned int textureMask) const
 {
-	// Start from material.diffuse1 or material.specular1
-	size_t diffuseNr = 1, specularNr = 1, normalNr = 1, heightNr = 1;
-
-	for (size_t i = 0; i < textures.size(); i++) {
-		glActiveTexture(GL_TEXTURE0 + i);
-		// Get texture numberN in diffuse_textureN 
-		std::string name = textures[i].type;
-
-		// Skip this texture if it's not in the list of types to use
-		if (!textureTypesToUse.empty() && 
-			std::find(textureTypesToUse.begin(), textureTypesToUse.end(), name) == textureTypesToUse.end()) {
-			continue;
-		}
-
-		std::string number;
-		if (name == "texture_diffuse")
-			number = std::to_string(diffuseNr++);
-		else if (name == "texture_specular")
-			number = std::to_string(specularNr++);
-		else if (name == "texture_normal")
-			number = std::to_string(normalNr++);
-		else if (name == "texture_height")
-			number = std::to_string(heightNr++);
-
-		// Notice: the corresponding uniform variable name should be:
-		// texture_diffuse1, texture_diffuse2, texture_specular2, etc.
-		// change this as needed(for different shader programs).
-		shader.SetInt((name + number).c_str(), i);
-		glBindTexture(GL_TEXTURE_2D, textures[i].id);
-	}
+	CPU_PROFILE_SCOPE("Mesh::Render");
+	material.Bind(shader, textureMask);
 
-	// Draw mesh
-	glBindVertexArray(VAO);
+	// Draw mesh. The VAO stays bound, the state cache skips the rebind when the next draw uses it again.
+	GLState::Get().BindVertexArray(VAO);
 	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
 }
 
 void Mesh::SetupMesh()
@@ -181,7 +176,7 @@ void Mesh::SetupMesh()
 	glGenBuffers(1, &VBO);
 	glGenBuffers(1, &IBO);
 
-	glBindVertexArray(VAO);
+	GLState::Get().BindVertexArray(VAO);
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
 
@@ -210,5 +205,5 @@ void Mesh::SetupMesh()
 		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
 	}
 	// Unbind VAO
-	glBindVertexArray(0);
+	GLState::Get().BindVertexArray(0);
 }
\ No newline at end of file
@@ -17,7 +17,12 @@
 #include <GL/glew.h>
 
 #include "mesh.h"
+#include "material.h"
 #include "shader.h"
+#include "cpu_profiler.h"
+#include "frustum_culling.h"
+#include "bvh.h"
+#include "occlusion_culling.h"
 
 unsigned int TextureFromFile(const char* path, const std::string& directory);
 
@@ -28,25 +33,84 @@ public:
 
 	Model(const std::string& _filePath) {
 		LoadModel(_filePath);
+		bounds = CalculateAABB();
+		BuildTriangleBVHs();
 	}
 
     // Draws the model using the provided shader.
     //
     // Usage:
     //   - To draw the model using only specific types of textures:
-    //       model.Draw(shader, {"texture_diffuse", "texture_specular"});
+    //       model.Render(shader, TEXTURE_DIFFUSE_BIT | TEXTURE_SPECULAR_BIT);
     //   - To draw the model using all available textures:
-    //       model.Draw(shader);
+    //       model.Render(shader);
     //
-	void Render(Shader& _shader, const std::vector<std::string>& textureTypeToUse = {}) {
+	void Render(Shader& _shader, unsigned int textureMask = TEXTURE_ALL_BITS) {
+		CPU_PROFILE_SCOPE("Model::Render");
 		for (size_t i = 0; i < meshes.size(); i++)
-			meshes[i].Render(_shader, textureTypeToUse);
+			meshes[i].Render(_shader, textureMask);
+	}
+
+	// Draws only the meshes whose bounds, transformed by _model, intersect _frustum and, given an _occlusion buffer,
+	// are not hidden behind its occluders.
+	// The caller still sets the "model" uniform as usual; tested/visible meshes are counted in FrustumCuller.
+	void Render(Shader& _shader, const glm::mat4& _model, const Frustum& _frustum, unsigned int textureMask = TEXTURE_ALL_BITS,
+		const OcclusionBuffer* _occlusion = nullptr) {
+		CPU_PROFILE_SCOPE("Model::Render");
+		meshBounds.Clear();
+		for (const Mesh& mesh : meshes)
+			meshBounds.AddBox(mesh.boundsMin, mesh.boundsMax, _model);
+		size_t visibleCount = meshes.size();
+		if (FrustumCuller::Get().enabled)
+			visibleCount = meshBounds.Cull(_frustum, meshVisible);
+		else
+			meshVisible.assign(meshes.size(), 1);
+		FrustumCuller::Get().Count(meshes.size(), visibleCount);
+
+		for (size_t i = 0; i < meshes.size(); i++) {
+			if (!meshVisible[i])
+				continue;
+			if (_occlusion) {
+				AABB box = AABB::Transformed(meshes[i].boundsMin, meshes[i].boundsMax, _model);
+				if (!_occlusion->TestBox(box.min, box.max))
+					continue;
+			}
+			meshes[i].Render(_shader, textureMask);
+		}
+	}
+
+	// Queues every mesh with the same model matrix instead of drawing them now (see RenderQueue).
+	void Submit(RenderQueue& queue, unsigned int pass, Shader& _shader, const glm::mat4& model,
+		unsigned int textureMask = TEXTURE_ALL_BITS) const {
+		for (size_t i = 0; i < meshes.size(); i++)
+			meshes[i].Submit(queue, pass, _shader, model, textureMask);
 	}
 
 	const std::vector<Mesh>& GetMesh() const{
 		return meshes;
 	}
 
+	// Local AABB of the whole model, computed once at load time.
+	const std::pair<glm::vec3, glm::vec3>& GetBounds() const { return bounds; }
+
+	// Closest triangle hit by _localRay (in the model's local space, see Ray::Transformed) closer than _hit.distance.
+	// Fills distance, mesh and triangle of _hit and returns true if there is one.
+	bool Raycast(const Ray& _localRay, RayHit& _hit) const {
+		bool found = false;
+		for (size_t i = 0; i < meshBVHs.size(); i++) {
+			if (_localRay.IntersectBox(meshes[i].boundsMin, meshes[i].boundsMax, _hit.distance) == FLT_MAX)
+				continue;
+			if (meshBVHs[i].Raycast(_localRay, _hit)) {
+				_hit.mesh = (unsigned int)i;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	// Time spent building the per-mesh triangle BVHs at load time.
+	float GetBVHBuildMilliseconds() const { return bvhBuildMilliseconds; }
+
 	// CalculateAABB computes the Axis-Aligned Bounding Box (AABB) for the model.
     // It returns a pair of glm::vec3 representing the minimum and maximum vertex positions that define the AABB.
 	std::pair<glm::vec3, glm::vec3> CalculateAABB();
@@ -56,6 +120,8 @@ private:
 
 	void ProcessNode(aiNode* node, const aiScene* scene);
 
+	void BuildTriangleBVHs();
+
 	Mesh ProcessMesh(aiMesh* mesh, const aiScene* scene);
 
 	std::vector<Texture> LoadMaterialTextures(aiMaterial* mat, aiTextureType type,
@@ -67,6 +133,12 @@ private:
 	std::string directory;
 
 	bool firstTime = true; // the first time to load mesh
+
+	std::pair<glm::vec3, glm::vec3> bounds;
+	std::vector<TriangleBVH> meshBVHs; // one per mesh, for ray casts
+	float bvhBuildMilliseconds = 0.0f;
+	BoundsBatch meshBounds; // scratch for the culled Render()
+	std::vector<uint8_t> meshVisible;
 };
 
 std::pair<glm::vec3, glm::vec3> Model::CalculateAABB()
@@ -89,12 +161,33 @@ std::pair<glm::vec3, glm::vec3> Model::CalculateAABB()
 	return { minVertexPos, maxVertexPos };
 }
 
+// Builds one triangle BVH per mesh from the CPU copy of its vertices
+void Model::BuildTriangleBVHs()
+{
+	CPU_PROFILE_SCOPE("Model::BuildTriangleBVHs");
+	meshBVHs.resize(meshes.size());
+	std::vector<glm::vec3> positions;
+	bvhBuildMilliseconds = 0.0f;
+	for (size_t i = 0; i < meshes.size(); i++) {
+		positions.resize(meshes[i].vertices.size());
+		for (size_t v = 0; v < positions.size(); v++)
+			positions[v] = meshes[i].vertices[v].position;
+		meshBVHs[i].Build(positions, meshes[i].indices);
+		bvhBuildMilliseconds += meshBVHs[i].GetBuildMilliseconds();
+	}
+}
+
 // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
 void Model::LoadModel(const std::string& _filePath)
 {
+	CPU_PROFILE_SCOPE("Model::LoadModel");
 	Assimp::Importer import;
-	const aiScene* scene = import.ReadFile(_filePath, 
-		aiProcess_Triangulate | aiProcess_FlipUVs );
+	const aiScene* scene;
+	{
+		CPU_PROFILE_SCOPE("Assimp::Importer::ReadFile");
+		scene = import.ReadFile(_filePath,
+			aiProcess_Triangulate | aiProcess_FlipUVs);
+	}
 
 #ifdef _DEBUG
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
@@ -130,9 +223,10 @@ inline void Model::ProcessNode(aiNode* currentNode, const aiScene* scene)
 // Retriving information from aiMesh and aiScene, converting all to our own Mesh
 inline Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
 {
+	CPU_PROFILE_SCOPE("Model::ProcessMesh");
 	std::vector<Vertex>vertices;
 	std::vector<unsigned int>indices;
-	std::vector<Texture>textures;
+	Material material;
 	bool hasTangentsAndBitangents = mesh->HasTangentsAndBitangents();
 
 	// Process vertices
@@ -169,22 +263,26 @@ inline Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
 		}
 	}
 
-	// Process textures based on shader naming conventions
+	// Process textures into the fixed material slots, only the first texture of each type is used
 	if (mesh->mMaterialIndex >= 0) {
-		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+		aiMaterial* aiMat = scene->mMaterials[mesh->mMaterialIndex];
 
 		// 1. diffuse maps
-		std::vector<Texture> diffuseMaps = LoadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+		std::vector<Texture> diffuseMaps = LoadMaterialTextures(aiMat, aiTextureType_DIFFUSE, "texture_diffuse");
+		if (!diffuseMaps.empty())
+			material.SetTexture(MATERIAL_SLOT_DIFFUSE, diffuseMaps[0].id);
 		// 2. specular maps
-		std::vector<Texture> specularMaps = LoadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+		std::vector<Texture> specularMaps = LoadMaterialTextures(aiMat, aiTextureType_SPECULAR, "texture_specular");
+		if (!specularMaps.empty())
+			material.SetTexture(MATERIAL_SLOT_SPECULAR, specularMaps[0].id);
 		// 3. normal maps
-		std::vector<Texture> normalMaps = LoadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+		std::vector<Texture> normalMaps = LoadMaterialTextures(aiMat, aiTextureType_HEIGHT, "texture_normal");
+		if (!normalMaps.empty())
+			material.SetTexture(MATERIAL_SLOT_NORMAL, normalMaps[0].id);
 		// 4. height maps
-		std::vector<Texture> heightMaps = LoadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+		std::vector<Texture> heightMaps = LoadMaterialTextures(aiMat, aiTextureType_AMBIENT, "texture_height");
+		if (!heightMaps.empty())
+			material.SetTexture(MATERIAL_SLOT_HEIGHT, heightMaps[0].id);
 	}
 
 #ifdef  _DEBUG
@@ -194,7 +292,7 @@ inline Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene)
 	}
 #endif 
 
-	return Mesh(vertices, indices, textures, hasTangentsAndBitangents);
+	return Mesh(vertices, indices, material, hasTangentsAndBitangents);
 }
 
 // Return a vector contains Texture, retriving texture information from aiMaterial to our own textures and textures_loaded
@@ -237,6 +335,7 @@ inline std::vector<Texture> Model::LoadMaterialTextures(aiMaterial* mat, aiTextu
 // Load a texture and return the actual id.
 unsigned int TextureFromFile(const char* path, const std::string& directory)
 {
+	CPU_PROFILE_SCOPE("TextureFromFile");
 	// Directory + filepath 
 	std::string filename = std::string(path);
 	filename = directory + '/' + filename;
@@ -252,7 +351,7 @@ unsigned int TextureFromFile(const char* path, const std::string& directory)
 		if (nrComponents == 3) format = GL_RGB;
 		if (nrComponents == 4) format = GL_RGBA;
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -7,6 +7,11 @@
 #include "camera.h"
 #include "model.h"
 #include "shader.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "benchmark.h"
+#include "uniform_buffer.h"
 
 // Function declarations
 void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT);
@@ -31,13 +36,17 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char** argv)
 {
+	// --benchmark runs a fixed, hidden, vsync-off camera loop and writes benchmark_normal_map.json
+	Benchmark benchmark("normal_map", argc, argv);
+
 	// glfw & glew configs
 	GLFWwindow* window = nullptr;
 	try {
 		if (!glfwInit())
 			throw std::runtime_error("failed to init glfw");
+		benchmark.ApplyWindowHints();
 		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "hnzz", nullptr, nullptr);
 		if (!window)
 			throw std::runtime_error("failed to create window");
@@ -50,10 +59,11 @@ int main()
 
 		if (glewInit() != GLEW_OK)
 			throw std::runtime_error("failed to init glew");
+		benchmark.ConfigureContext();
 
 		// OpenGL global status settings here
-		glEnable(GL_DEPTH_TEST);
-		glEnable(GL_CULL_FACE);
+		GLState::Get().Enable(GL_DEPTH_TEST);
+		GLState::Get().Enable(GL_CULL_FACE);
 	}
 	catch (const std::runtime_error& e) {
 		std::cerr << e.what() << std::endl;
@@ -65,8 +75,8 @@ int main()
 	unsigned int texture_normal = LoadTexture("res/textures/brickwall_normal.jpg");
 
 	// Shader configs
-	Shader shader("res/shaders/normal_map.vs", "res/shaders/normal_map.fs");
-	Shader lightShader("res/shaders/light.vs", "res/shaders/light.fs");
+	Shader shader(SHADER_NORMAL_MAP_VS, SHADER_NORMAL_MAP_FS);
+	Shader lightShader(SHADER_LIGHT_VS, SHADER_LIGHT_FS);
 
 	// Bind texture units
 	shader.Bind();
@@ -76,16 +86,26 @@ int main()
 	// lighting info
 	glm::vec3 lightPos(5.0f, 5.0f, -3.5f);
 
+	// Shared per-frame uniform blocks
+	FrameConstants frameConstants;
+
 	int counter = 0;
 	const int maxPrints = 50;
-	while (!glfwWindowShouldClose(window)) {
+	while (!glfwWindowShouldClose(window) && benchmark.NextFrame(camera)) {
+		// Publish last frame's state-cache counters and start counting this frame
+		GLState::Get().NewFrame();
+		// Read back the GPU timings of an older frame and start recording this one
+		GpuProfiler::Get().BeginFrame();
+		// Build the CPU call tree of the previous frame
+		CpuProfiler::Get().NewFrame();
+
 		// Per-frame logic
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
 		// fps printing
-		if (counter < maxPrints) {
+		if (counter < maxPrints && !benchmark.IsRunning()) {
 			std::cout << "fps: " << 1.0f / deltaTime << "\n";
 			counter++;
 		}
@@ -98,41 +118,48 @@ int main()
 		ProcessInput(window);
 
 		// Render our squad using normal and diffuse map
+		GpuProfiler::Get().Begin("normal mapped quad");
 		shader.Bind();
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture_diffuse);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture_normal);
+		GLState::Get().ActiveTexture(GL_TEXTURE0);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, texture_diffuse);
+		GLState::Get().ActiveTexture(GL_TEXTURE1);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, texture_normal);
 
 		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 		glm::mat4 view = camera.GetViewMatrix();
 		glm::mat4 model = glm::mat4(1.0f);
 		model = glm::rotate(model, glm::radians(-45.0f), glm::vec3(1, 0, 0));
 
-		shader.SetMat4("projection", projection);
-		shader.SetMat4("view", view);
+		frameConstants.SetCamera(projection, view, camera.position);
 		shader.SetMat4("model", model);
 		shader.SetVec3("lightPos", lightPos);
-		shader.SetVec3("viewPos", camera.position);
 		shader.SetFloat("lightIntensity", 2.3f);
 		RenderQuad();
+		GpuProfiler::Get().End();
 
 		// Render the light source for debugging
+		GpuProfiler::Get().Begin("light source");
 		lightShader.Bind();
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, lightPos);
 		model = glm::scale(model, glm::vec3(0.2f));
 
-		lightShader.SetMat4("projection", projection);
-		lightShader.SetMat4("view", view);
 		lightShader.SetMat4("model", model);
 		RenderCube();
+		GpuProfiler::Get().End();
+
+		GpuProfiler::Get().EndFrame();
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-		glfwSwapBuffers(window);
+		{
+			CPU_PROFILE_SCOPE("glfwSwapBuffers"); // includes the vsync wait
+			glfwSwapBuffers(window);
+		}
 		glfwPollEvents();
 	}
 
+	benchmark.Finish();
+
 	glfwTerminate();
 }
 
@@ -141,7 +168,7 @@ void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT
 {
 	// make sure the viewport matches the new window dimensions; note that SCR_WIDTH and 
 	// SCR_HEIGHT will be significantly larger than specified on retina displays.
-	glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+	GLState::Get().Viewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -185,6 +212,11 @@ void ProcessInput(GLFWwindow* window)
 		camera.ProcessKeyboard(LEFT, deltaTime);
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
 		camera.ProcessKeyboard(RIGHT, deltaTime);
+
+	// Print the GPU pass timings and write them to gpu_profile.csv by pressing P
+	GpuProfiler::Get().ReportOnKey(glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS);
+	// Write the CPU trace (chrome://tracing, ui.perfetto.dev) to cpu_trace.json by pressing T
+	CpuProfiler::Get().ExportOnKey(glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS);
 }
 
 // Utility function for loading a 2D texture from file
@@ -204,7 +236,7 @@ unsigned int LoadTexture(const std::string& path)
 		else if (nrComponents == 4)
 			format = GL_RGBA;
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -250,7 +282,7 @@ void RenderQuad()
 	glGenBuffers(1, &VBO);
 	glGenBuffers(1, &EBO);
 
-	glBindVertexArray(VAO);
+	GLState::Get().BindVertexArray(VAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
@@ -279,12 +311,12 @@ void RenderQuad()
 	glEnableVertexAttribArray(4);
 
 	// Render the quad
-	glBindVertexArray(VAO);
+	GLState::Get().BindVertexArray(VAO);
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
+	GLState::Get().BindVertexArray(0);
 
 	// Delete the VAO and VBOs
-	glDeleteVertexArrays(1, &VAO);
+	GLState::Get().DeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 	glDeleteBuffers(1, &EBO);
 }
@@ -348,7 +380,7 @@ void RenderCube()
 		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 		// link vertex attributes
-		glBindVertexArray(cubeVAO);
+		GLState::Get().BindVertexArray(cubeVAO);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(1);
@@ -356,10 +388,9 @@ void RenderCube()
 		glEnableVertexAttribArray(2);
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		GLState::Get().BindVertexArray(0);
 	}
 	// render Cube
-	glBindVertexArray(cubeVAO);
+	GLState::Get().BindVertexArray(cubeVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
 }
\ No newline at end of file
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "gl_state.h"
+#include "frustum_culling.h"
+#include "job_system.h"
+#include "cpu_profiler.h"
+#include "timer.h"
+
+#if defined(FRUSTUM_CULLING_AVX) || defined(FRUSTUM_CULLING_SSE)
+#include <emmintrin.h>
+#define OCCLUSION_CULLING_SSE
+#endif
+
+// Per-frame counters of the occlusion tests.
+struct OcclusionCounters
+{
+	unsigned int triangles = 0; // occluder triangles binned (after clipping)
+	unsigned int tested = 0;
+	unsigned int occluded = 0;
+	float rasterizeMilliseconds = 0.0f; // transform + binning + rasterization
+};
+
+// The OcclusionBuffer class is a small CPU depth buffer for software occlusion culling. A few large occluders (walls,
+// simplified meshes) are rasterized into it each frame, then the screen-space bounds of every draw are tested against
+// it before submission, so objects hidden behind the occluders never reach the GPU.
+//
+// The buffer is split into tiles. Occluder triangles are clipped against the near plane, set up as edge functions and
+// binned into the tiles they touch; the tiles are then rasterized in parallel on the JobSystem, 4 pixels per SSE2
+// instruction, so no two threads ever write the same memory. Every tile keeps the farthest depth it contains, which
+// lets most tests finish at tile granularity, like the hierarchical depth of masked occlusion culling, without
+// reading single pixels.
+//
+// Depth is NDC z mapped to [0, 1], 1 = nothing rasterized. Tests are conservative: a box crossing the near plane, or
+// with any covered pixel not behind the occluders, is visible.
+//
+// Usage Example:
+// OcclusionBuffer occlusion;                        // 320 x 192 by default
+// occlusion.Begin(projection * view);               // once per frame
+// occlusion.AddBox(glm::vec3(-1.0f), glm::vec3(1.0f), wallModel);
+// occlusion.Rasterize();
+// if (occlusion.TestBox(worldMin, worldMax)) Draw();
+class OcclusionBuffer
+{
+public:
+	static constexpr int TILE_WIDTH = 32;
+	static constexpr int TILE_HEIGHT = 16;
+
+	// Toggles the tests (TestBox() then reports everything visible); occluders are still rasterized for the debug view.
+	bool enabled = true;
+
+	OcclusionBuffer(int _width = 320, int _height = 192)
+	{
+		Resize(_width, _height);
+	}
+
+	~OcclusionBuffer()
+	{
+		if (debugTexture)
+			GLState::Get().DeleteTextures(1, &debugTexture);
+	}
+
+	OcclusionBuffer(const OcclusionBuffer&) = delete;
+	OcclusionBuffer& operator=(const OcclusionBuffer&) = delete;
+
+	// Rounded up to whole tiles.
+	void Resize(int _width, int _height)
+	{
+		tilesX = std::max(1, (_width + TILE_WIDTH - 1) / TILE_WIDTH);
+		tilesY = std::max(1, (_height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+		width = tilesX * TILE_WIDTH;
+		height = tilesY * TILE_HEIGHT;
+		depth.assign((size_t)width * height, 1.0f);
+		tileMaxDepth.assign((size_t)tilesX * tilesY, 1.0f);
+		tileBins.assign((size_t)tilesX * tilesY, std::vector<unsigned int>());
+	}
+
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+
+	// Starts a frame: publishes the last frame's counters and clears the occluders.
+	void Begin(const glm::mat4& _viewProjection)
+	{
+		lastFrameCounters.triangles = (unsigned int)triangles.size();
+		lastFrameCounters.tested = tested.exchange(0, std::memory_order_relaxed);
+		lastFrameCounters.occluded = occluded.exchange(0, std::memory_order_relaxed);
+		lastFrameCounters.rasterizeMilliseconds = rasterizeMilliseconds;
+		rasterizeMilliseconds = 0.0f;
+
+		viewProjection = _viewProjection;
+		triangles.clear();
+		for (std::vector<unsigned int>& bin : tileBins)
+			bin.clear();
+	}
+
+	// Occluder mesh in local space, placed by _model. Both faces are rasterized.
+	void AddOccluder(const std::vector<glm::vec3>& _positions, const std::vector<unsigned int>& _indices, const glm::mat4& _model)
+	{
+		AddOccluder(_positions.data(), _positions.size(), _indices.data(), _indices.size(), _model);
+	}
+
+	void AddOccluder(const glm::vec3* _positions, size_t _positionCount, const unsigned int* _indices, size_t _indexCount, const glm::mat4& _model)
+	{
+		long long start = Timer::nowNanoseconds();
+		glm::mat4 modelViewProjection = viewProjection * _model;
+		clipPositions.resize(_positionCount);
+		for (size_t i = 0; i < _positionCount; i++)
+			clipPositions[i] = modelViewProjection * glm::vec4(_positions[i], 1.0f);
+		for (size_t i = 0; i + 2 < _indexCount; i += 3)
+			ClipAndBin(clipPositions[_indices[i]], clipPositions[_indices[i + 1]], clipPositions[_indices[i + 2]]);
+		rasterizeMilliseconds += (Timer::nowNanoseconds() - start) / 1000000.0f;
+	}
+
+	// Box occluder (_min/_max in local space, placed by _model): walls, floors, simplified stand-ins.
+	void AddBox(const glm::vec3& _min, const glm::vec3& _max, const glm::mat4& _model)
+	{
+		static const unsigned int boxIndices[36] = {
+			0, 1, 3, 0, 3, 2,  4, 6, 7, 4, 7, 5,  0, 4, 5, 0, 5, 1,
+			2, 3, 7, 2, 7, 6,  0, 2, 6, 0, 6, 4,  1, 5, 7, 1, 7, 3
+		};
+		glm::vec3 corners[8];
+		for (int i = 0; i < 8; i++)
+			corners[i] = glm::vec3(i & 4 ? _max.x : _min.x, i & 2 ? _max.y : _min.y, i & 1 ? _max.z : _min.z);
+		AddOccluder(corners, 8, boxIndices, 36, _model);
+	}
+
+	// Rasterizes the binned occluders, one tile per job.
+	void Rasterize()
+	{
+		CPU_PROFILE_SCOPE("OcclusionBuffer::Rasterize");
+		long long start = Timer::nowNanoseconds();
+		JobSystem::Get().ParallelFor(tileBins.size(), 1, [&](size_t begin, size_t end, unsigned int) {
+			for (size_t tile = begin; tile < end; tile++)
+				RasterizeTile((int)tile);
+		});
+		rasterizeMilliseconds += (Timer::nowNanoseconds() - start) / 1000000.0f;
+	}
+
+	// World-space box test, true if any part of it may be visible. Thread safe once Rasterize() returned.
+	bool TestBox(const glm::vec3& _min, const glm::vec3& _max) const
+	{
+		if (!enabled)
+			return true;
+		tested.fetch_add(1, std::memory_order_relaxed);
+
+		glm::vec2 screenMin(FLT_MAX), screenMax(-FLT_MAX);
+		float nearestDepth = FLT_MAX;
+		for (int i = 0; i < 8; i++) {
+			glm::vec4 clip = viewProjection * glm::vec4(i & 4 ? _max.x : _min.x, i & 2 ? _max.y : _min.y, i & 1 ? _max.z : _min.z, 1.0f);
+			if (clip.z < -clip.w || clip.w <= 0.0f)
+				return true; // crosses the near plane, the projected bounds are meaningless
+			glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			glm::vec2 screen = ToScreen(ndc);
+			screenMin = glm::min(screenMin, screen);
+			screenMax = glm::max(screenMax, screen);
+			nearestDepth = std::min(nearestDepth, 0.5f * ndc.z + 0.5f);
+		}
+
+		// Every pixel the rectangle touches, so the test stays conservative
+		int x0 = std::max(0, (int)std::floor(screenMin.x)), x1 = std::min(width, (int)std::ceil(screenMax.x));
+		int y0 = std::max(0, (int)std::floor(screenMin.y)), y1 = std::min(height, (int)std::ceil(screenMax.y));
+		if (x0 >= x1 || y0 >= y1)
+			return true; // off screen, that is the frustum test's business
+
+		for (int tileY = y0 / TILE_HEIGHT; tileY <= (y1 - 1) / TILE_HEIGHT; tileY++) {
+			for (int tileX = x0 / TILE_WIDTH; tileX <= (x1 - 1) / TILE_WIDTH; tileX++) {
+				// Whole tile behind the occluders: nothing to read
+				if (nearestDepth > tileMaxDepth[tileY * tilesX + tileX])
+					continue;
+				int left = std::max(x0, tileX * TILE_WIDTH), right = std::min(x1, (tileX + 1) * TILE_WIDTH);
+				int bottom = std::max(y0, tileY * TILE_HEIGHT), top = std::min(y1, (tileY + 1) * TILE_HEIGHT);
+				for (int y = bottom; y < top; y++) {
+					const float* row = &depth[(size_t)y * width];
+					for (int x = left; x < right; x++) {
+						if (nearestDepth <= row[x])
+							return true;
+					}
+				}
+			}
+		}
+		occluded.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	const OcclusionCounters& GetFrameCounters() const { return lastFrameCounters; }
+
+	// Copies the depth into a GL texture for display (GL thread), nearer = brighter. Returns the texture id.
+	unsigned int UpdateDebugTexture()
+	{
+		if (!debugTexture) {
+			glGenTextures(1, &debugTexture);
+			GLState::Get().BindTexture(GL_TEXTURE_2D, debugTexture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+
+		// NDC depth crowds near 1, stretch the written range so the occluders are readable
+		float nearest = 1.0f;
+		for (float value : depth)
+			nearest = std::min(nearest, value);
+		float scale = nearest < 1.0f ? 1.0f / (1.0f - nearest) : 0.0f;
+		debugPixels.resize(depth.size());
+		for (size_t i = 0; i < depth.size(); i++)
+			debugPixels[i] = (unsigned char)(255.0f * (1.0f - depth[i]) * scale);
+
+		GLState::Get().BindTexture(GL_TEXTURE_2D, debugTexture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, debugPixels.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		return debugTexture;
+	}
+
+private:
+	// A binned triangle: three edge functions E(x, y) = a * x + b * y + c, >= 0 inside, and its depth plane,
+	// all evaluated at pixel centers.
+	struct Triangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3];
+		float depthA, depthB, depthC;
+		int minX, minY, maxX, maxY; // pixel bounds, max exclusive
+	};
+
+	glm::vec2 ToScreen(const glm::vec3& _ndc) const
+	{
+		return glm::vec2((0.5f * _ndc.x + 0.5f) * width, (0.5f * _ndc.y + 0.5f) * height);
+	}
+
+	// Clips against the near plane (z >= -w) and bins what is left.
+	void ClipAndBin(const glm::vec4& _a, const glm::vec4& _b, const glm::vec4& _c)
+	{
+		// Trivially outside one of the side planes
+		for (int axis = 0; axis < 2; axis++) {
+			if (_a[axis] > _a.w && _b[axis] > _b.w && _c[axis] > _c.w)
+				return;
+			if (_a[axis] < -_a.w && _b[axis] < -_b.w && _c[axis] < -_c.w)
+				return;
+		}
+
+		const glm::vec4* input[3] = { &_a, &_b, &_c };
+		glm::vec4 polygon[4];
+		int count = 0;
+		for (int i = 0; i < 3; i++) {
+			const glm::vec4& current = *input[i];
+			const glm::vec4& next = *input[(i + 1) % 3];
+			float currentDistance = current.z + current.w, nextDistance = next.z + next.w;
+			if (currentDistance >= 0.0f)
+				polygon[count++] = current;
+			if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+				polygon[count++] = glm::mix(current, next, currentDistance / (currentDistance - nextDistance));
+		}
+		for (int i = 1; i + 1 < count; i++)
+			SetupTriangle(polygon[0], polygon[i], polygon[i + 1]);
+	}
+
+	void SetupTriangle(const glm::vec4& _a, const glm::vec4& _b, const glm::vec4& _c)
+	{
+		glm::vec3 screen[3];
+		const glm::vec4* clip[3] = { &_a, &_b, &_c };
+		for (int i = 0; i < 3; i++) {
+			glm::vec3 ndc = glm::vec3(*clip[i]) / std::max(clip[i]->w, 1e-6f);
+			screen[i] = glm::vec3(ToScreen(ndc), 0.5f * ndc.z + 0.5f);
+		}
+
+		float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+		if (std::abs(area) < 1e-8f)
+			return;
+		if (area < 0.0f) {
+			// Both faces are occluders, make it counter-clockwise
+			std::swap(screen[1], screen[2]);
+			area = -area;
+		}
+
+		Triangle triangle;
+		float minX = std::min(std::min(screen[0].x, screen[1].x), screen[2].x);
+		float maxX = std::max(std::max(screen[0].x, screen[1].x), screen[2].x);
+		float minY = std::min(std::min(screen[0].y, screen[1].y), screen[2].y);
+		float maxY = std::max(std::max(screen[0].y, screen[1].y), screen[2].y);
+		triangle.minX = std::max(0, (int)std::floor(minX));
+		triangle.minY = std::max(0, (int)std::floor(minY));
+		triangle.maxX = std::min(width, (int)std::ceil(maxX));
+		triangle.maxY = std::min(height, (int)std::ceil(maxY));
+		if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY)
+			return;
+
+		// Edge i is opposite to vertex i; evaluated at pixel centers (x + 0.5, y + 0.5)
+		for (int i = 0; i < 3; i++) {
+			const glm::vec3& from = screen[(i + 1) % 3];
+			const glm::vec3& to = screen[(i + 2) % 3];
+			triangle.edgeA[i] = from.y - to.y;
+			triangle.edgeB[i] = to.x - from.x;
+			triangle.edgeC[i] = from.x * to.y - from.y * to.x + 0.5f * (triangle.edgeA[i] + triangle.edgeB[i]);
+		}
+
+		// NDC depth is linear in screen space: z = z0 * e0 / area + z1 * e1 / area + z2 * e2 / area
+		triangle.depthA = triangle.depthB = triangle.depthC = 0.0f;
+		for (int i = 0; i < 3; i++) {
+			float weight = screen[i].z / area;
+			triangle.depthA += weight * triangle.edgeA[i];
+			triangle.depthB += weight * triangle.edgeB[i];
+			triangle.depthC += weight * triangle.edgeC[i];
+		}
+
+		unsigned int index = (unsigned int)triangles.size();
+		triangles.push_back(triangle);
+		for (int tileY = triangle.minY / TILE_HEIGHT; tileY <= (triangle.maxY - 1) / TILE_HEIGHT; tileY++) {
+			for (int tileX = triangle.minX / TILE_WIDTH; tileX <= (triangle.maxX - 1) / TILE_WIDTH; tileX++)
+				tileBins[tileY * tilesX + tileX].push_back(index);
+		}
+	}
+
+	void RasterizeTile(int _tile)
+	{
+		int tileX = _tile % tilesX, tileY = _tile / tilesX;
+		int tileLeft = tileX * TILE_WIDTH, tileBottom = tileY * TILE_HEIGHT;
+		for (int y = tileBottom; y < tileBottom + TILE_HEIGHT; y++)
+			std::fill_n(&depth[(size_t)y * width + tileLeft], TILE_WIDTH, 1.0f);
+
+		for (unsigned int index : tileBins[_tile]) {
+			const Triangle& triangle = triangles[index];
+			// Left edge rounded down to 4 pixels; the extra pixels are in the same tile and fail the edge tests
+			int left = std::max(triangle.minX, tileLeft) & ~3;
+			int right = std::min(triangle.maxX, tileLeft + TILE_WIDTH);
+			int bottom = std::max(triangle.minY, tileBottom), top = std::min(triangle.maxY, tileBottom + TILE_HEIGHT);
+			for (int y = bottom; y < top; y++) {
+				float* row = &depth[(size_t)y * width];
+#if defined(OCCLUSION_CULLING_SSE)
+				const __m128 offsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+				__m128 edgeRow[3], edgeStep[3];
+				for (int i = 0; i < 3; i++) {
+					edgeRow[i] = _mm_set1_ps(triangle.edgeB[i] * y + triangle.edgeC[i]);
+					edgeStep[i] = _mm_set1_ps(triangle.edgeA[i]);
+				}
+				__m128 depthRow = _mm_set1_ps(triangle.depthB * y + triangle.depthC);
+				__m128 depthStep = _mm_set1_ps(triangle.depthA);
+				for (int x = left; x < right; x += 4) {
+					__m128 xs = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+					__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeStep[0], xs), edgeRow[0]), _mm_setzero_ps());
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeStep[1], xs), edgeRow[1]), _mm_setzero_ps()));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeStep[2], xs), edgeRow[2]), _mm_setzero_ps()));
+					if (_mm_movemask_ps(inside) == 0)
+						continue;
+					__m128 current = _mm_loadu_ps(row + x);
+					__m128 nearest = _mm_min_ps(current, _mm_add_ps(_mm_mul_ps(depthStep, xs), depthRow));
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+				}
+#else
+				for (int x = left; x < right; x++) {
+					bool inside = true;
+					for (int i = 0; i < 3; i++)
+						inside = inside && triangle.edgeA[i] * x + triangle.edgeB[i] * y + triangle.edgeC[i] >= 0.0f;
+					if (inside)
+						row[x] = std::min(row[x], triangle.depthA * x + triangle.depthB * y + triangle.depthC);
+				}
+#endif
+			}
+		}
+
+		float farthest = 0.0f;
+		for (int y = tileBottom; y < tileBottom + TILE_HEIGHT; y++) {
+			const float* row = &depth[(size_t)y * width + tileLeft];
+			farthest = std::max(farthest, *std::max_element(row, row + TILE_WIDTH));
+		}
+		tileMaxDepth[_tile] = farthest;
+	}
+
+private:
+	int width = 0, height = 0;
+	int tilesX = 0, tilesY = 0;
+	std::vector<float> depth;        // row-major, row 0 at the bottom like GL
+	std::vector<float> tileMaxDepth; // farthest depth per tile
+	std::vector<std::vector<unsigned int>> tileBins;
+	std::vector<Triangle> triangles;
+	std::vector<glm::vec4> clipPositions; // AddOccluder scratch
+
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	mutable std::atomic<unsigned int> tested{ 0 }, occluded{ 0 };
+	float rasterizeMilliseconds = 0.0f;
+	OcclusionCounters lastFrameCounters;
+
+	unsigned int debugTexture = 0;
+	std::vector<unsigned char> debugPixels;
+};
@@ -7,6 +7,11 @@
 #include "camera.h"
 #include "model.h"
 #include "shader.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "benchmark.h"
+#include "uniform_buffer.h"
 
 // Function declarations
 void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT);
@@ -33,13 +38,17 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char** argv)
 {
+	// --benchmark runs a fixed, hidden, vsync-off camera loop and writes benchmark_parallax_map.json
+	Benchmark benchmark("parallax_map", argc, argv);
+
 	// glfw & glew configs
 	GLFWwindow* window = nullptr;
 	try {
 		if (!glfwInit())
 			throw std::runtime_error("failed to init glfw");
+		benchmark.ApplyWindowHints();
 		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "hnzz", nullptr, nullptr);
 		if (!window)
 			throw std::runtime_error("failed to create window");
@@ -52,9 +61,10 @@ int main()
 
 		if (glewInit() != GLEW_OK)
 			throw std::runtime_error("failed to init glew");
+		benchmark.ConfigureContext();
 
 		// OpenGL global status settings here
-		glEnable(GL_DEPTH_TEST);
+		GLState::Get().Enable(GL_DEPTH_TEST);
 		//glEnable(GL_CULL_FACE);
 	}
 	catch (const std::runtime_error& e) {
@@ -63,8 +73,8 @@ int main()
 	}
 
 	// Build & compile shader(s)
-	Shader shader("res/shaders/parallax_map.vs", "res/shaders/parallax_map.fs");
-	Shader lightShader("res/shaders/light.vs", "res/shaders/light.fs");
+	Shader shader(SHADER_PARALLAX_MAP_VS, SHADER_PARALLAX_MAP_FS);
+	Shader lightShader(SHADER_LIGHT_VS, SHADER_LIGHT_FS);
 
 	// Load texture(s)
 	unsigned int diffuseMap = LoadTexture("res/textures/bricks2.jpg");
@@ -76,7 +86,7 @@ int main()
 	shader.SetInt("diffuseMap", 0);
 	shader.SetInt("normalMap", 1);
 	shader.SetInt("depthMap", 2);
-	shader.SetUniformBlock("LightProperties", 0);
+	shader.SetUniformBlock("LightProperties", USER_BLOCK_BINDING);
 
 	// lighting info
 	glm::vec3 lightPos(0.5f, 0.5f, 0.2f);
@@ -90,19 +100,29 @@ int main()
 	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
 	glBufferData(GL_UNIFORM_BUFFER, 4 * sizeof(float), lightProperties, GL_STATIC_DRAW); // 4 floats for lightIntensity, constant, linear, quadratic
 	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-	glBindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
+	glBindBufferBase(GL_UNIFORM_BUFFER, USER_BLOCK_BINDING, UBO);
+
+	// Shared per-frame uniform blocks
+	FrameConstants frameConstants;
 
 	int counter = 0;
 	const int maxPrints = 50;
 	//glPolygonMode(GL_FRONT, GL_LINE);
-	while (!glfwWindowShouldClose(window)) {
+	while (!glfwWindowShouldClose(window) && benchmark.NextFrame(camera)) {
+		// Publish last frame's state-cache counters and start counting this frame
+		GLState::Get().NewFrame();
+		// Read back the GPU timings of an older frame and start recording this one
+		GpuProfiler::Get().BeginFrame();
+		// Build the CPU call tree of the previous frame
+		CpuProfiler::Get().NewFrame();
+
 		// Per-frame logic
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
 		// fps printing
-		if (counter < maxPrints) {
+		if (counter < maxPrints && !benchmark.IsRunning()) {
 			std::cout << "fps: " << 1.0f / deltaTime << "\n";
 			counter++;
 		}
@@ -120,42 +140,49 @@ int main()
 		glm::mat4 model = glm::mat4(1.0f);
 		//model = glm::rotate(model, 0.1f * (float)glfwGetTime(), glm::vec3(1.0f, 0.0f, 0.0f));
 
+		frameConstants.SetCamera(projection, view, camera.position);
+
+		GpuProfiler::Get().Begin("parallax mapped quad");
 		shader.Bind();
-		shader.SetMat4("projection", projection);
-		shader.SetMat4("view", view);
 		shader.SetMat4("model", model);
-		
-		shader.SetVec3("viewPos", camera.position);
 		shader.SetVec3("lightPos", lightPos);
 		shader.SetFloat("height_scale", 0.1f);
 		shader.SetFloat("minLayers", 5.0f);
 		shader.SetFloat("maxLayers", 10.0f);
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, diffuseMap);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, normalMap);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, depthMap);
+		GLState::Get().ActiveTexture(GL_TEXTURE0);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, diffuseMap);
+		GLState::Get().ActiveTexture(GL_TEXTURE1);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, normalMap);
+		GLState::Get().ActiveTexture(GL_TEXTURE2);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, depthMap);
 
 		RenderQuad();
+		GpuProfiler::Get().End();
 
 		// Render light source
+		GpuProfiler::Get().Begin("light source");
 		lightShader.Bind();
 		model = glm::mat4(1.0f);
 		model = glm::translate(model, lightPos);
 		model = glm::scale(model, glm::vec3(0.05f));
 
-		lightShader.SetMat4("projection", projection);
-		lightShader.SetMat4("view", view);
 		lightShader.SetMat4("model", model);
 		RenderCube();
+		GpuProfiler::Get().End();
+
+		GpuProfiler::Get().EndFrame();
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-		glfwSwapBuffers(window);
+		{
+			CPU_PROFILE_SCOPE("glfwSwapBuffers"); // includes the vsync wait
+			glfwSwapBuffers(window);
+		}
 		glfwPollEvents();
 	}
 
+	benchmark.Finish();
+
 	glfwTerminate();
 }
 
@@ -164,7 +191,7 @@ void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT
 {
 	// make sure the viewport matches the new window dimensions; note that SCR_WIDTH and 
 	// SCR_HEIGHT will be significantly larger than specified on retina displays.
-	glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+	GLState::Get().Viewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -209,6 +236,11 @@ void ProcessInput(GLFWwindow* window)
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
 		camera.ProcessKeyboard(RIGHT, deltaTime);
 
+	// Print the GPU pass timings and write them to gpu_profile.csv by pressing P
+	GpuProfiler::Get().ReportOnKey(glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS);
+	// Write the CPU trace (chrome://tracing, ui.perfetto.dev) to cpu_trace.json by pressing T
+	CpuProfiler::Get().ExportOnKey(glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS);
+
 	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && !parallaxKeyPressed) {
 		parallax = !parallax;
 		parallaxKeyPressed = true;
@@ -235,7 +267,7 @@ unsigned int LoadTexture(const std::string& path)
 		else if (nrComponents == 4)
 			format = GL_RGBA;
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -281,7 +313,7 @@ void RenderQuad()
 	glGenBuffers(1, &VBO);
 	glGenBuffers(1, &EBO);
 
-	glBindVertexArray(VAO);
+	GLState::Get().BindVertexArray(VAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
@@ -310,12 +342,12 @@ void RenderQuad()
 	glEnableVertexAttribArray(4);
 
 	// Render the quad
-	glBindVertexArray(VAO);
+	GLState::Get().BindVertexArray(VAO);
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
+	GLState::Get().BindVertexArray(0);
 
 	// Delete the VAO and VBOs
-	glDeleteVertexArrays(1, &VAO);
+	GLState::Get().DeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 	glDeleteBuffers(1, &EBO);
 }
@@ -379,7 +411,7 @@ void RenderCube()
 		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 		// link vertex attributes
-		glBindVertexArray(cubeVAO);
+		GLState::Get().BindVertexArray(cubeVAO);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(1);
@@ -387,10 +419,9 @@ void RenderCube()
 		glEnableVertexAttribArray(2);
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		GLState::Get().BindVertexArray(0);
 	}
 	// render Cube
-	glBindVertexArray(cubeVAO);
+	GLState::Get().BindVertexArray(cubeVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
 }
\ No newline at end of file
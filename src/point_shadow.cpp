@@ -7,9 +7,16 @@
 #include "camera.h"
 #include "model.h"
 #include "shader.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "benchmark.h"
+#include "uniform_buffer.h"
+#include "render_target.h"
+#include "temporal.h"
 
 // Function declarations
-void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT);
+void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void ProcessInput(GLFWwindow* window);
@@ -19,10 +26,12 @@ void RenderCube();
 void RenderSphere();
 
 // Scene settings
-constexpr int SCR_WIDTH = 1920;
-constexpr int SCR_HEIGHT = 1080;
+int SCR_WIDTH = 1920;
+int SCR_HEIGHT = 1080;
 bool shadows = true;
 bool shadowKeyPressed = false;
+bool temporalShadows = false; // 4 rotated PCF taps per frame, accumulated over frames
+bool temporalKeyPressed = false;
 
 // Camera settings
 Camera camera(0.0f, 0.0f, 3.0f);
@@ -34,13 +43,17 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char** argv)
 {
+	// --benchmark runs a fixed, hidden, vsync-off camera loop and writes benchmark_point_shadow.json
+	Benchmark benchmark("point_shadow", argc, argv);
+
 	// glfw & glew configs
 	GLFWwindow* window = nullptr;
 	try {
 		if (!glfwInit())
 			throw std::runtime_error("failed to init glfw");
+		benchmark.ApplyWindowHints();
 		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "hnzz", nullptr, nullptr);
 		if (!window)
 			throw std::runtime_error("failed to create window");
@@ -53,50 +66,45 @@ int main()
 
 		if (glewInit() != GLEW_OK)
 			throw std::runtime_error("failed to init glew");
+		benchmark.ConfigureContext();
 
-		glEnable(GL_DEPTH_TEST);
-		glEnable(GL_CULL_FACE);
+		GLState::Get().Enable(GL_DEPTH_TEST);
+		GLState::Get().Enable(GL_CULL_FACE);
 	}
 	catch (const std::runtime_error& e) {
 		std::cerr << e.what() << std::endl;
 		return -1;
 	}
 
-	// Create & config cube map
-	unsigned int depthCubemap, depthCubeFBO;
-	const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-	glGenFramebuffers(1, &depthCubeFBO);
-	glGenTextures(1, &depthCubemap);
-
-	glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
-	for (size_t i = 0; i < 6; i++)
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, depthCubeFBO);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemap, 0);
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// Create & config depth cube map, all 6 faces are attached at once for layered rendering
+	const int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
+	RenderTarget depthCubeTarget({ { GL_DEPTH_COMPONENT24, SHADOW_WIDTH, SHADOW_HEIGHT, GL_NEAREST, 1, GL_CLAMP_TO_EDGE, true } });
+	unsigned int depthCubemap = depthCubeTarget.GetTexture(0);
 
 	// Shaders & textures configs
-	Shader shader("res/shaders/point_shadow.vs", "res/shaders/point_shadow.fs");
-	Shader simpleDepthShader("res/shaders/point_shadow_depth.vs", "res/shaders/point_shadow_depth.fs", "res/shaders/point_shadow_depth.gs");
-	Shader lightShader("res/shaders/light.vs", "res/shaders/light.fs");
+	Shader shader(SHADER_POINT_SHADOW_VS, SHADER_POINT_SHADOW_FS);
+	Shader simpleDepthShader(SHADER_POINT_SHADOW_DEPTH_VS, SHADER_POINT_SHADOW_DEPTH_FS, SHADER_POINT_SHADOW_DEPTH_GS);
+	Shader lightShader(SHADER_LIGHT_VS, SHADER_LIGHT_FS);
 	unsigned int woodTexture = LoadTexture("res/textures/wood.png");
 
 	shader.Bind();
 	shader.SetInt("diffuseTexture", 0);
 	shader.SetInt("depthMap", 1);
 
+	// Temporal filtering: the scene is rendered jittered into an offscreen target with velocity, taking 4 of the 20
+	// PCF taps per frame, and the resolve blends it with the reprojected history, which converges to the full filter
+	RenderTarget sceneTarget({ { GL_RGBA8, SCR_WIDTH, SCR_HEIGHT }, { GL_RG16F, SCR_WIDTH, SCR_HEIGHT }, { GL_DEPTH_COMPONENT24, SCR_WIDTH, SCR_HEIGHT } });
+	TemporalCamera temporalCamera;
+	TemporalHistory history({ GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, GL_LINEAR });
+	TemporalResolve temporalResolve;
+	const GLfloat zeroVelocity[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
 	// lighting info
 	glm::vec3 lightPos(0.0f, 0.0f, 0.0f);
 
+	// Shared per-frame uniform blocks
+	FrameConstants frameConstants;
+
 	// 0. create depth cubemap transformation matrices
 	float near_plane = 1.0f;
 	float far_plane = 25.0f;
@@ -116,7 +124,16 @@ int main()
 	for (int i = 0; i < 6; ++i) 
 		shadowTransforms.emplace_back(shadowProj * glm::lookAt(lightPos, lightPos + directions[i], upVectors[i]));	
 
-	while (!glfwWindowShouldClose(window)) {
+	while (!glfwWindowShouldClose(window) && benchmark.NextFrame(camera)) {
+		// Publish last frame's state-cache counters and start counting this frame
+		GLState::Get().NewFrame();
+		// Drop render targets that stayed idle since the last resize
+		RenderTargetPool::Get().NewFrame();
+		// Read back the GPU timings of an older frame and start recording this one
+		GpuProfiler::Get().BeginFrame();
+		// Build the CPU call tree of the previous frame
+		CpuProfiler::Get().NewFrame();
+
 		// Calculating deltaTime
 		float currentFrame = (float)glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
@@ -129,8 +146,8 @@ int main()
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// 1. render scene to depth cubemap
-		glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-		glBindFramebuffer(GL_FRAMEBUFFER, depthCubeFBO);
+		GpuProfiler::Get().Begin("shadow depth");
+		depthCubeTarget.Bind(); // also sets the viewport to the cube face size
 		glClear(GL_DEPTH_BUFFER_BIT);
 		simpleDepthShader.Bind();
 		for (unsigned int i = 0; i < 6; ++i)
@@ -139,43 +156,82 @@ int main()
 		simpleDepthShader.SetFloat("far_plane", far_plane);
 		simpleDepthShader.SetVec3("lightPos", lightPos);
 		RenderScene(simpleDepthShader);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GpuProfiler::Get().End();
+		GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
 
 		// 2. render scene as normal 
-		glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		shader.Bind();
 		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 		glm::mat4 view = camera.GetViewMatrix();
-		shader.SetMat4("projection", projection);
-		shader.SetMat4("view", view);
+		temporalCamera.jitter = temporalShadows;
+		temporalCamera.NewFrame(projection, view, SCR_WIDTH, SCR_HEIGHT);
+		if (temporalShadows) {
+			sceneTarget.Resize(SCR_WIDTH, SCR_HEIGHT);
+			history.Resize(SCR_WIDTH, SCR_HEIGHT);
+			sceneTarget.Bind();
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glClearBufferfv(GL_COLOR, 1, zeroVelocity);
+		}
+		else {
+			history.Invalidate(); // would be stale once temporal filtering is turned back on
+			GLState::Get().Viewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+		GpuProfiler::Get().Begin("lighting");
+		shader.Bind();
+		frameConstants.SetCamera(temporalCamera.GetProjection(), view, camera.position);
+		shader.SetMat4("viewProjection", temporalCamera.GetViewProjection());
+		shader.SetMat4("previousViewProjection", temporalCamera.GetPreviousViewProjection());
 		shader.SetVec3("lightPos", lightPos);
-		shader.SetVec3("viewPos", camera.position);
 		shader.SetInt("shadows", shadows); // enable/disable shadows by pressing 'SPACE'
 		shader.SetFloat("far_plane", far_plane);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, woodTexture);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
+		// The tap offset walks through all 20 taps every 5 frames
+		shader.SetInt("shadowSamples", temporalShadows ? 4 : 20);
+		shader.SetInt("shadowSampleOffset", temporalShadows ? (int)(temporalCamera.GetFrameIndex() % 5) * 4 : 0);
+		GLState::Get().ActiveTexture(GL_TEXTURE0);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, woodTexture);
+		GLState::Get().ActiveTexture(GL_TEXTURE1);
+		GLState::Get().BindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
 		RenderScene(shader);
+		GpuProfiler::Get().End();
 
 		// Light 
+		GpuProfiler::Get().Begin("light source");
 		lightShader.Bind();
 		glm::mat4 model_temp(1.0f);
 		model_temp = glm::translate(model_temp, lightPos);
 		model_temp = glm::scale(model_temp, glm::vec3(0.1f));
-		lightShader.SetMat4("projection", projection);
-		lightShader.SetMat4("view", view);
 		lightShader.SetMat4("model", model_temp);
+		glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE); // keep the velocity of the static scene behind the wires
 		RenderSphere();
+		glColorMaski(1, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		GpuProfiler::Get().End();
+
+		// 3. Accumulate, then copy the result to the screen; it stays in the history for the next frame
+		if (temporalShadows) {
+			GpuProfiler::Get().Begin("temporal resolve");
+			temporalResolve.Resolve(sceneTarget.GetTexture(0), sceneTarget.GetTexture(1), history);
+			history.GetPrevious().Bind(GL_READ_FRAMEBUFFER);
+			GLState::Get().BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+			glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+			GpuProfiler::Get().End();
+		}
 
 		// Debug information
-		std::cout << "render mode: " << (shadows ? "point shadow\n" : "origin\n");
+		if (!benchmark.IsRunning())
+			std::cout << "render mode: " << (shadows ? "point shadow" : "origin") << (temporalShadows ? ", temporal\n" : "\n");
+
+		GpuProfiler::Get().EndFrame();
 
-		glfwSwapBuffers(window);
+		{
+			CPU_PROFILE_SCOPE("glfwSwapBuffers"); // includes the vsync wait
+			glfwSwapBuffers(window);
+		}
 		glfwPollEvents();
 	}
 
+	benchmark.Finish();
+
 	glfwTerminate();
 }
 
@@ -186,11 +242,11 @@ void RenderScene(Shader& shader)
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::scale(model, glm::vec3(5.0f));
 	shader.SetMat4("model", model);
-	glDisable(GL_CULL_FACE); // Disable culling here since we render 'inside' the cube
+	GLState::Get().Disable(GL_CULL_FACE); // Disable culling here since we render 'inside' the cube
 	shader.SetInt("reverse_normals", 1); 
 	RenderCube();
 	shader.SetInt("reverse_normals", 0); 
-	glEnable(GL_CULL_FACE);
+	GLState::Get().Enable(GL_CULL_FACE);
 
 	// cubes
 	model = glm::mat4(1.0f);
@@ -283,7 +339,7 @@ void RenderCube()
 		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 		// link vertex attributes
-		glBindVertexArray(cubeVAO);
+		GLState::Get().BindVertexArray(cubeVAO);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(1);
@@ -291,12 +347,11 @@ void RenderCube()
 		glEnableVertexAttribArray(2);
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		GLState::Get().BindVertexArray(0);
 	}
 	// render Cube
-	glBindVertexArray(cubeVAO);
+	GLState::Get().BindVertexArray(cubeVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
 }
 
 void RenderSphere()
@@ -359,7 +414,7 @@ void RenderSphere()
 			oddRow = !oddRow;
 		}
 
-		glBindVertexArray(sphereVAO);
+		GLState::Get().BindVertexArray(sphereVAO);
 		glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
 		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
@@ -370,22 +425,24 @@ void RenderSphere()
 		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
 		glEnableVertexAttribArray(2);
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-		glBindVertexArray(0);
+		GLState::Get().BindVertexArray(0);
 	}
 
-	glBindVertexArray(sphereVAO);
+	GLState::Get().BindVertexArray(sphereVAO);
 	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	glDrawElements(GL_TRIANGLE_STRIP, (64 + 1) * 64 * 2, GL_UNSIGNED_INT, 0);
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	glBindVertexArray(0);
+	GLState::Get().BindVertexArray(0);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
-void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT)
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
 	// make sure the viewport matches the new window dimensions; note that SCR_WIDTH and 
 	// SCR_HEIGHT will be significantly larger than specified on retina displays.
-	glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+	GLState::Get().Viewport(0, 0, width, height);
+	SCR_WIDTH = width;
+	SCR_HEIGHT = height;
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -430,6 +487,11 @@ void ProcessInput(GLFWwindow* window)
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
 		camera.ProcessKeyboard(RIGHT, deltaTime);
 
+	// Print the GPU pass timings and write them to gpu_profile.csv by pressing P
+	GpuProfiler::Get().ReportOnKey(glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS);
+	// Write the CPU trace (chrome://tracing, ui.perfetto.dev) to cpu_trace.json by pressing T
+	CpuProfiler::Get().ExportOnKey(glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS);
+
 	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && !shadowKeyPressed) {
 		shadows = !shadows;
 		shadowKeyPressed = true;
@@ -438,6 +500,16 @@ void ProcessInput(GLFWwindow* window)
 	if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_RELEASE) {
 		shadowKeyPressed = false;
 	}
+
+	// Toggle temporal shadow filtering (jitter + reprojected history) by pressing R
+	if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS && !temporalKeyPressed) {
+		temporalShadows = !temporalShadows;
+		temporalKeyPressed = true;
+	}
+
+	if (glfwGetKey(window, GLFW_KEY_R) == GLFW_RELEASE) {
+		temporalKeyPressed = false;
+	}
 }
 
 // Utility function for loading a 2D texture from file
@@ -457,7 +529,7 @@ unsigned int LoadTexture(char const* path)
 		else if (nrComponents == 4)
 			format = GL_RGBA;
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -0,0 +1,442 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#include <GL/glew.h>
+
+#include "gl_state.h"
+#include "render_target.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+
+// Handle of a resource declared in a RenderGraph.
+struct RenderResource
+{
+	int index = -1;
+	bool IsValid() const { return index >= 0; }
+};
+
+struct RenderGraphStats
+{
+	unsigned int passes = 0;
+	unsigned int culledPasses = 0;
+	unsigned int transientResources = 0;
+	unsigned int physicalTargets = 0;
+	size_t unaliasedBytes = 0; // one texture per declared transient resource, what the demos used to allocate
+	size_t allocatedBytes = 0; // textures actually allocated after culling and aliasing
+};
+
+// The RenderGraph class describes a frame as a list of passes that declare which render targets they read and write.
+// Compile() works out the lifetime of every transient target, culls passes whose results are never used,
+// lets targets with the same description and non-overlapping lifetimes share one texture, and builds one FBO per pass.
+// Execute() runs the surviving passes in declaration order and invalidates each transient target after its last use.
+// Each pass is timed as a GpuProfiler and a CpuProfiler scope named after it.
+//
+// Transient targets have undefined content when a pass first writes them, so that pass must clear or overwrite them.
+// Passes writing the backbuffer or an imported texture are never culled.
+//
+// Usage Example:
+// RenderGraph graph;
+// RenderResource backbuffer = graph.ImportBackbuffer(width, height);
+// RenderResource color;
+// graph.AddPass("scene",
+//     [&](RenderGraph::PassBuilder& builder) { color = builder.Create("color", { GL_RGBA16F, width, height }); },
+//     [&](const RenderGraph& g) { glClear(GL_COLOR_BUFFER_BIT); DrawScene(); });
+// graph.AddPass("tonemap",
+//     [&](RenderGraph::PassBuilder& builder) { builder.Read(color); builder.Write(backbuffer); },
+//     [&](const RenderGraph& g) { GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(color)); quad.Render(); });
+// graph.Compile();  // once, or whenever the passes change
+// graph.Execute();  // every frame
+class RenderGraph
+{
+public:
+	class PassBuilder
+	{
+	public:
+		// Declares a new transient render target written by this pass.
+		RenderResource Create(const std::string& name, const RenderTargetDesc& desc)
+		{
+			RenderResource resource = graph.AddResource(name, desc, false, 0);
+			return Write(resource);
+		}
+
+		RenderResource Read(RenderResource resource)
+		{
+			graph.passes[pass].reads.push_back(resource.index);
+			return resource;
+		}
+
+		// Color targets are attached in the order they are written, a depth target goes to the depth attachment.
+		RenderResource Write(RenderResource resource)
+		{
+			graph.passes[pass].writes.push_back(resource.index);
+			return resource;
+		}
+
+	private:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph& _graph, int _pass) : graph(_graph), pass(_pass) {}
+
+		RenderGraph& graph;
+		int pass;
+	};
+
+	using SetupFunction = std::function<void(PassBuilder&)>;
+	using ExecuteFunction = std::function<void(const RenderGraph&)>;
+
+	RenderGraph() = default;
+
+	~RenderGraph()
+	{
+		ReleaseFramebuffers();
+		for (auto& target : targets)
+			RenderTargetPool::Get().ReleaseTexture(target.texture);
+	}
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// Removes all passes and resources. The textures go back to the RenderTargetPool on the next Compile().
+	void Reset()
+	{
+		ReleaseFramebuffers();
+		passes.clear();
+		resources.clear();
+		compiled = false;
+	}
+
+	RenderResource ImportBackbuffer(int width, int height)
+	{
+		RenderTargetDesc desc;
+		desc.width = width;
+		desc.height = height;
+		return AddResource("backbuffer", desc, true, 0);
+	}
+
+	// Makes a texture owned elsewhere (noise texture, history buffer...) visible to the passes.
+	RenderResource ImportTexture(const std::string& name, unsigned int texture, const RenderTargetDesc& desc)
+	{
+		return AddResource(name, desc, true, texture);
+	}
+
+	// Points an imported resource at another texture with the same description, e.g. the other half of a
+	// ping-pong history pair. The framebuffers of the passes writing it are re-attached, no Compile() needed.
+	void SetImportedTexture(RenderResource resource, unsigned int texture)
+	{
+		Resource& r = resources[resource.index];
+		if (!r.imported || r.texture == texture)
+			return;
+		r.texture = texture;
+
+		for (const auto& pass : passes) {
+			if (pass.framebuffer == 0)
+				continue;
+			GLenum colorAttachment = GL_COLOR_ATTACHMENT0;
+			for (int w : pass.writes) {
+				bool isDepth = GetRenderTargetFormatInfo(resources[w].desc.internalFormat).isDepth;
+				if (w == resource.index) {
+					GLenum attachment = colorAttachment;
+					if (isDepth)
+						attachment = r.desc.internalFormat == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+					GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+					glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+				}
+				if (!isDepth)
+					colorAttachment++;
+			}
+		}
+		GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void AddPass(const std::string& name, const SetupFunction& setup, const ExecuteFunction& execute)
+	{
+		Pass pass;
+		pass.name = name;
+		pass.profileName = CpuProfiler::Get().Intern(name);
+		pass.execute = execute;
+		passes.push_back(pass);
+
+		PassBuilder builder(*this, (int)passes.size() - 1);
+		setup(builder);
+		compiled = false;
+	}
+
+	void Compile()
+	{
+		ReleaseFramebuffers();
+		CullPasses();
+		ComputeLifetimes();
+		AllocateTargets();
+		CreateFramebuffers();
+		compiled = true;
+
+#ifdef _DEBUG
+		std::cout << "render graph: " << stats.passes - stats.culledPasses << "/" << stats.passes << " passes, "
+			<< stats.physicalTargets << " textures for " << stats.transientResources << " transient targets, "
+			<< stats.allocatedBytes / (1024.0 * 1024.0) << " MB (unaliased " << stats.unaliasedBytes / (1024.0 * 1024.0) << " MB)\n";
+#endif
+	}
+
+	void Execute() const
+	{
+		CPU_PROFILE_SCOPE("RenderGraph::Execute");
+#ifdef _DEBUG
+		if (!compiled)
+			std::cerr << "Warning: render graph executed without Compile()\n";
+#endif
+		bool canInvalidate = GLEW_ARB_invalidate_subdata != 0;
+
+		for (int i = 0; i < (int)passes.size(); i++) {
+			const Pass& pass = passes[i];
+			if (pass.culled)
+				continue;
+
+			if (!pass.writes.empty()) {
+				const RenderTargetDesc& desc = resources[pass.writes[0]].desc;
+				GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+				GLState::Get().Viewport(0, 0, desc.width, desc.height);
+			}
+			CpuProfileScope passScope(pass.profileName);
+			GpuProfiler::Get().Begin(pass.profileName);
+			pass.execute(*this);
+			GpuProfiler::Get().End();
+
+			// Nothing reads these targets any more, let the driver drop their content
+			if (canInvalidate) {
+				for (const auto& resource : resources) {
+					if (!resource.imported && resource.lastUse == i)
+						glInvalidateTexImage(targets[resource.target].texture, 0);
+				}
+			}
+		}
+	}
+
+	unsigned int GetTexture(RenderResource resource) const
+	{
+		const Resource& r = resources[resource.index];
+		if (r.imported)
+			return r.texture;
+		return r.target >= 0 ? targets[r.target].texture : 0;
+	}
+
+	const RenderTargetDesc& GetDesc(RenderResource resource) const { return resources[resource.index].desc; }
+
+	const RenderGraphStats& GetStats() const { return stats; }
+
+private:
+	struct Resource
+	{
+		std::string name;
+		RenderTargetDesc desc;
+		bool imported = false;
+		unsigned int texture = 0; // imported texture, 0 with imported == true is the backbuffer
+		int target = -1;          // index into targets for transient resources
+		int firstUse = -1, lastUse = -1;
+		int readers = 0;          // passes that read it and were not culled
+	};
+
+	struct Pass
+	{
+		std::string name;
+		const char* profileName = nullptr; // interned copy of name, scope names must outlive the graph
+		ExecuteFunction execute;
+		std::vector<int> reads, writes;
+		unsigned int framebuffer = 0;
+		int refCount = 0;
+		bool culled = false;
+	};
+
+	// A texture shared by every transient resource with the same description and non-overlapping lifetime.
+	struct Target
+	{
+		RenderTargetDesc desc;
+		unsigned int texture = 0;
+		int lastUse = -1; // last pass using it, updated during allocation
+	};
+
+	RenderResource AddResource(const std::string& name, const RenderTargetDesc& desc, bool imported, unsigned int texture)
+	{
+		Resource resource;
+		resource.name = name;
+		resource.desc = desc;
+		resource.imported = imported;
+		resource.texture = texture;
+		resources.push_back(resource);
+		compiled = false;
+
+		RenderResource handle;
+		handle.index = (int)resources.size() - 1;
+		return handle;
+	}
+
+	// A pass survives if it writes an imported resource or something a surviving pass reads.
+	void CullPasses()
+	{
+		for (auto& resource : resources)
+			resource.readers = 0;
+		for (auto& pass : passes) {
+			pass.culled = false;
+			for (int r : pass.reads)
+				resources[r].readers++;
+		}
+
+		std::vector<int> unreferenced;
+		for (int i = 0; i < (int)passes.size(); i++) {
+			Pass& pass = passes[i];
+			// One reference per written resource that is still needed, however many passes read it: the
+			// reference goes away below once the last of its readers is culled
+			pass.refCount = 0;
+			for (int w : pass.writes)
+				if (resources[w].imported || resources[w].readers > 0)
+					pass.refCount++;
+			if (pass.refCount == 0)
+				unreferenced.push_back(i);
+		}
+
+		while (!unreferenced.empty()) {
+			int index = unreferenced.back();
+			unreferenced.pop_back();
+			passes[index].culled = true;
+
+			for (int r : passes[index].reads) {
+				if (--resources[r].readers > 0 || resources[r].imported)
+					continue; // passes writing imported resources are always kept
+				for (auto& producer : passes) {
+					if (producer.culled || std::find(producer.writes.begin(), producer.writes.end(), r) == producer.writes.end())
+						continue;
+					if (--producer.refCount == 0)
+						unreferenced.push_back((int)(&producer - &passes[0]));
+				}
+			}
+		}
+	}
+
+	void ComputeLifetimes()
+	{
+		for (auto& resource : resources)
+			resource.firstUse = resource.lastUse = -1;
+
+		for (int i = 0; i < (int)passes.size(); i++) {
+			if (passes[i].culled)
+				continue;
+			auto use = [&](int r) {
+				if (resources[r].firstUse < 0)
+					resources[r].firstUse = i;
+				resources[r].lastUse = i;
+			};
+			for (int r : passes[i].reads) use(r);
+			for (int r : passes[i].writes) use(r);
+		}
+	}
+
+	// Greedy first-fit in order of first use. The textures of the previous compile go back to the
+	// RenderTargetPool first, so a rebuilt graph gets the same textures back when the descriptions still match.
+	void AllocateTargets()
+	{
+		for (auto& target : targets)
+			RenderTargetPool::Get().ReleaseTexture(target.texture);
+		targets.clear();
+
+		std::vector<int> order;
+		for (int r = 0; r < (int)resources.size(); r++) {
+			resources[r].target = -1;
+			if (!resources[r].imported && resources[r].firstUse >= 0)
+				order.push_back(r);
+		}
+		std::sort(order.begin(), order.end(), [&](int a, int b) { return resources[a].firstUse < resources[b].firstUse; });
+
+		for (int r : order) {
+			Resource& resource = resources[r];
+			int best = -1;
+			for (int t = 0; t < (int)targets.size() && best < 0; t++) {
+				if (targets[t].desc == resource.desc && targets[t].lastUse < resource.firstUse)
+					best = t;
+			}
+			if (best < 0) {
+				Target target;
+				target.desc = resource.desc;
+				target.texture = RenderTargetPool::Get().AcquireTexture(resource.desc);
+				targets.push_back(target);
+				best = (int)targets.size() - 1;
+			}
+			targets[best].lastUse = resource.lastUse;
+			resource.target = best;
+		}
+
+		stats = RenderGraphStats();
+		stats.passes = (unsigned int)passes.size();
+		for (const auto& pass : passes)
+			stats.culledPasses += pass.culled ? 1 : 0;
+		for (const auto& resource : resources) {
+			if (resource.imported)
+				continue;
+			stats.transientResources++;
+			stats.unaliasedBytes += GetRenderTargetBytes(resource.desc);
+		}
+		stats.physicalTargets = (unsigned int)targets.size();
+		for (const auto& target : targets)
+			stats.allocatedBytes += GetRenderTargetBytes(target.desc);
+	}
+
+	void CreateFramebuffers()
+	{
+		for (auto& pass : passes) {
+			pass.framebuffer = 0;
+			if (pass.culled || pass.writes.empty())
+				continue;
+
+			bool writesBackbuffer = false;
+			for (int w : pass.writes)
+				writesBackbuffer |= resources[w].imported && resources[w].texture == 0;
+			if (writesBackbuffer)
+				continue;
+
+			glGenFramebuffers(1, &pass.framebuffer);
+			GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+
+			std::vector<GLenum> drawBuffers;
+			for (int w : pass.writes) {
+				unsigned int texture = GetTexture(RenderResource{ w });
+				if (GetRenderTargetFormatInfo(resources[w].desc.internalFormat).isDepth) {
+					GLenum attachment = resources[w].desc.internalFormat == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+					glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+				}
+				else {
+					GLenum attachment = GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+					glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+					drawBuffers.push_back(attachment);
+				}
+			}
+			if (drawBuffers.empty())
+				glDrawBuffer(GL_NONE);
+			else
+				glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+
+#ifdef _DEBUG
+			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+				std::cerr << "render graph: framebuffer of pass '" << pass.name << "' not complete!\n";
+#endif
+		}
+		GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void ReleaseFramebuffers()
+	{
+		for (auto& pass : passes) {
+			if (pass.framebuffer != 0)
+				GLState::Get().DeleteFramebuffers(1, &pass.framebuffer);
+			pass.framebuffer = 0;
+		}
+	}
+
+private:
+	std::vector<Pass> passes;
+	std::vector<Resource> resources;
+	std::vector<Target> targets;
+	RenderGraphStats stats;
+	bool compiled = false;
+};
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+#include "gl_state.h"
+#include "shader.h"
+#include "material.h"
+#include "cpu_profiler.h"
+
+// Vertex array and draw range of a piece of geometry, everything a draw packet needs to issue the draw call.
+// indexType 0 draws with glDrawArrays, otherwise glDrawElements with indices of that type.
+struct DrawGeometry
+{
+	unsigned int vertexArray = 0;
+	GLenum mode = GL_TRIANGLES;
+	int count = 0;
+	GLenum indexType = 0;
+};
+
+// Pipeline state of a draw. Resolved once by RenderQueue::PrepareState() on the GL thread (that is where the
+// program/material/vertex array ids of the sort key are handed out), then shared by any number of packets.
+struct DrawState
+{
+	uint64_t stateKey;
+	Shader* shader;
+	const Material* material; // nullptr: only 'texture' (if any) is bound to unit 0
+	unsigned int textureMask;
+	unsigned int texture;
+	DrawGeometry geometry;
+};
+
+// One queued draw: the pipeline state it needs, its per-draw uniforms and the 64-bit sort key built from them.
+struct DrawPacket
+{
+	uint64_t key;
+	DrawState state;
+	glm::mat4 model;
+	const char* colorUniform; // optional vec3 uniform set per draw, e.g. "lightColor"
+	glm::vec3 color;
+
+	DrawPacket& SetColor(const char* _uniform, const glm::vec3& _color)
+	{
+		colorUniform = _uniform;
+		color = _color;
+		return *this;
+	}
+};
+
+class CommandList;
+
+// Per-frame counters of a RenderQueue: how many packets were drawn and how many state switches they needed.
+struct RenderQueueStats
+{
+	unsigned int packets = 0;
+	unsigned int programChanges = 0;
+	unsigned int materialChanges = 0;
+	unsigned int vertexArrayChanges = 0;
+};
+
+// The RenderQueue class collects draw packets instead of drawing immediately, sorts them by a 64-bit key and
+// then submits them in that order, so draws sharing a program, material or vertex array end up next to each other
+// and the state changes between them are minimized regardless of the order the scene code submits them in.
+//
+// Key layout, most significant bits first:
+//   pass (4) | program (10) | material (14) | vertex array (12) | depth (24)      SORT_STATE
+//   pass (4) | depth (24)   | program (10)  | material (14) | vertex array (12)   SORT_FRONT_TO_BACK / SORT_BACK_TO_FRONT
+// Program, material and vertex array are small ids handed out on first use, depth is the distance from the camera
+// to the model origin quantized over [0, farPlane]. Passes always run in order, the sort mode picks what matters
+// inside a pass: fewest switches, front-to-back for early-z rejection, or back-to-front for blending.
+// The keys are sorted with an 8-bit LSD radix sort, which skips the digits every key has in common.
+//
+// Model, Mesh and the yzh primitives submit through Submit() (see their Submit/GetGeometry methods).
+// The per-draw model matrix goes to the "model" uniform, everything else should live in uniform blocks.
+//
+// Worker threads record into their own CommandList instead (see below) with DrawStates prepared up front;
+// Append() merges those lists, so only the sort and the GL calls stay on the GL thread.
+//
+// Usage Example:
+// RenderQueue queue;
+// queue.SetCamera(camera.position, 100.0f);
+// cube.Submit(queue, 0, shader, model, woodTexture);
+// sphere.Submit(queue, 0, shaderLight, model).SetColor("lightColor", color);
+// backpack.Submit(queue, 0, shaderGeometryPass, model);
+// queue.Execute(); // sorts, draws and clears the queue
+class RenderQueue
+{
+public:
+	enum SortMode
+	{
+		SORT_STATE,
+		SORT_FRONT_TO_BACK,
+		SORT_BACK_TO_FRONT
+	};
+
+	static constexpr unsigned int MAX_PASSES = 1 << 4;
+
+	SortMode sortMode = SORT_STATE;
+
+	void SetCamera(const glm::vec3& _position, float _farPlane)
+	{
+		cameraPosition = _position;
+		farPlane = _farPlane;
+	}
+
+	// State of draws that bind a Material (textures selected by _textureMask). GL thread only.
+	DrawState PrepareState(Shader& _shader, const DrawGeometry& _geometry, const Material* _material,
+		unsigned int _textureMask = TEXTURE_ALL_BITS)
+	{
+		return { StateKey(_shader, _geometry, Id(materialIds, (uintptr_t)_material, MATERIAL_BITS)),
+			&_shader, _material, _textureMask, 0, _geometry };
+	}
+
+	// State of draws that bind a single 2D texture to unit 0 (or nothing when _texture is 0). GL thread only.
+	DrawState PrepareState(Shader& _shader, const DrawGeometry& _geometry, unsigned int _texture = 0)
+	{
+		return { StateKey(_shader, _geometry, Id(materialIds, (uintptr_t)_texture, MATERIAL_BITS)),
+			&_shader, nullptr, 0, _texture, _geometry };
+	}
+
+	// Queues a draw that binds a Material (textures selected by _textureMask).
+	DrawPacket& Submit(unsigned int _pass, Shader& _shader, const DrawGeometry& _geometry, const glm::mat4& _model,
+		const Material* _material, unsigned int _textureMask = TEXTURE_ALL_BITS)
+	{
+		return Push(_pass, PrepareState(_shader, _geometry, _material, _textureMask), _model);
+	}
+
+	// Queues a draw that binds a single 2D texture to unit 0 (or nothing when _texture is 0).
+	DrawPacket& Submit(unsigned int _pass, Shader& _shader, const DrawGeometry& _geometry, const glm::mat4& _model,
+		unsigned int _texture = 0)
+	{
+		return Push(_pass, PrepareState(_shader, _geometry, _texture), _model);
+	}
+
+	// Full sort key of a draw at _position. Only reads the queue, safe to call from any thread while
+	// the camera and sort mode stay unchanged.
+	uint64_t MakeKey(unsigned int _pass, const DrawState& _state, const glm::vec3& _position) const
+	{
+#ifdef _DEBUG
+		if (_pass >= MAX_PASSES)
+			std::cerr << "Warning: RenderQueue pass " << _pass << " out of range\n";
+#endif
+		uint64_t key = (uint64_t)(_pass & (MAX_PASSES - 1)) << 60;
+		uint64_t depth = Depth(_position);
+		if (sortMode == SORT_STATE)
+			return key | (_state.stateKey << DEPTH_BITS) | depth;
+		return key | (depth << (64 - 4 - DEPTH_BITS)) | _state.stateKey;
+	}
+
+	// Moves the packets recorded in _list into the queue and empties the list (keeping its memory).
+	void Append(CommandList& _list);
+
+	size_t Size() const { return packets.size(); }
+
+	// Sorts the queued packets by key. Execute() calls it, separate only for measuring.
+	void Sort()
+	{
+		CPU_PROFILE_SCOPE("RenderQueue::Sort");
+		size_t count = packets.size();
+		keys.resize(count);
+		order.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			keys[i] = packets[i].key;
+			order[i] = (uint32_t)i;
+		}
+		RadixSort();
+	}
+
+	// Sorts, submits every packet and empties the queue.
+	void Execute()
+	{
+		CPU_PROFILE_SCOPE("RenderQueue::Execute");
+		Sort();
+
+		stats = RenderQueueStats();
+		stats.packets = (unsigned int)packets.size();
+		const Shader* shader = nullptr;
+		uintptr_t material = UNBOUND;
+		unsigned int vertexArray = UNBOUND_NAME;
+		GLint modelLocation = -1;
+		const char* colorUniform = nullptr;
+		GLint colorLocation = -1;
+
+		for (uint32_t index : order) {
+			const DrawPacket& packet = packets[index];
+			const DrawState& state = packet.state;
+			if (state.shader != shader) {
+				shader = state.shader;
+				shader->Bind();
+				modelLocation = glGetUniformLocation(shader->GetID(), "model");
+				colorUniform = nullptr;
+				material = UNBOUND; // material samplers are resolved per program
+				stats.programChanges++;
+			}
+
+			uintptr_t packetMaterial = state.material ? (uintptr_t)state.material : (uintptr_t)state.texture;
+			if (packetMaterial != material) {
+				material = packetMaterial;
+				if (state.material)
+					state.material->Bind(*shader, state.textureMask);
+				else if (state.texture != 0)
+					GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, state.texture);
+				stats.materialChanges++;
+			}
+
+			if (state.geometry.vertexArray != vertexArray) {
+				vertexArray = state.geometry.vertexArray;
+				GLState::Get().BindVertexArray(vertexArray);
+				stats.vertexArrayChanges++;
+			}
+
+			glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &packet.model[0][0]);
+			if (packet.colorUniform) {
+				if (packet.colorUniform != colorUniform) {
+					colorUniform = packet.colorUniform;
+					colorLocation = glGetUniformLocation(shader->GetID(), colorUniform);
+				}
+				glUniform3fv(colorLocation, 1, &packet.color[0]);
+			}
+
+			const DrawGeometry& geometry = state.geometry;
+			if (geometry.indexType == 0)
+				glDrawArrays(geometry.mode, 0, geometry.count);
+			else
+				glDrawElements(geometry.mode, geometry.count, geometry.indexType, nullptr);
+		}
+
+		packets.clear();
+	}
+
+	// Counters of the last Execute().
+	const RenderQueueStats& GetStats() const { return stats; }
+
+private:
+	static constexpr uintptr_t UNBOUND = ~(uintptr_t)0;
+	static constexpr unsigned int UNBOUND_NAME = 0xFFFFFFFF;
+
+	static constexpr int DEPTH_BITS = 24, PROGRAM_BITS = 10, MATERIAL_BITS = 14, VERTEX_ARRAY_BITS = 12;
+
+	DrawPacket& Push(unsigned int _pass, const DrawState& _state, const glm::mat4& _model)
+	{
+		packets.push_back({ MakeKey(_pass, _state, glm::vec3(_model[3])), _state, _model, nullptr, glm::vec3(0.0f) });
+		return packets.back();
+	}
+
+	// program | material | vertex array, the part of the key that does not depend on the camera
+	uint64_t StateKey(const Shader& _shader, const DrawGeometry& _geometry, uint64_t _material)
+	{
+		uint64_t program = Id(programIds, _shader.GetID(), PROGRAM_BITS);
+		uint64_t vertexArray = Id(vertexArrayIds, _geometry.vertexArray, VERTEX_ARRAY_BITS);
+		return (program << (MATERIAL_BITS + VERTEX_ARRAY_BITS)) | (_material << VERTEX_ARRAY_BITS) | vertexArray;
+	}
+
+	// Dense id of a handle, assigned in order of first use. Ids wrap when a field overflows, which only costs
+	// sorting quality, never correctness.
+	static uint64_t Id(std::unordered_map<uintptr_t, uint32_t>& ids, uintptr_t handle, int bits)
+	{
+		auto result = ids.emplace(handle, (uint32_t)ids.size());
+		return result.first->second & ((1u << bits) - 1);
+	}
+
+	uint64_t Depth(const glm::vec3& position) const
+	{
+		float distance = glm::clamp(glm::length(position - cameraPosition) / farPlane, 0.0f, 1.0f);
+		uint64_t depth = (uint64_t)(distance * ((1 << DEPTH_BITS) - 1));
+		return sortMode == SORT_BACK_TO_FRONT ? ((1 << DEPTH_BITS) - 1) - depth : depth;
+	}
+
+	// LSD radix sort of (keys, order), one byte per pass; stable, so equal keys keep their submission order.
+	void RadixSort()
+	{
+		size_t count = keys.size();
+		if (count < 2)
+			return;
+		tempKeys.resize(count);
+		tempOrder.resize(count);
+
+		uint64_t differing = 0;
+		for (size_t i = 1; i < count; i++)
+			differing |= keys[i] ^ keys[0];
+
+		for (int shift = 0; shift < 64; shift += 8) {
+			if (((differing >> shift) & 0xFF) == 0)
+				continue; // every key has the same digit here
+
+			uint32_t offsets[256] = {};
+			for (size_t i = 0; i < count; i++)
+				offsets[(keys[i] >> shift) & 0xFF]++;
+			uint32_t sum = 0;
+			for (uint32_t& offset : offsets) {
+				uint32_t digitCount = offset;
+				offset = sum;
+				sum += digitCount;
+			}
+			for (size_t i = 0; i < count; i++) {
+				uint32_t destination = offsets[(keys[i] >> shift) & 0xFF]++;
+				tempKeys[destination] = keys[i];
+				tempOrder[destination] = order[i];
+			}
+			keys.swap(tempKeys);
+			order.swap(tempOrder);
+		}
+	}
+
+private:
+	std::vector<DrawPacket> packets;
+	std::vector<uint64_t> keys, tempKeys;
+	std::vector<uint32_t> order, tempOrder;
+
+	std::unordered_map<uintptr_t, uint32_t> programIds, materialIds, vertexArrayIds;
+
+	glm::vec3 cameraPosition = glm::vec3(0.0f);
+	float farPlane = 100.0f;
+
+	RenderQueueStats stats;
+};
+
+// The CommandList class records draw packets on any thread, for merging into a RenderQueue with Append().
+// It only computes sort keys (read-only on the queue) and never touches OpenGL; the DrawStates it records must be
+// prepared by the queue on the GL thread beforehand. Keep one list per thread, each on its own cache lines.
+//
+// Usage Example:
+// DrawState cubeState = queue.PrepareState(shader, cube.GetGeometry(), texture);
+// std::vector<CommandList> lists(JobSystem::Get().GetThreadCount(), CommandList(queue));
+// ... on worker 'thread': lists[thread].Submit(0, cubeState, model);
+// for (CommandList& list : lists) queue.Append(list);
+// queue.Execute();
+class alignas(64) CommandList
+{
+public:
+	explicit CommandList(const RenderQueue& _queue) : queue(&_queue) {}
+
+	DrawPacket& Submit(unsigned int _pass, const DrawState& _state, const glm::mat4& _model)
+	{
+		packets.push_back({ queue->MakeKey(_pass, _state, glm::vec3(_model[3])), _state, _model, nullptr, glm::vec3(0.0f) });
+		return packets.back();
+	}
+
+	size_t Size() const { return packets.size(); }
+	void Clear() { packets.clear(); }
+
+private:
+	friend class RenderQueue;
+
+	const RenderQueue* queue;
+	std::vector<DrawPacket> packets;
+};
+
+inline void RenderQueue::Append(CommandList& _list)
+{
+	packets.insert(packets.end(), _list.packets.begin(), _list.packets.end());
+	_list.packets.clear();
+}
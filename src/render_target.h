@@ -0,0 +1,365 @@
+#pragma once
+
+#include <vector>
+#include <iostream>
+
+#include <GL/glew.h>
+
+#include "gl_state.h"
+
+// Description of a render target texture. Two targets with equal descriptions are interchangeable.
+struct RenderTargetDesc
+{
+	GLenum internalFormat = GL_RGBA8;
+	int width = 0;
+	int height = 0;
+	GLenum filter = GL_NEAREST;   // used for both minification and magnification
+	int samples = 1;              // > 1 creates a GL_TEXTURE_2D_MULTISAMPLE texture
+	GLenum wrap = GL_CLAMP_TO_EDGE; // GL_CLAMP_TO_BORDER uses a white border (depth 1.0, i.e. "not in shadow")
+	bool cubeMap = false;
+
+	bool operator==(const RenderTargetDesc& other) const
+	{
+		return internalFormat == other.internalFormat && width == other.width && height == other.height &&
+			filter == other.filter && samples == other.samples && wrap == other.wrap && cubeMap == other.cubeMap;
+	}
+	bool operator!=(const RenderTargetDesc& other) const { return !(*this == other); }
+};
+
+// Upload format/type matching an internal format, and its size in bytes per pixel.
+struct RenderTargetFormatInfo
+{
+	GLenum format;
+	GLenum type;
+	unsigned int bytesPerPixel;
+	bool isDepth;
+};
+
+inline RenderTargetFormatInfo GetRenderTargetFormatInfo(GLenum internalFormat)
+{
+	switch (internalFormat) {
+	case GL_R8:                 return { GL_RED, GL_UNSIGNED_BYTE, 1, false };
+	case GL_R16F:               return { GL_RED, GL_FLOAT, 2, false };
+	case GL_R32F:               return { GL_RED, GL_FLOAT, 4, false };
+	case GL_RG8:                return { GL_RG, GL_UNSIGNED_BYTE, 2, false };
+	case GL_RG16:               return { GL_RG, GL_UNSIGNED_SHORT, 4, false };
+	case GL_RG16F:              return { GL_RG, GL_FLOAT, 4, false };
+	case GL_RGB16F:             return { GL_RGB, GL_FLOAT, 6, false };
+	case GL_R11F_G11F_B10F:     return { GL_RGB, GL_FLOAT, 4, false };
+	case GL_RGBA8:              return { GL_RGBA, GL_UNSIGNED_BYTE, 4, false };
+	case GL_RGBA16F:            return { GL_RGBA, GL_FLOAT, 8, false };
+	case GL_RGBA32F:            return { GL_RGBA, GL_FLOAT, 16, false };
+	case GL_DEPTH_COMPONENT24:  return { GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 4, true };
+	case GL_DEPTH_COMPONENT32F: return { GL_DEPTH_COMPONENT, GL_FLOAT, 4, true };
+	case GL_DEPTH24_STENCIL8:   return { GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4, true };
+	default:                    return { GL_RGBA, GL_UNSIGNED_BYTE, 4, false };
+	}
+}
+
+inline size_t GetRenderTargetBytes(const RenderTargetDesc& desc)
+{
+	size_t bytes = (size_t)desc.width * desc.height * GetRenderTargetFormatInfo(desc.internalFormat).bytesPerPixel;
+	return bytes * (desc.samples > 1 ? desc.samples : 1) * (desc.cubeMap ? 6 : 1);
+}
+
+inline GLenum GetRenderTargetTextureTarget(const RenderTargetDesc& desc)
+{
+	if (desc.cubeMap)
+		return GL_TEXTURE_CUBE_MAP;
+	return desc.samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+}
+
+// Creates an uninitialized texture for the description.
+inline unsigned int CreateRenderTargetTexture(const RenderTargetDesc& desc)
+{
+	RenderTargetFormatInfo info = GetRenderTargetFormatInfo(desc.internalFormat);
+	GLenum target = GetRenderTargetTextureTarget(desc);
+
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	GLState::Get().BindTexture(target, texture);
+
+	// Multisample textures have no sampler state
+	if (target == GL_TEXTURE_2D_MULTISAMPLE) {
+		glTexImage2DMultisample(target, desc.samples, desc.internalFormat, desc.width, desc.height, GL_TRUE);
+		return texture;
+	}
+
+	if (desc.cubeMap) {
+		for (unsigned int face = 0; face < 6; face++)
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, desc.internalFormat, desc.width, desc.height, 0, info.format, info.type, nullptr);
+		glTexParameteri(target, GL_TEXTURE_WRAP_R, desc.wrap);
+	}
+	else
+		glTexImage2D(target, 0, desc.internalFormat, desc.width, desc.height, 0, info.format, info.type, nullptr);
+
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, desc.filter);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, desc.filter);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, desc.wrap);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, desc.wrap);
+	if (desc.wrap == GL_CLAMP_TO_BORDER) {
+		GLfloat borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glTexParameterfv(target, GL_TEXTURE_BORDER_COLOR, borderColor);
+	}
+	return texture;
+}
+
+struct RenderTargetPoolStats
+{
+	unsigned int textures = 0;      // alive, in use or idle
+	unsigned int idleTextures = 0;
+	unsigned int framebuffers = 0;
+	size_t bytes = 0;               // memory of all alive textures
+	unsigned int created = 0;       // textures created since startup
+	unsigned int reused = 0;        // acquisitions served from the idle list
+};
+
+// The RenderTargetPool class owns every render target texture and FBO of a demo.
+// Textures are keyed by their RenderTargetDesc (format, size, samples, filter, wrap); framebuffers by the
+// descriptions of their attachments, so an FBO comes back fully attached and checked.
+// Released objects stay idle for a few frames and are handed out again if someone asks for the same key,
+// otherwise NewFrame() deletes them. After a resize the old sizes are never requested again and disappear
+// on their own, without the demos having to track them.
+//
+// Usage Example:
+// RenderTargetPool::Get().NewFrame(); // once at the start of every frame
+// unsigned int texture = RenderTargetPool::Get().AcquireTexture({ GL_RGBA16F, width, height });
+// ...
+// RenderTargetPool::Get().ReleaseTexture(texture);
+class RenderTargetPool
+{
+public:
+	static constexpr unsigned int MAX_IDLE_FRAMES = 3;
+
+	static RenderTargetPool& Get()
+	{
+		static RenderTargetPool instance;
+		return instance;
+	}
+
+	RenderTargetPool(const RenderTargetPool&) = delete;
+	RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+	// Deletes the objects that stayed idle for more than MAX_IDLE_FRAMES frames.
+	void NewFrame()
+	{
+		frame++;
+
+		for (size_t i = 0; i < framebuffers.size();) {
+			if (framebuffers[i].inUse || frame - framebuffers[i].releaseFrame <= MAX_IDLE_FRAMES) {
+				i++;
+				continue;
+			}
+			for (unsigned int texture : framebuffers[i].textures)
+				ReleaseTexture(texture);
+			GLState::Get().DeleteFramebuffers(1, &framebuffers[i].framebuffer);
+			framebuffers.erase(framebuffers.begin() + i);
+		}
+
+		for (size_t i = 0; i < textures.size();) {
+			if (textures[i].inUse || frame - textures[i].releaseFrame <= MAX_IDLE_FRAMES) {
+				i++;
+				continue;
+			}
+			GLState::Get().DeleteTextures(1, &textures[i].texture);
+			textures.erase(textures.begin() + i);
+		}
+	}
+
+	unsigned int AcquireTexture(const RenderTargetDesc& desc)
+	{
+		for (auto& entry : textures) {
+			if (!entry.inUse && entry.desc == desc) {
+				entry.inUse = true;
+				stats.reused++;
+				return entry.texture;
+			}
+		}
+
+		TextureEntry entry;
+		entry.desc = desc;
+		entry.texture = CreateRenderTargetTexture(desc);
+		textures.push_back(entry);
+		stats.created++;
+		return entry.texture;
+	}
+
+	void ReleaseTexture(unsigned int texture)
+	{
+		for (auto& entry : textures) {
+			if (entry.texture == texture) {
+				entry.inUse = false;
+				entry.releaseFrame = frame;
+				return;
+			}
+		}
+	}
+
+	// Returns a complete framebuffer with one texture per attachment. Color attachments are bound to
+	// GL_COLOR_ATTACHMENT0..N in order and enabled as draw buffers, a depth format goes to the depth attachment.
+	unsigned int AcquireFramebuffer(const std::vector<RenderTargetDesc>& attachments)
+	{
+		for (auto& entry : framebuffers) {
+			if (!entry.inUse && entry.attachments == attachments) {
+				entry.inUse = true;
+				return entry.framebuffer;
+			}
+		}
+
+		FramebufferEntry entry;
+		entry.attachments = attachments;
+		glGenFramebuffers(1, &entry.framebuffer);
+		GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, entry.framebuffer);
+
+		std::vector<GLenum> drawBuffers;
+		for (const auto& desc : attachments) {
+			unsigned int texture = AcquireTexture(desc);
+			entry.textures.push_back(texture);
+
+			GLenum attachment;
+			if (GetRenderTargetFormatInfo(desc.internalFormat).isDepth)
+				attachment = desc.internalFormat == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+			else {
+				attachment = GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+				drawBuffers.push_back(attachment);
+			}
+			// glFramebufferTexture attaches every face of a cube map (layered rendering)
+			glFramebufferTexture(GL_FRAMEBUFFER, attachment, texture, 0);
+		}
+
+		if (drawBuffers.empty()) {
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+		}
+		else
+			glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "Framebuffer not complete!" << std::endl;
+		GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		framebuffers.push_back(entry);
+		return entry.framebuffer;
+	}
+
+	void ReleaseFramebuffer(unsigned int framebuffer)
+	{
+		for (auto& entry : framebuffers) {
+			if (entry.framebuffer == framebuffer) {
+				entry.inUse = false;
+				entry.releaseFrame = frame;
+				return;
+			}
+		}
+	}
+
+	// Texture bound to the i-th attachment (in the order given to AcquireFramebuffer).
+	unsigned int GetFramebufferTexture(unsigned int framebuffer, unsigned int index) const
+	{
+		for (const auto& entry : framebuffers) {
+			if (entry.framebuffer == framebuffer)
+				return index < entry.textures.size() ? entry.textures[index] : 0;
+		}
+		return 0;
+	}
+
+	RenderTargetPoolStats GetStats() const
+	{
+		RenderTargetPoolStats result = stats;
+		result.textures = (unsigned int)textures.size();
+		result.framebuffers = (unsigned int)framebuffers.size();
+		for (const auto& entry : textures) {
+			result.idleTextures += entry.inUse ? 0 : 1;
+			result.bytes += GetRenderTargetBytes(entry.desc);
+		}
+		return result;
+	}
+
+private:
+	RenderTargetPool() = default;
+
+	struct TextureEntry
+	{
+		RenderTargetDesc desc;
+		unsigned int texture = 0;
+		bool inUse = true;
+		unsigned long long releaseFrame = 0;
+	};
+
+	struct FramebufferEntry
+	{
+		std::vector<RenderTargetDesc> attachments;
+		std::vector<unsigned int> textures;
+		unsigned int framebuffer = 0;
+		bool inUse = true;
+		unsigned long long releaseFrame = 0;
+	};
+
+private:
+	std::vector<TextureEntry> textures;         // a few dozen at most, a linear scan is enough
+	std::vector<FramebufferEntry> framebuffers;
+	unsigned long long frame = 0;
+	RenderTargetPoolStats stats;
+};
+
+// The RenderTarget class is a framebuffer with its attachments, taken from the RenderTargetPool.
+// Resize() only records the new size; the pooled FBO is swapped on the next Bind() or GetTexture(),
+// so calling it every frame with the window size is cheap.
+//
+// Usage Example:
+// RenderTarget gBuffer({ { GL_RGBA16F, width, height }, { GL_RGBA8, width, height }, { GL_DEPTH_COMPONENT24, width, height } });
+// gBuffer.Resize(SCR_WIDTH, SCR_HEIGHT);
+// gBuffer.Bind();   // binds the FBO and sets the viewport to its size
+// GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, gBuffer.GetTexture(0));
+class RenderTarget
+{
+public:
+	explicit RenderTarget(const std::vector<RenderTargetDesc>& _attachments) : attachments(_attachments) {}
+
+	~RenderTarget()
+	{
+		if (framebuffer != 0)
+			RenderTargetPool::Get().ReleaseFramebuffer(framebuffer);
+	}
+
+	RenderTarget(const RenderTarget&) = delete;
+	RenderTarget& operator=(const RenderTarget&) = delete;
+
+	// A zero size (minimized window) is ignored, the target keeps its last size.
+	void Resize(int width, int height)
+	{
+		if (width <= 0 || height <= 0 || (width == GetWidth() && height == GetHeight()))
+			return;
+
+		for (auto& desc : attachments) {
+			desc.width = width;
+			desc.height = height;
+		}
+		if (framebuffer != 0)
+			RenderTargetPool::Get().ReleaseFramebuffer(framebuffer);
+		framebuffer = 0;
+	}
+
+	void Bind(GLenum target = GL_FRAMEBUFFER)
+	{
+		GLState::Get().BindFramebuffer(target, GetFramebuffer());
+		if (target != GL_READ_FRAMEBUFFER)
+			GLState::Get().Viewport(0, 0, GetWidth(), GetHeight());
+	}
+
+	unsigned int GetFramebuffer()
+	{
+		if (framebuffer == 0)
+			framebuffer = RenderTargetPool::Get().AcquireFramebuffer(attachments);
+		return framebuffer;
+	}
+
+	unsigned int GetTexture(unsigned int index) { return RenderTargetPool::Get().GetFramebufferTexture(GetFramebuffer(), index); }
+
+	int GetWidth() const { return attachments.empty() ? 0 : attachments[0].width; }
+	int GetHeight() const { return attachments.empty() ? 0 : attachments[0].height; }
+
+private:
+	std::vector<RenderTargetDesc> attachments;
+	unsigned int framebuffer = 0;
+};
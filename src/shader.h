@@ -1,18 +1,41 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <unordered_set>
+#include <chrono>
 
 #include <glm/glm.hpp>
 #include <GL/glew.h>
 
+#include "embedded_shaders.h"
+#include "gl_state.h"
+#include "shader_cache.h"
+#include "uniform_buffer.h"
+#include "cpu_profiler.h"
+
+// Statistics of where shader sources came from, accumulated over every Shader constructed so far.
+struct ShaderLoadStats
+{
+	unsigned int fileOpens = 0;      // source files opened on disk
+	unsigned int embeddedSources = 0; // sources taken from embedded_shaders.h
+	long long loadMicroseconds = 0;   // time spent fetching sources (compilation excluded)
+};
+
 // The Shader class encapsulates OpenGL shader programs. It provides functionalities for creating, 
 // compiling, and linking shaders, as well as setting uniform variables.
+//
+// Sources are embedded into the binary by tools/embed_shaders.py, so building a program normally does no file I/O.
+// Define SHADERS_FROM_DISK to always read res/shaders instead, which lets you edit shaders without rebuilding.
+//
+// Variants of one source are built by passing preprocessor defines, they are inserted right after the #version line.
 // 
 // Usage Example:
+// Shader myShader(SHADER_BLOOM_VS, SHADER_BLOOM_FS);
+// Shader myShader(SHADER_G_BUFFER_VS, SHADER_G_BUFFER_FS, EMBEDDED_SHADER_NONE, { "PACKED_GBUFFER" });
 // Shader myShader("vertexShaderPath", "fragmentShaderPath");
 // Shader myShader("vertexShaderPath", "fragmentShaderPath", "geometryShaderPath");
 // 
@@ -27,13 +50,19 @@ public:
 
 	// Constructor for the Shader class. 
 	// It requires paths to the vertex, fragment, and optionally, geometry shader source files.
-	Shader(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const std::string& geometryShaderPath = "")
+	// Paths under res/shaders resolve to the embedded sources, any other path is read from disk.
+	// Every name in defines is #defined in all stages.
+	Shader(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const std::string& geometryShaderPath = "",
+		const std::vector<std::string>& defines = {})
 	{
-		// Parse the shader source files. This function will read the shader files from the provided paths and return their contents as strings.
-		const auto& [vertexSource, fragmentSource, geometrySource] = ParseShader(vertexShaderPath, fragmentShaderPath, geometryShaderPath);
+		CPU_PROFILE_SCOPE("Shader::Shader");
+		auto start = std::chrono::high_resolution_clock::now();
+		std::string vertexSource = AddDefines(LoadSource(vertexShaderPath), defines);
+		std::string fragmentSource = AddDefines(LoadSource(fragmentShaderPath), defines);
+		std::string geometrySource = geometryShaderPath.empty() ? std::string() : AddDefines(LoadSource(geometryShaderPath), defines);
+		loadStats.loadMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
 
-		// Create the shader program using the parsed shader sources.
-		m_rendererID = CreateShader(vertexSource, fragmentSource, geometrySource);
+		Create(vertexSource, fragmentSource, geometrySource);
 
 #ifdef _DEBUG
 		std::cout << "successfully create and compile shader: \n" << vertexShaderPath <<
@@ -41,19 +70,29 @@ public:
 #endif 
 	}
 
+	// Constructor taking the IDs of embedded sources (see embedded_shaders.h), geometry stage optional.
+	Shader(EmbeddedShaderID vertexShader, EmbeddedShaderID fragmentShader, EmbeddedShaderID geometryShader = EMBEDDED_SHADER_NONE,
+		const std::vector<std::string>& defines = {})
+		: Shader(embeddedShaders[vertexShader].path, embeddedShaders[fragmentShader].path,
+			geometryShader == EMBEDDED_SHADER_NONE ? "" : embeddedShaders[geometryShader].path, defines)
+	{
+	}
+
+	static const ShaderLoadStats& GetLoadStats() { return loadStats; }
+
 	~Shader()
 	{
-		glDeleteProgram(m_rendererID);
+		ShaderCache::Get().ReleaseProgram(m_rendererID);
 	}
 
 	void Bind() const
 	{
-		glUseProgram(m_rendererID);
+		GLState::Get().UseProgram(m_rendererID);
 	}
 
 	void Unbind() const
 	{
-		glUseProgram(0);
+		GLState::Get().UseProgram(0);
 	}
 
 	unsigned int GetID() const
@@ -61,6 +100,9 @@ public:
 		return m_rendererID;
 	}
 
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
+
 	// Set a vec3 uniform in the shader.
 	//
 	// @param _name Name of the uniform variable in the shader.
@@ -183,101 +225,73 @@ public:
 	}
 
 private:
-	unsigned int CompileShader(unsigned int type, const std::string& source)
+	// Binds every per-frame block the program declares to its fixed binding point.
+	// Blocks the program doesn't use are silently skipped.
+	void AttachFrameUniformBlocks() const
 	{
-		unsigned int id = glCreateShader(type);
-		const char* src = source.c_str();
-		glShaderSource(id, 1, &src, nullptr);
-		glCompileShader(id);
-
-#ifdef _DEBUG
-		int result;
-		glGetShaderiv(id, GL_COMPILE_STATUS, &result);
-
-		if (result == GL_FALSE) {
-			int length;
-			glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
-			std::vector<char> message(length);
-			glGetShaderInfoLog(id, length, &length, message.data());
-			std::string errorMessage = "Failed to compile ";
-
-			if (type == GL_VERTEX_SHADER) errorMessage += "vertex";
-			else if (type == GL_FRAGMENT_SHADER) errorMessage += "fragment";
-			else if (type == GL_GEOMETRY_SHADER) errorMessage += "geometry";
-			else errorMessage += "unknown";
-
-			errorMessage += " shader: ";
-			errorMessage += message.data();
-			glDeleteShader(id);
-
-			std::cout << errorMessage << "\n";
-			throw std::runtime_error(errorMessage);
+		for (const auto& block : frameUniformBlocks) {
+			unsigned int blockIndex = glGetUniformBlockIndex(m_rendererID, block.name);
+			if (blockIndex != GL_INVALID_INDEX)
+				glUniformBlockBinding(m_rendererID, blockIndex, block.binding);
 		}
-#endif 
-		return id;
 	}
 
-	std::tuple<std::string, std::string, std::string> ParseShader(const std::string& vertexShaderPath,
-		const std::string& fragmentShaderPath, const std::string& geometryShaderPath)
+	void Create(const std::string& vertexSource, const std::string& fragmentSource, const std::string& geometrySource)
 	{
-		std::ifstream vShaderFile(vertexShaderPath);
-		std::ifstream fShaderFile(fragmentShaderPath);
-
-		std::stringstream vShaderStream, fShaderStream, gShaderStream;
-
-#ifdef  _DEBUG
-		if (!vShaderFile.is_open())
-			std::cerr << "failed to open vertex shader file: " << vertexShaderPath;
+		// Get the shader program from the cache; identical stages are compiled and identical programs linked only once.
+		m_rendererID = ShaderCache::Get().AcquireProgram(vertexSource, fragmentSource, geometrySource);
 
-		if (!fShaderFile.is_open())
-			std::cerr << "failed to open fragment shader file: " << fragmentShaderPath;
-#endif 
-
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-
-		if (!geometryShaderPath.empty()) {
-			std::ifstream gShaderFile(geometryShaderPath);
-#ifdef _DEBUG
-			if (!gShaderFile.is_open())
-				std::cerr << "failed to open geometry shader file: " << geometryShaderPath;
-#endif
-			gShaderStream << gShaderFile.rdbuf();
-			gShaderFile.close();
-		}
-
-		vShaderFile.close();
-		fShaderFile.close();
+		// Attach the shared per-frame uniform blocks (Camera, Lights...) to their fixed binding points.
+		AttachFrameUniformBlocks();
+	}
 
-		return std::make_tuple(vShaderStream.str(), fShaderStream.str(), gShaderStream.str());
+	// Inserts "#define NAME" lines after the #version line, which has to stay the first statement of the source.
+	// Every variant has its own source text, so the ShaderCache compiles each one separately.
+	static std::string AddDefines(const std::string& source, const std::vector<std::string>& defines)
+	{
+		if (defines.empty())
+			return source;
+
+		std::string lines;
+		for (const auto& define : defines)
+			lines += "#define " + define + "\n";
+
+		size_t version = source.find("#version");
+		if (version == std::string::npos)
+			return lines + source;
+		size_t insert = source.find('\n', version);
+		if (insert == std::string::npos)
+			return source + "\n" + lines;
+		return source.substr(0, insert + 1) + lines + source.substr(insert + 1);
 	}
 
-	unsigned int CreateShader(const std::string& vertexShader,
-		const std::string& fragmentShader, const std::string& geometryShader)
+	// Returns the embedded source for the path if there is one, otherwise reads the file.
+	static std::string LoadSource(const std::string& path)
 	{
-		unsigned int program = glCreateProgram();
-		unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertexShader);
-		unsigned int fs = CompileShader(GL_FRAGMENT_SHADER, fragmentShader);
-
-		unsigned int gs = 0;
-		if (!geometryShader.empty()) {
-			gs = CompileShader(GL_GEOMETRY_SHADER, geometryShader);
-			glAttachShader(program, gs);
+#ifndef SHADERS_FROM_DISK
+		for (const auto& shader : embeddedShaders) {
+			if (path == shader.path) {
+				loadStats.embeddedSources++;
+				return shader.source;
+			}
 		}
-		glAttachShader(program, vs);
-		glAttachShader(program, fs);
-		glLinkProgram(program);
-		glValidateProgram(program);
+#endif
+		std::ifstream file(path);
+		loadStats.fileOpens++;
 
-		glDeleteShader(vs);
-		glDeleteShader(fs);
-		if (gs != 0)
-			glDeleteShader(gs);
+#ifdef _DEBUG
+		if (!file.is_open())
+			std::cerr << "failed to open shader file: " << path;
+#endif
 
-		return program;
+		std::stringstream stream;
+		stream << file.rdbuf();
+		return stream.str();
 	}
 
 private:
+	static inline ShaderLoadStats loadStats;
+
 	unsigned int m_rendererID; // Unique identifier for the OpenGL shader program
 	std::unordered_set<std::string> warnedUniforms; // Set to keep track of uniform variables that have already triggered a warning
 };
\ No newline at end of file
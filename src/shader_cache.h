@@ -0,0 +1,219 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <GL/glew.h>
+
+#include "gl_state.h"
+#include "cpu_profiler.h"
+
+// Counters of how much compile and link work the cache saved.
+struct ShaderCacheStats
+{
+	unsigned int stagesCompiled = 0;
+	unsigned int stageHits = 0;
+	unsigned int programsLinked = 0;
+	unsigned int programHits = 0;
+};
+
+// The ShaderCache class deduplicates shader objects and linked programs inside the process.
+// Stages are keyed by a hash of (type, source) and compiled once; programs are keyed by their stage objects
+// and linked once. Both are reference counted and deleted when the last Shader using them goes away.
+//
+// Since identical programs are shared, uniforms set through one Shader are visible through every Shader
+// built from the same sources.
+//
+// Usage Example:
+// unsigned int program = ShaderCache::Get().AcquireProgram(vertexSource, fragmentSource, geometrySource);
+// ...
+// ShaderCache::Get().ReleaseProgram(program);
+class ShaderCache
+{
+public:
+	static ShaderCache& Get()
+	{
+		static ShaderCache instance;
+		return instance;
+	}
+
+	ShaderCache(const ShaderCache&) = delete;
+	ShaderCache& operator=(const ShaderCache&) = delete;
+
+	// Returns a linked program for the given sources, an empty geometry source means no geometry stage.
+	unsigned int AcquireProgram(const std::string& vertexSource,
+		const std::string& fragmentSource, const std::string& geometrySource)
+	{
+		unsigned int vs = AcquireStage(GL_VERTEX_SHADER, vertexSource);
+		unsigned int fs = AcquireStage(GL_FRAGMENT_SHADER, fragmentSource);
+		unsigned int gs = geometrySource.empty() ? 0 : AcquireStage(GL_GEOMETRY_SHADER, geometrySource);
+
+		for (auto& entry : programs) {
+			if (entry.vs == vs && entry.fs == fs && entry.gs == gs) {
+				// the program already holds its stages, drop the references taken above
+				ReleaseStage(vs);
+				ReleaseStage(fs);
+				if (gs != 0)
+					ReleaseStage(gs);
+
+				entry.refCount++;
+				stats.programHits++;
+				return entry.program;
+			}
+		}
+
+		CPU_PROFILE_SCOPE("ShaderCache::LinkProgram");
+		unsigned int program = glCreateProgram();
+		if (gs != 0)
+			glAttachShader(program, gs);
+		glAttachShader(program, vs);
+		glAttachShader(program, fs);
+		glLinkProgram(program);
+
+		// Stages that compile on their own can still fail to link together, e.g. a uniform block declared
+		// differently in the vertex and fragment shader; the program then silently draws nothing
+		int linked;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (linked == GL_FALSE) {
+			int length;
+			glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+			std::vector<char> message(length > 0 ? length : 1, '\0');
+			glGetProgramInfoLog(program, (int)message.size(), nullptr, message.data());
+			std::cerr << "Failed to link shader program: " << message.data() << "\n";
+		}
+		glValidateProgram(program);
+
+		programs.push_back({ program, vs, fs, gs, 1 });
+		stats.programsLinked++;
+		return program;
+	}
+
+	void ReleaseProgram(unsigned int program)
+	{
+		for (size_t i = 0; i < programs.size(); i++) {
+			if (programs[i].program != program)
+				continue;
+
+			if (--programs[i].refCount == 0) {
+				ProgramEntry entry = programs[i];
+				programs.erase(programs.begin() + i);
+
+				GLState::Get().DeleteProgram(entry.program);
+				ReleaseStage(entry.vs);
+				ReleaseStage(entry.fs);
+				if (entry.gs != 0)
+					ReleaseStage(entry.gs);
+			}
+			return;
+		}
+	}
+
+	const ShaderCacheStats& GetStats() const { return stats; }
+
+private:
+	ShaderCache() = default;
+
+	struct StageEntry
+	{
+		GLenum type;
+		std::string source; // kept to rule out hash collisions
+		unsigned int shader;
+		unsigned int refCount;
+	};
+
+	struct ProgramEntry
+	{
+		unsigned int program;
+		unsigned int vs, fs, gs;
+		unsigned int refCount;
+	};
+
+	// 64-bit FNV-1a over the stage type and its source.
+	static unsigned long long HashStage(GLenum type, const std::string& source)
+	{
+		unsigned long long hash = 14695981039346656037ull;
+		hash = (hash ^ type) * 1099511628211ull;
+		for (unsigned char c : source)
+			hash = (hash ^ c) * 1099511628211ull;
+		return hash;
+	}
+
+	unsigned int AcquireStage(GLenum type, const std::string& source)
+	{
+		std::vector<StageEntry>& bucket = stages[HashStage(type, source)];
+		for (auto& entry : bucket) {
+			if (entry.type == type && entry.source == source) {
+				entry.refCount++;
+				stats.stageHits++;
+				return entry.shader;
+			}
+		}
+
+		unsigned int shader = CompileShader(type, source);
+		bucket.push_back({ type, source, shader, 1 });
+		stats.stagesCompiled++;
+		return shader;
+	}
+
+	void ReleaseStage(unsigned int shader)
+	{
+		for (auto it = stages.begin(); it != stages.end(); ++it) {
+			std::vector<StageEntry>& bucket = it->second;
+			for (size_t i = 0; i < bucket.size(); i++) {
+				if (bucket[i].shader != shader)
+					continue;
+
+				if (--bucket[i].refCount == 0) {
+					glDeleteShader(shader);
+					bucket.erase(bucket.begin() + i);
+					if (bucket.empty())
+						stages.erase(it);
+				}
+				return;
+			}
+		}
+	}
+
+	unsigned int CompileShader(unsigned int type, const std::string& source)
+	{
+		CPU_PROFILE_SCOPE("ShaderCache::CompileShader");
+		unsigned int id = glCreateShader(type);
+		const char* src = source.c_str();
+		glShaderSource(id, 1, &src, nullptr);
+		glCompileShader(id);
+
+#ifdef _DEBUG
+		int result;
+		glGetShaderiv(id, GL_COMPILE_STATUS, &result);
+
+		if (result == GL_FALSE) {
+			int length;
+			glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+			std::vector<char> message(length);
+			glGetShaderInfoLog(id, length, &length, message.data());
+			std::string errorMessage = "Failed to compile ";
+
+			if (type == GL_VERTEX_SHADER) errorMessage += "vertex";
+			else if (type == GL_FRAGMENT_SHADER) errorMessage += "fragment";
+			else if (type == GL_GEOMETRY_SHADER) errorMessage += "geometry";
+			else errorMessage += "unknown";
+
+			errorMessage += " shader: ";
+			errorMessage += message.data();
+			glDeleteShader(id);
+
+			std::cout << errorMessage << "\n";
+			throw std::runtime_error(errorMessage);
+		}
+#endif
+		return id;
+	}
+
+private:
+	std::unordered_map<unsigned long long, std::vector<StageEntry>> stages;
+	std::vector<ProgramEntry> programs; // a handful per demo, a linear scan is enough
+	ShaderCacheStats stats;
+};
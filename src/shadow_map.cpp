@@ -7,22 +7,28 @@
 #include "camera.h"
 #include "model.h"
 #include "shader.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "benchmark.h"
+#include "uniform_buffer.h"
+#include "render_target.h"
+#include "frustum_culling.h"
 
 // Function declarations
-void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT);
+void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void ProcessInput(GLFWwindow* window);
-void CreateDepthMapFBO(unsigned int& depthMapFBO, unsigned int& depthMap);
 unsigned int LoadTexture(const std::string& path, bool gammaCorrection = false);
 
-void RenderScene(Shader& shader);
+void RenderScene(Shader& shader, const Frustum& frustum);
 void RenderCube();
 void RenderQuad();
 
 // Scene settings
-static constexpr int SCR_WIDTH = 800;
-static constexpr int SCR_HEIGHT = 600;
+static int SCR_WIDTH = 800;
+static int SCR_HEIGHT = 600;
 static constexpr int SHADOW_WIDTH = 1024;
 static constexpr int SHADOW_HEIGHT = 1024;
 
@@ -44,12 +50,16 @@ static unsigned int quadVBO = 0;
 static unsigned int cubeVAO = 0;
 static unsigned int cubeVBO = 0;
 
-int main()
+int main(int argc, char** argv)
 {
+	// --benchmark runs a fixed, hidden, vsync-off camera loop and writes benchmark_shadow_map.json
+	Benchmark benchmark("shadow_map", argc, argv);
+
 	GLFWwindow* window = nullptr;
 	try {
 		if (!glfwInit()) 
 			throw std::runtime_error("failed to init glfw");
+		benchmark.ApplyWindowHints();
 		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "hnzz", nullptr, nullptr);
 		if (!window)
 			throw std::runtime_error("failed to create window");
@@ -62,9 +72,10 @@ int main()
 
 		if(glewInit() != GLEW_OK) 
 			throw std::runtime_error("failed to init glew");
+		benchmark.ConfigureContext();
 
 		// configure global opengl state
-		glEnable(GL_DEPTH_TEST);
+		GLState::Get().Enable(GL_DEPTH_TEST);
 		//glEnable(GL_BLEND);
 		//glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	}
@@ -87,7 +98,7 @@ int main()
 	// Set up VAO & VBO for plane
 	glGenVertexArrays(1, &planeVAO);
 	glGenBuffers(1, &planeVBO);
-	glBindVertexArray(planeVAO);
+	GLState::Get().BindVertexArray(planeVAO);
 	glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
 
@@ -97,17 +108,18 @@ int main()
 	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
 	glEnableVertexAttribArray(2);
 	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glBindVertexArray(0);
+	GLState::Get().BindVertexArray(0);
 
-	// Configure depth map FBO (frame buffer object)
-	unsigned int depthMapFBO = 0, depthMap = 0;
-	CreateDepthMapFBO(depthMapFBO, depthMap);
+	// Configure depth map FBO (frame buffer object), a depth-only target from the pool.
+	// Clamp to a white border so everything outside the light's frustum is lit.
+	RenderTarget depthMapTarget({ { GL_DEPTH_COMPONENT24, SHADOW_WIDTH, SHADOW_HEIGHT, GL_NEAREST, 1, GL_CLAMP_TO_BORDER } });
+	unsigned int depthMap = depthMapTarget.GetTexture(0);
 
 	// Shader & texture configs
-	Shader shader("res/shaders/shadow_map.vs", "res/shaders/shadow_map.fs"); // shader render with depth_map, applying bias and PCF
-	Shader simpleDepthShader("res/shaders/shadow_map_depth.vs", "res/shaders/shadow_map_depth.fs"); // shader with designated FBO to render depth map
-	Shader debugDepthQuad("res/shaders/debug_quad.vs", "res/shaders/debug_quad.fs");
-	Shader lightShader("res/shaders/light.vs", "res/shaders/light.fs");
+	Shader shader(SHADER_SHADOW_MAP_VS, SHADER_SHADOW_MAP_FS); // shader render with depth_map, applying bias and PCF
+	Shader simpleDepthShader(SHADER_SHADOW_MAP_DEPTH_VS, SHADER_SHADOW_MAP_DEPTH_FS); // shader with designated FBO to render depth map
+	Shader debugDepthQuad(SHADER_DEBUG_QUAD_VS, SHADER_DEBUG_QUAD_FS);
+	Shader lightShader(SHADER_LIGHT_VS, SHADER_LIGHT_FS);
 
 	unsigned int woodTexture = LoadTexture("res/textures/wood.png");
 	debugDepthQuad.Bind();
@@ -120,7 +132,21 @@ int main()
 	glm::vec3 lightPosition(-2.0f, 4.0f, -1.0f); // Point light
 	//glm::vec3 lightDirection(1.0f, -1.0f, 1.0f); // Directional light
 
-	while (!glfwWindowShouldClose(window)) {
+	// Shared per-frame uniform blocks
+	FrameConstants frameConstants;
+
+	while (!glfwWindowShouldClose(window) && benchmark.NextFrame(camera)) {
+		// Publish last frame's state-cache counters and start counting this frame
+		GLState::Get().NewFrame();
+		// Drop render targets that stayed idle since the last resize
+		RenderTargetPool::Get().NewFrame();
+		// Read back the GPU timings of an older frame and start recording this one
+		GpuProfiler::Get().BeginFrame();
+		// Build the CPU call tree of the previous frame
+		CpuProfiler::Get().NewFrame();
+		// Publish last frame's culling counters
+		FrustumCuller::Get().NewFrame();
+
 		// per-frame logic
 		float currentFrame = static_cast<float>(glfwGetTime());
 		deltaTime = currentFrame - lastFrame;
@@ -145,95 +171,116 @@ int main()
 		simpleDepthShader.SetMat4("lightSpaceMatrix", lightSpaceMatrix);
 
 		// 1. Render scene from light's point of view to generate depth map
-		glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-		glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+		GpuProfiler::Get().Begin("shadow depth");
+		depthMapTarget.Bind(); // also sets the viewport to the shadow map size
 		glClear(GL_DEPTH_BUFFER_BIT); // explicitly clear deapth buffer since we are rendering depth value
-		glCullFace(GL_FRONT);
-		RenderScene(simpleDepthShader);
-		glCullFace(GL_BACK);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0); // bind to default framebuffer
+		GLState::Get().CullFace(GL_FRONT);
+		RenderScene(simpleDepthShader, Frustum(lightSpaceMatrix));
+		GLState::Get().CullFace(GL_BACK);
+		GpuProfiler::Get().End();
+		GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0); // bind to default framebuffer
 
 		// Reset viewport
-		glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+		GLState::Get().Viewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// 2. Render scene using the generated depth map
+		GpuProfiler::Get().Begin("lighting");
 		shader.Bind();
 		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.01f, 100.0f);
 		glm::mat4 view = camera.GetViewMatrix();
-		shader.SetMat4("projection", projection);
-		shader.SetMat4("view", view);
+		frameConstants.SetCamera(projection, view, camera.position);
 
-		shader.SetVec3("viewPos", camera.position);
 		shader.SetVec3("lightPosition", lightPosition);
 		//shader.SetVec3("lightDirection", lightDirection);
 		shader.SetMat4("lightSpaceMatrix", lightSpaceMatrix);
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, woodTexture);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, depthMap); // using rendered depthMap
-		RenderScene(shader);
+		GLState::Get().ActiveTexture(GL_TEXTURE0);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, woodTexture);
+		GLState::Get().ActiveTexture(GL_TEXTURE1);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, depthMap); // using rendered depthMap
+		RenderScene(shader, Frustum(projection * view));
+		GpuProfiler::Get().End();
 
 		// optional: Render Depth map to quad for visual debugging
 		debugDepthQuad.Bind();
 		debugDepthQuad.SetFloat("near_plane", near_plane);
 		debugDepthQuad.SetFloat("far_plane", far_plane);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, depthMap); // Use depth map as texture to render
+		GLState::Get().ActiveTexture(GL_TEXTURE0);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, depthMap); // Use depth map as texture to render
 		//RenderQuad();
 
 		// optional: Render light 
+		GpuProfiler::Get().Begin("light source");
 		lightShader.Bind();
 		glm::mat4 model = glm::mat4(1.0f);
 		model = glm::translate(model, lightPosition);
 		model = glm::scale(model, glm::vec3(0.01f));
 
-		lightShader.SetMat4("projection", projection);
-		lightShader.SetMat4("view", view);
 		lightShader.SetMat4("model", model);
 
 		RenderCube();
+		GpuProfiler::Get().End();
+
+		GpuProfiler::Get().EndFrame();
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-		glfwSwapBuffers(window);
+		{
+			CPU_PROFILE_SCOPE("glfwSwapBuffers"); // includes the vsync wait
+			glfwSwapBuffers(window);
+		}
 		glfwPollEvents();
 	}
 
-	glDeleteVertexArrays(1, &planeVAO);
+	benchmark.Finish();
+
+	GLState::Get().DeleteVertexArrays(1, &planeVAO);
 	glDeleteBuffers(1, &planeVBO);
 
 	glfwTerminate();
 }
 
-// Render the 3D scene
-void RenderScene(Shader& shader)
+// Render the 3D scene, skipping the objects outside the frustum of the pass (camera or light)
+void RenderScene(Shader& shader, const Frustum& frustum)
 {
-	// floor
-	glm::mat4 model = glm::mat4(1.0f);
-	shader.SetMat4("model", model);
-	glBindVertexArray(planeVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
+	static BoundsBatch bounds;
+	static std::vector<uint8_t> visible;
 
 	// cubes
-	model = glm::mat4(1.0f);
-	model = glm::translate(model, glm::vec3(0.0f, 1.5f, 0.0));
-	model = glm::scale(model, glm::vec3(0.5f));
-	shader.SetMat4("model", model);
-	RenderCube();
-
-	model = glm::mat4(1.0f);
-	model = glm::translate(model, glm::vec3(2.0f, 0.0f, 1.0));
-	model = glm::scale(model, glm::vec3(0.5f));
-	shader.SetMat4("model", model);
-	RenderCube();
-
-	model = glm::mat4(1.0f);
-	model = glm::translate(model, glm::vec3(-1.0f, 0.0f, 2.0));
-	model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
-	model = glm::scale(model, glm::vec3(0.25));
-	shader.SetMat4("model", model);
-	RenderCube();
+	glm::mat4 cubeModels[3];
+	cubeModels[0] = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.5f, 0.0));
+	cubeModels[0] = glm::scale(cubeModels[0], glm::vec3(0.5f));
+	cubeModels[1] = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, 1.0));
+	cubeModels[1] = glm::scale(cubeModels[1], glm::vec3(0.5f));
+	cubeModels[2] = glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 0.0f, 2.0));
+	cubeModels[2] = glm::rotate(cubeModels[2], glm::radians(60.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
+	cubeModels[2] = glm::scale(cubeModels[2], glm::vec3(0.25));
+
+	// entry 0 is the floor plane
+	bounds.Clear();
+	bounds.AddBox(glm::vec3(-25.0f, -0.5f, -25.0f), glm::vec3(25.0f, -0.5f, 25.0f));
+	for (const glm::mat4& cubeModel : cubeModels)
+		bounds.AddBox(glm::vec3(-1.0f), glm::vec3(1.0f), cubeModel);
+	size_t visibleCount = bounds.Size();
+	if (FrustumCuller::Get().enabled)
+		visibleCount = bounds.Cull(frustum, visible);
+	else
+		visible.assign(bounds.Size(), 1);
+	FrustumCuller::Get().Count(bounds.Size(), visibleCount);
+
+	// floor
+	if (visible[0]) {
+		shader.SetMat4("model", glm::mat4(1.0f));
+		GLState::Get().BindVertexArray(planeVAO);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
+
+	for (int i = 0; i < 3; i++) {
+		if (!visible[i + 1])
+			continue;
+		shader.SetMat4("model", cubeModels[i]);
+		RenderCube();
+	}
 }
 
 // renderCube() renders a 1x1 3D cube in NDC.
@@ -298,7 +345,7 @@ void RenderCube()
 		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
 		// link vertex attributes
-		glBindVertexArray(cubeVAO);
+		GLState::Get().BindVertexArray(cubeVAO);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(1);
@@ -306,13 +353,12 @@ void RenderCube()
 		glEnableVertexAttribArray(2);
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		GLState::Get().BindVertexArray(0);
 	}
 
 	// render Cube
-	glBindVertexArray(cubeVAO);
+	GLState::Get().BindVertexArray(cubeVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
 }
 
 // renderQuad() renders a 1x1 XY quad in NDC
@@ -331,7 +377,7 @@ void RenderQuad()
 		glGenVertexArrays(1, &quadVAO);
 		glGenBuffers(1, &quadVBO);
 
-		glBindVertexArray(quadVAO);
+		GLState::Get().BindVertexArray(quadVAO);
 		glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
 
@@ -341,18 +387,19 @@ void RenderQuad()
 		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 	}
 
-	glBindVertexArray(quadVAO);
+	GLState::Get().BindVertexArray(quadVAO);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	glBindVertexArray(0);
 }
 
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
-void framebuffer_size_callback(GLFWwindow* window, int SCR_WIDTH, int SCR_HEIGHT)
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
 	// make sure the viewport matches the new window dimensions; note that SCR_WIDTH and 
 	// SCR_HEIGHT will be significantly larger than specified on retina displays.
-	glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+	GLState::Get().Viewport(0, 0, width, height);
+	SCR_WIDTH = width;
+	SCR_HEIGHT = height;
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -397,12 +444,17 @@ void ProcessInput(GLFWwindow* window)
 		camera.ProcessKeyboard(LEFT, deltaTime);
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
 		camera.ProcessKeyboard(RIGHT, deltaTime);
+
+	// Print the GPU pass timings and write them to gpu_profile.csv by pressing P
+	GpuProfiler::Get().ReportOnKey(glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS);
+	// Write the CPU trace (chrome://tracing, ui.perfetto.dev) to cpu_trace.json by pressing T
+	CpuProfiler::Get().ExportOnKey(glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS);
 }
 
 // IMPORTANT REMINDER:
 // If you are loading textures with gammaCorrection set to true (meaning they are sRGB),
 // ensure to also enable GL_FRAMEBUFFER_SRGB in your rendering pipeline.
-// i.e., glEnable(GL_FRAMEBUFFER_SRGB);
+// i.e., GLState::Get().Enable(GL_FRAMEBUFFER_SRGB);
 unsigned int LoadTexture(const std::string& path, bool gammaCorrection)
 {
 	unsigned int textureID;
@@ -429,7 +481,7 @@ unsigned int LoadTexture(const std::string& path, bool gammaCorrection)
 			return 0;
 		}
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, SCR_WIDTH, SCR_HEIGHT, 0, format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -447,27 +499,3 @@ unsigned int LoadTexture(const std::string& path, bool gammaCorrection)
 
 	return textureID;
 }
-
-// return tuple, FBO & depthMap
-void CreateDepthMapFBO(unsigned int& depthMapFBO, unsigned int& depthMap)
-{
-	glGenFramebuffers(1, &depthMapFBO);
-
-	// Create depth texture (id)
-	glGenTextures(1, &depthMap);
-	glBindTexture(GL_TEXTURE_2D, depthMap);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-	GLfloat borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
-	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-
-	// Attach depth texture as FBO's depth buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
\ No newline at end of file
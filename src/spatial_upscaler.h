@@ -0,0 +1,73 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "gl_state.h"
+#include "shader.h"
+#include "render_target.h"
+#include "geometry_renderers.h"
+
+// The SpatialUpscaler class upscales a low resolution image to the output resolution with the two FSR1 passes:
+// EASU (edge adaptive upsampling, input -> output size) followed by RCAS (contrast adaptive sharpening, output size).
+// Both expect a tonemapped, perceptual-space input, so upscale after the post chain, not before.
+//
+// Render() runs both passes, keeping the EASU result in a pooled RenderTarget, and leaves the output in the
+// default framebuffer. RenderEASU()/RenderRCAS() only draw into the bound framebuffer, for render graph passes.
+//
+// Usage Example:
+// SpatialUpscaler upscaler;
+// upscaler.sharpness = 0.2f;
+// upscaler.Render(sceneTarget.GetTexture(0), SCR_WIDTH, SCR_HEIGHT);
+class SpatialUpscaler
+{
+public:
+	float sharpness = 0.2f; // RCAS strength in stops, 0.0 is the strongest
+
+	SpatialUpscaler()
+		: easuShader(SHADER_BLUR_VS, SHADER_FSR_EASU_FS), rcasShader(SHADER_BLUR_VS, SHADER_FSR_RCAS_FS),
+		easuTarget({ { GL_RGBA8, 1, 1 } })
+	{
+		easuShader.Bind();
+		easuShader.SetInt("inputTexture", 0);
+		rcasShader.Bind();
+		rcasShader.SetInt("inputTexture", 0);
+	}
+
+	void Render(unsigned int input, int outputWidth, int outputHeight)
+	{
+		easuTarget.Resize(outputWidth, outputHeight);
+		easuTarget.Bind();
+		RenderEASU(input, outputWidth, outputHeight);
+
+		GLState::Get().BindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::Get().Viewport(0, 0, outputWidth, outputHeight);
+		RenderRCAS(easuTarget.GetTexture(0));
+	}
+
+	// Draws the upsampled image into the bound framebuffer, which must be outputWidth x outputHeight.
+	void RenderEASU(unsigned int input, int outputWidth, int outputHeight)
+	{
+		GLState::Get().Disable(GL_DEPTH_TEST);
+		easuShader.Bind();
+		easuShader.SetVec2("outputSize", glm::vec2((float)outputWidth, (float)outputHeight));
+		GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, input);
+		quad.Render();
+		GLState::Get().Enable(GL_DEPTH_TEST); // the demos keep depth testing on by default
+	}
+
+	// Draws the sharpened image into the bound framebuffer, which must have the size of the input.
+	void RenderRCAS(unsigned int input)
+	{
+		GLState::Get().Disable(GL_DEPTH_TEST);
+		rcasShader.Bind();
+		rcasShader.SetFloat("sharpness", sharpness);
+		GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, input);
+		quad.Render();
+		GLState::Get().Enable(GL_DEPTH_TEST);
+	}
+
+private:
+	Shader easuShader, rcasShader;
+	RenderTarget easuTarget;
+	yzh::Quad quad;
+};
@@ -29,9 +29,20 @@
 
 #include "camera.h"
 #include "shader.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "benchmark.h"
+#include "uniform_buffer.h"
+#include "render_graph.h"
 #include "geometry_renderers.h"
 #include "model.h"
+#include "frustum_culling.h"
+#include "bvh.h"
+#include "occlusion_culling.h"
 #include "timer.h"
+#include "temporal.h"
+#include "gaussian_kernel.h"
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_glfw.h"
@@ -63,9 +74,16 @@ float lastFrame = 0.0f;
 
 // SSAO settings
 bool enableSSAO = true;
+bool packedGBuffer = false; // depth + octahedral RG16 normal instead of RGBA16F position and normal
+bool halfResolutionSSAO = false; // occlusion at half resolution, bilateral blur and upsample back to full
+bool temporalSSAO = false; // rotate the kernel every frame and accumulate the result over frames
+bool gaussianBlur = false; // full resolution: separable Gaussian from the BlurKernel block instead of the 4x4 box
 
-int main()
+int main(int argc, char** argv)
 {
+	// --benchmark runs a fixed, hidden, vsync-off camera loop and writes benchmark_ssao.json
+	Benchmark benchmark("ssao", argc, argv);
+
 	Timer timer;
 	timer.start();
 
@@ -75,6 +93,7 @@ int main()
 	try {
 		if (!glfwInit())
 			throw std::runtime_error("failed to init glfw");
+		benchmark.ApplyWindowHints();
 		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "hnzz", nullptr, nullptr);
 		if (!window)
 			throw std::runtime_error("failed to create window");
@@ -86,9 +105,10 @@ int main()
 
 		if (glewInit() != GLEW_OK)
 			throw std::runtime_error("failed to init glew");
+		benchmark.ConfigureContext();
 
 		// OpenGL global status settings here
-		glEnable(GL_DEPTH_TEST);
+		GLState::Get().Enable(GL_DEPTH_TEST);
 		//glEnable(GL_CULL_FACE);
 	}
 	catch (const std::runtime_error& e) {
@@ -108,11 +128,22 @@ int main()
 
 	// build and compile shader(s)
 	// ---------------------------
-	Shader shaderGeometryPass("res/shaders/ssao_geometry.vs", "res/shaders/ssao_geometry.fs");
-	Shader shaderSSAO("res/shaders/ssao.vs", "res/shaders/ssao.fs");
-	Shader shaderSSAOBlur("res/shaders/ssao.vs", "res/shaders/ssao_blur.fs");
-	Shader shaderLightingPass("res/shaders/ssao.vs", "res/shaders/ssao_lighting.fs");
-	Shader shaderLightSource("res/shaders/deferred_light_box.vs", "res/shaders/deferred_light_box.fs");
+	Shader shaderGeometryPass(SHADER_SSAO_GEOMETRY_VS, SHADER_SSAO_GEOMETRY_FS);
+	Shader shaderSSAO(SHADER_SSAO_VS, SHADER_SSAO_FS);
+	Shader shaderSSAOBlur(SHADER_SSAO_VS, SHADER_SSAO_BLUR_FS);
+	Shader shaderGaussianBlur(SHADER_SSAO_VS, SHADER_GAUSSIAN_BLUR_FS);
+	Shader shaderLightingPass(SHADER_SSAO_VS, SHADER_SSAO_LIGHTING_FS);
+	// the same passes for the packed G-buffer layout
+	Shader packedGeometryPass(SHADER_SSAO_GEOMETRY_VS, SHADER_SSAO_GEOMETRY_FS, EMBEDDED_SHADER_NONE, { "PACKED_GBUFFER" });
+	Shader packedSSAO(SHADER_SSAO_VS, SHADER_SSAO_FS, EMBEDDED_SHADER_NONE, { "PACKED_GBUFFER" });
+	Shader packedLightingPass(SHADER_SSAO_VS, SHADER_SSAO_LIGHTING_FS, EMBEDDED_SHADER_NONE, { "PACKED_GBUFFER" });
+	// half-resolution SSAO
+	Shader shaderSSAODownsample(SHADER_SSAO_VS, SHADER_SSAO_DOWNSAMPLE_FS);
+	Shader packedSSAODownsample(SHADER_SSAO_VS, SHADER_SSAO_DOWNSAMPLE_FS, EMBEDDED_SHADER_NONE, { "PACKED_GBUFFER" });
+	Shader shaderSSAOBilateralBlur(SHADER_SSAO_VS, SHADER_SSAO_BILATERAL_BLUR_FS);
+	Shader shaderSSAOUpsample(SHADER_SSAO_VS, SHADER_SSAO_UPSAMPLE_FS);
+	Shader packedSSAOUpsample(SHADER_SSAO_VS, SHADER_SSAO_UPSAMPLE_FS, EMBEDDED_SHADER_NONE, { "PACKED_GBUFFER" });
+	Shader shaderLightSource(SHADER_DEFERRED_LIGHT_BOX_VS, SHADER_DEFERRED_LIGHT_BOX_FS);
 
 	// load model(s)
 	// -------------
@@ -124,108 +155,37 @@ int main()
 	yzh::Cube cube;
 	yzh::Sphere sphere;
 
-	// Set up G-Buffer with 3 textures:
-	// 
-    // 1. Position
-    // 2. Color
-    // 3. Normal 
-	// ---------------
-	unsigned int gBuffer;
-	glGenFramebuffers(1, &gBuffer);
-	glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-
-	unsigned int gPosition, gNormal, gAlbedo;
-	glGenTextures(1, &gPosition);
-	glBindTexture(GL_TEXTURE_2D, gPosition);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-
-	glGenTextures(1, &gNormal);
-	glBindTexture(GL_TEXTURE_2D, gNormal);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-
-	glGenTextures(1, &gAlbedo);
-	glBindTexture(GL_TEXTURE_2D, gAlbedo);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedo, 0);
-
-	unsigned int attachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-	glDrawBuffers(3, attachments);
-
-	unsigned int rboDepth;
-	glGenRenderbuffers(1, &rboDepth);
-	glBindBuffer(GL_RENDERBUFFER, rboDepth);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "GBuffer Framebuffer not complete!" << std::endl;
-
-	// 2. Create SSAO texture
-    // ----------------------
-	unsigned int ssaoFBO, ssaoColorBuffer;
-	glGenFramebuffers(1, &ssaoFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-
-	glGenTextures(1, &ssaoColorBuffer);
-	glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBuffer, 0);
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "SSAO Framebuffer not complete!" << std::endl;
-
-	// 3. Blur SSAO texture to remove noise
-	// ------------------------------------
-	unsigned int ssaoBlurFBO, ssaoColorBufferBlur;
-	glGenFramebuffers(1, &ssaoBlurFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-
-	glGenTextures(1, &ssaoColorBufferBlur);
-	glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBufferBlur, 0);
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "SSAO Blur Framebuffer not complete!" << std::endl;
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-	// 4. Sample kernel (in tangent space)
+	// 1. Sample kernel (in tangent space)
 	// -----------------------------------
-	std::random_device rd;
-	std::mt19937 gen(rd());
+	std::mt19937 gen(benchmark.GetSeed());
 	std::uniform_real_distribution<float> dis(-1, 1);
 
+	// The sample count is a UI slider, the kernel is regenerated when it changes (the shader loops over kernelSize)
 	std::vector<glm::vec3>sampleKernel;
-	unsigned int sampleSize = 16;
+	int sampleSize = 16;
 	float radius = 0.05f;
-	for (size_t i = 0; i < sampleSize; i++) {
-		glm::vec3 sample(dis(gen), dis(gen), (dis(gen) * 0.5f + 0.5f)); // Generate random sample point in a hemisphere oriented along the z-axis
-		sample = glm::normalize(sample);
-		sample *= dis(gen); // Provide random length of sample vector
-
-		// Scale samples so that they are more aligned to the center of the kernel
-		float scale = float(i) / (float)sampleSize;
-		scale = glm::mix(0.1f, 1.0f, scale * scale);
-		sample *= scale;
-		sampleKernel.emplace_back(sample);
-	}
+	auto GenerateKernel = [&]() {
+		sampleKernel.clear();
+		for (int i = 0; i < sampleSize; i++) {
+			glm::vec3 sample(dis(gen), dis(gen), (dis(gen) * 0.5f + 0.5f)); // Generate random sample point in a hemisphere oriented along the z-axis
+			sample = glm::normalize(sample);
+			sample *= dis(gen); // Provide random length of sample vector
+
+			// Scale samples so that they are more aligned to the center of the kernel
+			float scale = float(i) / (float)sampleSize;
+			scale = glm::mix(0.1f, 1.0f, scale * scale);
+			sample *= scale;
+			sampleKernel.emplace_back(sample);
+		}
+	};
+	GenerateKernel();
+	int generatedSampleSize = sampleSize;
+	float depthSharpness = 20.0f; // bilateral blur and upsample: weight falloff per relative depth difference
 
-	// 5. Noise texture (in tangent space)
+	// 2. Noise texture (in tangent space)
 	unsigned int noiseTexture;
 	glGenTextures(1, &noiseTexture);
-	glBindTexture(GL_TEXTURE_2D, noiseTexture);
+	GLState::Get().BindTexture(GL_TEXTURE_2D, noiseTexture);
 
 	std::vector<glm::vec3>ssaoNoise;
 	for (size_t i = 0; i < 16; i++) {
@@ -240,15 +200,36 @@ int main()
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // Use GL_REPEAT to fill the quad as the noise texture is relatively small
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); 
 
-	// lighting info
+	// Temporal accumulation: the SSAO result is blended with last frame's, reprojected through a velocity target.
+	// The noise vectors turn by the golden angle every frame, so a few kernel samples per frame converge to many.
+	// The camera is not jittered, the lit image has no resolve of its own and would shimmer.
+	TemporalCamera temporalCamera;
+	temporalCamera.jitter = false;
+	TemporalHistory ssaoHistory({ GL_R8, SCR_WIDTH, SCR_HEIGHT, GL_LINEAR });
+	TemporalResolve temporalResolve;
+
+	// Shared per-frame uniform blocks (Camera, Lights, SSAOKernel)
+	// ------------------------------------------------------------
+	FrameConstants frameConstants;
+
+	// Gaussian blur kernel, shared by the separable full-resolution blur and the half-resolution bilateral blur
+	// through the BlurKernel block; regenerated when its sliders change. Sigma 2 and radius 4 give the 9 taps
+	// the bilateral blur used to hardcode.
+	float blurSigma = 2.0f;
+	int blurRadius = 4;
+	GaussianKernel blurKernel(blurSigma, blurRadius);
+	float kernelSigma = blurSigma; // what blurKernel was generated from, its own radius may be clamped
+	int kernelRadius = blurRadius;
+	frameConstants.SetBlurKernel(blurKernel);
+
+	// lighting info (static, so the Lights block is written only once)
 	// -------------
-	struct Light {
-		glm::vec3 position = glm::vec3(2.0, 4.0, -2.0);
-	    glm::vec3 color = glm::vec3(0.2, 0.2, 0.7);
-		const float linear = 0.09f;
-		const float quadratic = 0.032f;
-	};
-	Light light;
+	PointLight light;
+	light.position = glm::vec3(2.0, 4.0, -2.0);
+	light.color = glm::vec3(0.2, 0.2, 0.7);
+	light.linear = 0.09f;
+	light.quadratic = 0.032f;
+	frameConstants.SetLights({ light });
 
 	// shader configs
 	// --------------
@@ -261,8 +242,351 @@ int main()
 	shaderSSAO.SetInt("gPosition", 0);
 	shaderSSAO.SetInt("gNormal", 1);
 	shaderSSAO.SetInt("noiseTexture", 2);
+	packedLightingPass.Bind();
+	packedLightingPass.SetInt("gDepth", 0);
+	packedLightingPass.SetInt("gNormal", 1);
+	packedLightingPass.SetInt("gAlbedo", 2);
+	packedLightingPass.SetInt("ssao", 3);
+	packedSSAO.Bind();
+	packedSSAO.SetInt("gDepth", 0);
+	packedSSAO.SetInt("gNormal", 1);
+	packedSSAO.SetInt("noiseTexture", 2);
 	shaderSSAOBlur.Bind();
 	shaderSSAOBlur.SetInt("ssaoInput", 0);
+	shaderGaussianBlur.Bind();
+	shaderGaussianBlur.SetInt("image", 0);
+	shaderSSAODownsample.Bind();
+	shaderSSAODownsample.SetInt("gPosition", 0);
+	shaderSSAODownsample.SetInt("gNormal", 1);
+	packedSSAODownsample.Bind();
+	packedSSAODownsample.SetInt("gDepth", 0);
+	packedSSAODownsample.SetInt("gNormal", 1);
+	shaderSSAOBilateralBlur.Bind();
+	shaderSSAOBilateralBlur.SetInt("ssaoInput", 0);
+	shaderSSAOBilateralBlur.SetInt("positionInput", 1);
+	shaderSSAOUpsample.Bind();
+	shaderSSAOUpsample.SetInt("ssaoInput", 0);
+	shaderSSAOUpsample.SetInt("halfPosition", 1);
+	shaderSSAOUpsample.SetInt("gPosition", 2);
+	packedSSAOUpsample.Bind();
+	packedSSAOUpsample.SetInt("ssaoInput", 0);
+	packedSSAOUpsample.SetInt("halfPosition", 1);
+	packedSSAOUpsample.SetInt("gDepth", 2);
+
+	// Render graph: G-buffer -> SSAO -> blur -> lighting -> light source
+	// -----------------------------------------------------------------
+	// The G-buffer and SSAO targets are transient, the graph allocates and aliases them.
+	// It is rebuilt when SSAO is toggled (nothing reads the SSAO targets then, so their passes are culled),
+	// when the G-buffer layout or the SSAO resolution changes and when the window is resized.
+	// At half resolution the SSAO part becomes downsample -> SSAO -> bilateral blur x/y -> bilateral upsample.
+	// With temporal accumulation the geometry pass also writes velocity and the blurred AO goes through a resolve
+	// into the history pair, which is imported and swapped every frame.
+	RenderGraph graph;
+	RenderResource gPosition, gNormal, gAlbedo, gDepth, noise, ssao, ssaoBlur;
+	RenderResource halfPosition, halfNormal, ssaoBlurX, ssaoBlurY;
+	RenderResource gVelocity, ssaoHistoryPrevious, ssaoResolved, ssaoResult;
+	bool graphSSAO = enableSSAO;
+	bool graphPacked = packedGBuffer;
+	bool graphHalfResolution = halfResolutionSSAO;
+	bool graphTemporal = temporalSSAO;
+	bool graphGaussianBlur = gaussianBlur;
+	int graphWidth = 0, graphHeight = 0;
+	glm::mat4 model;
+	Frustum frustum; // camera frustum of the current frame, for culling the backpack's meshes
+
+	// The backpack never moves; its inverse takes cursor rays into its local space for picking
+	glm::mat4 backpackModel = glm::mat4(1.0f);
+	backpackModel = glm::translate(backpackModel, glm::vec3(0.0f, 0.5f, 0.0));
+	backpackModel = glm::rotate(backpackModel, glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
+	glm::mat4 backpackInverseModel = glm::inverse(backpackModel);
+
+	// Occlusion culling: the room and a partition wall behind the backpack are rasterized on the CPU every frame,
+	// the crates stacked behind the wall and the backpack's meshes are tested against them before they are drawn
+	glm::mat4 roomModel = glm::mat4(1.0f);
+	roomModel = glm::translate(roomModel, glm::vec3(0.0, 7.0f, 0.0f));
+	roomModel = glm::scale(roomModel, glm::vec3(7.5f, 7.5f, 7.5f));
+	glm::mat4 wallModel = glm::mat4(1.0f);
+	wallModel = glm::translate(wallModel, glm::vec3(0.0f, 1.5f, -3.0f));
+	wallModel = glm::scale(wallModel, glm::vec3(5.0f, 2.0f, 0.1f));
+	std::vector<glm::mat4> crateModels;
+	for (float z = -4.5f; z >= -6.5f; z -= 1.0f) {
+		for (float x = -4.0f; x <= 4.0f; x += 1.6f) {
+			glm::mat4 crate = glm::translate(glm::mat4(1.0f), glm::vec3(x, -0.1f, z));
+			crateModels.push_back(glm::scale(crate, glm::vec3(0.4f)));
+		}
+	}
+	OcclusionBuffer occlusion;
+	bool showOcclusionBuffer = false;
+
+	auto BuildRenderGraph = [&]() {
+		graphSSAO = enableSSAO;
+		graphPacked = packedGBuffer;
+		graphHalfResolution = halfResolutionSSAO;
+		graphTemporal = enableSSAO && temporalSSAO;
+		graphGaussianBlur = gaussianBlur;
+		graphWidth = SCR_WIDTH;
+		graphHeight = SCR_HEIGHT;
+
+		graph.Reset();
+		RenderResource backbuffer = graph.ImportBackbuffer(SCR_WIDTH, SCR_HEIGHT);
+		noise = graph.ImportTexture("noise", noiseTexture, { GL_RGBA32F, 4, 4 });
+
+		// 1. Geometry Pass: render scene's geometry/color data into gbuffer
+		graph.AddPass("geometry",
+			[&](RenderGraph::PassBuilder& builder) {
+				// the packed layout has no position target, the passes below rebuild view positions from gDepth
+				if (!packedGBuffer)
+					gPosition = builder.Create("gPosition", { GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT });
+				GLenum normalFormat = packedGBuffer ? GL_RG16 : GL_RGBA16F;
+				gNormal = builder.Create("gNormal", { normalFormat, SCR_WIDTH, SCR_HEIGHT });
+				gAlbedo = builder.Create("gAlbedo", { GL_RGBA8, SCR_WIDTH, SCR_HEIGHT });
+				gDepth = builder.Create("gDepth", { GL_DEPTH_COMPONENT24, SCR_WIDTH, SCR_HEIGHT });
+				if (graphTemporal)
+					gVelocity = builder.Create("gVelocity", { GL_RG16F, SCR_WIDTH, SCR_HEIGHT });
+			},
+			[&](const RenderGraph&) {
+				GLState::Get().Enable(GL_DEPTH_TEST);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				Shader& geometryPass = packedGBuffer ? packedGeometryPass : shaderGeometryPass;
+				geometryPass.Bind();
+				geometryPass.SetMat4("viewProjection", temporalCamera.GetViewProjection());
+				geometryPass.SetMat4("previousViewProjection", temporalCamera.GetPreviousViewProjection());
+
+				model = roomModel;
+				geometryPass.SetMat4("model", model);
+				geometryPass.SetInt("invertedNormals", 1); // invert normals as we're inside the cube
+				cube.Render();
+				geometryPass.SetInt("invertedNormals", 0);
+
+				geometryPass.SetMat4("model", wallModel);
+				cube.Render();
+				for (const glm::mat4& crate : crateModels) {
+					AABB box = AABB::Transformed(glm::vec3(-1.0f), glm::vec3(1.0f), crate);
+					if (!frustum.TestBox(box.Center(), box.Extent()) || !occlusion.TestBox(box.min, box.max))
+						continue;
+					geometryPass.SetMat4("model", crate);
+					cube.Render();
+				}
+
+				model = backpackModel;
+				geometryPass.SetMat4("model", model);
+				//nanosuit.Render(geometryPass);
+				backpack.Render(geometryPass, model, frustum, TEXTURE_ALL_BITS, &occlusion);
+			});
+
+		if (!halfResolutionSSAO) {
+			// 2. Perform SSAO Calculation
+			graph.AddPass("ssao",
+				[&](RenderGraph::PassBuilder& builder) {
+					builder.Read(packedGBuffer ? gDepth : gPosition);
+					builder.Read(gNormal);
+					builder.Read(noise);
+					ssao = builder.Create("ssao", { GL_R8, SCR_WIDTH, SCR_HEIGHT, GL_LINEAR }); // linear for the Gaussian taps
+				},
+				[&](const RenderGraph& g) {
+					GLState::Get().Disable(GL_DEPTH_TEST);
+					glClear(GL_COLOR_BUFFER_BIT);
+					Shader& ssaoPass = packedGBuffer ? packedSSAO : shaderSSAO;
+					ssaoPass.Bind();
+					GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(packedGBuffer ? gDepth : gPosition));
+					GLState::Get().BindTextureUnit(1, GL_TEXTURE_2D, g.GetTexture(gNormal));
+					GLState::Get().BindTextureUnit(2, GL_TEXTURE_2D, g.GetTexture(noise));
+					quad.Render();
+				});
+
+			// 3. Blur ssao texture to remove noise
+			if (!gaussianBlur) {
+				graph.AddPass("ssao blur",
+					[&](RenderGraph::PassBuilder& builder) {
+						builder.Read(ssao);
+						ssaoBlur = builder.Create("ssao blur", { GL_R8, SCR_WIDTH, SCR_HEIGHT });
+					},
+					[&](const RenderGraph& g) {
+						GLState::Get().Disable(GL_DEPTH_TEST);
+						glClear(GL_COLOR_BUFFER_BIT);
+						shaderSSAOBlur.Bind();
+						GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(ssao));
+						quad.Render();
+					});
+			}
+			else {
+				graph.AddPass("ssao gaussian x",
+					[&](RenderGraph::PassBuilder& builder) {
+						builder.Read(ssao);
+						ssaoBlurX = builder.Create("ssao gaussian x", { GL_R8, SCR_WIDTH, SCR_HEIGHT, GL_LINEAR });
+					},
+					[&](const RenderGraph& g) {
+						GLState::Get().Disable(GL_DEPTH_TEST);
+						shaderGaussianBlur.Bind();
+						shaderGaussianBlur.SetVec2("direction", glm::vec2(1.0f, 0.0f));
+						GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(ssao));
+						quad.Render();
+					});
+				graph.AddPass("ssao gaussian y",
+					[&](RenderGraph::PassBuilder& builder) {
+						builder.Read(ssaoBlurX);
+						ssaoBlur = builder.Create("ssao blur", { GL_R8, SCR_WIDTH, SCR_HEIGHT });
+					},
+					[&](const RenderGraph& g) {
+						shaderGaussianBlur.Bind();
+						shaderGaussianBlur.SetVec2("direction", glm::vec2(0.0f, 1.0f));
+						GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(ssaoBlurX));
+						quad.Render();
+					});
+			}
+		}
+		else {
+			int halfWidth = (SCR_WIDTH + 1) / 2, halfHeight = (SCR_HEIGHT + 1) / 2;
+
+			// 2. Keep the closest of every 2x2 pixels' view position and normal
+			graph.AddPass("ssao downsample",
+				[&, halfWidth, halfHeight](RenderGraph::PassBuilder& builder) {
+					builder.Read(packedGBuffer ? gDepth : gPosition);
+					builder.Read(gNormal);
+					halfPosition = builder.Create("half position", { GL_RGBA16F, halfWidth, halfHeight });
+					halfNormal = builder.Create("half normal", { GL_RGBA16F, halfWidth, halfHeight });
+				},
+				[&](const RenderGraph& g) {
+					GLState::Get().Disable(GL_DEPTH_TEST);
+					Shader& downsamplePass = packedGBuffer ? packedSSAODownsample : shaderSSAODownsample;
+					downsamplePass.Bind();
+					GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(packedGBuffer ? gDepth : gPosition));
+					GLState::Get().BindTextureUnit(1, GL_TEXTURE_2D, g.GetTexture(gNormal));
+					quad.Render();
+				});
+
+			// 3. The SSAO shader itself is unchanged, it reads the half-resolution buffers as its G-buffer
+			graph.AddPass("ssao half-res",
+				[&, halfWidth, halfHeight](RenderGraph::PassBuilder& builder) {
+					builder.Read(halfPosition);
+					builder.Read(halfNormal);
+					builder.Read(noise);
+					ssao = builder.Create("ssao", { GL_R8, halfWidth, halfHeight });
+				},
+				[&](const RenderGraph& g) {
+					shaderSSAO.Bind();
+					GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(halfPosition));
+					GLState::Get().BindTextureUnit(1, GL_TEXTURE_2D, g.GetTexture(halfNormal));
+					GLState::Get().BindTextureUnit(2, GL_TEXTURE_2D, g.GetTexture(noise));
+					quad.Render();
+				});
+
+			// 4. Separable depth-aware blur, horizontal then vertical
+			graph.AddPass("ssao blur x",
+				[&, halfWidth, halfHeight](RenderGraph::PassBuilder& builder) {
+					builder.Read(ssao);
+					builder.Read(halfPosition);
+					ssaoBlurX = builder.Create("ssao blur x", { GL_R8, halfWidth, halfHeight });
+				},
+				[&](const RenderGraph& g) {
+					shaderSSAOBilateralBlur.Bind();
+					shaderSSAOBilateralBlur.SetVec2("direction", glm::vec2(1.0f, 0.0f));
+					shaderSSAOBilateralBlur.SetFloat("depthSharpness", depthSharpness);
+					GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(ssao));
+					GLState::Get().BindTextureUnit(1, GL_TEXTURE_2D, g.GetTexture(halfPosition));
+					quad.Render();
+				});
+			graph.AddPass("ssao blur y",
+				[&, halfWidth, halfHeight](RenderGraph::PassBuilder& builder) {
+					builder.Read(ssaoBlurX);
+					builder.Read(halfPosition);
+					ssaoBlurY = builder.Create("ssao blur y", { GL_R8, halfWidth, halfHeight });
+				},
+				[&](const RenderGraph& g) {
+					shaderSSAOBilateralBlur.Bind();
+					shaderSSAOBilateralBlur.SetVec2("direction", glm::vec2(0.0f, 1.0f));
+					GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(ssaoBlurX));
+					GLState::Get().BindTextureUnit(1, GL_TEXTURE_2D, g.GetTexture(halfPosition));
+					quad.Render();
+				});
+
+			// 5. Joint bilateral upsample against the full-resolution depth, into the target the lighting reads
+			graph.AddPass("ssao upsample",
+				[&](RenderGraph::PassBuilder& builder) {
+					builder.Read(ssaoBlurY);
+					builder.Read(halfPosition);
+					builder.Read(packedGBuffer ? gDepth : gPosition);
+					ssaoBlur = builder.Create("ssao blur", { GL_R8, SCR_WIDTH, SCR_HEIGHT });
+				},
+				[&](const RenderGraph& g) {
+					Shader& upsamplePass = packedGBuffer ? packedSSAOUpsample : shaderSSAOUpsample;
+					upsamplePass.Bind();
+					upsamplePass.SetFloat("depthSharpness", depthSharpness);
+					GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(ssaoBlurY));
+					GLState::Get().BindTextureUnit(1, GL_TEXTURE_2D, g.GetTexture(halfPosition));
+					GLState::Get().BindTextureUnit(2, GL_TEXTURE_2D, g.GetTexture(packedGBuffer ? gDepth : gPosition));
+					quad.Render();
+				});
+		}
+
+		// Temporal accumulation of the blurred AO, the lighting reads the resolved history instead
+		ssaoResult = ssaoBlur;
+		if (graphTemporal) {
+			ssaoHistory.Resize(SCR_WIDTH, SCR_HEIGHT);
+			ssaoHistory.Invalidate(); // the AO passes changed, last frame's result does not match them any more
+			RenderTargetDesc historyDesc = { GL_R8, SCR_WIDTH, SCR_HEIGHT, GL_LINEAR };
+			ssaoHistoryPrevious = graph.ImportTexture("ssao history", ssaoHistory.GetPrevious().GetTexture(0), historyDesc);
+			ssaoResolved = graph.ImportTexture("ssao resolved", ssaoHistory.GetCurrent().GetTexture(0), historyDesc);
+			ssaoResult = ssaoResolved;
+
+			graph.AddPass("ssao temporal",
+				[&](RenderGraph::PassBuilder& builder) {
+					builder.Read(ssaoBlur);
+					builder.Read(gVelocity);
+					builder.Read(ssaoHistoryPrevious);
+					builder.Write(ssaoResolved);
+				},
+				[&](const RenderGraph& g) {
+					temporalResolve.Render(g.GetTexture(ssaoBlur), g.GetTexture(gVelocity), g.GetTexture(ssaoHistoryPrevious), ssaoHistory.IsValid());
+				});
+		}
+
+		// 4. Lighting Pass: traditional deferred Blinn-Phong lighting now with added screen-space ambient occlusion
+		graph.AddPass("lighting",
+			[&](RenderGraph::PassBuilder& builder) {
+				builder.Read(packedGBuffer ? gDepth : gPosition);
+				builder.Read(gNormal);
+				builder.Read(gAlbedo);
+				if (enableSSAO)
+					builder.Read(ssaoResult);
+				builder.Write(backbuffer);
+			},
+			[&](const RenderGraph& g) {
+				GLState::Get().Disable(GL_DEPTH_TEST);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				Shader& lightingPass = packedGBuffer ? packedLightingPass : shaderLightingPass;
+				lightingPass.Bind();
+				GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, g.GetTexture(packedGBuffer ? gDepth : gPosition));
+				GLState::Get().BindTextureUnit(1, GL_TEXTURE_2D, g.GetTexture(gNormal));
+				GLState::Get().BindTextureUnit(2, GL_TEXTURE_2D, g.GetTexture(gAlbedo));
+				GLState::Get().BindTextureUnit(3, GL_TEXTURE_2D, g.GetTexture(ssaoResult)); // 0 when the SSAO passes are culled
+
+				// The light is read from the Lights block and moved to view space in the shader
+				lightingPass.SetInt("enableSSAO", enableSSAO);
+				quad.Render();
+			});
+
+		// 5. Render light source
+		graph.AddPass("light source",
+			[&](RenderGraph::PassBuilder& builder) {
+				builder.Write(backbuffer);
+			},
+			[&](const RenderGraph&) {
+				GLState::Get().Enable(GL_DEPTH_TEST);
+				shaderLightSource.Bind();
+
+				model = glm::mat4(1.0f);
+				model = glm::translate(model, light.position);
+				model = glm::scale(model, glm::vec3(0.05f));
+
+				shaderLightSource.SetMat4("model", model);
+				shaderLightSource.SetVec3("lightColor", light.color);
+				sphere.Render();
+			});
+
+		graph.Compile();
+	};
+	BuildRenderGraph();
 
 	timer.stop();
 
@@ -270,8 +594,18 @@ int main()
 	// --------------
 	bool firstTime = true;
 	double cursor_x, cursor_y;
-	unsigned char pixel[4];
-	while (!glfwWindowShouldClose(window)){
+	while (!glfwWindowShouldClose(window) && benchmark.NextFrame(camera)) {
+		// Publish last frame's state-cache counters and start counting this frame
+		GLState::Get().NewFrame();
+		// Drop render targets that stayed idle since the last resize
+		RenderTargetPool::Get().NewFrame();
+		// Read back the GPU timings of an older frame and start recording this one
+		GpuProfiler::Get().BeginFrame();
+		// Build the CPU call tree of the previous frame
+		CpuProfiler::Get().NewFrame();
+		// Publish last frame's culling counters
+		FrustumCuller::Get().NewFrame();
+
 		// Per-frame logic
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
@@ -279,116 +613,50 @@ int main()
 
 		// Render
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// Process input
 		ProcessInput(window);
 
-		// 1. Geometry Pass: render scene's geometry/color data into gbuffer
-		// -----------------------------------------------------------------
-		glEnable(GL_DEPTH_TEST);
-		glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		shaderGeometryPass.Bind();
+		if (enableSSAO != graphSSAO || packedGBuffer != graphPacked || halfResolutionSSAO != graphHalfResolution || (enableSSAO && temporalSSAO) != graphTemporal || gaussianBlur != graphGaussianBlur || ((SCR_WIDTH != graphWidth || SCR_HEIGHT != graphHeight) && SCR_WIDTH > 0 && SCR_HEIGHT > 0))
+			BuildRenderGraph();
 
 		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, plane_near, plane_far);
 		glm::mat4 view = camera.GetViewMatrix();
-		glm::mat4 model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(0.0, 7.0f, 0.0f));
-		model = glm::scale(model, glm::vec3(7.5f, 7.5f, 7.5f));
-		shaderGeometryPass.SetMat4("projection", projection);
-		shaderGeometryPass.SetMat4("view", view);
-		shaderGeometryPass.SetMat4("model", model);
-		shaderGeometryPass.SetInt("invertedNormals", 1); // invert normals as we're inside the cube
-		cube.Render();
-		shaderGeometryPass.SetInt("invertedNormals", 0);
-
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(0.0f, 0.5f, 0.0));
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
-		model = glm::scale(model, glm::vec3(1.0f));
-		shaderGeometryPass.SetMat4("model", model);
-		//nanosuit.Render(shaderGeometryPass);
-		backpack.Render(shaderGeometryPass);
-
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		// 2. Perform SSAO Calculation
-		// ---------------------------
-		glDisable(GL_DEPTH_TEST);
-		glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-		glClear(GL_COLOR_BUFFER_BIT);
-		shaderSSAO.Bind();
-
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, gPosition);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, gNormal);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, noiseTexture);
-		for (size_t i = 0; i < sampleSize; i++) {
-			shaderSSAO.SetVec3("samples[" + std::to_string(i) + "]", sampleKernel[i]);
+		temporalCamera.NewFrame(projection, view, SCR_WIDTH, SCR_HEIGHT);
+		frameConstants.SetCamera(temporalCamera.GetProjection(), view, camera.position);
+		frustum = Frustum(projection * view);
+
+		// Rasterize the occluders before the geometry pass tests against them
+		occlusion.Begin(projection * view);
+		occlusion.AddBox(glm::vec3(-1.0f), glm::vec3(1.0f), roomModel);
+		occlusion.AddBox(glm::vec3(-1.0f), glm::vec3(1.0f), wallModel);
+		occlusion.Rasterize();
+		if (sampleSize != generatedSampleSize) {
+			GenerateKernel();
+			generatedSampleSize = sampleSize;
+		}
+		frameConstants.SetSSAOKernel(sampleKernel, radius);
+		if (blurSigma != kernelSigma || blurRadius != kernelRadius) {
+			kernelSigma = blurSigma;
+			kernelRadius = blurRadius;
+			blurKernel.Generate(blurSigma, blurRadius);
+			frameConstants.SetBlurKernel(blurKernel);
 		}
-		shaderSSAO.SetMat4("projection", projection);
-		shaderSSAO.SetFloat("kernelSize", (float)sampleSize);
-		shaderSSAO.SetFloat("radius", radius);
-		quad.Render();
-
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		// 3. Blur ssao texture to remove noise
-		// ------------------------------------
-		glDisable(GL_DEPTH_TEST);
-		glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-		glClear(GL_COLOR_BUFFER_BIT);
-		shaderSSAOBlur.Bind();
-		
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-		quad.Render();
-
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		// 4. Lighting Pass: traditional deferred Blinn-Phong lighting now with added screen-space ambient occlusion
-		// ---------------------------------------------------------------------------------------------------------
-		glDisable(GL_DEPTH_TEST);
-		glClear(GL_COLOR_BUFFER_BIT);
-		shaderLightingPass.Bind();
-		
-		// Notice we multiply view matrix here instead of in glsl code
-		glm::vec3 lightPosView = glm::vec3(camera.GetViewMatrix() * glm::vec4(light.position, 1.0));
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, gPosition);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, gNormal);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, gAlbedo);
-		glActiveTexture(GL_TEXTURE3);
-		glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
-        
-		// Send lighting uniforms
-		shaderLightingPass.SetVec3("light.Position", lightPosView);
-		shaderLightingPass.SetVec3("light.Color", light.color);
-		shaderLightingPass.SetFloat("light.Linear", light.linear);
-		shaderLightingPass.SetFloat("light.Quadratic", light.quadratic);
-
-		shaderLightingPass.SetInt("enableSSAO", enableSSAO);
-		quad.Render();
-
-		// 5. Render light source
-		// ----------------------
-		glEnable(GL_DEPTH_TEST);
-		shaderLightSource.Bind();
 
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, light.position);
-		model = glm::scale(model, glm::vec3(0.05f));
+		// Golden-angle steps never line up with earlier ones, so the history keeps seeing new noise orientations
+		float noiseAngle = graphTemporal ? 2.39996323f * (float)(temporalCamera.GetFrameIndex() % 4096) : 0.0f;
+		for (Shader* ssaoPass : { &shaderSSAO, &packedSSAO }) {
+			ssaoPass->Bind();
+			ssaoPass->SetVec2("noiseRotation", glm::vec2(std::cos(noiseAngle), std::sin(noiseAngle)));
+		}
+		if (graphTemporal) {
+			graph.SetImportedTexture(ssaoHistoryPrevious, ssaoHistory.GetPrevious().GetTexture(0));
+			graph.SetImportedTexture(ssaoResolved, ssaoHistory.GetCurrent().GetTexture(0));
+		}
 
-		shaderLightSource.SetMat4("projection", projection);
-		shaderLightSource.SetMat4("view", view);
-		shaderLightSource.SetMat4("model", model);
-		shaderLightSource.SetVec3("lightColor", light.color);
-		sphere.Render();
+		graph.Execute();
+		if (graphTemporal)
+			ssaoHistory.Swap();
 
 		// ImGui code here
         // ---------------
@@ -403,10 +671,20 @@ int main()
 		}
 		ImGui::Begin("hnzz");
 		ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
-		glfwGetCursorPos(window, &cursor_x, &cursor_y); // Retrieve and display the cursor position and the RGBA color of the pixel under the cursor
-		glReadPixels(cursor_x, SCR_HEIGHT - cursor_y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+		ImGui::Text("GL state changes: %u issued, %u filtered", GLState::Get().GetFrameCounters().issued, GLState::Get().GetFrameCounters().filtered);
+		ImGui::Text("Shader stages: %u compiled, %u reused", ShaderCache::Get().GetStats().stagesCompiled, ShaderCache::Get().GetStats().stageHits);
+		ImGui::Text("Shader sources: %u embedded, %u file opens, %.2f ms", Shader::GetLoadStats().embeddedSources, Shader::GetLoadStats().fileOpens, Shader::GetLoadStats().loadMicroseconds / 1000.0f);
+		ImGui::Text("Render targets: %.1f MB (%.1f MB unaliased), %u/%u passes culled", graph.GetStats().allocatedBytes / (1024.0f * 1024.0f), graph.GetStats().unaliasedBytes / (1024.0f * 1024.0f), graph.GetStats().culledPasses, graph.GetStats().passes);
+		ImGui::Text("Render target pool: %u textures (%.1f MB), %u idle", RenderTargetPool::Get().GetStats().textures, RenderTargetPool::Get().GetStats().bytes / (1024.0f * 1024.0f), RenderTargetPool::Get().GetStats().idleTextures);
+		glfwGetCursorPos(window, &cursor_x, &cursor_y); // Retrieve the cursor position and pick the backpack triangle under it on the CPU
+		Ray cursorRay = Ray::FromScreen((float)cursor_x, (float)cursor_y, (float)SCR_WIDTH, (float)SCR_HEIGHT, glm::inverse(projection * view));
+		RayHit picked;
 		ImGui::Text("Cursor position: (%.2f, %.2f)", cursor_x, cursor_y);
-		ImGui::Text("RGBA: (%d, %d, %d, %d)", pixel[0], pixel[1], pixel[2], pixel[3]);
+		if (backpack.Raycast(cursorRay.Transformed(backpackInverseModel), picked))
+			ImGui::Text("Picked: backpack mesh %u, triangle %u at %.2f", picked.mesh, picked.triangle, picked.distance);
+		else
+			ImGui::Text("Picked: room");
+		ImGui::Text("Triangle BVHs: %.2f ms at load", backpack.GetBVHBuildMilliseconds());
 		ImGui::End();
 
 		// The second UI panal
@@ -416,21 +694,77 @@ int main()
 			firstTime = false;
 		}
 		ImGui::Begin("ssao");
-		ImGui::Text("Sample Kernel: %u", sampleSize);
+		ImGui::SliderInt("Sample Kernel", &sampleSize, 4, (int)MAX_SSAO_KERNEL_SIZE);
 		ImGui::SliderFloat("Radius", &radius, 0.0f, 1.0f);
+		ImGui::Checkbox("Half-resolution SSAO", &halfResolutionSSAO);
+		if (halfResolutionSSAO)
+			ImGui::SliderFloat("Bilateral depth sharpness", &depthSharpness, 1.0f, 100.0f);
+		else
+			ImGui::Checkbox("Gaussian blur (instead of 4x4 box)", &gaussianBlur);
+		if (halfResolutionSSAO || gaussianBlur) {
+			ImGui::SliderFloat("Blur sigma", &blurSigma, 0.5f, 8.0f);
+			ImGui::SliderInt("Blur radius", &blurRadius, 0, 24);
+			if (ImGui::Button("Radius from sigma"))
+				blurRadius = GaussianKernel::RadiusForSigma(blurSigma);
+			ImGui::Text("Fetches per pass: %d linear-sampled, %d bilateral", blurKernel.GetFetchCount(), 2 * blurKernel.GetRadius() + 1);
+		}
+		// Rolling averages are kept per pass name, so the mode that isn't running shows its last measurement
+		float fullResolutionMilliseconds = GpuProfiler::Get().GetAverageMilliseconds("ssao") + (gaussianBlur ?
+			GpuProfiler::Get().GetAverageMilliseconds("ssao gaussian x") + GpuProfiler::Get().GetAverageMilliseconds("ssao gaussian y") : GpuProfiler::Get().GetAverageMilliseconds("ssao blur"));
+		float halfResolutionMilliseconds = GpuProfiler::Get().GetAverageMilliseconds("ssao downsample") + GpuProfiler::Get().GetAverageMilliseconds("ssao half-res") +
+			GpuProfiler::Get().GetAverageMilliseconds("ssao blur x") + GpuProfiler::Get().GetAverageMilliseconds("ssao blur y") + GpuProfiler::Get().GetAverageMilliseconds("ssao upsample");
+		ImGui::Text("SSAO GPU time: full-res %.3f ms | half-res %.3f ms", fullResolutionMilliseconds, halfResolutionMilliseconds);
+		ImGui::Checkbox("Temporal accumulation", &temporalSSAO);
+		if (temporalSSAO) {
+			// The kernel turns every frame, 4 samples accumulated over frames compare with 16-32 in one frame
+			ImGui::SliderFloat("History blend", &temporalResolve.blendFactor, 0.02f, 1.0f);
+			ImGui::SliderFloat("Neighbourhood clamp", &temporalResolve.clampGamma, 0.5f, 4.0f);
+			ImGui::Text("Temporal resolve: %.3f ms", GpuProfiler::Get().GetAverageMilliseconds("ssao temporal"));
+		}
 		ImGui::Checkbox("Enable camera movement", &enableCameraMovement);
 		ImGui::Checkbox("Enable SSAO", &enableSSAO);
+		ImGui::Checkbox("Packed G-buffer", &packedGBuffer);
+		ImGui::Checkbox("Frustum culling", &FrustumCuller::Get().enabled);
+		ImGui::Text("Culling: %u of %u meshes visible", FrustumCuller::Get().GetFrameCounters().visible, FrustumCuller::Get().GetFrameCounters().tested);
+		const OcclusionCounters& occlusionCounters = occlusion.GetFrameCounters();
+		ImGui::Checkbox("Occlusion culling", &occlusion.enabled);
+		ImGui::Text("Occlusion: %u of %u draws culled (%.0f%%)", occlusionCounters.occluded, occlusionCounters.tested,
+			occlusionCounters.tested ? 100.0f * occlusionCounters.occluded / occlusionCounters.tested : 0.0f);
+		ImGui::Text("Occluders: %u triangles, %.3f ms on the CPU", occlusionCounters.triangles, occlusionCounters.rasterizeMilliseconds);
+		ImGui::Checkbox("Show occlusion buffer", &showOcclusionBuffer);
+		if (showOcclusionBuffer) {
+			// Row 0 of the buffer is the bottom of the screen, flip it for ImGui
+			unsigned int texture = occlusion.UpdateDebugTexture();
+			ImGui::Image((ImTextureID)(intptr_t)texture, ImVec2((float)occlusion.GetWidth(), (float)occlusion.GetHeight()), ImVec2(0.0f, 1.0f), ImVec2(1.0f, 0.0f));
+		}
+		ImGui::End();
+
+		// GPU pass timings and the CPU call tree
+		ImGui::SetNextWindowSize(ImVec2(400, 500), ImGuiCond_FirstUseEver);
+		ImGui::SetNextWindowPos(ImVec2(600, 50), ImGuiCond_FirstUseEver);
+		ImGui::Begin("Profiler");
+		GpuProfiler::Get().DrawImGui();
+		CpuProfiler::Get().DrawImGui();
 		ImGui::End();
 
 		// ImGui Rendering
 		ImGui::Render();
+		GpuProfiler::Get().Begin("imgui");
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		GpuProfiler::Get().End();
+
+		GpuProfiler::Get().EndFrame();
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-		glfwSwapBuffers(window);
+		{
+			CPU_PROFILE_SCOPE("glfwSwapBuffers"); // includes the vsync wait
+			glfwSwapBuffers(window);
+		}
 		glfwPollEvents();
 	}
 
+	benchmark.Finish();
+
 	// Optional: release all the resources of OpenGL (VAO, VBO, etc.)
 	glfwTerminate();
 
@@ -447,7 +781,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
 	// make sure the viewport matches the new window dimensions; note that SCR_WIDTH and 
 	// SCR_HEIGHT will be significantly larger than specified on retina displays.
-	glViewport(0, 0, width, height);
+	GLState::Get().Viewport(0, 0, width, height);
 	SCR_WIDTH = width;
 	SCR_HEIGHT = height;
 }
@@ -521,7 +855,7 @@ unsigned int LoadTexture(const std::string& path)
 			return -1;
 		}
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "gl_state.h"
+#include "shader.h"
+#include "render_target.h"
+#include "geometry_renderers.h"
+
+// Element _index of the Halton low-discrepancy sequence in base _base, in [0, 1). Element 0 is 0, start at 1.
+inline float Halton(unsigned int _index, unsigned int _base)
+{
+	float result = 0.0f;
+	float fraction = 1.0f;
+	while (_index > 0) {
+		fraction /= (float)_base;
+		result += fraction * (float)(_index % _base);
+		_index /= _base;
+	}
+	return result;
+}
+
+// The TemporalCamera class keeps what temporal passes need from the camera across frames: the view-projection
+// of this frame and of the previous one (unjittered, for motion vectors) and a sub-pixel jitter that walks the
+// Halton(2, 3) sequence, so an accumulated history sees every pixel at jitterPhases different sample positions.
+// Render with GetProjection(), compute motion vectors with GetViewProjection()/GetPreviousViewProjection().
+//
+// Usage Example:
+// TemporalCamera temporalCamera;
+// temporalCamera.NewFrame(projection, view, SCR_WIDTH, SCR_HEIGHT); // once per frame, before rendering
+// frameConstants.SetCamera(temporalCamera.GetProjection(), view, camera.position);
+// shader.SetMat4("previousViewProjection", temporalCamera.GetPreviousViewProjection());
+class TemporalCamera
+{
+public:
+	bool jitter = true;
+	unsigned int jitterPhases = 8; // length of the jitter cycle
+
+	void NewFrame(const glm::mat4& _projection, const glm::mat4& _view, int _width, int _height)
+	{
+		glm::mat4 next = _projection * _view;
+		previousViewProjection = frameIndex == 0 ? next : viewProjection;
+		viewProjection = next;
+		frameIndex++;
+
+		offset = glm::vec2(0.0f);
+		if (jitter && _width > 0 && _height > 0) {
+			unsigned int phase = frameIndex % jitterPhases + 1;
+			offset = glm::vec2(Halton(phase, 2), Halton(phase, 3)) - 0.5f;
+		}
+		// Shifting clip space after the projection moves the image by offset pixels, whatever the projection is
+		glm::vec3 ndcOffset(offset.x * 2.0f / (float)glm::max(_width, 1), offset.y * 2.0f / (float)glm::max(_height, 1), 0.0f);
+		projection = glm::translate(glm::mat4(1.0f), ndcOffset) * _projection;
+	}
+
+	// The jittered projection to render with.
+	const glm::mat4& GetProjection() const { return projection; }
+	const glm::mat4& GetViewProjection() const { return viewProjection; }
+	// Equal to GetViewProjection() on the first frame, so everything starts with zero motion.
+	const glm::mat4& GetPreviousViewProjection() const { return previousViewProjection; }
+	// In pixels, within [-0.5, 0.5].
+	glm::vec2 GetJitter() const { return offset; }
+	// Frames since startup, for rotating per-frame sample patterns.
+	unsigned int GetFrameIndex() const { return frameIndex; }
+
+private:
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	glm::mat4 previousViewProjection = glm::mat4(1.0f);
+	glm::vec2 offset = glm::vec2(0.0f);
+	unsigned int frameIndex = 0;
+};
+
+// The TemporalHistory class is the pair of pooled targets a temporal pass ping-pongs between: it reads last
+// frame's result from GetPrevious() and writes this frame's into GetCurrent(), then Swap() exchanges them.
+// After a resize or Invalidate() the previous target holds nothing useful and IsValid() is false until the next Swap().
+//
+// Usage Example:
+// TemporalHistory history({ GL_RGBA8, width, height, GL_LINEAR });
+// history.Resize(SCR_WIDTH, SCR_HEIGHT);
+// unsigned int resolved = temporalResolve.Resolve(sceneTarget.GetTexture(0), sceneTarget.GetTexture(1), history);
+class TemporalHistory
+{
+public:
+	explicit TemporalHistory(const RenderTargetDesc& _desc) : first({ _desc }), second({ _desc }) {}
+
+	void Resize(int _width, int _height)
+	{
+		if (_width <= 0 || _height <= 0 || (_width == first.GetWidth() && _height == first.GetHeight()))
+			return;
+		first.Resize(_width, _height);
+		second.Resize(_width, _height);
+		valid = false;
+	}
+
+	void Swap()
+	{
+		currentIsFirst = !currentIsFirst;
+		valid = true;
+	}
+
+	void Invalidate() { valid = false; }
+	bool IsValid() const { return valid; }
+
+	RenderTarget& GetCurrent() { return currentIsFirst ? first : second; }
+	RenderTarget& GetPrevious() { return currentIsFirst ? second : first; }
+
+private:
+	RenderTarget first, second;
+	bool currentIsFirst = true;
+	bool valid = false;
+};
+
+// The TemporalResolve class blends a noisy frame with the reprojected history: the history is fetched where
+// the velocity buffer says the surface was last frame, clamped to the mean +- clampGamma standard deviations of
+// the 3x3 neighbourhood of the current frame (rejects disoccluded and changed pixels without ghosting) and
+// mixed with blendFactor of the current frame. Effects that rotate their samples every frame then converge to
+// the result of all rotations together, for a fraction of the per-frame cost.
+//
+// Resolve() renders into the history's current target and swaps, Render() only draws into the bound
+// framebuffer, for render graph passes. Both expect the velocity buffer at the size of the current input.
+//
+// Usage Example:
+// TemporalResolve temporalResolve;
+// temporalResolve.blendFactor = 0.1f;
+// unsigned int resolved = temporalResolve.Resolve(color, velocity, history);
+class TemporalResolve
+{
+public:
+	float blendFactor = 0.1f; // ~1/N converges over N frames
+	float clampGamma = 1.0f;  // larger keeps more history (less noise, more ghosting)
+
+	TemporalResolve() : shader(SHADER_BLUR_VS, SHADER_TEMPORAL_RESOLVE_FS)
+	{
+		shader.Bind();
+		shader.SetInt("currentInput", 0);
+		shader.SetInt("historyInput", 1);
+		shader.SetInt("velocityInput", 2);
+	}
+
+	// Returns the resolved texture, which is also the history of the next frame.
+	unsigned int Resolve(unsigned int _current, unsigned int _velocity, TemporalHistory& _history)
+	{
+		_history.GetCurrent().Bind();
+		Render(_current, _velocity, _history.GetPrevious().GetTexture(0), _history.IsValid());
+		_history.Swap();
+		return _history.GetPrevious().GetTexture(0);
+	}
+
+	void Render(unsigned int _current, unsigned int _velocity, unsigned int _history, bool _historyValid)
+	{
+		GLState::Get().Disable(GL_DEPTH_TEST);
+		shader.Bind();
+		shader.SetFloat("blendFactor", blendFactor);
+		shader.SetFloat("clampGamma", clampGamma);
+		shader.SetInt("historyValid", _historyValid);
+		GLState::Get().BindTextureUnit(0, GL_TEXTURE_2D, _current);
+		GLState::Get().BindTextureUnit(1, GL_TEXTURE_2D, _history);
+		GLState::Get().BindTextureUnit(2, GL_TEXTURE_2D, _velocity);
+		quad.Render();
+		GLState::Get().Enable(GL_DEPTH_TEST); // the demos keep depth testing on by default
+	}
+
+private:
+	Shader shader;
+	yzh::Quad quad;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+
+#include <GL/glew.h>
+
+#include "gl_state.h"
+
+// The TextureBuffer class wraps a buffer object exposed to shaders as a buffer texture (GL 3.1 core), for data that
+// outgrows the 16KB of a uniform block: GLSL reads it with texelFetch() from a samplerBuffer (float formats) or a
+// usamplerBuffer (integer formats). Update() orphans the storage, so rewriting it every frame never waits for draws
+// of the previous frame that still read the old contents.
+//
+// Usage Example:
+// TextureBuffer indices(GL_R32UI);
+// indices.Update(data.data(), data.size() * sizeof(unsigned int));
+// indices.Bind(3); // then shader.SetInt("lightIndices", 3)
+class TextureBuffer
+{
+public:
+	TextureBuffer() = delete;
+
+	explicit TextureBuffer(GLenum _internalFormat)
+		: internalFormat(_internalFormat)
+	{
+		glGenBuffers(1, &buffer);
+		glGenTextures(1, &texture);
+	}
+
+	~TextureBuffer()
+	{
+		glDeleteBuffers(1, &buffer);
+		GLState::Get().DeleteTextures(1, &texture);
+	}
+
+	TextureBuffer(const TextureBuffer&) = delete;
+	TextureBuffer& operator=(const TextureBuffer&) = delete;
+
+	void Update(const void* _data, size_t _size)
+	{
+		// An empty buffer texture is not valid, keep at least one texel around
+		size_t size = _size > 0 ? _size : 16;
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+		glBufferData(GL_TEXTURE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		if (_size > 0)
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, _size, _data);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		if (!attached) {
+			GLState::Get().BindTexture(GL_TEXTURE_BUFFER, texture);
+			glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+			attached = true;
+		}
+	}
+
+	void Bind(unsigned int _unit) const
+	{
+		GLState::Get().BindTextureUnit(_unit, GL_TEXTURE_BUFFER, texture);
+	}
+
+	unsigned int GetTexture() const { return texture; }
+
+private:
+	unsigned int buffer = 0;
+	unsigned int texture = 0;
+	GLenum internalFormat;
+	bool attached = false;
+};
@@ -56,6 +56,12 @@ public:
         startTime = std::chrono::time_point<std::chrono::high_resolution_clock>();
     }
 
+    // Monotonic timestamp in nanoseconds since an arbitrary epoch, used by CpuProfiler.
+    static long long nowNanoseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
     long long elapsedMicroseconds() 
     {
         if (running) {
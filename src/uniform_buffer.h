@@ -0,0 +1,281 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+
+#include "cpu_profiler.h"
+#include "gaussian_kernel.h"
+
+// Fixed binding points of the per-frame uniform blocks.
+// Every Shader looks these blocks up after linking and attaches them automatically,
+// so a block written once per frame is visible to every program that declares it.
+enum UniformBlockBinding : unsigned int
+{
+	CAMERA_BLOCK_BINDING = 0,
+	LIGHTS_BLOCK_BINDING = 1,
+	SSAO_KERNEL_BLOCK_BINDING = 2,
+	POST_PARAMS_BLOCK_BINDING = 3,
+	BLUR_KERNEL_BLOCK_BINDING = 4,
+	USER_BLOCK_BINDING = 5 // first binding point that is free for demo specific blocks
+};
+
+struct UniformBlockInfo
+{
+	const char* name;
+	UniformBlockBinding binding;
+};
+
+// Block names as declared in GLSL, in the same order as the binding points above.
+inline constexpr UniformBlockInfo frameUniformBlocks[] = {
+	{ "Camera", CAMERA_BLOCK_BINDING },
+	{ "Lights", LIGHTS_BLOCK_BINDING },
+	{ "SSAOKernel", SSAO_KERNEL_BLOCK_BINDING },
+	{ "PostParams", POST_PARAMS_BLOCK_BINDING },
+	{ "BlurKernel", BLUR_KERNEL_BLOCK_BINDING }
+};
+
+constexpr unsigned int MAX_LIGHTS = 32;
+constexpr unsigned int MAX_SSAO_KERNEL_SIZE = 64;
+constexpr int MAX_BLUR_RADIUS = GaussianKernel::MAX_RADIUS;
+
+// CPU mirrors of the std140 blocks. The GLSL declarations must be kept in sync:
+//
+// layout (std140) uniform Camera
+// {
+//     mat4 projection;
+//     mat4 view;
+//     vec3 viewPos;
+//     mat4 inverseProjection; // optional: shaders that don't reconstruct positions may stop after viewPos
+//     mat4 inverseView;
+// };
+struct CameraBlock
+{
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::vec3 viewPos;
+	float padding0;
+	glm::mat4 inverseProjection;
+	glm::mat4 inverseView;
+};
+
+// struct Light { vec3 Position; float Linear; vec3 Color; float Quadratic; };
+//
+// layout (std140) uniform Lights
+// {
+//     Light lights[32];
+//     int lightCount;
+// };
+struct PointLight
+{
+	glm::vec3 position;
+	float linear = 0.0f;
+	glm::vec3 color;
+	float quadratic = 0.0f;
+};
+
+struct LightsBlock
+{
+	PointLight lights[MAX_LIGHTS];
+	int lightCount;
+	int padding0[3];
+};
+
+// layout (std140) uniform SSAOKernel
+// {
+//     vec4 samples[64];
+//     int kernelSize;
+//     float radius;
+// };
+struct SSAOKernelBlock
+{
+	glm::vec4 samples[MAX_SSAO_KERNEL_SIZE];
+	int kernelSize;
+	float radius;
+	float padding0[2];
+};
+
+// layout (std140) uniform PostParams
+// {
+//     float exposure;
+//     int bloom;
+//     int hdr;
+// };
+struct PostParamsBlock
+{
+	float exposure;
+	int bloom;
+	int hdr;
+	float padding0;
+};
+
+// layout (std140) uniform BlurKernel
+// {
+//     vec4 taps[64]; // x, y: offset and weight of the linear-sampled taps, center first (tapCount of them)
+//                    // z: weight of the texel at offset i, for shaders weighting every texel (radius + 1 of them)
+//     int tapCount;
+//     int radius;
+// };
+struct BlurKernelBlock
+{
+	glm::vec4 taps[MAX_BLUR_RADIUS + 1];
+	int tapCount;
+	int radius;
+	int padding0[2];
+};
+
+static_assert(offsetof(CameraBlock, inverseProjection) == 144, "CameraBlock must match the std140 layout");
+static_assert(sizeof(CameraBlock) == 272, "CameraBlock must match the std140 layout");
+static_assert(sizeof(PointLight) == 32, "PointLight must match the std140 layout");
+static_assert(offsetof(LightsBlock, lightCount) == 32 * MAX_LIGHTS, "LightsBlock must match the std140 layout");
+static_assert(offsetof(SSAOKernelBlock, kernelSize) == 16 * MAX_SSAO_KERNEL_SIZE, "SSAOKernelBlock must match the std140 layout");
+static_assert(sizeof(PostParamsBlock) == 16, "PostParamsBlock must match the std140 layout");
+static_assert(offsetof(BlurKernelBlock, tapCount) == 16 * (MAX_BLUR_RADIUS + 1), "BlurKernelBlock must match the std140 layout");
+
+// The UniformBuffer class wraps an OpenGL uniform buffer object bound to a fixed binding point.
+//
+// Usage Example:
+// UniformBuffer ubo(sizeof(MyBlock), USER_BLOCK_BINDING);
+// ubo.Update(&myBlock, sizeof(MyBlock));
+class UniformBuffer
+{
+public:
+	UniformBuffer() = delete;
+
+	UniformBuffer(size_t _size, unsigned int _bindingPoint, const void* _data = nullptr)
+		: size(_size), bindingPoint(_bindingPoint)
+	{
+		glGenBuffers(1, &m_rendererID);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_rendererID);
+		glBufferData(GL_UNIFORM_BUFFER, size, _data, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, m_rendererID);
+	}
+
+	~UniformBuffer()
+	{
+		glDeleteBuffers(1, &m_rendererID);
+	}
+
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+	// Uploads [_offset, _offset + _size) of the block in a single call.
+	void Update(const void* _data, size_t _size, size_t _offset = 0) const
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_rendererID);
+		glBufferSubData(GL_UNIFORM_BUFFER, _offset, _size, _data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	unsigned int GetID() const { return m_rendererID; }
+	unsigned int GetBindingPoint() const { return bindingPoint; }
+
+private:
+	unsigned int m_rendererID = 0;
+	size_t size;
+	unsigned int bindingPoint;
+};
+
+// The FrameConstants class owns the shared per-frame uniform blocks (camera, lights, SSAO kernel,
+// post-processing parameters and blur kernel). Each setter performs exactly one buffer update, no matter how many
+// programs read the block, so per-frame uniform work no longer scales with programs and draws.
+//
+// Usage Example:
+// FrameConstants frameConstants;
+// frameConstants.SetCamera(projection, view, camera.position); // once per frame
+// ...every Shader declaring "layout (std140) uniform Camera" now sees the new matrices
+class FrameConstants
+{
+public:
+	FrameConstants()
+		: cameraUBO(sizeof(CameraBlock), CAMERA_BLOCK_BINDING),
+		lightsUBO(sizeof(LightsBlock), LIGHTS_BLOCK_BINDING),
+		ssaoKernelUBO(sizeof(SSAOKernelBlock), SSAO_KERNEL_BLOCK_BINDING),
+		postParamsUBO(sizeof(PostParamsBlock), POST_PARAMS_BLOCK_BINDING),
+		blurKernelUBO(sizeof(BlurKernelBlock), BLUR_KERNEL_BLOCK_BINDING)
+	{
+	}
+
+	void SetCamera(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos)
+	{
+		CPU_PROFILE_SCOPE("FrameConstants::SetCamera");
+		CameraBlock block;
+		block.projection = projection;
+		block.view = view;
+		block.viewPos = viewPos;
+		block.padding0 = 0.0f;
+		block.inverseProjection = glm::inverse(projection);
+		block.inverseView = glm::inverse(view);
+		cameraUBO.Update(&block, sizeof(CameraBlock));
+	}
+
+	// Only the used part of the light array is uploaded, together with the light count.
+	void SetLights(const std::vector<PointLight>& lights)
+	{
+		CPU_PROFILE_SCOPE("FrameConstants::SetLights");
+		size_t count = lights.size() < MAX_LIGHTS ? lights.size() : MAX_LIGHTS;
+		for (size_t i = 0; i < count; i++)
+			lightsBlock.lights[i] = lights[i];
+		lightsBlock.lightCount = (int)count;
+
+		// lightCount sits behind the whole array in std140: upload the used lights and the count separately
+		if (count > 0)
+			lightsUBO.Update(lightsBlock.lights, count * sizeof(PointLight), offsetof(LightsBlock, lights));
+		lightsUBO.Update(&lightsBlock.lightCount, sizeof(int), offsetof(LightsBlock, lightCount));
+	}
+
+	void SetSSAOKernel(const std::vector<glm::vec3>& samples, float radius)
+	{
+		CPU_PROFILE_SCOPE("FrameConstants::SetSSAOKernel");
+		size_t count = samples.size() < MAX_SSAO_KERNEL_SIZE ? samples.size() : MAX_SSAO_KERNEL_SIZE;
+		for (size_t i = 0; i < count; i++)
+			ssaoKernelBlock.samples[i] = glm::vec4(samples[i], 0.0f);
+		ssaoKernelBlock.kernelSize = (int)count;
+		ssaoKernelBlock.radius = radius;
+		ssaoKernelUBO.Update(&ssaoKernelBlock, sizeof(SSAOKernelBlock));
+	}
+
+	void SetPostParams(float exposure, bool bloom, bool hdr)
+	{
+		CPU_PROFILE_SCOPE("FrameConstants::SetPostParams");
+		PostParamsBlock block;
+		block.exposure = exposure;
+		block.bloom = bloom;
+		block.hdr = hdr;
+		block.padding0 = 0.0f;
+		postParamsUBO.Update(&block, sizeof(PostParamsBlock));
+	}
+
+	void SetBlurKernel(const GaussianKernel& kernel)
+	{
+		CPU_PROFILE_SCOPE("FrameConstants::SetBlurKernel");
+		BlurKernelBlock block = {};
+		const std::vector<float>& weights = kernel.GetWeights();
+		const std::vector<BlurTap>& linearTaps = kernel.GetLinearTaps();
+		int radius = kernel.GetRadius(); // GaussianKernel keeps it within MAX_BLUR_RADIUS
+		for (int i = 0; i <= radius; i++)
+			block.taps[i].z = weights[i];
+		int tapCount = (int)linearTaps.size();
+		for (int i = 0; i < tapCount; i++) {
+			block.taps[i].x = linearTaps[i].offset;
+			block.taps[i].y = linearTaps[i].weight;
+		}
+		block.tapCount = tapCount;
+		block.radius = radius;
+		blurKernelUBO.Update(&block, sizeof(BlurKernelBlock));
+	}
+
+private:
+	UniformBuffer cameraUBO;
+	UniformBuffer lightsUBO;
+	UniformBuffer ssaoKernelUBO;
+	UniformBuffer postParamsUBO;
+	UniformBuffer blurKernelUBO;
+
+	// Kept on the CPU so partial edits (count, radius) don't need the caller to resend everything
+	LightsBlock lightsBlock = {};
+	SSAOKernelBlock ssaoKernelBlock = {};
+};
@@ -0,0 +1,75 @@
+# Generates src/embedded_shaders.h from every file in res/shaders.
+#
+# Each shader becomes an EmbeddedShaderID and a raw string literal, so the demos can build their programs
+# without touching the file system. Runs as a pre-build step of AdvancedLighting.vcxproj; run it by hand
+# (python tools/embed_shaders.py) after adding or editing a shader if you build some other way.
+#
+# The header is only rewritten when its content changes, so unchanged shaders don't trigger a rebuild.
+
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SHADER_DIR = os.path.join(ROOT, "res", "shaders")
+OUTPUT = os.path.join(ROOT, "src", "embedded_shaders.h")
+
+# MSVC rejects single string literals longer than 16KB, longer sources are split into adjacent literals.
+CHUNK_SIZE = 8192
+DELIMITER = "glsl"
+
+
+def shader_id(file_name):
+    return "SHADER_" + re.sub(r"[^0-9A-Za-z]", "_", file_name).upper()
+
+
+def literal(source):
+    if ")" + DELIMITER + '"' in source:
+        sys.exit("embed_shaders.py: shader source contains the raw string delimiter")
+    chunks = [source[i:i + CHUNK_SIZE] for i in range(0, len(source), CHUNK_SIZE)] or [""]
+    return "\n".join('R"{0}({1}){0}"'.format(DELIMITER, chunk) for chunk in chunks)
+
+
+def main():
+    names = sorted(f for f in os.listdir(SHADER_DIR) if os.path.isfile(os.path.join(SHADER_DIR, f)))
+
+    out = []
+    out.append("// Generated by tools/embed_shaders.py from res/shaders, do not edit by hand.")
+    out.append("")
+    out.append("#pragma once")
+    out.append("")
+    out.append("enum EmbeddedShaderID : int")
+    out.append("{")
+    out.append("\tEMBEDDED_SHADER_NONE = -1,")
+    for index, name in enumerate(names):
+        out.append("\t{} = {},".format(shader_id(name), index))
+    out.append("\tEMBEDDED_SHADER_COUNT = {}".format(len(names)))
+    out.append("};")
+    out.append("")
+    out.append("struct EmbeddedShader")
+    out.append("{")
+    out.append("\tconst char* path; // path the source was embedded from, relative to the project directory")
+    out.append("\tconst char* source;")
+    out.append("};")
+    out.append("")
+    out.append("inline constexpr EmbeddedShader embeddedShaders[EMBEDDED_SHADER_COUNT] = {")
+    for name in names:
+        with open(os.path.join(SHADER_DIR, name), "r", encoding="utf-8") as f:
+            source = f.read().replace("\r\n", "\n")
+        out.append('\t{{ "res/shaders/{}",'.format(name))
+        out.append(literal(source) + " },")
+    out.append("};")
+    out.append("")
+
+    content = "\n".join(out)
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT, "r", encoding="utf-8", newline="") as f:
+            if f.read() == content:
+                return
+    with open(OUTPUT, "w", encoding="utf-8", newline="") as f:
+        f.write(content)
+    print("embed_shaders.py: wrote {} shaders to {}".format(len(names), os.path.relpath(OUTPUT, ROOT)))
+
+
+if __name__ == "__main__":
+    main()